@@ -0,0 +1,504 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+
+#include <chrono>
+#include <vector>
+#include "chip8.h"
+#include "chip8_engine.h"
+#include "chip8_batch.h"
+
+#define internal static
+
+/* NOTE(koekeishiya): Name of the framebuffer layout the core is built with, so that results
+ * from before and after a layout change are not compared as if they were the same thing. */
+#define BENCH_LAYOUT "packed-rows-64"
+
+struct bench_rom
+{
+    const char *Name;
+    const char *Description;
+    std::vector<unsigned char> Data;
+};
+
+struct bench_result
+{
+    const char *Workload;
+    const char *Engine;
+    unsigned long long Cycles;
+    int Repetitions;
+    double MeanNanos;
+    double StddevNanos;
+    double MinNanos;
+    unsigned long long StateHash;
+};
+
+struct bench_options
+{
+    unsigned long long Cycles;
+    int Repetitions;
+    bool Json;
+    const char *Label;
+    const char *Engine;
+    const char *Workload;
+};
+
+internal unsigned long long
+GetTimeNanos()
+{
+    using namespace std::chrono;
+    return (duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())).count();
+}
+
+internal void
+Fatal(const char *Format, ...)
+{
+    va_list Args;
+    va_start(Args, Format);
+    vfprintf(stderr, Format, Args);
+    va_end(Args);
+    exit(1);
+}
+
+internal void
+Emit(bench_rom *Rom, unsigned short Opcode)
+{
+    Rom->Data.push_back(Opcode >> 8);
+    Rom->Data.push_back(Opcode & 0xFF);
+}
+
+internal unsigned short
+Here(bench_rom *Rom)
+{
+    return 0x200 + Rom->Data.size();
+}
+
+/* NOTE(koekeishiya): Every workload is an endless loop that never waits for keys or
+ * timers, so any number of cycles measures the same thing. */
+internal std::vector<bench_rom>
+GenerateRoms()
+{
+    std::vector<bench_rom> Roms;
+
+    {
+        bench_rom Rom = { "alu", "8XYn arithmetic and logic on all registers", {} };
+        for(int Index = 0; Index < 15; ++Index)
+            Emit(&Rom, 0x6000 | Index << 8 | (Index * 37 + 11));
+
+        unsigned short Loop = Here(&Rom);
+        for(int Index = 0; Index < 14; ++Index)
+        {
+            int X = Index, Y = Index + 1;
+            Emit(&Rom, 0x8004 | X << 8 | Y << 4);
+            Emit(&Rom, 0x8001 | Y << 8 | X << 4);
+            Emit(&Rom, 0x8005 | X << 8 | Y << 4);
+            Emit(&Rom, 0x8003 | Y << 8 | X << 4);
+            Emit(&Rom, 0x8007 | X << 8 | Y << 4);
+            Emit(&Rom, 0x8002 | Y << 8 | X << 4);
+            Emit(&Rom, 0x800E | X << 8 | Y << 4);
+            Emit(&Rom, 0x8006 | Y << 8 | X << 4);
+            Emit(&Rom, 0x7000 | X << 8 | 0x2B);
+        }
+        Emit(&Rom, 0x1000 | Loop);
+        Roms.push_back(Rom);
+    }
+
+    {
+        /* NOTE(koekeishiya): A chain of 12 nested subroutines, each doing a little work on
+         * the way in and out. */
+        bench_rom Rom = { "call", "2NNN/00EE chains 12 deep", {} };
+        const int Depth = 12;
+        unsigned short Main = Here(&Rom);
+        unsigned short First = Main + 4;
+        Emit(&Rom, 0x2000 | First);
+        Emit(&Rom, 0x1000 | Main);
+
+        for(int Level = 0; Level < Depth; ++Level)
+        {
+            unsigned short Next = Here(&Rom) + 8;
+            Emit(&Rom, 0x7001 | (Level & 0xF) << 8);
+            if(Level + 1 < Depth)
+                Emit(&Rom, 0x2000 | Next);
+            else
+                Emit(&Rom, 0x7101);
+            Emit(&Rom, 0x7201);
+            Emit(&Rom, 0x00EE);
+        }
+        Roms.push_back(Rom);
+    }
+
+    {
+        bench_rom Rom = { "sprite", "DXYN storms of 15 row sprites across the screen", {} };
+        Emit(&Rom, 0x6000);
+        Emit(&Rom, 0x6100);
+        Emit(&Rom, 0x6200);
+
+        unsigned short Loop = Here(&Rom);
+        Emit(&Rom, 0xF229);
+        Emit(&Rom, 0xD01F);
+        Emit(&Rom, 0x7005);
+        Emit(&Rom, 0xD01A);
+        Emit(&Rom, 0x7107);
+        Emit(&Rom, 0xD015);
+        Emit(&Rom, 0x7201);
+        Emit(&Rom, 0x320F);
+        Emit(&Rom, 0x1000 | Loop);
+        Emit(&Rom, 0x6200);
+        Emit(&Rom, 0x00E0);
+        Emit(&Rom, 0x1000 | Loop);
+        Roms.push_back(Rom);
+    }
+
+    {
+        /* NOTE(koekeishiya): Stores and loads go to 0x800-0x8FF, well away from the code, so
+         * engines that track self-modifying code only pay for the bookkeeping. */
+        bench_rom Rom = { "memory", "FX55/FX65 block stores and loads", {} };
+        Emit(&Rom, 0x6000);
+
+        unsigned short Loop = Here(&Rom);
+        Emit(&Rom, 0xA800);
+        Emit(&Rom, 0xF01E);
+        Emit(&Rom, 0xFF55);
+        Emit(&Rom, 0xFE65);
+        Emit(&Rom, 0xF755);
+        Emit(&Rom, 0xFF65);
+        Emit(&Rom, 0x7011);
+        Emit(&Rom, 0x1000 | Loop);
+        Roms.push_back(Rom);
+    }
+
+    {
+        bench_rom Rom = { "bcd", "FX33 conversions read back with FX65", {} };
+        Emit(&Rom, 0x6300);
+
+        unsigned short Loop = Here(&Rom);
+        Emit(&Rom, 0xA900);
+        Emit(&Rom, 0xF333);
+        Emit(&Rom, 0xF265);
+        Emit(&Rom, 0x8304);
+        Emit(&Rom, 0x7301);
+        Emit(&Rom, 0xF333);
+        Emit(&Rom, 0xF165);
+        Emit(&Rom, 0x1000 | Loop);
+        Roms.push_back(Rom);
+    }
+
+    {
+        /* NOTE(koekeishiya): Nothing but the sequences the fused engine runs as one dispatch:
+         * 6XNN;6YNN, ANNN;DXYN, a counted 7XNN;3XNN;1NNN loop and a 3XNN;1NNN that always
+         * takes the jump, since VF is 0 or 1 after DXYN. */
+        bench_rom Rom = { "fusion", "the four fused sequences in a loop", {} };
+        unsigned short Loop = Here(&Rom);
+        Emit(&Rom, 0x6305);
+        Emit(&Rom, 0x6100);
+        Emit(&Rom, 0xA000);
+        Emit(&Rom, 0xD341);
+
+        unsigned short Inner = Here(&Rom);
+        Emit(&Rom, 0x7101);
+        Emit(&Rom, 0x3108);
+        Emit(&Rom, 0x1000 | Inner);
+        Emit(&Rom, 0x3F02);
+        Emit(&Rom, 0x1000 | Loop);
+        Roms.push_back(Rom);
+    }
+
+    return Roms;
+}
+
+internal void
+LoadRom(chip8 *Processor, bench_rom *Rom)
+{
+    Chip8Initialize(Processor);
+    memcpy(Processor->Memory + 0x200, Rom->Data.data(), Rom->Data.size());
+}
+
+/* NOTE(koekeishiya): Everything an engine is responsible for, hashed, so that results
+ * from different engines can be checked to describe the same computation. */
+internal unsigned long long
+StateHash(chip8 *Processor)
+{
+    unsigned long long Hash = Chip8GraphicsHash(Processor);
+    unsigned char Bytes[22];
+    memcpy(Bytes, Processor->V, 16);
+    Bytes[16] = Processor->I & 0xFF;
+    Bytes[17] = Processor->I >> 8;
+    Bytes[18] = Processor->Pc & 0xFF;
+    Bytes[19] = Processor->Pc >> 8;
+    Bytes[20] = Processor->Sp & 0xFF;
+    Bytes[21] = Processor->Sp >> 8;
+
+    for(int Index = 0; Index < 22; ++Index)
+    {
+        Hash ^= Bytes[Index];
+        Hash *= 0x100000001B3ULL;
+    }
+
+    return Hash;
+}
+
+/* NOTE(koekeishiya): An engine, or a batch with every lane running the rom, and the machine
+ * it runs. It is created once per workload and engine, so that the untimed warm-up pays
+ * for compiling and caching and the timed runs do not. Every run continues where the last
+ * one stopped, which measures the same thing since no workload ever ends. */
+struct bench_machine
+{
+    chip8 *Processor;
+    chip8_engine Engine;
+    chip8_batch *Batch;
+};
+
+internal void
+CreateMachine(bench_machine *Machine, bench_rom *Rom, const char *EngineName)
+{
+    Machine->Processor = (chip8 *) malloc(sizeof(chip8));
+    if(!Machine->Processor)
+        Fatal("Failed to allocate chip8\n");
+
+    LoadRom(Machine->Processor, Rom);
+    Machine->Batch = NULL;
+
+    if(strcmp(EngineName, "batch") == 0)
+    {
+        Machine->Batch = Chip8BatchCreate();
+        if(!Machine->Batch)
+            Fatal("Failed to create batch\n");
+
+        for(int Lane = 0; Lane < CHIP8_BATCH_LANES; ++Lane)
+            Chip8BatchSetLane(Machine->Batch, Lane, Machine->Processor);
+    }
+    else
+    {
+        chip8_engine_type Type;
+        if(!Chip8EngineFromName(EngineName, &Type) || !Chip8EngineCreate(&Machine->Engine, Type))
+            Fatal("Failed to create %s engine\n", EngineName);
+    }
+}
+
+internal void
+DestroyMachine(bench_machine *Machine)
+{
+    if(Machine->Batch)
+        Chip8BatchDestroy(Machine->Batch);
+    else
+        Chip8EngineDestroy(&Machine->Engine);
+
+    free(Machine->Processor);
+}
+
+/* NOTE(koekeishiya): Time one run of Cycles instructions, for the batch engine spread over
+ * all lanes. Returns nanoseconds per instruction. */
+internal double
+RunOnce(bench_machine *Machine, unsigned long long Cycles)
+{
+    unsigned long long Elapsed;
+    if(Machine->Batch)
+    {
+        unsigned long long PerLane = Cycles / CHIP8_BATCH_LANES;
+        unsigned long long Start = GetTimeNanos();
+        Chip8BatchRun(Machine->Batch, PerLane);
+        Elapsed = GetTimeNanos() - Start;
+        Cycles = PerLane * CHIP8_BATCH_LANES;
+    }
+    else
+    {
+        unsigned long long Start = GetTimeNanos();
+        Chip8EngineRun(&Machine->Engine, Machine->Processor, Cycles);
+        Elapsed = GetTimeNanos() - Start;
+    }
+
+    return (double) Elapsed / Cycles;
+}
+
+internal bench_result
+Measure(bench_rom *Rom, const char *EngineName, bench_options *Options)
+{
+    bench_result Result = {};
+    Result.Workload = Rom->Name;
+    Result.Engine = EngineName;
+    Result.Cycles = Options->Cycles;
+    Result.Repetitions = Options->Repetitions;
+
+    bench_machine Machine;
+    CreateMachine(&Machine, Rom, EngineName);
+
+    /* NOTE(koekeishiya): One untimed run to compile, fault in code and data and warm the
+     * caches. */
+    RunOnce(&Machine, Options->Cycles / 10 + CHIP8_BATCH_LANES);
+
+    double Sum = 0, SumSquares = 0, Min = 1E30;
+    for(int Repetition = 0; Repetition < Options->Repetitions; ++Repetition)
+    {
+        double Nanos = RunOnce(&Machine, Options->Cycles);
+        Sum += Nanos;
+        SumSquares += Nanos * Nanos;
+        if(Nanos < Min)
+            Min = Nanos;
+    }
+
+    if(Machine.Batch)
+        Chip8BatchGetLane(Machine.Batch, 0, Machine.Processor);
+
+    Result.StateHash = StateHash(Machine.Processor);
+    DestroyMachine(&Machine);
+
+    int Count = Options->Repetitions;
+    Result.MeanNanos = Sum / Count;
+    Result.StddevNanos = Count > 1 ? sqrt((SumSquares - Sum * Sum / Count) / (Count - 1)) : 0.0;
+    if(Result.StddevNanos != Result.StddevNanos)
+        Result.StddevNanos = 0.0;
+    Result.MinNanos = Min;
+    return Result;
+}
+
+/* NOTE(koekeishiya): Print Text as the inside of a JSON string. */
+internal void
+PrintJsonString(const char *Text)
+{
+    for(const char *At = Text; *At; ++At)
+    {
+        unsigned char Char = (unsigned char) *At;
+        if(Char == '"' || Char == '\\')
+            printf("\\%c", Char);
+        else if(Char < 0x20)
+            printf("\\u%04x", Char);
+        else
+            putchar(Char);
+    }
+}
+
+internal void
+PrintUsage()
+{
+    Fatal("Usage: chip8-bench [-cycles N] [-reps N] [-engine E] [-workload W] [-label L] [-json]\n"
+          "  -cycles N    instructions per timed run (default: 20000000)\n"
+          "  -reps N      timed runs per workload and engine (default: 5)\n"
+          "  -engine E    only this engine: interpreter, cached, fused, jit or batch\n"
+          "  -workload W  only this workload: alu, call, sprite, memory, bcd or fusion\n"
+          "  -label L     free-form label stored with the results, e.g. a commit hash\n"
+          "  -json        print results as JSON instead of a table\n");
+}
+
+int main(int argc, char **argv)
+{
+    bench_options Options = {};
+    Options.Cycles = 20000000;
+    Options.Repetitions = 5;
+    Options.Label = "";
+
+    for(int Index = 1; Index < argc; ++Index)
+    {
+        const char *Arg = argv[Index];
+        bool HasValue = Index + 1 < argc;
+
+        if(strcmp(Arg, "-cycles") == 0 && HasValue)
+            Options.Cycles = strtoull(argv[++Index], NULL, 10);
+        else if(strcmp(Arg, "-reps") == 0 && HasValue)
+            Options.Repetitions = atoi(argv[++Index]);
+        else if(strcmp(Arg, "-engine") == 0 && HasValue)
+            Options.Engine = argv[++Index];
+        else if(strcmp(Arg, "-workload") == 0 && HasValue)
+            Options.Workload = argv[++Index];
+        else if(strcmp(Arg, "-label") == 0 && HasValue)
+            Options.Label = argv[++Index];
+        else if(strcmp(Arg, "-json") == 0)
+            Options.Json = true;
+        else
+            PrintUsage();
+    }
+
+    if(Options.Cycles < CHIP8_BATCH_LANES || Options.Repetitions < 1)
+        PrintUsage();
+
+    /* NOTE(koekeishiya): jit-lockstep is a debugging aid and would only measure the
+     * interpreter twice over. */
+    const char *Engines[] = { "interpreter", "cached", "fused", "jit", "batch" };
+    std::vector<bench_rom> Roms = GenerateRoms();
+    std::vector<bench_result> Results;
+
+    if(Options.Engine)
+    {
+        bool Known = false;
+        for(size_t EngineIndex = 0; EngineIndex < sizeof(Engines) / sizeof(Engines[0]); ++EngineIndex)
+            Known |= strcmp(Options.Engine, Engines[EngineIndex]) == 0;
+
+        if(!Known)
+            PrintUsage();
+    }
+
+    if(Options.Workload)
+    {
+        bool Known = false;
+        for(size_t RomIndex = 0; RomIndex < Roms.size(); ++RomIndex)
+            Known |= strcmp(Options.Workload, Roms[RomIndex].Name) == 0;
+
+        if(!Known)
+            PrintUsage();
+    }
+
+    for(size_t RomIndex = 0; RomIndex < Roms.size(); ++RomIndex)
+    {
+        bench_rom *Rom = &Roms[RomIndex];
+        if(Options.Workload && strcmp(Options.Workload, Rom->Name) != 0)
+            continue;
+
+        for(size_t EngineIndex = 0; EngineIndex < sizeof(Engines) / sizeof(Engines[0]); ++EngineIndex)
+        {
+            const char *Engine = Engines[EngineIndex];
+            if(Options.Engine && strcmp(Options.Engine, Engine) != 0)
+                continue;
+
+            Results.push_back(Measure(Rom, Engine, &Options));
+            if(!Options.Json)
+            {
+                bench_result *Result = &Results.back();
+                printf("%-8s %-12s %8.3f ns/instr  %7.1f M instr/s  +-%5.1f%%  min %8.3f ns  state %016llx\n",
+                       Result->Workload, Result->Engine, Result->MeanNanos, 1E3 / Result->MeanNanos,
+                       100.0 * Result->StddevNanos / Result->MeanNanos, Result->MinNanos, Result->StateHash);
+                fflush(stdout);
+            }
+        }
+    }
+
+    /* NOTE(koekeishiya): The batch engine runs the rom in every lane for Cycles / lanes
+     * cycles, so its state is compared against nothing. All other engines must agree. */
+    int Mismatches = 0;
+    for(size_t Index = 0; Index < Results.size(); ++Index)
+    {
+        for(size_t Other = 0; Other < Index; ++Other)
+        {
+            bench_result *A = &Results[Index], *B = &Results[Other];
+            if(strcmp(A->Workload, B->Workload) == 0 && strcmp(A->Engine, "batch") != 0 &&
+               strcmp(B->Engine, "batch") != 0 && A->StateHash != B->StateHash)
+            {
+                fprintf(stderr, "%s: %s and %s ended in different states\n", A->Workload, A->Engine, B->Engine);
+                ++Mismatches;
+            }
+        }
+    }
+
+    if(Options.Json)
+    {
+        printf("{\n  \"label\": \"");
+        PrintJsonString(Options.Label);
+        printf("\",\n  \"layout\": \"%s\",\n  \"cycles\": %llu,\n  \"repetitions\": %d,\n  \"results\": [",
+               BENCH_LAYOUT, Options.Cycles, Options.Repetitions);
+
+        for(size_t Index = 0; Index < Results.size(); ++Index)
+        {
+            bench_result *Result = &Results[Index];
+            printf("%s\n    {\"workload\": \"%s\", \"engine\": \"%s\", \"ns_per_instruction\": %.4f, "
+                   "\"instructions_per_second\": %.0f, \"stddev_ns\": %.4f, \"variance_ns2\": %.6f, \"min_ns\": %.4f, "
+                   "\"state_hash\": \"%016llx\"}",
+                   Index ? "," : "", Result->Workload, Result->Engine, Result->MeanNanos,
+                   1E9 / Result->MeanNanos, Result->StddevNanos, Result->StddevNanos * Result->StddevNanos,
+                   Result->MinNanos, Result->StateHash);
+        }
+
+        printf("\n  ]\n}\n");
+    }
+
+    return Mismatches ? 1 : 0;
+}
@@ -1,15 +1,14 @@
 #include "chip8.h"
+#include "chip8_debug.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
-#include <time.h>
-#include <math.h>
 
 #define internal static
-#define DISPLAY_LENGTH (DISPLAY_WIDTH * DISPLAY_HEIGHT)
+#define force_inline inline __attribute__((always_inline))
 
-static unsigned char Chip8Font[80] =
+const unsigned char Chip8Font[CHIP8_FONT_SIZE] =
 {
     0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
     0x20, 0x60, 0x20, 0x20, 0x70, // 1
@@ -38,33 +37,104 @@ void Chip8Initialize(chip8 *Processor)
     Processor->Pc = 0x200;
     memcpy(Processor->Memory, Chip8Font, sizeof(Chip8Font));
 
-    srand(time(NULL));
+    /* NOTE(koekeishiya): The renderer has not seen the cleared screen yet. */
+    Processor->DirtyRows = 0xFFFFFFFF;
+
+    Chip8Seed(Processor, 0);
 }
 
-bool Chip8LoadRom(chip8 *Processor, const char *Rom)
+unsigned long long Chip8RandomState(unsigned long long Seed)
 {
-    FILE *FileHandle = fopen(Rom, "rb");
-    unsigned int Length = 0;
+    /* NOTE(koekeishiya): Run the seed through splitmix64 so that small or similar seeds
+     * still give unrelated streams, and so the xorshift state can never be zero. */
+    unsigned long long Z = Seed + 0x9E3779B97F4A7C15ULL;
+    Z = (Z ^ (Z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    Z = (Z ^ (Z >> 27)) * 0x94D049BB133111EBULL;
+    Z = Z ^ (Z >> 31);
+
+    return Z ? Z : 0x9E3779B97F4A7C15ULL;
+}
+
+void Chip8Seed(chip8 *Processor, unsigned long long Seed)
+{
+    Processor->RandomState = Chip8RandomState(Seed);
+}
+
+static const char *Chip8QuirksNames[Chip8Quirks_Count] =
+{
+    "default",
+    "chip8",
+    "chip48",
+    "schip",
+    "xochip",
+};
 
-    if(FileHandle)
+void Chip8SetQuirks(chip8 *Processor, chip8_quirks Quirks)
+{
+    Processor->Quirks = Quirks < Chip8Quirks_Count ? Quirks : Chip8Quirks_Default;
+}
+
+const char *Chip8QuirksName(chip8_quirks Quirks)
+{
+    return Quirks < Chip8Quirks_Count ? Chip8QuirksNames[Quirks] : "unknown";
+}
+
+bool Chip8QuirksFromName(const char *Name, chip8_quirks *Quirks)
+{
+    for(int Index = 0; Index < Chip8Quirks_Count; ++Index)
     {
-        fseek(FileHandle, 0, SEEK_END);
-        Length = ftell(FileHandle);
-        fseek(FileHandle, 0, SEEK_SET);
-        fread(Processor->Memory + 0x200, Length, 1, FileHandle);
-        fclose(FileHandle);
-        return true;
+        if(strcmp(Name, Chip8QuirksNames[Index]) == 0)
+        {
+            *Quirks = (chip8_quirks) Index;
+            return true;
+        }
     }
-    else
-    {
+
+    return false;
+}
+
+bool Chip8LoadRom(chip8 *Processor, const char *Rom)
+{
+    FILE *FileHandle = fopen(Rom, "rb");
+    if(!FileHandle)
         return false;
-    }
+
+    /* NOTE(koekeishiya): Read one byte more than fits to notice roms that are too long. */
+    unsigned char Buffer[CHIP8_ROM_CAPACITY + 1];
+    size_t Length = fread(Buffer, 1, sizeof(Buffer), FileHandle);
+    bool Failed = ferror(FileHandle) != 0;
+    fclose(FileHandle);
+
+    return !Failed && Chip8LoadRomImage(Processor, Buffer, (unsigned int) Length);
 }
 
-void Chip8DoCycle(chip8 *Processor)
+bool Chip8LoadRomImage(chip8 *Processor, const unsigned char *Data, unsigned int Size)
 {
-    Processor->Opcode = Processor->Memory[Processor->Pc] << 8 |
-                        Processor->Memory[Processor->Pc + 1];
+    if(Size == 0 || Size > CHIP8_ROM_CAPACITY)
+        return false;
+
+    memcpy(Processor->Memory + 0x200, Data, Size);
+    return true;
+}
+
+/* NOTE(koekeishiya): Every quirk check below compares a constant against a constant, so
+ * the compiler drops the branch and each specialization only contains its own behaviour.
+ * The same goes for Debug: only Chip8StepDebug reports memory accesses to the debugger,
+ * Chip8Step compiles to exactly what it would without them. */
+#define WATCH(Address, Access) if(Debug) Chip8DebugAccess(Debugger, (Address) & 0xFFF, Access)
+
+template<int Quirks, bool Debug> internal force_inline void
+Chip8Execute(chip8 *Processor, chip8_debugger *Debugger)
+{
+    const chip8_quirk_set &Quirk = Chip8QuirkSets[Quirks];
+
+    Processor->Opcode = Processor->Memory[Processor->Pc & 0xFFF] << 8 |
+                        Processor->Memory[(Processor->Pc + 1) & 0xFFF];
+
+#ifdef CHIP8_PROFILE
+    if(Processor->Profile)
+        Chip8ProfileInstruction(Processor->Profile, Processor->Pc, Processor->Opcode);
+#endif
 
     Processor->Pc += 2;
     unsigned short X = (Processor->Opcode & 0x0F00) >> 8;
@@ -79,12 +149,13 @@ void Chip8DoCycle(chip8 *Processor)
             {
                 case 0x00E0: // 00E0: Clears the screen.
                 {
-                    memset(Processor->Graphics, 0, DISPLAY_LENGTH);
+                    memset(Processor->Graphics, 0, sizeof(Processor->Graphics));
+                    Processor->DirtyRows = 0xFFFFFFFF;
                     Processor->Draw = true;
                 } break;
                 case 0x00EE: // 00EE: Returns from subroutine.
                 {
-                    Processor->Pc = Processor->Stack[--Processor->Sp];
+                    Processor->Pc = Processor->Stack[--Processor->Sp & 0xF];
                 } break;
                 default: // 0NNN: Calls RCA 1802 program at address NNN. Not necessary for most ROMs.
                 {
@@ -97,7 +168,7 @@ void Chip8DoCycle(chip8 *Processor)
         } break;
         case 0x2000: // 2NNN: Calls subroutine at address NNN.
         {
-            Processor->Stack[Processor->Sp++] = Processor->Pc;
+            Processor->Stack[Processor->Sp++ & 0xF] = Processor->Pc;
             Processor->Pc = Processor->Opcode & 0x0FFF;
         } break;
         case 0x3000: // 3XNN: Skips the next instruction if VX equals NN.
@@ -134,63 +205,53 @@ void Chip8DoCycle(chip8 *Processor)
                 case 0x0001: // 8XY1: Sets VX to VX or VY.
                 {
                     Processor->V[X] |= Processor->V[Y];
+                    if(Quirk.LogicResetsVF)
+                        Processor->V[0xF] = 0;
                 } break;
                 case 0x0002: // 8XY2: Sets VX to VX and VY.
                 {
                     Processor->V[X] &= Processor->V[Y];
+                    if(Quirk.LogicResetsVF)
+                        Processor->V[0xF] = 0;
                 } break;
                 case 0x0003: // 8XY3: Sets VX to VX xor VY.
                 {
                     Processor->V[X] ^= Processor->V[Y];
+                    if(Quirk.LogicResetsVF)
+                        Processor->V[0xF] = 0;
                 } break;
+
+                /* NOTE(koekeishiya): The arithmetic instructions write VF after VX, so that
+                 * with X = F the flag is what remains. */
                 case 0x0004: // 8XY4: Adds VY to VX. VF is set to 1 when there is a carry.
                 {
-                    Processor->V[0xF] = 0;
                     unsigned short Sum = Processor->V[X] + Processor->V[Y];
-
-                    if(Sum > 255)
-                    {
-                        Processor->V[0xF] = 1;
-                        Sum -= 256;
-                    }
-
-                    Processor->V[X] = Sum;
+                    Processor->V[X] = Sum & 0xFF;
+                    Processor->V[0xF] = Sum > 255;
                 } break;
                 case 0x0005: // 8XY5: VY is subtracted from VX. VF is set to 0 when borrow.
                 {
-                    Processor->V[0xF] = 1;
-                    short Diff = Processor->V[X] - Processor->V[Y];
-
-                    if(Diff < 0)
-                    {
-                        Processor->V[0xF] = 0;
-                        Diff += 256;
-                    }
-
-                    Processor->V[X] = Diff;
+                    unsigned char NoBorrow = Processor->V[X] >= Processor->V[Y];
+                    Processor->V[X] -= Processor->V[Y];
+                    Processor->V[0xF] = NoBorrow;
                 } break;
-                case 0x0006: // 8XY6: Shifts VX right by one. VF is set to value of least sig bit before shift.
+                case 0x0006: // 8XY6: Shifts VX (or VY) right by one into VX. VF is set to value of least sig bit before shift.
                 {
-                    Processor->V[0xF] = Processor->V[X] & 0x1;
-                    Processor->V[X] >>= 1;
+                    unsigned char Source = Quirk.ShiftReadsVY ? Processor->V[Y] : Processor->V[X];
+                    Processor->V[X] = Source >> 1;
+                    Processor->V[0xF] = Source & 0x1;
                 } break;
                 case 0x0007: // 8XY7: Sets VX to VY minus VX. VF is set to 0 when borrow.
                 {
-                    Processor->V[0xF] = 1;
-                    short Diff = Processor->V[Y] - Processor->V[X];
-
-                    if(Diff < 0)
-                    {
-                        Processor->V[0xF] = 0;
-                        Diff += 256;
-                    }
-
-                    Processor->V[X] = Diff;
+                    unsigned char NoBorrow = Processor->V[Y] >= Processor->V[X];
+                    Processor->V[X] = Processor->V[Y] - Processor->V[X];
+                    Processor->V[0xF] = NoBorrow;
                 } break;
-                case 0x000E: // 8XYE: Shifts VX left by one. VF is set to value of most sig bit before shift.
+                case 0x000E: // 8XYE: Shifts VX (or VY) left by one into VX. VF is set to value of most sig bit before shift.
                 {
-                    Processor->V[0xF] = Processor->V[X] & 0x80;
-                    Processor->V[X] <<= 1;
+                    unsigned char Source = Quirk.ShiftReadsVY ? Processor->V[Y] : Processor->V[X];
+                    Processor->V[X] = Source << 1;
+                    Processor->V[0xF] = Source >> 7;
                 } break;
             }
         } break;
@@ -203,35 +264,53 @@ void Chip8DoCycle(chip8 *Processor)
         {
             Processor->I = Processor->Opcode & 0x0FFF;
         } break;
-        case 0xB000: // BNNN: Jump to address NNN plus V0.
+        case 0xB000: // BNNN: Jump to address NNN plus V0, or BXNN: to XNN plus VX.
         {
-            Processor->Pc = (Processor->Opcode & 0x0FFF) + Processor->V[0];
+            Processor->Pc = (Processor->Opcode & 0x0FFF) + Processor->V[Quirk.JumpUsesVX ? X : 0];
         } break;
         case 0xC000: // CXNN: Sets VX to the result of bitwise and on a random number and NN.
         {
-            Processor->V[X] = floor((rand() % 0xFF) & (Processor->Opcode & 0x00FF));
+            Processor->V[X] = Chip8NextRandom(&Processor->RandomState) & (Processor->Opcode & 0x00FF);
         } break;
         case 0xD000: // DXYN: Display sprite starting at memory location I, set VF equal to collision.
         {
+            /* NOTE(koekeishiya): The starting position wraps around the screen, but the
+             * parts of a sprite that extend past the right or bottom edge are clipped. */
+#ifdef CHIP8_PROFILE
+            if(Processor->Profile)
+                ++Processor->Profile->DrawCalls;
+#endif
+
             Processor->V[0xF] = 0;
-            unsigned short RegisterX = Processor->V[X];
-            unsigned short RegisterY = Processor->V[Y];
+            unsigned short RegisterX = Processor->V[X] % DISPLAY_WIDTH;
+            unsigned short RegisterY = Processor->V[Y] % DISPLAY_HEIGHT;
             unsigned short Height = Processor->Opcode & 0x000F;
 
-            for(int Col = 0; Col < Height; ++Col)
+            if(Height > DISPLAY_HEIGHT - RegisterY)
+                Height = DISPLAY_HEIGHT - RegisterY;
+
+            for(int Row = 0; Row < Height; ++Row)
             {
-                unsigned short Pixel = Processor->Memory[Processor->I + Col];
-                for(int Row = 0; Row < 8; ++Row)
-                {
-                    if((Pixel & (0x80 >> Row)) != 0)
-                    {
-                        unsigned short Location = RegisterX + Row + ((RegisterY + Col) * DISPLAY_WIDTH);
-                        if(Processor->Graphics[Location] == 1)
-                            Processor->V[0xF] = 1;
+                WATCH(Processor->I + Row, Chip8Watch_Read);
+                unsigned long long Sprite = Processor->Memory[(Processor->I + Row) & 0xFFF];
+                unsigned long long Bits = (Sprite << (DISPLAY_WIDTH - 8)) >> RegisterX;
+                unsigned long long *Line = Processor->Graphics + RegisterY + Row;
 
-                        Processor->Graphics[Location] ^= 1;
-                    }
+                if(*Line & Bits)
+                    Processor->V[0xF] = 1;
+
+                if(Bits)
+                    Processor->DirtyRows |= 1u << (RegisterY + Row);
+
+#ifdef CHIP8_PROFILE
+                if(Processor->Profile)
+                {
+                    Processor->Profile->PixelsTouched += __builtin_popcountll(Bits);
+                    Processor->Profile->PixelsErased += __builtin_popcountll(*Line & Bits);
                 }
+#endif
+
+                *Line ^= Bits;
             }
 
             Processor->Draw = true;
@@ -240,14 +319,15 @@ void Chip8DoCycle(chip8 *Processor)
         {
             switch(Processor->Opcode & 0x00FF)
             {
+                /* NOTE(koekeishiya): There are 16 keys, only the low nibble of VX is used. */
                 case 0x009E: // EX9E: Skips the next instruction if the key stored in VX is pressed.
                 {
-                    if(Processor->Key[Processor->V[X]] == 1)
+                    if(Processor->Key[Processor->V[X] & 0xF] == 1)
                         Processor->Pc += 2;
                 } break;
                 case 0x00A1: // EXA1: Skips the next instruction if the key stored in VX is not pressed.
                 {
-                    if(Processor->Key[Processor->V[X]] != 1)
+                    if(Processor->Key[Processor->V[X] & 0xF] != 1)
                         Processor->Pc += 2;
                 } break;
             }
@@ -294,24 +374,39 @@ void Chip8DoCycle(chip8 *Processor)
                 {
                     Processor->I = Processor->V[X] * 5;
                 } break;
+                /* NOTE(koekeishiya): I is 16 bits wide and FX1E or the index quirks can move it
+                 * past the end of Memory, so the addresses wrap around like those of DXYN. */
                 case 0x0033: // FX33: Stores BCD representation of VX, with 3 digits, in memory at location I.
                 {
                     unsigned char Digit = Processor->V[X];
                     for(int Index = 3; Index > 0; --Index)
                     {
-                        Processor->Memory[Processor->I + Index - 1] = Digit % 10;
+                        WATCH(Processor->I + Index - 1, Chip8Watch_Write);
+                        Processor->Memory[(Processor->I + Index - 1) & 0xFFF] = Digit % 10;
                         Digit /= 10;
                     }
                 } break;
                 case 0x0055: // FX55: Store registers V0 through VX in memory at location I.
                 {
                     for(int Index = 0; Index <= X; ++Index)
-                        Processor->Memory[Processor->I + Index] = Processor->V[Index];
+                    {
+                        WATCH(Processor->I + Index, Chip8Watch_Write);
+                        Processor->Memory[(Processor->I + Index) & 0xFFF] = Processor->V[Index];
+                    }
+
+                    if(Quirk.IndexAdvance != Chip8Index_Unchanged)
+                        Processor->I += X + (Quirk.IndexAdvance == Chip8Index_PlusXPlusOne);
                 } break;
                 case 0x0065: // FX65: Read registers V0 through VX from memory at location I.
                 {
                     for(int Index = 0; Index <= X; ++Index)
-                        Processor->V[Index] = Processor->Memory[Processor->I + Index];
+                    {
+                        WATCH(Processor->I + Index, Chip8Watch_Read);
+                        Processor->V[Index] = Processor->Memory[(Processor->I + Index) & 0xFFF];
+                    }
+
+                    if(Quirk.IndexAdvance != Chip8Index_Unchanged)
+                        Processor->I += X + (Quirk.IndexAdvance == Chip8Index_PlusXPlusOne);
                 } break;
             }
         } break;
@@ -321,3 +416,244 @@ void Chip8DoCycle(chip8 *Processor)
         } break;
     }
 }
+
+#undef WATCH
+
+template<int Quirks> void Chip8Step(chip8 *Processor)
+{
+    Chip8Execute<Quirks, false>(Processor, NULL);
+}
+
+template<int Quirks> void Chip8StepDebug(chip8 *Processor, chip8_debugger *Debugger)
+{
+    Chip8Execute<Quirks, true>(Processor, Debugger);
+}
+
+template void Chip8Step<Chip8Quirks_Default>(chip8 *Processor);
+template void Chip8Step<Chip8Quirks_Chip8>(chip8 *Processor);
+template void Chip8Step<Chip8Quirks_Chip48>(chip8 *Processor);
+template void Chip8Step<Chip8Quirks_Schip>(chip8 *Processor);
+template void Chip8Step<Chip8Quirks_XoChip>(chip8 *Processor);
+
+template void Chip8StepDebug<Chip8Quirks_Default>(chip8 *Processor, chip8_debugger *Debugger);
+template void Chip8StepDebug<Chip8Quirks_Chip8>(chip8 *Processor, chip8_debugger *Debugger);
+template void Chip8StepDebug<Chip8Quirks_Chip48>(chip8 *Processor, chip8_debugger *Debugger);
+template void Chip8StepDebug<Chip8Quirks_Schip>(chip8 *Processor, chip8_debugger *Debugger);
+template void Chip8StepDebug<Chip8Quirks_XoChip>(chip8 *Processor, chip8_debugger *Debugger);
+
+void Chip8DoCycle(chip8 *Processor)
+{
+    switch(Processor->Quirks)
+    {
+        case Chip8Quirks_Chip8: Chip8Step<Chip8Quirks_Chip8>(Processor); break;
+        case Chip8Quirks_Chip48: Chip8Step<Chip8Quirks_Chip48>(Processor); break;
+        case Chip8Quirks_Schip: Chip8Step<Chip8Quirks_Schip>(Processor); break;
+        case Chip8Quirks_XoChip: Chip8Step<Chip8Quirks_XoChip>(Processor); break;
+        default: Chip8Step<Chip8Quirks_Default>(Processor); break;
+    }
+}
+
+template<int Quirks> internal void
+Chip8RunSpecialized(chip8 *Processor, unsigned long long Cycles)
+{
+    while(Cycles--)
+        Chip8Step<Quirks>(Processor);
+}
+
+void Chip8RunCycles(chip8 *Processor, unsigned long long Cycles)
+{
+    switch(Processor->Quirks)
+    {
+        case Chip8Quirks_Chip8: Chip8RunSpecialized<Chip8Quirks_Chip8>(Processor, Cycles); break;
+        case Chip8Quirks_Chip48: Chip8RunSpecialized<Chip8Quirks_Chip48>(Processor, Cycles); break;
+        case Chip8Quirks_Schip: Chip8RunSpecialized<Chip8Quirks_Schip>(Processor, Cycles); break;
+        case Chip8Quirks_XoChip: Chip8RunSpecialized<Chip8Quirks_XoChip>(Processor, Cycles); break;
+        default: Chip8RunSpecialized<Chip8Quirks_Default>(Processor, Cycles); break;
+    }
+}
+
+void Chip8TickTimers(chip8 *Processor)
+{
+    if(Processor->DelayTimer > 0)
+        --Processor->DelayTimer;
+
+    if(Processor->SoundTimer > 0)
+        --Processor->SoundTimer;
+}
+
+/* NOTE(koekeishiya): Execute one instruction on the probe, mirroring Chip8DoCycle. Returns
+ * false for every instruction that could make the loop anything but idle. */
+internal bool
+Chip8ProbeStep(chip8_idle_probe *Probe, bool *ReadsKey, bool *ReadsTimer)
+{
+    if(Probe->Pc > 0xFFE)
+        return false;
+
+    unsigned short Opcode = Probe->Memory[Probe->Pc] << 8 | Probe->Memory[Probe->Pc + 1];
+    unsigned short X = (Opcode & 0x0F00) >> 8;
+    unsigned short Y = (Opcode & 0x00F0) >> 4;
+    unsigned char NN = Opcode & 0x00FF;
+    unsigned char *V = Probe->V;
+
+    Probe->Opcode = Opcode;
+    Probe->Pc += 2;
+
+    switch(Opcode & 0xF000)
+    {
+        case 0x1000: Probe->Pc = Opcode & 0x0FFF; break;
+        case 0x3000: if(V[X] == NN) Probe->Pc += 2; break;
+        case 0x4000: if(V[X] != NN) Probe->Pc += 2; break;
+        case 0x5000: if(V[X] == V[Y]) Probe->Pc += 2; break;
+        case 0x6000: V[X] = NN; break;
+        case 0x7000: V[X] += NN; break;
+        case 0x8000:
+        {
+            switch(Opcode & 0x000F)
+            {
+                case 0x0000: V[X] = V[Y]; break;
+                case 0x0001: V[X] |= V[Y]; break;
+                case 0x0002: V[X] &= V[Y]; break;
+                case 0x0003: V[X] ^= V[Y]; break;
+                default: return false;
+            }
+
+            if((Opcode & 0x000F) != 0x0000 && Chip8QuirkSets[Probe->Quirks].LogicResetsVF)
+                V[0xF] = 0;
+        } break;
+        case 0x9000: if(V[X] != V[Y]) Probe->Pc += 2; break;
+        case 0xA000: Probe->I = Opcode & 0x0FFF; break;
+        case 0xE000:
+        {
+            if(V[X] > 0xF)
+                return false;
+
+            *ReadsKey = true;
+            if(NN == 0x9E)
+            {
+                if(Probe->Key[V[X]] == 1)
+                    Probe->Pc += 2;
+            }
+            else if(NN == 0xA1)
+            {
+                if(Probe->Key[V[X]] != 1)
+                    Probe->Pc += 2;
+            }
+        } break;
+        case 0xF000:
+        {
+            switch(NN)
+            {
+                case 0x07:
+                {
+                    *ReadsTimer = true;
+                    V[X] = Probe->DelayTimer;
+                } break;
+                case 0x0A:
+                {
+                    *ReadsKey = true;
+                    bool Keypress = false;
+                    for(int Index = 0; Index < 16; ++Index)
+                    {
+                        if(Probe->Key[Index] == 1)
+                        {
+                            V[X] = Index;
+                            Keypress = true;
+                        }
+                    }
+
+                    if(!Keypress)
+                        Probe->Pc -= 2;
+                } break;
+                case 0x1E: Probe->I += V[X]; break;
+                case 0x29: Probe->I = V[X] * 5; break;
+                default: return false;
+            }
+        } break;
+        default: return false;
+    }
+
+    return true;
+}
+
+internal bool
+Chip8ProbeEqual(chip8_idle_probe *A, chip8_idle_probe *B)
+{
+    return A->Pc == B->Pc && A->I == B->I && A->Opcode == B->Opcode &&
+           memcmp(A->V, B->V, sizeof(A->V)) == 0;
+}
+
+chip8_idle Chip8ProbeIdle(chip8_idle_probe *Probe, unsigned int MaxPeriod)
+{
+    chip8_idle Idle = {};
+    unsigned short Start = Probe->Pc;
+    bool ReadsKey = false;
+    bool ReadsTimer = false;
+
+    /* NOTE(koekeishiya): Run until the loop is back at the starting pc. The instructions up
+     * to that point may still differ from later rounds, e.g. the first FX07 overwrites an
+     * unrelated value, so a second round has to end in exactly the same state. If it does,
+     * the state repeats every Period instructions from then on. */
+    unsigned int Period = 0;
+    do
+    {
+        if(++Period > MaxPeriod || !Chip8ProbeStep(Probe, &ReadsKey, &ReadsTimer))
+            return Idle;
+    } while(Probe->Pc != Start);
+
+    chip8_idle_probe First = *Probe;
+    for(unsigned int Step = 0; Step < Period; ++Step)
+    {
+        if(!Chip8ProbeStep(Probe, &ReadsKey, &ReadsTimer))
+            return Idle;
+    }
+
+    if(!Chip8ProbeEqual(Probe, &First))
+        return Idle;
+
+    Idle.Type = ReadsTimer ? Chip8Idle_Timer : ReadsKey ? Chip8Idle_Key : Chip8Idle_Halt;
+    Idle.Period = Period;
+    return Idle;
+}
+
+chip8_idle Chip8DetectIdle(chip8 *Processor, unsigned int MaxPeriod)
+{
+    chip8_idle_probe Probe;
+    Probe.Memory = Processor->Memory;
+    Probe.Key = Processor->Key;
+    memcpy(Probe.V, Processor->V, sizeof(Probe.V));
+    Probe.Pc = Processor->Pc;
+    Probe.I = Processor->I;
+    Probe.Opcode = Processor->Opcode;
+    Probe.DelayTimer = Processor->DelayTimer;
+    Probe.Quirks = Processor->Quirks;
+
+    return Chip8ProbeIdle(&Probe, MaxPeriod);
+}
+
+unsigned long long Chip8GraphicsHash(chip8 *Processor)
+{
+    /* NOTE(koekeishiya): 64-bit FNV-1a over the framebuffer, one byte per 8 pixels from the
+     * top-left. Stable across runs and hosts, so hashes printed by different machines can
+     * be compared directly. */
+    unsigned long long Hash = 0xcbf29ce484222325ULL;
+    for(int Row = 0; Row < DISPLAY_HEIGHT; ++Row)
+    {
+        for(int Shift = DISPLAY_WIDTH - 8; Shift >= 0; Shift -= 8)
+        {
+            Hash ^= (Processor->Graphics[Row] >> Shift) & 0xFF;
+            Hash *= 0x100000001b3ULL;
+        }
+    }
+
+    return Hash;
+}
+
+void Chip8UnpackGraphics(chip8 *Processor, unsigned char *Pixels)
+{
+    for(int Y = 0; Y < DISPLAY_HEIGHT; ++Y)
+    {
+        unsigned long long Line = Processor->Graphics[Y];
+        for(int X = 0; X < DISPLAY_WIDTH; ++X)
+            *Pixels++ = (Line >> (DISPLAY_WIDTH - 1 - X)) & 1;
+    }
+}
@@ -4,6 +4,61 @@
 #define DISPLAY_WIDTH 64
 #define DISPLAY_HEIGHT 32
 
+/* NOTE(koekeishiya): The hex digits 0-F, five bytes each, loaded at address 0. */
+#define CHIP8_FONT_SIZE 80
+extern const unsigned char Chip8Font[CHIP8_FONT_SIZE];
+
+#ifdef CHIP8_PROFILE
+#include "chip8_profile.h"
+#endif
+
+/* NOTE(koekeishiya): Roms written for different interpreters disagree on a handful of
+ * instructions. A profile picks one behaviour for each of them; Default is what this
+ * emulator has always done, the others follow the platform they are named after. */
+enum chip8_quirks
+{
+    Chip8Quirks_Default,
+    Chip8Quirks_Chip8,
+    Chip8Quirks_Chip48,
+    Chip8Quirks_Schip,
+    Chip8Quirks_XoChip,
+
+    Chip8Quirks_Count,
+};
+
+/* NOTE(koekeishiya): What FX55 and FX65 leave in I. */
+enum chip8_index_quirk
+{
+    Chip8Index_Unchanged,
+    Chip8Index_PlusX,
+    Chip8Index_PlusXPlusOne,
+};
+
+struct chip8_quirk_set
+{
+    /* NOTE(koekeishiya): 8XY6 and 8XYE shift VY into VX instead of shifting VX. */
+    bool ShiftReadsVY;
+
+    chip8_index_quirk IndexAdvance;
+
+    /* NOTE(koekeishiya): BNNN becomes BXNN, jumping to XNN + VX instead of NNN + V0. */
+    bool JumpUsesVX;
+
+    /* NOTE(koekeishiya): 8XY1, 8XY2 and 8XY3 clear VF. */
+    bool LogicResetsVF;
+};
+
+/* NOTE(koekeishiya): Indexed by chip8_quirks. Being constexpr, a lookup with a profile
+ * known at compile time folds into a constant, which is how Chip8Step is specialized. */
+constexpr chip8_quirk_set Chip8QuirkSets[Chip8Quirks_Count] =
+{
+    { false, Chip8Index_Unchanged,     false, false }, // Default
+    { true,  Chip8Index_PlusXPlusOne,  false, true  }, // CHIP-8 (COSMAC VIP)
+    { false, Chip8Index_PlusX,         true,  false }, // CHIP-48
+    { false, Chip8Index_Unchanged,     true,  false }, // SUPER-CHIP 1.1
+    { true,  Chip8Index_PlusXPlusOne,  false, false }, // XO-CHIP (Octo)
+};
+
 struct chip8
 {
     /* NOTE(koekeishiya): Current Opcode. The chip-8 has 35opcodes, all two bytes long. */
@@ -29,8 +84,15 @@ struct chip8
 
     /* NOTE(koekeishiya): The chip-8 graphics system is black & white and has a total
      * of 2048 pixels. Drawing is done in XOR mode, setting the VF register when a pixel
-     * is turned off. This is used for collision detection. */
-    unsigned char Graphics[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+     * is turned off. This is used for collision detection.
+     *
+     * Every row is packed into a single 64-bit word, the leftmost pixel being the most
+     * significant bit. Use Chip8GetPixel or Chip8UnpackGraphics to read it. */
+    unsigned long long Graphics[DISPLAY_HEIGHT];
+
+    /* NOTE(koekeishiya): One bit per row of Graphics that has changed since the renderer
+     * last cleared it. Set by 00E0 and DXYN. */
+    unsigned int DirtyRows;
 
     /* NOTE(koekeishiya): The stack is only used to store return addresses when
      * subroutines are called. must have at least 16 levels. */
@@ -50,12 +112,145 @@ struct chip8
 
     /* NOTE(koekeishiya): Pause execution. */
     bool Paused;
+
+    /* NOTE(koekeishiya): State of the xorshift64* generator used by CXNN. Kept per processor
+     * so that instances never share a generator, and identical seeds give identical runs. */
+    unsigned long long RandomState;
+
+    /* NOTE(koekeishiya): A chip8_quirks profile, picked when the rom is loaded. Engines
+     * that translate code ahead of running it have to be reset when it changes. */
+    unsigned char Quirks;
+
+#ifdef CHIP8_PROFILE
+    /* NOTE(koekeishiya): Counters updated by Chip8DoCycle, nothing is counted while NULL.
+     * Chip8Initialize clears it. */
+    chip8_profile *Profile;
+#endif
 };
 
 void Chip8Initialize(chip8 *Processor);
 
+/* NOTE(koekeishiya): Chip8Initialize uses a fixed default seed, call this afterwards
+ * to pick a different (reproducible) sequence for CXNN. */
+void Chip8Seed(chip8 *Processor, unsigned long long Seed);
+
+/* NOTE(koekeishiya): The generator state Chip8Seed gives for Seed. */
+unsigned long long Chip8RandomState(unsigned long long Seed);
+
+/* NOTE(koekeishiya): Advance a xorshift64* state and return one random byte. */
+inline unsigned char Chip8NextRandom(unsigned long long *State)
+{
+    unsigned long long X = *State;
+    X ^= X >> 12;
+    X ^= X << 25;
+    X ^= X >> 27;
+    *State = X;
+
+    /* NOTE(koekeishiya): The high bits of xorshift64* are the best ones, and taking all
+     * eight of them gives every value in 0x00-0xFF with equal probability. */
+    return (unsigned char)((X * 0x2545F4914F6CDD1DULL) >> 56);
+}
+
+/* NOTE(koekeishiya): Roms are loaded at 0x200 and can fill the rest of memory. */
+#define CHIP8_ROM_CAPACITY (0x1000 - 0x200)
+
+/* NOTE(koekeishiya): Both fail, leaving memory alone, for an empty rom or one larger than
+ * CHIP8_ROM_CAPACITY, and the file version when it can not be read in full. */
 bool Chip8LoadRom(chip8 *Processor, const char *Rom);
+bool Chip8LoadRomImage(chip8 *Processor, const unsigned char *Data, unsigned int Size);
 
+/* NOTE(koekeishiya): Chip8Initialize selects Chip8Quirks_Default. */
+void Chip8SetQuirks(chip8 *Processor, chip8_quirks Quirks);
+const char *Chip8QuirksName(chip8_quirks Quirks);
+bool Chip8QuirksFromName(const char *Name, chip8_quirks *Quirks);
+
+/* NOTE(koekeishiya): Execute one instruction with the behaviour of profile Quirks, which
+ * is resolved at compile time; specialized for every chip8_quirks. Processor->Quirks is
+ * not looked at. */
+template<int Quirks> void Chip8Step(chip8 *Processor);
+
+/* NOTE(koekeishiya): The same with every memory access of DXYN, FX33, FX55 and FX65
+ * reported to the debugger, see chip8_debug.h. A separate specialization, so that
+ * Chip8Step does not pay for it. */
+struct chip8_debugger;
+template<int Quirks> void Chip8StepDebug(chip8 *Processor, chip8_debugger *Debugger);
+
+/* NOTE(koekeishiya): Execute one instruction with the profile of the processor. Loops
+ * should prefer Chip8RunCycles, which picks the specialization only once. */
 void Chip8DoCycle(chip8 *Processor);
+void Chip8RunCycles(chip8 *Processor, unsigned long long Cycles);
+
+/* NOTE(koekeishiya): Count both timers down by one, should be called at 60 Hz. */
+void Chip8TickTimers(chip8 *Processor);
+
+/* NOTE(koekeishiya): Longest idle loop, in instructions, that Chip8DetectIdle looks for. */
+#define CHIP8_IDLE_MAX_PERIOD 16
+
+enum chip8_idle_type
+{
+    Chip8Idle_None,
+
+    /* NOTE(koekeishiya): The loop reads neither the keypad nor the delay timer, e.g. a
+     * jump to itself at the end of a program. It never ends. */
+    Chip8Idle_Halt,
+
+    /* NOTE(koekeishiya): The loop polls the keypad (FX0A, EX9E, EXA1) but not the delay
+     * timer. It can only end once a key changes. */
+    Chip8Idle_Key,
+
+    /* NOTE(koekeishiya): The loop reads the delay timer through FX07. It may end on the
+     * next timer tick. */
+    Chip8Idle_Timer,
+};
+
+/* NOTE(koekeishiya): Starting at the current state, the processor goes through a cycle of
+ * Period instructions that it repeats forever, as long as Key and DelayTimer stay as they
+ * are. Those instructions only change Pc, I, Opcode and V. */
+struct chip8_idle
+{
+    chip8_idle_type Type;
+    unsigned int Period;
+};
+
+/* NOTE(koekeishiya): The part of a processor an idle loop can depend on. Memory and Key
+ * are only read, which lets the batch engine probe its lanes without copying them out. */
+struct chip8_idle_probe
+{
+    const unsigned char *Memory;
+    const unsigned char *Key;
+    unsigned char V[16];
+    unsigned short Pc;
+    unsigned short I;
+    unsigned short Opcode;
+    unsigned char DelayTimer;
+    unsigned char Quirks;
+};
+
+/* NOTE(koekeishiya): Look for an idle loop of at most MaxPeriod instructions, by running up
+ * to 2 * MaxPeriod instructions on a copy of the registers. Loops that touch anything but
+ * Pc, I, Opcode and V (memory writes, drawing, CXNN, the stack, timer writes) are never
+ * considered idle. */
+chip8_idle Chip8ProbeIdle(chip8_idle_probe *Probe, unsigned int MaxPeriod);
+chip8_idle Chip8DetectIdle(chip8 *Processor, unsigned int MaxPeriod);
+
+/* NOTE(koekeishiya): Number of instructions that actually have to be executed inside an
+ * idle loop to end up in the same state as executing Cycles of them. */
+inline unsigned long long Chip8IdleCycles(chip8_idle *Idle, unsigned long long Cycles)
+{
+    if(Cycles <= Idle->Period)
+        return Cycles;
+
+    return Idle->Period + (Cycles - Idle->Period) % Idle->Period;
+}
+
+unsigned long long Chip8GraphicsHash(chip8 *Processor);
+
+inline bool Chip8GetPixel(chip8 *Processor, int X, int Y)
+{
+    return (Processor->Graphics[Y] >> (DISPLAY_WIDTH - 1 - X)) & 1;
+}
+
+/* NOTE(koekeishiya): Expand the framebuffer to one byte (0 or 1) per pixel, row by row. */
+void Chip8UnpackGraphics(chip8 *Processor, unsigned char *Pixels);
 
 #endif
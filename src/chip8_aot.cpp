@@ -0,0 +1,714 @@
+#include "chip8_aot.h"
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+
+#define internal static
+
+#define AOT_SLOTS (0x1000 / 2)
+#define AOT_NO_BLOCK -1
+
+/* NOTE(koekeishiya): Translation. Everything below up to the runtime only runs inside the
+ * recompiler tool, never while emulating. */
+
+enum aot_flow
+{
+    AotFlow_Next,
+    AotFlow_End,
+};
+
+internal unsigned short
+AotOpcode(const unsigned char *Image, unsigned int Address)
+{
+    return Image[Address] << 8 | Image[Address + 1];
+}
+
+/* NOTE(koekeishiya): Instructions after which the block has to return to the dispatcher:
+ * anything that changes pc other than by falling through, FX0A which may stay where it is,
+ * and the two instructions that write memory, so the runtime can check whether they wrote
+ * over translated code before running any more of it. */
+internal bool
+AotEndsBlock(unsigned short Opcode)
+{
+    switch(Opcode & 0xF000)
+    {
+        case 0x0000: return Opcode == 0x00EE;
+        case 0x1000: case 0x2000: case 0x3000: case 0x4000:
+        case 0x5000: case 0x9000: case 0xB000: return true;
+        case 0xE000: return (Opcode & 0x00FF) == 0x009E || (Opcode & 0x00FF) == 0x00A1;
+        case 0xF000:
+        {
+            unsigned char NN = Opcode & 0x00FF;
+            return NN == 0x0A || NN == 0x33 || NN == 0x55;
+        }
+    }
+
+    return false;
+}
+
+/* NOTE(koekeishiya): How far FX55 and FX65 move I. */
+internal unsigned int
+AotIndexAdvance(const chip8_quirk_set *Quirk, unsigned short Opcode)
+{
+    if(Quirk->IndexAdvance == Chip8Index_Unchanged)
+        return 0;
+
+    return ((Opcode & 0x0F00) >> 8) + (Quirk->IndexAdvance == Chip8Index_PlusXPlusOne);
+}
+
+struct aot_graph
+{
+    unsigned char Image[0x1000];
+    unsigned int End;
+    bool Reached[0x1000];
+    bool Leader[0x1000];
+    unsigned short Work[0x1000];
+    int WorkCount;
+    const chip8_quirk_set *Quirk;
+};
+
+internal bool
+AotInRom(aot_graph *Graph, unsigned int Address)
+{
+    return !(Address & 1) && Address >= 0x200 && Address + 1 < Graph->End;
+}
+
+internal void
+AotAddLeader(aot_graph *Graph, unsigned int Address)
+{
+    if(!AotInRom(Graph, Address))
+        return;
+
+    Graph->Leader[Address] = true;
+    if(!Graph->Reached[Address])
+        Graph->Work[Graph->WorkCount++] = (unsigned short) Address;
+}
+
+/* NOTE(koekeishiya): BNNN jumps to NNN + V0 (or VX with the BXNN quirk). The target is
+ * known when the instruction right before it loads that register with a constant;
+ * otherwise roms almost always jump into a table of 1NNN instructions, in which case every
+ * entry of the table is a target. Guessing wrong only costs speed, the translated BNNN
+ * always computes its target. */
+internal bool
+AotResolveIndirect(aot_graph *Graph, unsigned int Address, unsigned short Opcode)
+{
+    unsigned int Base = Opcode & 0x0FFF;
+    unsigned short Load = Graph->Quirk->JumpUsesVX ? (0x6000 | (Opcode & 0x0F00)) : 0x6000;
+    if(Address >= 0x202)
+    {
+        unsigned short Previous = AotOpcode(Graph->Image, Address - 2);
+        if((Previous & 0xFF00) == Load && Graph->Reached[Address - 2])
+        {
+            AotAddLeader(Graph, Base + (Previous & 0x00FF));
+            return AotInRom(Graph, Base + (Previous & 0x00FF));
+        }
+    }
+
+    int Entries = 0;
+    for(unsigned int Entry = Base; Entry < Base + 0x100 && AotInRom(Graph, Entry); Entry += 2)
+    {
+        if((AotOpcode(Graph->Image, Entry) & 0xF000) != 0x1000)
+            break;
+
+        AotAddLeader(Graph, Entry);
+        ++Entries;
+    }
+
+    return Entries > 0;
+}
+
+internal void
+AotExplore(aot_graph *Graph, chip8_aot_translate_stats *Stats)
+{
+    AotAddLeader(Graph, 0x200);
+    while(Graph->WorkCount)
+    {
+        unsigned int Address = Graph->Work[--Graph->WorkCount];
+        while(AotInRom(Graph, Address) && !Graph->Reached[Address])
+        {
+            Graph->Reached[Address] = true;
+            ++Stats->Instructions;
+
+            unsigned short Opcode = AotOpcode(Graph->Image, Address);
+            unsigned int Next = Address + 2;
+
+            switch(Opcode & 0xF000)
+            {
+                case 0x1000: AotAddLeader(Graph, Opcode & 0x0FFF); break;
+                case 0x2000:
+                {
+                    AotAddLeader(Graph, Opcode & 0x0FFF);
+                    AotAddLeader(Graph, Next);
+                } break;
+                case 0x3000: case 0x4000: case 0x5000: case 0x9000: case 0xE000:
+                {
+                    if(AotEndsBlock(Opcode))
+                    {
+                        AotAddLeader(Graph, Next);
+                        AotAddLeader(Graph, Next + 2);
+                    }
+                } break;
+                case 0xB000:
+                {
+                    if(AotResolveIndirect(Graph, Address, Opcode))
+                        ++Stats->ResolvedIndirect;
+                    else
+                        ++Stats->UnresolvedIndirect;
+                } break;
+                case 0xF000:
+                {
+                    if((Opcode & 0x00FF) == 0x000A)
+                        AotAddLeader(Graph, Address);
+
+                    if(AotEndsBlock(Opcode))
+                        AotAddLeader(Graph, Next);
+                } break;
+            }
+
+            if(AotEndsBlock(Opcode))
+                break;
+
+            Address = Next;
+        }
+    }
+}
+
+/* NOTE(koekeishiya): Write one instruction as C++, mirroring Chip8Step statement for
+ * statement so that even the odd cases (VF as an operand, out of range keys) come out the
+ * same. Quirks are resolved here, the output only contains the chosen behaviour.
+ * Instructions that end a block return the next pc. */
+internal aot_flow
+AotEmitInstruction(FILE *File, const chip8_quirk_set *Quirk, unsigned int Address, unsigned short Opcode)
+{
+    int X = (Opcode & 0x0F00) >> 8;
+    int Y = (Opcode & 0x00F0) >> 4;
+    int N = Opcode & 0x000F;
+    int NN = Opcode & 0x00FF;
+    int NNN = Opcode & 0x0FFF;
+    unsigned int Next = Address + 2;
+
+    fprintf(File, "    /* 0x%03X: %04X */\n", Address, Opcode);
+    if(AotEndsBlock(Opcode))
+        fprintf(File, "    P->Opcode = 0x%04X;\n", Opcode);
+
+    switch(Opcode & 0xF000)
+    {
+        case 0x0000:
+        {
+            if(Opcode == 0x00E0)
+            {
+                fprintf(File, "    memset(P->Graphics, 0, sizeof(P->Graphics));\n"
+                              "    P->DirtyRows = 0xFFFFFFFF;\n"
+                              "    P->Draw = true;\n");
+            }
+            else if(Opcode == 0x00EE)
+            {
+                fprintf(File, "    return P->Stack[--P->Sp & 0xF];\n");
+                return AotFlow_End;
+            }
+        } break;
+        case 0x1000:
+        {
+            fprintf(File, "    return 0x%03X;\n", NNN);
+            return AotFlow_End;
+        } break;
+        case 0x2000:
+        {
+            fprintf(File, "    P->Stack[P->Sp++ & 0xF] = 0x%03X;\n    return 0x%03X;\n", Next, NNN);
+            return AotFlow_End;
+        } break;
+        case 0x3000:
+        case 0x4000:
+        {
+            fprintf(File, "    if(P->V[0x%X] %s 0x%02X) return 0x%03X;\n    return 0x%03X;\n",
+                    X, (Opcode & 0xF000) == 0x3000 ? "==" : "!=", NN, Next + 2, Next);
+            return AotFlow_End;
+        } break;
+        case 0x5000:
+        case 0x9000:
+        {
+            fprintf(File, "    if(P->V[0x%X] %s P->V[0x%X]) return 0x%03X;\n    return 0x%03X;\n",
+                    X, (Opcode & 0xF000) == 0x5000 ? "==" : "!=", Y, Next + 2, Next);
+            return AotFlow_End;
+        } break;
+        case 0x6000: fprintf(File, "    P->V[0x%X] = 0x%02X;\n", X, NN); break;
+        case 0x7000: fprintf(File, "    P->V[0x%X] += 0x%02X;\n", X, NN); break;
+        case 0x8000:
+        {
+            switch(Opcode & 0x000F)
+            {
+                case 0x0000: fprintf(File, "    P->V[0x%X] = P->V[0x%X];\n", X, Y); break;
+                case 0x0001:
+                case 0x0002:
+                case 0x0003:
+                {
+                    const char *Operators[] = { "|=", "&=", "^=" };
+                    fprintf(File, "    P->V[0x%X] %s P->V[0x%X];\n", X, Operators[(Opcode & 0x000F) - 1], Y);
+                    if(Quirk->LogicResetsVF)
+                        fprintf(File, "    P->V[0xF] = 0;\n");
+                } break;
+                case 0x0004:
+                {
+                    fprintf(File, "    {\n        unsigned short Sum = P->V[0x%X] + P->V[0x%X];\n"
+                                  "        P->V[0x%X] = Sum & 0xFF;\n"
+                                  "        P->V[0xF] = Sum > 255;\n    }\n", X, Y, X);
+                } break;
+                case 0x0005:
+                case 0x0007:
+                {
+                    bool Reverse = (Opcode & 0x000F) == 0x0007;
+                    int From = Reverse ? Y : X;
+                    int Subtract = Reverse ? X : Y;
+                    fprintf(File, "    {\n        unsigned char NoBorrow = P->V[0x%X] >= P->V[0x%X];\n"
+                                  "        P->V[0x%X] = P->V[0x%X] - P->V[0x%X];\n"
+                                  "        P->V[0xF] = NoBorrow;\n    }\n", From, Subtract, X, From, Subtract);
+                } break;
+                case 0x0006:
+                case 0x000E:
+                {
+                    bool Left = (Opcode & 0x000F) == 0x000E;
+                    fprintf(File, "    {\n        unsigned char Source = P->V[0x%X];\n"
+                                  "        P->V[0x%X] = Source %s 1;\n"
+                                  "        P->V[0xF] = Source %s;\n    }\n",
+                            Quirk->ShiftReadsVY ? Y : X, X, Left ? "<<" : ">>", Left ? ">> 7" : "& 0x1");
+                } break;
+            }
+        } break;
+        case 0xA000: fprintf(File, "    P->I = 0x%03X;\n", NNN); break;
+        case 0xB000:
+        {
+            fprintf(File, "    return 0x%03X + P->V[0x%X];\n", NNN, Quirk->JumpUsesVX ? X : 0);
+            return AotFlow_End;
+        } break;
+        case 0xC000:
+        {
+            fprintf(File, "    P->V[0x%X] = Chip8NextRandom(&P->RandomState) & 0x%02X;\n", X, NN);
+        } break;
+        case 0xD000:
+        {
+            fprintf(File, "    AotDraw(P, 0x%X, 0x%X, %d);\n", X, Y, N);
+        } break;
+        case 0xE000:
+        {
+            if(NN == 0x9E || NN == 0xA1)
+            {
+                fprintf(File, "    if(P->Key[P->V[0x%X] & 0xF] %s 1) return 0x%03X;\n    return 0x%03X;\n",
+                        X, NN == 0x9E ? "==" : "!=", Next + 2, Next);
+                return AotFlow_End;
+            }
+        } break;
+        case 0xF000:
+        {
+            switch(NN)
+            {
+                case 0x07: fprintf(File, "    P->V[0x%X] = P->DelayTimer;\n", X); break;
+                case 0x0A:
+                {
+                    fprintf(File, "    if(!AotWaitKey(P, 0x%X)) return 0x%03X;\n    return 0x%03X;\n",
+                            X, Address, Next);
+                    return AotFlow_End;
+                } break;
+                case 0x15: fprintf(File, "    P->DelayTimer = P->V[0x%X];\n", X); break;
+                case 0x18: fprintf(File, "    P->SoundTimer = P->V[0x%X];\n", X); break;
+                case 0x1E: fprintf(File, "    P->I += P->V[0x%X];\n", X); break;
+                case 0x29: fprintf(File, "    P->I = P->V[0x%X] * 5;\n", X); break;
+                case 0x33:
+                {
+                    fprintf(File, "    AotStoreBcd(P, 0x%X);\n    return 0x%03X;\n", X, Next);
+                    return AotFlow_End;
+                } break;
+                case 0x55:
+                {
+                    fprintf(File, "    for(int Index = 0; Index <= 0x%X; ++Index)\n"
+                                  "        P->Memory[(P->I + Index) & 0xFFF] = P->V[Index];\n", X);
+                    if(Quirk->IndexAdvance != Chip8Index_Unchanged)
+                        fprintf(File, "    P->I += 0x%X;\n", AotIndexAdvance(Quirk, Opcode));
+                    fprintf(File, "    return 0x%03X;\n", Next);
+                    return AotFlow_End;
+                } break;
+                case 0x65:
+                {
+                    fprintf(File, "    for(int Index = 0; Index <= 0x%X; ++Index)\n"
+                                  "        P->V[Index] = P->Memory[(P->I + Index) & 0xFFF];\n", X);
+                    if(Quirk->IndexAdvance != Chip8Index_Unchanged)
+                        fprintf(File, "    P->I += 0x%X;\n", AotIndexAdvance(Quirk, Opcode));
+                } break;
+            }
+        } break;
+    }
+
+    return AotFlow_Next;
+}
+
+/* NOTE(koekeishiya): Helpers for the instructions that are too long to repeat at every
+ * use, copied from Chip8DoCycle. */
+static const char *AotPreamble =
+    "static inline void\n"
+    "AotDraw(chip8 *P, int X, int Y, unsigned short Height)\n"
+    "{\n"
+    "    P->V[0xF] = 0;\n"
+    "    unsigned short RegisterX = P->V[X] % DISPLAY_WIDTH;\n"
+    "    unsigned short RegisterY = P->V[Y] % DISPLAY_HEIGHT;\n"
+    "    if(Height > DISPLAY_HEIGHT - RegisterY)\n"
+    "        Height = DISPLAY_HEIGHT - RegisterY;\n"
+    "\n"
+    "    for(int Row = 0; Row < Height; ++Row)\n"
+    "    {\n"
+    "        unsigned long long Sprite = P->Memory[(P->I + Row) & 0xFFF];\n"
+    "        unsigned long long Bits = (Sprite << (DISPLAY_WIDTH - 8)) >> RegisterX;\n"
+    "        unsigned long long *Line = P->Graphics + RegisterY + Row;\n"
+    "        if(*Line & Bits)\n"
+    "            P->V[0xF] = 1;\n"
+    "        if(Bits)\n"
+    "            P->DirtyRows |= 1u << (RegisterY + Row);\n"
+    "        *Line ^= Bits;\n"
+    "    }\n"
+    "\n"
+    "    P->Draw = true;\n"
+    "}\n"
+    "\n"
+    "static inline bool\n"
+    "AotWaitKey(chip8 *P, int X)\n"
+    "{\n"
+    "    bool Keypress = false;\n"
+    "    for(int Index = 0; Index < 16; ++Index)\n"
+    "    {\n"
+    "        if(P->Key[Index] == 1)\n"
+    "        {\n"
+    "            P->V[X] = Index;\n"
+    "            Keypress = true;\n"
+    "        }\n"
+    "    }\n"
+    "    return Keypress;\n"
+    "}\n"
+    "\n"
+    "static inline void\n"
+    "AotStoreBcd(chip8 *P, int X)\n"
+    "{\n"
+    "    unsigned char Digit = P->V[X];\n"
+    "    for(int Index = 3; Index > 0; --Index)\n"
+    "    {\n"
+    "        P->Memory[(P->I + Index - 1) & 0xFFF] = Digit % 10;\n"
+    "        Digit /= 10;\n"
+    "    }\n"
+    "}\n";
+
+bool Chip8AotTranslate(const unsigned char *Rom, unsigned int Length, const char *Name,
+                       chip8_quirks Quirks, FILE *File, chip8_aot_translate_stats *Stats)
+{
+    memset(Stats, 0, sizeof(chip8_aot_translate_stats));
+    if(Length == 0 || Length > 0x1000 - 0x200 || Quirks >= Chip8Quirks_Count)
+        return false;
+
+    aot_graph *Graph = (aot_graph *) calloc(1, sizeof(aot_graph));
+    if(!Graph)
+        return false;
+
+    memcpy(Graph->Image + 0x200, Rom, Length);
+    Graph->End = 0x200 + Length;
+    Graph->Quirk = Chip8QuirkSets + Quirks;
+    AotExplore(Graph, Stats);
+
+    fprintf(File, "/* NOTE(koekeishiya): Generated by chip8-recompile from %s with the %s quirks, do not edit.\n"
+                  " * Build with: g++ -O2 -shared -fPIC -Isrc <this file> -o <module>.so */\n\n",
+            Name, Chip8QuirksName(Quirks));
+    fprintf(File, "#include <string.h>\n#include \"chip8.h\"\n#include \"chip8_aot.h\"\n\n");
+    fprintf(File, "%s\n", AotPreamble);
+
+    /* NOTE(koekeishiya): Blocks run from a leader up to the first instruction that ends a
+     * block, the next leader, or the length limit, in which case the next instruction
+     * becomes a leader of its own. */
+    unsigned short *Starts = (unsigned short *) malloc(sizeof(unsigned short) * AOT_SLOTS);
+    unsigned short *Ends = (unsigned short *) malloc(sizeof(unsigned short) * AOT_SLOTS);
+    unsigned short *Lengths = (unsigned short *) malloc(sizeof(unsigned short) * AOT_SLOTS);
+    bool *Writes = (bool *) malloc(sizeof(bool) * AOT_SLOTS);
+
+    for(unsigned int Start = 0x200; Start < Graph->End; Start += 2)
+    {
+        if(!Graph->Leader[Start] || !Graph->Reached[Start])
+            continue;
+
+        fprintf(File, "static unsigned short\nBlock_%03X(chip8 *P)\n{\n", Start);
+
+        unsigned int Address = Start;
+        unsigned short Count = 0;
+        unsigned short Last = 0;
+        aot_flow Flow = AotFlow_Next;
+
+        while(Flow == AotFlow_Next)
+        {
+            Last = AotOpcode(Graph->Image, Address);
+            Flow = AotEmitInstruction(File, Graph->Quirk, Address, Last);
+            Address += 2;
+            ++Count;
+
+            if(Flow == AotFlow_Next &&
+               (!AotInRom(Graph, Address) || !Graph->Reached[Address] || Graph->Leader[Address] ||
+                Count == CHIP8_AOT_MAX_BLOCK_LENGTH))
+            {
+                if(AotInRom(Graph, Address) && Graph->Reached[Address])
+                    Graph->Leader[Address] = true;
+
+                fprintf(File, "    P->Opcode = 0x%04X;\n    return 0x%03X;\n", Last, Address);
+                break;
+            }
+        }
+
+        fprintf(File, "}\n\n");
+
+        Starts[Stats->Blocks] = (unsigned short) Start;
+        Ends[Stats->Blocks] = (unsigned short) Address;
+        Lengths[Stats->Blocks] = Count;
+        Writes[Stats->Blocks] = (Last & 0xF0FF) == 0xF033 || (Last & 0xF0FF) == 0xF055;
+        ++Stats->Blocks;
+    }
+
+    fprintf(File, "static const unsigned char Rom[%u] =\n{", Length);
+    for(unsigned int Index = 0; Index < Length; ++Index)
+        fprintf(File, "%s0x%02X,", (Index % 16) ? " " : "\n    ", Rom[Index]);
+    fprintf(File, "\n};\n\n");
+
+    fprintf(File, "static const chip8_aot_entry Blocks[%u] =\n{\n", Stats->Blocks ? Stats->Blocks : 1);
+    for(unsigned int Index = 0; Index < Stats->Blocks; ++Index)
+    {
+        fprintf(File, "    { 0x%03X, 0x%03X, %u, %s, Block_%03X },\n", Starts[Index], Ends[Index],
+                Lengths[Index], Writes[Index] ? "Chip8AotBlock_Writes" : "0", Starts[Index]);
+    }
+    fprintf(File, "};\n\n");
+
+    fprintf(File, "static const chip8_aot_module Module =\n{\n"
+                  "    CHIP8_AOT_VERSION,\n    sizeof(chip8),\n    %u,\n    \"", (unsigned int) Quirks);
+    for(const char *At = Name; *At; ++At)
+    {
+        if(*At == '"' || *At == '\\')
+            fputc('\\', File);
+        fputc(*At, File);
+    }
+    fprintf(File, "\",\n    Rom,\n    sizeof(Rom),\n    Blocks,\n    %u,\n};\n\n", Stats->Blocks);
+    fprintf(File, "extern \"C\" const chip8_aot_module *\nChip8AotModule()\n{\n    return &Module;\n}\n");
+
+    free(Writes);
+    free(Lengths);
+    free(Ends);
+    free(Starts);
+    free(Graph);
+    return !ferror(File);
+}
+
+/* NOTE(koekeishiya): Runtime. */
+
+struct chip8_aot
+{
+    void *Handle;
+    const chip8_aot_module *Module;
+    const chip8_quirk_set *Quirk;
+
+    short BlockAt[AOT_SLOTS];
+    unsigned char Covered[AOT_SLOTS];
+    bool *Valid;
+
+    /* NOTE(koekeishiya): Set by Chip8AotReset, memory has to be checked against the rom
+     * before the next block runs. */
+    bool Stale;
+
+    chip8_aot_stats Stats;
+};
+
+internal bool
+AotMatches(chip8_aot *Aot, chip8 *Processor, const chip8_aot_entry *Entry)
+{
+    return memcmp(Processor->Memory + Entry->Start, Aot->Module->Rom + (Entry->Start - 0x200),
+                  Entry->End - Entry->Start) == 0;
+}
+
+/* NOTE(koekeishiya): Memory[Low] to Memory[High] may have changed. Blocks under it are
+ * disabled while their bytes differ from the rom, and enabled again if the bytes are ever
+ * restored, e.g. by loading a state. */
+internal void
+AotCheck(chip8_aot *Aot, chip8 *Processor, unsigned int Low, unsigned int High)
+{
+    /* NOTE(koekeishiya): Writes past the end of Memory wrap around to the start. */
+    if(High > 0xFFF)
+    {
+        AotCheck(Aot, Processor, 0, High & 0xFFF);
+        High = 0xFFF;
+    }
+
+    bool Hit = false;
+    for(unsigned int Address = Low & ~1u; Address <= High; Address += 2)
+        Hit |= Aot->Covered[Address >> 1] != 0;
+
+    if(!Hit)
+        return;
+
+    for(unsigned int Index = 0; Index < Aot->Module->BlockCount; ++Index)
+    {
+        const chip8_aot_entry *Entry = Aot->Module->Blocks + Index;
+        if(Entry->Start > High || Entry->End <= Low)
+            continue;
+
+        bool Matches = AotMatches(Aot, Processor, Entry);
+        if(Aot->Valid[Index] && !Matches)
+            ++Aot->Stats.BlocksInvalidated;
+
+        Aot->Valid[Index] = Matches;
+    }
+}
+
+internal void
+AotWritten(chip8_aot *Aot, chip8 *Processor, unsigned short Opcode, unsigned int Address)
+{
+    if((Opcode & 0xF0FF) == 0xF033)
+        AotCheck(Aot, Processor, Address, Address + 2);
+    else if((Opcode & 0xF0FF) == 0xF055)
+        AotCheck(Aot, Processor, Address, Address + ((Opcode & 0x0F00) >> 8));
+}
+
+chip8_aot *Chip8AotCreate(const char *Path)
+{
+    /* NOTE(koekeishiya): dlopen searches the library path for names without a slash, a
+     * module is always meant to be a file. */
+    char Local[4096];
+    if(!strchr(Path, '/'))
+    {
+        snprintf(Local, sizeof(Local), "./%s", Path);
+        Path = Local;
+    }
+
+    void *Handle = dlopen(Path, RTLD_NOW | RTLD_LOCAL);
+    if(!Handle)
+    {
+        fprintf(stderr, "aot: %s\n", dlerror());
+        return NULL;
+    }
+
+    chip8_aot_module_function *GetModule = (chip8_aot_module_function *) dlsym(Handle, CHIP8_AOT_SYMBOL);
+    const chip8_aot_module *Module = GetModule ? GetModule() : NULL;
+    if(!Module || Module->Version != CHIP8_AOT_VERSION || Module->StructSize != sizeof(chip8) ||
+       Module->Quirks >= Chip8Quirks_Count)
+    {
+        fprintf(stderr, "aot: %s was not built for this version of the emulator\n", Path);
+        dlclose(Handle);
+        return NULL;
+    }
+
+    chip8_aot *Aot = (chip8_aot *) calloc(1, sizeof(chip8_aot));
+    bool *Valid = (bool *) calloc(Module->BlockCount + 1, sizeof(bool));
+    if(!Aot || !Valid)
+    {
+        free(Aot);
+        free(Valid);
+        dlclose(Handle);
+        return NULL;
+    }
+
+    Aot->Handle = Handle;
+    Aot->Module = Module;
+    Aot->Quirk = Chip8QuirkSets + Module->Quirks;
+    Aot->Valid = Valid;
+    for(int Slot = 0; Slot < AOT_SLOTS; ++Slot)
+        Aot->BlockAt[Slot] = AOT_NO_BLOCK;
+
+    for(unsigned int Index = 0; Index < Module->BlockCount; ++Index)
+    {
+        const chip8_aot_entry *Entry = Module->Blocks + Index;
+        Aot->BlockAt[Entry->Start >> 1] = (short) Index;
+        for(unsigned int Slot = Entry->Start >> 1; Slot < (unsigned int)(Entry->End >> 1); ++Slot)
+            Aot->Covered[Slot] = 1;
+    }
+
+    Chip8AotReset(Aot);
+    return Aot;
+}
+
+void Chip8AotDestroy(chip8_aot *Aot)
+{
+    if(Aot)
+    {
+        dlclose(Aot->Handle);
+        free(Aot->Valid);
+        free(Aot);
+    }
+}
+
+const char *Chip8AotName(chip8_aot *Aot)
+{
+    return Aot ? Aot->Module->Name : "none";
+}
+
+void Chip8AotReset(chip8_aot *Aot)
+{
+    if(Aot)
+        Aot->Stale = true;
+}
+
+void Chip8AotRun(chip8_aot *Aot, chip8 *Processor, unsigned long long Cycles)
+{
+    if(!Aot)
+    {
+        Chip8RunCycles(Processor, Cycles);
+        return;
+    }
+
+    /* NOTE(koekeishiya): The blocks only implement the profile the module was translated
+     * for. Writes are not tracked meanwhile, so everything is checked again afterwards. */
+    if(Processor->Quirks != Aot->Module->Quirks)
+    {
+        Chip8RunCycles(Processor, Cycles);
+        Aot->Stats.InterpretedCycles += Cycles;
+        Aot->Stale = true;
+        return;
+    }
+
+    if(Aot->Stale)
+    {
+        for(unsigned int Index = 0; Index < Aot->Module->BlockCount; ++Index)
+            Aot->Valid[Index] = AotMatches(Aot, Processor, Aot->Module->Blocks + Index);
+        Aot->Stale = false;
+    }
+
+    long long Budget = (long long) Cycles;
+    while(Budget > 0)
+    {
+        unsigned short Pc = Processor->Pc;
+        short Index = (Pc & 0xF001) ? AOT_NO_BLOCK : Aot->BlockAt[Pc >> 1];
+
+        if(Index >= 0 && Aot->Valid[Index] && Budget >= Aot->Module->Blocks[Index].Length)
+        {
+            const chip8_aot_entry *Entry = Aot->Module->Blocks + Index;
+            Processor->Pc = Entry->Run(Processor);
+            Budget -= Entry->Length;
+            Aot->Stats.NativeCycles += Entry->Length;
+
+            /* NOTE(koekeishiya): The writing instruction is the last one of the block and
+             * FX33 leaves I alone while FX55 moves it by a known amount, so the range can be
+             * recovered afterwards. */
+            if(Entry->Flags & Chip8AotBlock_Writes)
+            {
+                unsigned short Opcode = Processor->Opcode;
+                unsigned int Advance = (Opcode & 0xF0FF) == 0xF055 ? AotIndexAdvance(Aot->Quirk, Opcode) : 0;
+                AotWritten(Aot, Processor, Opcode, (Processor->I - Advance) & 0xFFF);
+            }
+        }
+        else
+        {
+            /* NOTE(koekeishiya): No block here, e.g. a BNNN target that could not be
+             * resolved, code the rom builds at runtime, or a block that was written over. */
+            unsigned short Opcode = 0;
+            if(Pc < 0x0FFF)
+                Opcode = Processor->Memory[Pc] << 8 | Processor->Memory[Pc + 1];
+
+            unsigned int Address = Processor->I & 0xFFF;
+            Chip8DoCycle(Processor);
+            --Budget;
+            ++Aot->Stats.InterpretedCycles;
+            AotWritten(Aot, Processor, Opcode, Address);
+        }
+    }
+}
+
+chip8_aot_stats Chip8AotGetStats(chip8_aot *Aot)
+{
+    chip8_aot_stats Stats = {};
+    return Aot ? Aot->Stats : Stats;
+}
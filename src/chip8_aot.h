@@ -0,0 +1,98 @@
+#ifndef CHIP_8_AOT
+#define CHIP_8_AOT
+
+#include <stdio.h>
+#include "chip8.h"
+
+/* NOTE(koekeishiya): Bumped whenever chip8_aot_module or the meaning of its fields change,
+ * modules built against another version are refused. */
+#define CHIP8_AOT_VERSION 2
+
+/* NOTE(koekeishiya): Longest run of instructions translated into a single block. Blocks
+ * only run when the cycle budget covers all of them, so this bounds how many cycles at the
+ * end of a run fall back to the interpreter. */
+#define CHIP8_AOT_MAX_BLOCK_LENGTH 64
+
+/* NOTE(koekeishiya): Execute a whole block on the processor and return the pc it ends at.
+ * Opcode is left as the last instruction of the block, the same as the interpreter. */
+typedef unsigned short chip8_aot_block(chip8 *Processor);
+
+enum chip8_aot_block_flags
+{
+    /* NOTE(koekeishiya): The last instruction is FX33 or FX55, so the block may have
+     * written over code. */
+    Chip8AotBlock_Writes = 0x1,
+};
+
+struct chip8_aot_entry
+{
+    unsigned short Start;
+    unsigned short End;
+    unsigned short Length;
+    unsigned short Flags;
+    chip8_aot_block *Run;
+};
+
+/* NOTE(koekeishiya): What a recompiled rom exports through Chip8AotModule. Rom is the image
+ * the blocks were translated from; a block only runs while the memory under it still holds
+ * exactly those bytes. StructSize guards against a module built with different flags,
+ * e.g. CHIP8_PROFILE, which changes the layout of the chip8 struct. Quirks is the
+ * chip8_quirks profile the blocks implement; processors with another profile are
+ * interpreted. */
+struct chip8_aot_module
+{
+    unsigned int Version;
+    unsigned int StructSize;
+    unsigned int Quirks;
+    const char *Name;
+    const unsigned char *Rom;
+    unsigned int RomLength;
+    const chip8_aot_entry *Blocks;
+    unsigned int BlockCount;
+};
+
+typedef const chip8_aot_module *chip8_aot_module_function();
+#define CHIP8_AOT_SYMBOL "Chip8AotModule"
+
+struct chip8_aot_translate_stats
+{
+    unsigned int Instructions;
+    unsigned int Blocks;
+    unsigned int ResolvedIndirect;
+    unsigned int UnresolvedIndirect;
+};
+
+/* NOTE(koekeishiya): Recover the control-flow graph of a rom starting at 0x200 and write a
+ * C++ translation unit with one function per basic block for the given quirk profile to
+ * File. BNNN targets are resolved when the register is a known constant or NNN is the
+ * start of a table of jumps; anything else, as well as code reached only at runtime, is
+ * left to the interpreter. */
+bool Chip8AotTranslate(const unsigned char *Rom, unsigned int Length, const char *Name,
+                       chip8_quirks Quirks, FILE *File, chip8_aot_translate_stats *Stats);
+
+struct chip8_aot;
+
+struct chip8_aot_stats
+{
+    unsigned long long NativeCycles;
+    unsigned long long InterpretedCycles;
+    unsigned long long BlocksInvalidated;
+};
+
+/* NOTE(koekeishiya): Load a module built from the output of Chip8AotTranslate. Returns
+ * NULL when the shared object can not be loaded or was built for another version. */
+chip8_aot *Chip8AotCreate(const char *Path);
+void Chip8AotDestroy(chip8_aot *Aot);
+const char *Chip8AotName(chip8_aot *Aot);
+
+/* NOTE(koekeishiya): Memory was changed outside of Chip8AotRun, every block is checked
+ * against the rom again before it is used. */
+void Chip8AotReset(chip8_aot *Aot);
+
+/* NOTE(koekeishiya): Execute exactly the given number of cycles. Aot may be NULL, in which
+ * case everything is interpreted. */
+void Chip8AotRun(chip8_aot *Aot, chip8 *Processor, unsigned long long Cycles);
+
+chip8_aot_stats Chip8AotGetStats(chip8_aot *Aot);
+
+#endif
@@ -0,0 +1,409 @@
+#include "chip8_audio.h"
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+
+#ifdef __APPLE__
+#include <AudioToolbox/AudioToolbox.h>
+#include <CoreAudio/CoreAudio.h>
+#endif
+
+#define internal static
+
+#define RING_MASK (CHIP8_AUDIO_RING_SIZE - 1)
+#define VOLUME 0.2f
+
+/* NOTE(koekeishiya): Fade time of the envelope, in samples. */
+#define RAMP_FRAMES (CHIP8_AUDIO_RATE / 500)
+
+#define WAV_HEADER_SIZE 44
+
+static const char *Chip8AudioNames[Chip8Audio_Count] =
+{
+    "null",
+    "wav",
+    "device",
+};
+
+internal unsigned long long
+GetTimeNanos()
+{
+    using namespace std::chrono;
+    return (duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())).count();
+}
+
+internal unsigned char *
+Put(unsigned char *At, unsigned long long Value, int Bytes)
+{
+    for(int Index = 0; Index < Bytes; ++Index)
+        *At++ = (unsigned char)(Value >> (8 * Index));
+    return At;
+}
+
+internal bool
+WriteWavHeader(FILE *File, unsigned long long Frames)
+{
+    unsigned long long DataSize = Frames * 2;
+    unsigned char Header[WAV_HEADER_SIZE];
+    unsigned char *At = Header;
+
+    memcpy(At, "RIFF", 4);
+    At = Put(At + 4, 36 + DataSize, 4);
+    memcpy(At, "WAVEfmt ", 8);
+    At = Put(At + 8, 16, 4);
+    At = Put(At, 1, 2);
+    At = Put(At, 1, 2);
+    At = Put(At, CHIP8_AUDIO_RATE, 4);
+    At = Put(At, CHIP8_AUDIO_RATE * 2, 4);
+    At = Put(At, 2, 2);
+    At = Put(At, 16, 2);
+    memcpy(At, "data", 4);
+    Put(At + 4, DataSize, 4);
+
+    return fseek(File, 0, SEEK_SET) == 0 && fwrite(Header, 1, sizeof(Header), File) == sizeof(Header);
+}
+
+internal void
+WriteSamples(chip8_audio *Audio, float *Samples, unsigned int Frames)
+{
+    if(!Audio->Wav)
+        return;
+
+    unsigned char Buffer[CHIP8_AUDIO_PERIOD * 2];
+    unsigned char *At = Buffer;
+    for(unsigned int Index = 0; Index < Frames; ++Index)
+        At = Put(At, (unsigned short)(short)(Samples[Index] * 32767.0f), 2);
+
+    fwrite(Buffer, 1, Frames * 2, Audio->Wav);
+}
+
+/* NOTE(koekeishiya): The correction PolyBLEP adds around a discontinuity at phase 0, for
+ * a phase advancing by Step per sample. */
+internal inline float
+PolyBlep(double Phase, double Step)
+{
+    if(Phase < Step)
+    {
+        double T = Phase / Step;
+        return (float)(T + T - T * T - 1.0);
+    }
+    else if(Phase > 1.0 - Step)
+    {
+        double T = (Phase - 1.0) / Step;
+        return (float)(T * T + T + T + 1.0);
+    }
+    return 0.0f;
+}
+
+void Chip8AudioRender(chip8_audio *Audio, float *Samples, unsigned int Frames)
+{
+    chip8_audio_ring *Ring = &Audio->Ring;
+    unsigned int Tail = Ring->Tail.load(std::memory_order_relaxed);
+    unsigned int Head = Ring->Head.load(std::memory_order_acquire);
+
+    if(Tail != Head)
+    {
+        unsigned long long Now = Audio->Realtime ? GetTimeNanos() + Audio->DeviceLatencyNanos : 0;
+        for(; Tail != Head; ++Tail)
+        {
+            chip8_audio_event *Event = Ring->Events + (Tail & RING_MASK);
+            Audio->Gate = Event->On;
+
+            if(Audio->Realtime)
+            {
+                unsigned long long Latency = Now > Event->Nanos ? Now - Event->Nanos : 0;
+                Audio->Stats.LatencyNanos += Latency;
+                if(Latency > Audio->Stats.MaxLatencyNanos)
+                    Audio->Stats.MaxLatencyNanos = Latency;
+            }
+        }
+
+        Ring->Tail.store(Tail, std::memory_order_release);
+    }
+
+    const double Step = (double) CHIP8_AUDIO_TONE / CHIP8_AUDIO_RATE;
+    const float Ramp = 1.0f / RAMP_FRAMES;
+
+    for(unsigned int Index = 0; Index < Frames; ++Index)
+    {
+        if(Audio->Gate)
+            Audio->Level = Audio->Level + Ramp < 1.0f ? Audio->Level + Ramp : 1.0f;
+        else
+            Audio->Level = Audio->Level - Ramp > 0.0f ? Audio->Level - Ramp : 0.0f;
+
+        float Sample = 0.0f;
+        if(Audio->Level > 0.0f)
+        {
+            double Half = Audio->Phase + 0.5;
+            if(Half >= 1.0)
+                Half -= 1.0;
+
+            Sample = Audio->Phase < 0.5 ? 1.0f : -1.0f;
+            Sample += PolyBlep(Audio->Phase, Step);
+            Sample -= PolyBlep(Half, Step);
+            Sample *= Audio->Level * VOLUME;
+        }
+
+        Samples[Index] = Sample;
+        Audio->Phase += Step;
+        if(Audio->Phase >= 1.0)
+            Audio->Phase -= 1.0;
+    }
+
+    Audio->Stats.Frames += Frames;
+    ++Audio->Stats.Callbacks;
+}
+
+void Chip8AudioPull(chip8_audio *Audio, unsigned int Frames)
+{
+    float Samples[CHIP8_AUDIO_PERIOD];
+    while(Frames > 0)
+    {
+        unsigned int Count = Frames < CHIP8_AUDIO_PERIOD ? Frames : CHIP8_AUDIO_PERIOD;
+        Chip8AudioRender(Audio, Samples, Count);
+        WriteSamples(Audio, Samples, Count);
+        Frames -= Count;
+    }
+}
+
+/* NOTE(koekeishiya): Stands in for a device: renders one period per period of wall-clock
+ * time, sleeping in between, and catches up on its own if it was held up. */
+internal void
+PacingThread(chip8_audio *Audio)
+{
+    const unsigned long long Period = 1000000000ULL * CHIP8_AUDIO_PERIOD / CHIP8_AUDIO_RATE;
+    unsigned long long Next = GetTimeNanos();
+    float Samples[CHIP8_AUDIO_PERIOD];
+
+    while(Audio->Running.load(std::memory_order_relaxed))
+    {
+        Chip8AudioRender(Audio, Samples, CHIP8_AUDIO_PERIOD);
+        WriteSamples(Audio, Samples, CHIP8_AUDIO_PERIOD);
+
+        Next += Period;
+        unsigned long long Now = GetTimeNanos();
+        if(Now < Next)
+        {
+            struct timespec Request;
+            Request.tv_sec = (Next - Now) / 1000000000ULL;
+            Request.tv_nsec = (Next - Now) % 1000000000ULL;
+            nanosleep(&Request, NULL);
+        }
+    }
+}
+
+#ifdef __APPLE__
+internal OSStatus
+DeviceCallback(void *User, AudioUnitRenderActionFlags *Flags, const AudioTimeStamp *TimeStamp,
+               UInt32 Bus, UInt32 Frames, AudioBufferList *Data)
+{
+    Chip8AudioRender((chip8_audio *) User, (float *) Data->mBuffers[0].mData, Frames);
+    return noErr;
+}
+
+internal UInt32
+GetDeviceProperty(AudioObjectID Device, AudioObjectPropertySelector Selector)
+{
+    AudioObjectPropertyAddress Address = { Selector, kAudioDevicePropertyScopeOutput, kAudioObjectPropertyElementMaster };
+    UInt32 Value = 0;
+    UInt32 Size = sizeof(Value);
+    AudioObjectGetPropertyData(Device, &Address, 0, NULL, &Size, &Value);
+    return Value;
+}
+
+/* NOTE(koekeishiya): The default output unit in 32-bit float mono. The device buffer is
+ * asked to shrink to one period, because the default of 512 frames alone would take most
+ * of the latency budget; a device that refuses keeps its own. */
+internal bool
+OpenDevice(chip8_audio *Audio)
+{
+    AudioComponentDescription Description = {};
+    Description.componentType = kAudioUnitType_Output;
+    Description.componentSubType = kAudioUnitSubType_DefaultOutput;
+    Description.componentManufacturer = kAudioUnitManufacturer_Apple;
+
+    AudioComponent Component = AudioComponentFindNext(NULL, &Description);
+    AudioUnit Unit;
+    if(!Component || AudioComponentInstanceNew(Component, &Unit) != noErr)
+        return false;
+
+    AudioStreamBasicDescription Format = {};
+    Format.mSampleRate = CHIP8_AUDIO_RATE;
+    Format.mFormatID = kAudioFormatLinearPCM;
+    Format.mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked;
+    Format.mBytesPerPacket = sizeof(float);
+    Format.mFramesPerPacket = 1;
+    Format.mBytesPerFrame = sizeof(float);
+    Format.mChannelsPerFrame = 1;
+    Format.mBitsPerChannel = 32;
+
+    AURenderCallbackStruct Callback = { DeviceCallback, Audio };
+    if(AudioUnitSetProperty(Unit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Input, 0, &Format, sizeof(Format)) != noErr ||
+       AudioUnitSetProperty(Unit, kAudioUnitProperty_SetRenderCallback, kAudioUnitScope_Input, 0, &Callback, sizeof(Callback)) != noErr)
+    {
+        AudioComponentInstanceDispose(Unit);
+        return false;
+    }
+
+    AudioObjectID Device = 0;
+    UInt32 Size = sizeof(Device);
+    if(AudioUnitGetProperty(Unit, kAudioOutputUnitProperty_CurrentDevice, kAudioUnitScope_Global, 0, &Device, &Size) == noErr)
+    {
+        AudioObjectPropertyAddress Address = { kAudioDevicePropertyBufferFrameSize, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster };
+        UInt32 Frames = CHIP8_AUDIO_PERIOD;
+        AudioObjectSetPropertyData(Device, &Address, 0, NULL, sizeof(Frames), &Frames);
+
+        Float64 Rate = 0;
+        Address.mSelector = kAudioDevicePropertyNominalSampleRate;
+        Size = sizeof(Rate);
+        AudioObjectGetPropertyData(Device, &Address, 0, NULL, &Size, &Rate);
+
+        UInt32 Buffered = GetDeviceProperty(Device, kAudioDevicePropertyBufferFrameSize) +
+                          GetDeviceProperty(Device, kAudioDevicePropertyLatency) +
+                          GetDeviceProperty(Device, kAudioDevicePropertySafetyOffset);
+        if(Rate > 0)
+            Audio->DeviceLatencyNanos = (unsigned long long)(Buffered * 1E9 / Rate);
+    }
+
+    if(AudioUnitInitialize(Unit) != noErr)
+    {
+        AudioComponentInstanceDispose(Unit);
+        return false;
+    }
+
+    Audio->Device = Unit;
+    return true;
+}
+
+internal bool
+StartDevice(chip8_audio *Audio)
+{
+    return AudioOutputUnitStart((AudioUnit) Audio->Device) == noErr;
+}
+
+internal void
+CloseDevice(chip8_audio *Audio)
+{
+    AudioUnit Unit = (AudioUnit) Audio->Device;
+    AudioOutputUnitStop(Unit);
+    AudioUnitUninitialize(Unit);
+    AudioComponentInstanceDispose(Unit);
+}
+#else
+internal bool OpenDevice(chip8_audio *) { return false; }
+internal bool StartDevice(chip8_audio *) { return false; }
+internal void CloseDevice(chip8_audio *) {}
+#endif
+
+bool Chip8AudioOpen(chip8_audio *Audio, chip8_audio_backend Backend, const char *Path)
+{
+    Audio->Ring.Head.store(0, std::memory_order_relaxed);
+    Audio->Ring.Tail.store(0, std::memory_order_relaxed);
+    Audio->Backend = Backend;
+    Audio->Realtime = false;
+    Audio->Phase = 0.0;
+    Audio->Level = 0.0f;
+    Audio->Gate = false;
+    Audio->Wav = NULL;
+    Audio->Running.store(false, std::memory_order_relaxed);
+    Audio->Device = NULL;
+    Audio->DeviceLatencyNanos = 0;
+    memset(&Audio->Stats, 0, sizeof(Audio->Stats));
+
+    switch(Backend)
+    {
+        case Chip8Audio_Null:
+        {
+            return true;
+        } break;
+        case Chip8Audio_Wav:
+        {
+            Audio->Wav = Path ? fopen(Path, "wb") : NULL;
+            if(Audio->Wav && WriteWavHeader(Audio->Wav, 0))
+                return true;
+
+            if(Audio->Wav)
+                fclose(Audio->Wav);
+            Audio->Wav = NULL;
+            return false;
+        } break;
+        case Chip8Audio_Device:
+        {
+            return OpenDevice(Audio);
+        } break;
+        default:
+        {
+            return false;
+        } break;
+    }
+}
+
+bool Chip8AudioStart(chip8_audio *Audio)
+{
+    Audio->Realtime = true;
+    if(Audio->Backend == Chip8Audio_Device)
+        return StartDevice(Audio);
+
+    Audio->Running.store(true, std::memory_order_relaxed);
+    Audio->Thread = std::thread(PacingThread, Audio);
+    return true;
+}
+
+void Chip8AudioClose(chip8_audio *Audio)
+{
+    if(Audio->Running.exchange(false))
+        Audio->Thread.join();
+
+    if(Audio->Device)
+        CloseDevice(Audio);
+    Audio->Device = NULL;
+
+    if(Audio->Wav)
+    {
+        WriteWavHeader(Audio->Wav, Audio->Stats.Frames);
+        fclose(Audio->Wav);
+        Audio->Wav = NULL;
+    }
+}
+
+bool Chip8AudioPush(chip8_audio *Audio, bool On, unsigned long long Nanos)
+{
+    chip8_audio_ring *Ring = &Audio->Ring;
+    unsigned int Head = Ring->Head.load(std::memory_order_relaxed);
+    unsigned int Tail = Ring->Tail.load(std::memory_order_acquire);
+    if(Head - Tail == CHIP8_AUDIO_RING_SIZE)
+    {
+        ++Audio->Stats.Dropped;
+        return false;
+    }
+
+    Ring->Events[Head & RING_MASK].Nanos = Nanos;
+    Ring->Events[Head & RING_MASK].On = On;
+    Ring->Head.store(Head + 1, std::memory_order_release);
+    ++Audio->Stats.Events;
+    return true;
+}
+
+chip8_audio_stats Chip8AudioGetStats(chip8_audio *Audio)
+{
+    return Audio->Stats;
+}
+
+const char *Chip8AudioName(chip8_audio_backend Backend)
+{
+    return Backend < Chip8Audio_Count ? Chip8AudioNames[Backend] : "unknown";
+}
+
+bool Chip8AudioFromName(const char *Name, chip8_audio_backend *Backend)
+{
+    for(int Index = 0; Index < Chip8Audio_Count; ++Index)
+    {
+        if(strcmp(Name, Chip8AudioNames[Index]) == 0)
+        {
+            *Backend = (chip8_audio_backend) Index;
+            return true;
+        }
+    }
+    return false;
+}
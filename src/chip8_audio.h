@@ -0,0 +1,113 @@
+#ifndef CHIP_8_AUDIO
+#define CHIP_8_AUDIO
+
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+
+#define CHIP8_AUDIO_RATE 48000
+#define CHIP8_AUDIO_TONE 440
+
+/* NOTE(koekeishiya): Frames rendered per callback by the backends that pace themselves,
+ * 2.7 ms at 48 kHz. */
+#define CHIP8_AUDIO_PERIOD 128
+
+/* NOTE(koekeishiya): Must be a power of two. */
+#define CHIP8_AUDIO_RING_SIZE 256
+
+enum chip8_audio_backend
+{
+    Chip8Audio_Null,
+    Chip8Audio_Wav,
+    Chip8Audio_Device,
+
+    Chip8Audio_Count
+};
+
+/* NOTE(koekeishiya): The buzzer turning on or off, stamped with the time the emulated
+ * frame that caused it started. */
+struct chip8_audio_event
+{
+    unsigned long long Nanos;
+    bool On;
+};
+
+/* NOTE(koekeishiya): Lock-free ring for a single producer and a single consumer. The
+ * producer only writes Head and the consumer only writes Tail, each on its own cache
+ * line. A full ring drops the newest event rather than waiting. */
+struct chip8_audio_ring
+{
+    chip8_audio_event Events[CHIP8_AUDIO_RING_SIZE];
+    alignas(64) std::atomic<unsigned int> Head;
+    alignas(64) std::atomic<unsigned int> Tail;
+};
+
+/* NOTE(koekeishiya): Latency runs from the start of the emulated frame that changed the
+ * buzzer to the output time of the first sample rendered with the change, which is the
+ * time of the callback plus whatever the device reports it buffers after it. */
+struct chip8_audio_stats
+{
+    unsigned long long Events;
+    unsigned long long Dropped;
+    unsigned long long Frames;
+    unsigned long long Callbacks;
+    unsigned long long LatencyNanos;
+    unsigned long long MaxLatencyNanos;
+};
+
+/* NOTE(koekeishiya): The emulation thread only ever calls Chip8AudioPush, which neither
+ * allocates nor locks. Everything else below Ring belongs to whoever renders: the thread
+ * or device callback of a started backend, or the caller of Chip8AudioPull. */
+struct chip8_audio
+{
+    chip8_audio_ring Ring;
+
+    chip8_audio_backend Backend;
+    bool Realtime;
+
+    /* NOTE(koekeishiya): Square wave phase in cycles, the envelope level and whether
+     * the buzzer is meant to sound. */
+    double Phase;
+    float Level;
+    bool Gate;
+
+    FILE *Wav;
+    std::thread Thread;
+    std::atomic<bool> Running;
+    void *Device;
+    unsigned long long DeviceLatencyNanos;
+
+    chip8_audio_stats Stats;
+};
+
+/* NOTE(koekeishiya): Open a backend. Wav writes 16-bit mono samples to Path. Device is
+ * the default output of the host and only exists on macOS. */
+bool Chip8AudioOpen(chip8_audio *Audio, chip8_audio_backend Backend, const char *Path);
+
+/* NOTE(koekeishiya): Start rendering in real time, from the audio device or, for null and
+ * wav, from a thread that renders CHIP8_AUDIO_PERIOD frames at a time. */
+bool Chip8AudioStart(chip8_audio *Audio);
+
+/* NOTE(koekeishiya): Stop, finish the wav file and release the backend. */
+void Chip8AudioClose(chip8_audio *Audio);
+
+/* NOTE(koekeishiya): Producer side. Returns false if the ring was full and the event was
+ * dropped. */
+bool Chip8AudioPush(chip8_audio *Audio, bool On, unsigned long long Nanos);
+
+/* NOTE(koekeishiya): Render Frames samples into the backend on the calling thread, for
+ * backends that were opened but not started. Used to write the audio of a run in
+ * emulated rather than wall-clock time. */
+void Chip8AudioPull(chip8_audio *Audio, unsigned int Frames);
+
+/* NOTE(koekeishiya): Synthesize Frames samples after applying all pending events. The
+ * tone is a band-limited square (PolyBLEP) and it fades in and out over about 2 ms, so
+ * that neither its edges nor the buzzer switching make it click. */
+void Chip8AudioRender(chip8_audio *Audio, float *Samples, unsigned int Frames);
+
+chip8_audio_stats Chip8AudioGetStats(chip8_audio *Audio);
+
+const char *Chip8AudioName(chip8_audio_backend Backend);
+bool Chip8AudioFromName(const char *Name, chip8_audio_backend *Backend);
+
+#endif
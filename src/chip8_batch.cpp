@@ -0,0 +1,763 @@
+#include "chip8_batch.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHIP8_BATCH_AVX2 1
+#endif
+
+#define internal static
+#define LANES CHIP8_BATCH_LANES
+
+struct chip8_batch
+{
+    unsigned char V[16][LANES];
+    unsigned char DelayTimer[LANES];
+    unsigned char SoundTimer[LANES];
+    unsigned short Pc[LANES];
+    unsigned short I[LANES];
+    unsigned short Opcode[LANES];
+    unsigned short Sp[LANES];
+    unsigned short Stack[16][LANES];
+    unsigned char Key[16][LANES];
+    bool Draw[LANES];
+    bool Paused[LANES];
+    unsigned long long RandomState[LANES];
+    unsigned long long Graphics[DISPLAY_HEIGHT][LANES];
+    unsigned int DirtyRows[LANES];
+    unsigned char Memory[LANES][0x1000];
+
+    /* NOTE(koekeishiya): Cycles executed by every lane during the current run. */
+    unsigned int Executed[LANES];
+
+    int Lanes;
+    unsigned char Quirks;
+    bool Vectorized;
+    bool SkipIdle;
+
+    /* NOTE(koekeishiya): While false, Memory is identical in every lane, so lanes with equal
+     * program counters are guaranteed to be executing the same instruction. */
+    bool MemoryDiverged;
+    bool MemoryUnknown;
+
+    chip8_batch_stats Stats;
+};
+
+/* NOTE(koekeishiya): Execute one instruction in a single lane. This mirrors Chip8Step,
+ * except that out of range indices are masked instead of running off the arrays. Like
+ * Chip8Step, everything down to the run loops is specialized for the quirk profile. */
+template<int Quirks> internal void
+BatchStepLane(chip8_batch *B, int L)
+{
+    const chip8_quirk_set &Quirk = Chip8QuirkSets[Quirks];
+
+    unsigned char *Memory = B->Memory[L];
+    unsigned short Pc = B->Pc[L];
+    unsigned short Opcode = Memory[Pc & 0xFFF] << 8 | Memory[(Pc + 1) & 0xFFF];
+    B->Opcode[L] = Opcode;
+    B->Pc[L] = Pc + 2;
+
+    unsigned short X = (Opcode & 0x0F00) >> 8;
+    unsigned short Y = (Opcode & 0x00F0) >> 4;
+    unsigned char NN = Opcode & 0x00FF;
+
+#define VX B->V[X][L]
+#define VY B->V[Y][L]
+#define VF B->V[0xF][L]
+
+    switch(Opcode & 0xF000)
+    {
+        case 0x0000:
+        {
+            if(Opcode == 0x00E0)
+            {
+                for(int Row = 0; Row < DISPLAY_HEIGHT; ++Row)
+                    B->Graphics[Row][L] = 0;
+                B->DirtyRows[L] = 0xFFFFFFFF;
+                B->Draw[L] = true;
+            }
+            else if(Opcode == 0x00EE)
+            {
+                B->Pc[L] = B->Stack[--B->Sp[L] & 0xF][L];
+            }
+        } break;
+        case 0x1000: B->Pc[L] = Opcode & 0x0FFF; break;
+        case 0x2000:
+        {
+            B->Stack[B->Sp[L]++ & 0xF][L] = B->Pc[L];
+            B->Pc[L] = Opcode & 0x0FFF;
+        } break;
+        case 0x3000: if(VX == NN) B->Pc[L] += 2; break;
+        case 0x4000: if(VX != NN) B->Pc[L] += 2; break;
+        case 0x5000: if(VX == VY) B->Pc[L] += 2; break;
+        case 0x6000: VX = NN; break;
+        case 0x7000: VX += NN; break;
+        case 0x8000:
+        {
+            switch(Opcode & 0x000F)
+            {
+                case 0x0000: VX = VY; break;
+                case 0x0001: VX |= VY; if(Quirk.LogicResetsVF) VF = 0; break;
+                case 0x0002: VX &= VY; if(Quirk.LogicResetsVF) VF = 0; break;
+                case 0x0003: VX ^= VY; if(Quirk.LogicResetsVF) VF = 0; break;
+                case 0x0004:
+                {
+                    unsigned short Sum = VX + VY;
+                    VX = Sum & 0xFF;
+                    VF = Sum > 255;
+                } break;
+                case 0x0005:
+                {
+                    unsigned char NoBorrow = VX >= VY;
+                    VX -= VY;
+                    VF = NoBorrow;
+                } break;
+                case 0x0006:
+                {
+                    unsigned char Source = Quirk.ShiftReadsVY ? VY : VX;
+                    VX = Source >> 1;
+                    VF = Source & 0x1;
+                } break;
+                case 0x0007:
+                {
+                    unsigned char NoBorrow = VY >= VX;
+                    VX = VY - VX;
+                    VF = NoBorrow;
+                } break;
+                case 0x000E:
+                {
+                    unsigned char Source = Quirk.ShiftReadsVY ? VY : VX;
+                    VX = Source << 1;
+                    VF = Source >> 7;
+                } break;
+            }
+        } break;
+        case 0x9000: if(VX != VY) B->Pc[L] += 2; break;
+        case 0xA000: B->I[L] = Opcode & 0x0FFF; break;
+        case 0xB000: B->Pc[L] = (Opcode & 0x0FFF) + B->V[Quirk.JumpUsesVX ? X : 0][L]; break;
+        case 0xC000: VX = Chip8NextRandom(&B->RandomState[L]) & NN; break;
+        case 0xD000:
+        {
+            VF = 0;
+            unsigned short RegisterX = VX % DISPLAY_WIDTH;
+            unsigned short RegisterY = VY % DISPLAY_HEIGHT;
+            unsigned short Height = Opcode & 0x000F;
+
+            if(Height > DISPLAY_HEIGHT - RegisterY)
+                Height = DISPLAY_HEIGHT - RegisterY;
+
+            for(int Row = 0; Row < Height; ++Row)
+            {
+                unsigned long long Sprite = Memory[(B->I[L] + Row) & 0xFFF];
+                unsigned long long Bits = (Sprite << (DISPLAY_WIDTH - 8)) >> RegisterX;
+                unsigned long long *Line = &B->Graphics[RegisterY + Row][L];
+
+                if(*Line & Bits)
+                    VF = 1;
+
+                if(Bits)
+                    B->DirtyRows[L] |= 1u << (RegisterY + Row);
+
+                *Line ^= Bits;
+            }
+
+            B->Draw[L] = true;
+        } break;
+        case 0xE000:
+        {
+            if(NN == 0x9E && B->Key[VX & 0xF][L] == 1)
+                B->Pc[L] += 2;
+            else if(NN == 0xA1 && B->Key[VX & 0xF][L] != 1)
+                B->Pc[L] += 2;
+        } break;
+        case 0xF000:
+        {
+            switch(NN)
+            {
+                case 0x07: VX = B->DelayTimer[L]; break;
+                case 0x0A:
+                {
+                    bool Keypress = false;
+                    for(int Index = 0; Index < 16; ++Index)
+                    {
+                        if(B->Key[Index][L] == 1)
+                        {
+                            VX = Index;
+                            Keypress = true;
+                        }
+                    }
+
+                    if(!Keypress)
+                        B->Pc[L] -= 2;
+                } break;
+                case 0x15: B->DelayTimer[L] = VX; break;
+                case 0x18: B->SoundTimer[L] = VX; break;
+                case 0x1E: B->I[L] += VX; break;
+                case 0x29: B->I[L] = VX * 5; break;
+                case 0x33:
+                {
+                    unsigned char Digit = VX;
+                    for(int Index = 3; Index > 0; --Index)
+                    {
+                        Memory[(B->I[L] + Index - 1) & 0xFFF] = Digit % 10;
+                        Digit /= 10;
+                    }
+                    B->MemoryDiverged = true;
+                } break;
+                case 0x55:
+                {
+                    for(int Index = 0; Index <= X; ++Index)
+                        Memory[(B->I[L] + Index) & 0xFFF] = B->V[Index][L];
+                    B->MemoryDiverged = true;
+
+                    if(Quirk.IndexAdvance != Chip8Index_Unchanged)
+                        B->I[L] += X + (Quirk.IndexAdvance == Chip8Index_PlusXPlusOne);
+                } break;
+                case 0x65:
+                {
+                    for(int Index = 0; Index <= X; ++Index)
+                        B->V[Index][L] = Memory[(B->I[L] + Index) & 0xFFF];
+
+                    if(Quirk.IndexAdvance != Chip8Index_Unchanged)
+                        B->I[L] += X + (Quirk.IndexAdvance == Chip8Index_PlusXPlusOne);
+                } break;
+            }
+        } break;
+    }
+
+#undef VX
+#undef VY
+#undef VF
+}
+
+template<int Quirks> internal void
+BatchRunScalar(chip8_batch *B, unsigned long long Cycles, unsigned int Skip)
+{
+    for(int L = 0; L < B->Lanes; ++L)
+    {
+        if(Skip & (1u << L))
+            continue;
+
+        for(unsigned long long Cycle = 0; Cycle < Cycles; ++Cycle)
+            BatchStepLane<Quirks>(B, L);
+
+        B->Stats.ScalarLaneSteps += Cycles;
+    }
+}
+
+/* NOTE(koekeishiya): Lanes sitting in an idle loop only execute as many instructions as it
+ * takes to end up where the full run would have left them. Returns the lanes that have
+ * been run to completion this way. */
+template<int Quirks> internal unsigned int
+BatchSkipIdle(chip8_batch *B, unsigned long long Cycles)
+{
+    unsigned int MaxPeriod = Cycles / 2 < CHIP8_IDLE_MAX_PERIOD ? Cycles / 2 : CHIP8_IDLE_MAX_PERIOD;
+    unsigned int Skip = 0;
+
+    for(int L = 0; L < B->Lanes; ++L)
+    {
+        unsigned char Key[16];
+        chip8_idle_probe Probe;
+        Probe.Memory = B->Memory[L];
+        Probe.Key = Key;
+        Probe.Pc = B->Pc[L];
+        Probe.I = B->I[L];
+        Probe.Opcode = B->Opcode[L];
+        Probe.DelayTimer = B->DelayTimer[L];
+        Probe.Quirks = Quirks;
+
+        for(int Index = 0; Index < 16; ++Index)
+        {
+            Probe.V[Index] = B->V[Index][L];
+            Key[Index] = B->Key[Index][L];
+        }
+
+        chip8_idle Idle = Chip8ProbeIdle(&Probe, MaxPeriod);
+        if(Idle.Type == Chip8Idle_None)
+            continue;
+
+        unsigned long long Run = Chip8IdleCycles(&Idle, Cycles);
+        for(unsigned long long Cycle = 0; Cycle < Run; ++Cycle)
+            BatchStepLane<Quirks>(B, L);
+
+        B->Stats.ScalarLaneSteps += Run;
+        B->Stats.IdleLaneSteps += Cycles - Run;
+        Skip |= 1u << L;
+    }
+
+    return Skip;
+}
+
+#ifdef CHIP8_BATCH_AVX2
+
+#define AVX2 __attribute__((target("avx2")))
+#define LOAD(P) _mm256_loadu_si256((__m256i *)(P))
+#define STORE(P, Value) _mm256_storeu_si256((__m256i *)(P), (Value))
+#define BLEND(P, Value, Mask) STORE(P, _mm256_blendv_epi8(LOAD(P), (Value), (Mask)))
+
+/* NOTE(koekeishiya): A set of lanes as a byte mask for the V registers and timers, and as
+ * two 16-bit masks for Pc, I and Opcode (lanes 0-15 and 16-31). */
+struct batch_mask
+{
+    __m256i Bytes;
+    __m256i WordsLow;
+    __m256i WordsHigh;
+};
+
+AVX2 internal inline __m256i
+BatchWordMask(unsigned int Bits)
+{
+    const __m256i Select = _mm256_setr_epi16(1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 4, 1 << 5, 1 << 6, 1 << 7,
+                                             1 << 8, 1 << 9, 1 << 10, 1 << 11, 1 << 12, 1 << 13, 1 << 14,
+                                             (short)(1 << 15));
+    __m256i Broadcast = _mm256_set1_epi16((short)Bits);
+    return _mm256_cmpeq_epi16(_mm256_and_si256(Broadcast, Select), Select);
+}
+
+AVX2 internal inline batch_mask
+BatchExpandMask(unsigned int Bits)
+{
+    batch_mask Mask;
+    Mask.WordsLow = BatchWordMask(Bits & 0xFFFF);
+    Mask.WordsHigh = BatchWordMask(Bits >> 16);
+    Mask.Bytes = _mm256_permute4x64_epi64(_mm256_packs_epi16(Mask.WordsLow, Mask.WordsHigh), 0xD8);
+    return Mask;
+}
+
+/* NOTE(koekeishiya): Sign extend a byte mask (0 or -1 per lane) to the two 16-bit halves. */
+AVX2 internal inline void
+BatchWidenBytes(__m256i Bytes, __m256i *Low, __m256i *High)
+{
+    *Low = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(Bytes));
+    *High = _mm256_cvtepi8_epi16(_mm256_extracti128_si256(Bytes, 1));
+}
+
+AVX2 internal inline void
+BatchBlendWords(unsigned short *Words, __m256i Low, __m256i High, batch_mask *Mask)
+{
+    BLEND(Words, Low, Mask->WordsLow);
+    BLEND(Words + 16, High, Mask->WordsHigh);
+}
+
+/* NOTE(koekeishiya): Execute Opcode in every lane of Mask with one vector kernel. Returns
+ * false without touching any state when the instruction has no kernel. */
+template<int Quirks> AVX2 internal bool
+BatchStepVector(chip8_batch *B, unsigned short Opcode, batch_mask *Mask)
+{
+    const chip8_quirk_set &Quirk = Chip8QuirkSets[Quirks];
+
+    int X = (Opcode & 0x0F00) >> 8;
+    int Y = (Opcode & 0x00F0) >> 4;
+    __m256i NN = _mm256_set1_epi8((char)(Opcode & 0x00FF));
+    __m256i NNN = _mm256_set1_epi16((short)(Opcode & 0x0FFF));
+    __m256i Zero = _mm256_setzero_si256();
+    __m256i Ones = _mm256_set1_epi8(-1);
+
+    /* NOTE(koekeishiya): Lanes that skip the next instruction, and whether Pc is replaced. */
+    __m256i Skip = Zero;
+    bool Jump = false;
+
+    switch(Opcode & 0xF000)
+    {
+        case 0x1000:
+        {
+            BatchBlendWords(B->Pc, NNN, NNN, Mask);
+            Jump = true;
+        } break;
+        case 0x3000: Skip = _mm256_cmpeq_epi8(LOAD(B->V[X]), NN); break;
+        case 0x4000: Skip = _mm256_xor_si256(_mm256_cmpeq_epi8(LOAD(B->V[X]), NN), Ones); break;
+        case 0x5000: Skip = _mm256_cmpeq_epi8(LOAD(B->V[X]), LOAD(B->V[Y])); break;
+        case 0x9000: Skip = _mm256_xor_si256(_mm256_cmpeq_epi8(LOAD(B->V[X]), LOAD(B->V[Y])), Ones); break;
+        case 0x6000: BLEND(B->V[X], NN, Mask->Bytes); break;
+        case 0x7000: BLEND(B->V[X], _mm256_add_epi8(LOAD(B->V[X]), NN), Mask->Bytes); break;
+        case 0x8000:
+        {
+            int Operation = Opcode & 0x000F;
+            bool Shift = Operation == 0x6 || Operation == 0xE;
+            __m256i A = LOAD(B->V[(Shift && Quirk.ShiftReadsVY) ? Y : X]);
+            __m256i C = LOAD(B->V[Y]);
+
+            /* NOTE(koekeishiya): Both operands are loaded before anything is stored and VF
+             * is stored last, which is the order Chip8Step uses, so VF may be an operand. */
+            bool Flags = Operation >= 0x4 || (Operation != 0x0 && Quirk.LogicResetsVF);
+
+            __m256i Result, Flag = Zero;
+            switch(Operation)
+            {
+                case 0x0: Result = C; break;
+                case 0x1: Result = _mm256_or_si256(A, C); break;
+                case 0x2: Result = _mm256_and_si256(A, C); break;
+                case 0x3: Result = _mm256_xor_si256(A, C); break;
+                case 0x4:
+                {
+                    /* NOTE(koekeishiya): There was a carry when the wrapped sum is below VX. */
+                    Result = _mm256_add_epi8(A, C);
+                    Flag = _mm256_xor_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(Result, A), Result), Ones);
+                } break;
+                case 0x5:
+                {
+                    Result = _mm256_sub_epi8(A, C);
+                    Flag = _mm256_cmpeq_epi8(_mm256_max_epu8(A, C), A);
+                } break;
+                case 0x7:
+                {
+                    Result = _mm256_sub_epi8(C, A);
+                    Flag = _mm256_cmpeq_epi8(_mm256_max_epu8(C, A), C);
+                } break;
+                case 0x6:
+                {
+                    Flag = _mm256_and_si256(A, _mm256_set1_epi8(0x01));
+                    Result = _mm256_and_si256(_mm256_srli_epi16(A, 1), _mm256_set1_epi8(0x7F));
+                } break;
+                case 0xE:
+                {
+                    Flag = _mm256_and_si256(_mm256_srli_epi16(A, 7), _mm256_set1_epi8(0x01));
+                    Result = _mm256_add_epi8(A, A);
+                } break;
+                default: return false;
+            }
+
+            if(Operation == 0x4 || Operation == 0x5 || Operation == 0x7)
+                Flag = _mm256_and_si256(Flag, _mm256_set1_epi8(0x01));
+
+            BLEND(B->V[X], Result, Mask->Bytes);
+            if(Flags)
+                BLEND(B->V[0xF], Flag, Mask->Bytes);
+        } break;
+        case 0xA000:
+        {
+            BatchBlendWords(B->I, NNN, NNN, Mask);
+        } break;
+        case 0xF000:
+        {
+            switch(Opcode & 0x00FF)
+            {
+                case 0x07: BLEND(B->V[X], LOAD(B->DelayTimer), Mask->Bytes); break;
+                case 0x15: BLEND(B->DelayTimer, LOAD(B->V[X]), Mask->Bytes); break;
+                case 0x18: BLEND(B->SoundTimer, LOAD(B->V[X]), Mask->Bytes); break;
+                case 0x1E:
+                case 0x29:
+                {
+                    __m256i Value = LOAD(B->V[X]);
+                    __m256i Low = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(Value));
+                    __m256i High = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(Value, 1));
+
+                    if((Opcode & 0x00FF) == 0x1E)
+                    {
+                        Low = _mm256_add_epi16(LOAD(B->I), Low);
+                        High = _mm256_add_epi16(LOAD(B->I + 16), High);
+                    }
+                    else
+                    {
+                        Low = _mm256_mullo_epi16(Low, _mm256_set1_epi16(5));
+                        High = _mm256_mullo_epi16(High, _mm256_set1_epi16(5));
+                    }
+
+                    BatchBlendWords(B->I, Low, High, Mask);
+                } break;
+                default: return false;
+            }
+        } break;
+        default: return false;
+    }
+
+    __m256i OpcodeWords = _mm256_set1_epi16((short)Opcode);
+    BatchBlendWords(B->Opcode, OpcodeWords, OpcodeWords, Mask);
+
+    if(!Jump)
+    {
+        /* NOTE(koekeishiya): Pc += 2, plus another 2 in lanes that skip. */
+        __m256i SkipLow, SkipHigh;
+        BatchWidenBytes(Skip, &SkipLow, &SkipHigh);
+
+        __m256i Two = _mm256_set1_epi16(2);
+        __m256i Low = _mm256_add_epi16(LOAD(B->Pc), _mm256_add_epi16(Two, _mm256_and_si256(SkipLow, Two)));
+        __m256i High = _mm256_add_epi16(LOAD(B->Pc + 16), _mm256_add_epi16(Two, _mm256_and_si256(SkipHigh, Two)));
+        BatchBlendWords(B->Pc, Low, High, Mask);
+    }
+
+    return true;
+}
+
+/* NOTE(koekeishiya): After FX33 or FX55 ran in every lane at once, Memory is still the same
+ * everywhere if every lane wrote the same bytes to the same place. */
+internal bool
+BatchSameWrite(chip8_batch *B, unsigned short Opcode, unsigned short Advance)
+{
+    unsigned int Count = (Opcode & 0x00FF) == 0x33 ? 3 : ((Opcode & 0x0F00) >> 8) + 1;
+    unsigned short Start = B->I[0] - Advance;
+    for(int L = 1; L < B->Lanes; ++L)
+    {
+        if(B->I[L] != B->I[0])
+            return false;
+
+        for(unsigned int Index = 0; Index < Count; ++Index)
+        {
+            unsigned int Address = (Start + Index) & 0xFFF;
+            if(B->Memory[L][Address] != B->Memory[0][Address])
+                return false;
+        }
+    }
+
+    return true;
+}
+
+template<int Quirks> AVX2 internal void
+BatchRunVector(chip8_batch *B, unsigned int Cycles, unsigned int Skip)
+{
+    unsigned int LaneMask = B->Lanes == 32 ? 0xFFFFFFFF : (1u << B->Lanes) - 1;
+    LaneMask &= ~Skip;
+    __m256i Limit = _mm256_set1_epi32((int)Cycles);
+    const __m256i LaneBits = _mm256_setr_epi32(1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 4, 1 << 5, 1 << 6, 1 << 7);
+
+    memset(B->Executed, 0, sizeof(B->Executed));
+
+    for(;;)
+    {
+        /* NOTE(koekeishiya): Lanes that still have cycles left to run. */
+        unsigned int Active = 0;
+        for(int Part = 0; Part < 4; ++Part)
+        {
+            __m256i Left = _mm256_cmpgt_epi32(Limit, LOAD(B->Executed + 8 * Part));
+            Active |= (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(Left)) << (8 * Part);
+        }
+
+        Active &= LaneMask;
+        if(!Active)
+            break;
+
+        /* NOTE(koekeishiya): Step the lanes at the lowest pc first, which lets lanes that
+         * fell behind after a branch catch up and reconverge with the others. */
+        __m256i ActiveLow = BatchWordMask(Active & 0xFFFF);
+        __m256i ActiveHigh = BatchWordMask(Active >> 16);
+        __m256i PcLow = _mm256_or_si256(LOAD(B->Pc), _mm256_xor_si256(ActiveLow, _mm256_set1_epi8(-1)));
+        __m256i PcHigh = _mm256_or_si256(LOAD(B->Pc + 16), _mm256_xor_si256(ActiveHigh, _mm256_set1_epi8(-1)));
+        __m256i PcMin = _mm256_min_epu16(PcLow, PcHigh);
+        __m128i Half = _mm_min_epu16(_mm256_castsi256_si128(PcMin), _mm256_extracti128_si256(PcMin, 1));
+        unsigned short MinPc = (unsigned short)_mm_cvtsi128_si32(_mm_minpos_epu16(Half));
+
+        __m256i Target = _mm256_set1_epi16((short)MinPc);
+        __m256i GroupLow = _mm256_and_si256(_mm256_cmpeq_epi16(PcLow, Target), ActiveLow);
+        __m256i GroupHigh = _mm256_and_si256(_mm256_cmpeq_epi16(PcHigh, Target), ActiveHigh);
+        __m256i GroupBytes = _mm256_permute4x64_epi64(_mm256_packs_epi16(GroupLow, GroupHigh), 0xD8);
+        unsigned int Group = (unsigned int)_mm256_movemask_epi8(GroupBytes);
+
+        int First = __builtin_ctz(Group);
+        unsigned short Opcode = B->Memory[First][MinPc & 0xFFF] << 8 | B->Memory[First][(MinPc + 1) & 0xFFF];
+
+        if(B->MemoryDiverged)
+        {
+            /* NOTE(koekeishiya): Lanes at the same pc may be looking at different code. */
+            for(unsigned int Rest = Group & (Group - 1); Rest; Rest &= Rest - 1)
+            {
+                int L = __builtin_ctz(Rest);
+                unsigned short Other = B->Memory[L][MinPc & 0xFFF] << 8 | B->Memory[L][(MinPc + 1) & 0xFFF];
+                if(Other != Opcode)
+                    Group &= ~(1u << L);
+            }
+        }
+
+        int Count = __builtin_popcount(Group);
+        batch_mask Mask = BatchExpandMask(Group);
+
+        if(Count > 1 && BatchStepVector<Quirks>(B, Opcode, &Mask))
+        {
+            ++B->Stats.VectorSteps;
+            B->Stats.VectorLaneSteps += Count;
+        }
+        else
+        {
+            bool Writes = (Opcode & 0xF0FF) == 0xF033 || (Opcode & 0xF0FF) == 0xF055;
+            bool WasDiverged = B->MemoryDiverged;
+
+            for(unsigned int Rest = Group; Rest; Rest &= Rest - 1)
+                BatchStepLane<Quirks>(B, __builtin_ctz(Rest));
+
+            /* NOTE(koekeishiya): How far FX55 moved I past the bytes it wrote. */
+            chip8_index_quirk IndexAdvance = Chip8QuirkSets[Quirks].IndexAdvance;
+            unsigned short Advance = 0;
+            if((Opcode & 0xF0FF) == 0xF055 && IndexAdvance != Chip8Index_Unchanged)
+                Advance = ((Opcode & 0x0F00) >> 8) + (IndexAdvance == Chip8Index_PlusXPlusOne);
+
+            if(Writes && !WasDiverged && Group == LaneMask && BatchSameWrite(B, Opcode, Advance))
+                B->MemoryDiverged = false;
+
+            B->Stats.ScalarLaneSteps += Count;
+        }
+
+        for(int Part = 0; Part < 4; ++Part)
+        {
+            __m256i Bits = _mm256_set1_epi32((int)(Group >> (8 * Part)));
+            __m256i Stepped = _mm256_cmpeq_epi32(_mm256_and_si256(Bits, LaneBits), LaneBits);
+            STORE(B->Executed + 8 * Part, _mm256_sub_epi32(LOAD(B->Executed + 8 * Part), Stepped));
+        }
+    }
+}
+
+#endif
+
+chip8_batch *Chip8BatchCreate()
+{
+    chip8_batch *Batch = (chip8_batch *) calloc(1, sizeof(chip8_batch));
+    if(!Batch)
+        return NULL;
+
+#ifdef CHIP8_BATCH_AVX2
+    Batch->Vectorized = __builtin_cpu_supports("avx2");
+#endif
+
+    Batch->SkipIdle = true;
+
+    return Batch;
+}
+
+void Chip8BatchDestroy(chip8_batch *Batch)
+{
+    free(Batch);
+}
+
+bool Chip8BatchSetLane(chip8_batch *Batch, int Lane, chip8 *Processor)
+{
+    bool Alone = Batch->Lanes == 0 || (Batch->Lanes == 1 && Lane == 0);
+    if(!Alone && Processor->Quirks != Batch->Quirks)
+        return false;
+
+    Batch->Pc[Lane] = Processor->Pc;
+    Batch->I[Lane] = Processor->I;
+    Batch->Opcode[Lane] = Processor->Opcode;
+    Batch->Sp[Lane] = Processor->Sp;
+    Batch->DelayTimer[Lane] = Processor->DelayTimer;
+    Batch->SoundTimer[Lane] = Processor->SoundTimer;
+    Batch->Draw[Lane] = Processor->Draw;
+    Batch->Paused[Lane] = Processor->Paused;
+    Batch->RandomState[Lane] = Processor->RandomState;
+    Batch->DirtyRows[Lane] = Processor->DirtyRows;
+    Batch->Quirks = Processor->Quirks;
+
+    for(int Index = 0; Index < 16; ++Index)
+    {
+        Batch->V[Index][Lane] = Processor->V[Index];
+        Batch->Stack[Index][Lane] = Processor->Stack[Index];
+        Batch->Key[Index][Lane] = Processor->Key[Index];
+    }
+
+    for(int Row = 0; Row < DISPLAY_HEIGHT; ++Row)
+        Batch->Graphics[Row][Lane] = Processor->Graphics[Row];
+
+    memcpy(Batch->Memory[Lane], Processor->Memory, sizeof(Processor->Memory));
+
+    if(Lane >= Batch->Lanes)
+        Batch->Lanes = Lane + 1;
+
+    Batch->MemoryUnknown = true;
+    return true;
+}
+
+void Chip8BatchGetLane(chip8_batch *Batch, int Lane, chip8 *Processor)
+{
+    Processor->Pc = Batch->Pc[Lane];
+    Processor->I = Batch->I[Lane];
+    Processor->Opcode = Batch->Opcode[Lane];
+    Processor->Sp = Batch->Sp[Lane];
+    Processor->DelayTimer = Batch->DelayTimer[Lane];
+    Processor->SoundTimer = Batch->SoundTimer[Lane];
+    Processor->Draw = Batch->Draw[Lane];
+    Processor->Paused = Batch->Paused[Lane];
+    Processor->RandomState = Batch->RandomState[Lane];
+    Processor->DirtyRows = Batch->DirtyRows[Lane];
+    Processor->Quirks = Batch->Quirks;
+
+    for(int Index = 0; Index < 16; ++Index)
+    {
+        Processor->V[Index] = Batch->V[Index][Lane];
+        Processor->Stack[Index] = Batch->Stack[Index][Lane];
+        Processor->Key[Index] = Batch->Key[Index][Lane];
+    }
+
+    for(int Row = 0; Row < DISPLAY_HEIGHT; ++Row)
+        Processor->Graphics[Row] = Batch->Graphics[Row][Lane];
+
+    memcpy(Processor->Memory, Batch->Memory[Lane], sizeof(Processor->Memory));
+}
+
+int Chip8BatchLaneCount(chip8_batch *Batch)
+{
+    return Batch->Lanes;
+}
+
+template<int Quirks> internal void
+BatchRun(chip8_batch *Batch, unsigned long long Cycles)
+{
+    if(Batch->MemoryUnknown)
+    {
+        Batch->MemoryDiverged = false;
+        for(int Lane = 1; Lane < Batch->Lanes; ++Lane)
+        {
+            if(memcmp(Batch->Memory[Lane], Batch->Memory[0], sizeof(Batch->Memory[0])) != 0)
+                Batch->MemoryDiverged = true;
+        }
+
+        Batch->MemoryUnknown = false;
+    }
+
+    unsigned int Skip = Batch->SkipIdle ? BatchSkipIdle<Quirks>(Batch, Cycles) : 0;
+
+#ifdef CHIP8_BATCH_AVX2
+    if(Batch->Vectorized)
+    {
+        while(Cycles > 0)
+        {
+            unsigned int Chunk = Cycles > 0x40000000 ? 0x40000000 : (unsigned int) Cycles;
+            BatchRunVector<Quirks>(Batch, Chunk, Skip);
+            Cycles -= Chunk;
+        }
+
+        return;
+    }
+#endif
+
+    BatchRunScalar<Quirks>(Batch, Cycles, Skip);
+}
+
+void Chip8BatchRun(chip8_batch *Batch, unsigned long long Cycles)
+{
+    if(Batch->Lanes == 0)
+        return;
+
+    switch(Batch->Quirks)
+    {
+        case Chip8Quirks_Chip8: BatchRun<Chip8Quirks_Chip8>(Batch, Cycles); break;
+        case Chip8Quirks_Chip48: BatchRun<Chip8Quirks_Chip48>(Batch, Cycles); break;
+        case Chip8Quirks_Schip: BatchRun<Chip8Quirks_Schip>(Batch, Cycles); break;
+        case Chip8Quirks_XoChip: BatchRun<Chip8Quirks_XoChip>(Batch, Cycles); break;
+        default: BatchRun<Chip8Quirks_Default>(Batch, Cycles); break;
+    }
+}
+
+void Chip8BatchSetSkipIdle(chip8_batch *Batch, bool SkipIdle)
+{
+    Batch->SkipIdle = SkipIdle;
+}
+
+void Chip8BatchTickTimers(chip8_batch *Batch)
+{
+    for(int Lane = 0; Lane < LANES; ++Lane)
+    {
+        if(Batch->DelayTimer[Lane] > 0)
+            --Batch->DelayTimer[Lane];
+
+        if(Batch->SoundTimer[Lane] > 0)
+            --Batch->SoundTimer[Lane];
+    }
+}
+
+chip8_batch_stats Chip8BatchGetStats(chip8_batch *Batch)
+{
+    return Batch->Stats;
+}
+
+bool Chip8BatchVectorized(chip8_batch *Batch)
+{
+    return Batch->Vectorized;
+}
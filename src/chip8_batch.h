@@ -0,0 +1,56 @@
+#ifndef CHIP_8_BATCH
+#define CHIP_8_BATCH
+
+#include "chip8.h"
+
+/* NOTE(koekeishiya): Number of instances stepped together, one AVX2 register holds one
+ * V register of every lane. */
+#define CHIP8_BATCH_LANES 32
+
+struct chip8_batch;
+
+struct chip8_batch_stats
+{
+    /* NOTE(koekeishiya): Lane-instructions executed by a vector kernel, and the number of
+     * kernel invocations. VectorLaneSteps / (VectorSteps * Lanes) is the occupancy. */
+    unsigned long long VectorSteps;
+    unsigned long long VectorLaneSteps;
+
+    /* NOTE(koekeishiya): Lane-instructions that were stepped one lane at a time, either
+     * because the lane had diverged or because the instruction has no vector kernel. */
+    unsigned long long ScalarLaneSteps;
+
+    /* NOTE(koekeishiya): Lane-instructions that were never executed because the lane was
+     * in an idle loop, see Chip8DetectIdle. */
+    unsigned long long IdleLaneSteps;
+};
+
+/* NOTE(koekeishiya): Structure-of-arrays engine running up to CHIP8_BATCH_LANES copies of
+ * chip8 side by side. Lanes are stepped with AVX2 kernels whenever their program counters
+ * agree, and one by one otherwise. Every lane ends up in exactly the state that running
+ * it on its own through Chip8DoCycle would give. */
+chip8_batch *Chip8BatchCreate();
+void Chip8BatchDestroy(chip8_batch *Batch);
+
+/* NOTE(koekeishiya): Copy a processor into or out of a lane. Lanes are used from 0 up to
+ * the highest lane that has been set. One quirk profile applies to the whole batch, so
+ * setting a lane fails if its processor has a different profile than the lanes already
+ * set; only lane 0 of a batch holding nothing else may change it. */
+bool Chip8BatchSetLane(chip8_batch *Batch, int Lane, chip8 *Processor);
+void Chip8BatchGetLane(chip8_batch *Batch, int Lane, chip8 *Processor);
+int Chip8BatchLaneCount(chip8_batch *Batch);
+
+/* NOTE(koekeishiya): Execute exactly the given number of cycles in every lane. */
+void Chip8BatchRun(chip8_batch *Batch, unsigned long long Cycles);
+void Chip8BatchTickTimers(chip8_batch *Batch);
+
+/* NOTE(koekeishiya): Fast-forward lanes that are in an idle loop instead of stepping them,
+ * on by default. The resulting state is the same either way. */
+void Chip8BatchSetSkipIdle(chip8_batch *Batch, bool SkipIdle);
+
+chip8_batch_stats Chip8BatchGetStats(chip8_batch *Batch);
+
+/* NOTE(koekeishiya): False when the host lacks AVX2, every lane is then stepped alone. */
+bool Chip8BatchVectorized(chip8_batch *Batch);
+
+#endif
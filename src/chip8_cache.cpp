@@ -0,0 +1,535 @@
+#include "chip8_cache.h"
+#include <string.h>
+
+#define internal static
+
+static const char *Chip8CacheSequenceNames[Chip8Fused_Count] =
+{
+    "6XNN;6YNN",
+    "ANNN;DXYN",
+    "3XNN/4XNN;1NNN",
+    "7XNN;3XNN/4XNN;1NNN",
+};
+
+/* NOTE(koekeishiya): Everything a slot can run, in the order of the label table in
+ * Chip8CacheRunSpecialized. Instructions that are rare or involved, like drawing, go
+ * through the interpreter. */
+enum chip8_cache_op
+{
+    CacheOp_Decode,
+    CacheOp_Interpret,
+
+    CacheOp_00EE,
+    CacheOp_1NNN,
+    CacheOp_2NNN,
+    CacheOp_3XNN,
+    CacheOp_4XNN,
+    CacheOp_5XY0,
+    CacheOp_6XNN,
+    CacheOp_7XNN,
+    CacheOp_8XY0,
+    CacheOp_8XY1,
+    CacheOp_8XY2,
+    CacheOp_8XY3,
+    CacheOp_8XY4,
+    CacheOp_8XY5,
+    CacheOp_8XY6,
+    CacheOp_8XY7,
+    CacheOp_8XYE,
+    CacheOp_9XY0,
+    CacheOp_ANNN,
+    CacheOp_BNNN,
+    CacheOp_CXNN,
+    CacheOp_EX9E,
+    CacheOp_EXA1,
+    CacheOp_FX07,
+    CacheOp_FX15,
+    CacheOp_FX18,
+    CacheOp_FX1E,
+    CacheOp_FX29,
+    CacheOp_FX33,
+    CacheOp_FX55,
+    CacheOp_FX65,
+
+    CacheOp_Fuse6XNN6YNN,
+    CacheOp_FuseANNNDXYN,
+    CacheOp_Fuse3XNN1NNN,
+    CacheOp_Fuse4XNN1NNN,
+    CacheOp_Fuse7XNN3XNN1NNN,
+    CacheOp_Fuse7XNN4XNN1NNN,
+
+    CacheOp_Count
+};
+
+internal unsigned char
+Chip8CacheSelectOp(unsigned short Opcode)
+{
+    switch(Opcode & 0xF000)
+    {
+        case 0x0000: return Opcode == 0x00EE ? CacheOp_00EE : CacheOp_Interpret;
+        case 0x1000: return CacheOp_1NNN;
+        case 0x2000: return CacheOp_2NNN;
+        case 0x3000: return CacheOp_3XNN;
+        case 0x4000: return CacheOp_4XNN;
+        case 0x5000: return CacheOp_5XY0;
+        case 0x6000: return CacheOp_6XNN;
+        case 0x7000: return CacheOp_7XNN;
+        case 0x8000:
+        {
+            switch(Opcode & 0x000F)
+            {
+                case 0x0000: return CacheOp_8XY0;
+                case 0x0001: return CacheOp_8XY1;
+                case 0x0002: return CacheOp_8XY2;
+                case 0x0003: return CacheOp_8XY3;
+                case 0x0004: return CacheOp_8XY4;
+                case 0x0005: return CacheOp_8XY5;
+                case 0x0006: return CacheOp_8XY6;
+                case 0x0007: return CacheOp_8XY7;
+                case 0x000E: return CacheOp_8XYE;
+            }
+        } break;
+        case 0x9000: return CacheOp_9XY0;
+        case 0xA000: return CacheOp_ANNN;
+        case 0xB000: return CacheOp_BNNN;
+        case 0xC000: return CacheOp_CXNN;
+        case 0xE000:
+        {
+            switch(Opcode & 0x00FF)
+            {
+                case 0x009E: return CacheOp_EX9E;
+                case 0x00A1: return CacheOp_EXA1;
+            }
+        } break;
+        case 0xF000:
+        {
+            switch(Opcode & 0x00FF)
+            {
+                case 0x0007: return CacheOp_FX07;
+                case 0x0015: return CacheOp_FX15;
+                case 0x0018: return CacheOp_FX18;
+                case 0x001E: return CacheOp_FX1E;
+                case 0x0029: return CacheOp_FX29;
+                case 0x0033: return CacheOp_FX33;
+                case 0x0055: return CacheOp_FX55;
+                case 0x0065: return CacheOp_FX65;
+            }
+        } break;
+    }
+
+    return CacheOp_Interpret;
+}
+
+/* NOTE(koekeishiya): Look at the instructions following the one at Address for a sequence
+ * that can be fused. Only the opcodes are kept, so the following slots are left alone
+ * and can still start sequences of their own when jumped to. */
+internal void
+Chip8CacheSelectFusion(chip8 *Processor, unsigned int Address, chip8_decoded *Instruction)
+{
+    unsigned short Next[CHIP8_CACHE_MAX_FUSED - 1] = {};
+    for(int Index = 0; Index < CHIP8_CACHE_MAX_FUSED - 1; ++Index)
+    {
+        unsigned int At = Address + 2 * (Index + 1);
+        if(At < 0x0FFF)
+            Next[Index] = Processor->Memory[At] << 8 | Processor->Memory[At + 1];
+    }
+
+    unsigned short Opcode = Instruction->Opcode;
+    bool Fits = Address + 2 < 0x0FFF;
+    bool FitsThree = Address + 4 < 0x0FFF;
+
+    switch(Opcode & 0xF000)
+    {
+        case 0x3000:
+        case 0x4000:
+        {
+            if(Fits && (Next[0] & 0xF000) == 0x1000)
+            {
+                Instruction->Entry = (Opcode & 0xF000) == 0x3000 ? CacheOp_Fuse3XNN1NNN : CacheOp_Fuse4XNN1NNN;
+                Instruction->FusedLength = 2;
+            }
+        } break;
+        case 0x6000:
+        {
+            if(Fits && (Next[0] & 0xF000) == 0x6000)
+            {
+                Instruction->Entry = CacheOp_Fuse6XNN6YNN;
+                Instruction->FusedLength = 2;
+            }
+        } break;
+        case 0x7000:
+        {
+            bool SameRegister = (Next[0] & 0x0F00) == (Opcode & 0x0F00);
+            bool Compare = (Next[0] & 0xF000) == 0x3000 || (Next[0] & 0xF000) == 0x4000;
+            if(FitsThree && SameRegister && Compare && (Next[1] & 0xF000) == 0x1000)
+            {
+                Instruction->Entry = (Next[0] & 0xF000) == 0x3000 ? CacheOp_Fuse7XNN3XNN1NNN : CacheOp_Fuse7XNN4XNN1NNN;
+                Instruction->FusedLength = 3;
+            }
+        } break;
+        case 0xA000:
+        {
+            if(Fits && (Next[0] & 0xF000) == 0xD000)
+            {
+                Instruction->Entry = CacheOp_FuseANNNDXYN;
+                Instruction->FusedLength = 2;
+            }
+        } break;
+    }
+
+    if(Instruction->Entry != Instruction->Op)
+        memcpy(Instruction->Next, Next, sizeof(Instruction->Next));
+}
+
+internal void
+Chip8CacheDecode(chip8_cache *Cache, chip8 *Processor, unsigned int Address, chip8_decoded *Instruction)
+{
+    unsigned short Opcode = Processor->Memory[Address] << 8 | Processor->Memory[Address + 1];
+
+    Instruction->Opcode = Opcode;
+    Instruction->NNN = Opcode & 0x0FFF;
+    Instruction->NN = Opcode & 0x00FF;
+    Instruction->X = (Opcode & 0x0F00) >> 8;
+    Instruction->Y = (Opcode & 0x00F0) >> 4;
+    Instruction->Op = Chip8CacheSelectOp(Opcode);
+    Instruction->Entry = Instruction->Op;
+    Instruction->FusedLength = 1;
+
+    if(Cache->Fuse)
+        Chip8CacheSelectFusion(Processor, Address, Instruction);
+
+    unsigned int End = Address + 2 * Instruction->FusedLength - 1;
+    if(Address < Cache->CodeLow)
+        Cache->CodeLow = Address;
+    if(End > Cache->CodeHigh)
+        Cache->CodeHigh = End;
+}
+
+/* NOTE(koekeishiya): Token threaded: every instruction ends by jumping straight to the
+ * code of the next slot, so there is no call, no return and no shared dispatch branch.
+ * Pc and Opcode live in locals and are only written back when the interpreter runs an
+ * instruction and on the way out. Every label mirrors the matching case in Chip8Step
+ * exactly, and the quirk checks fold away like they do there. Fused sequences end in
+ * exactly the state the single instructions would have left, Opcode being the last one
+ * executed; when the budget does not cover all of them the first one runs on its own. */
+template<int Quirks> internal void
+Chip8CacheRunSpecialized(chip8_cache *Cache, chip8 *Processor, unsigned long long Cycles)
+{
+    static void *Labels[CacheOp_Count] =
+    {
+        &&Decode, &&Interpret,
+        &&Op00EE, &&Op1NNN, &&Op2NNN, &&Op3XNN, &&Op4XNN, &&Op5XY0, &&Op6XNN, &&Op7XNN,
+        &&Op8XY0, &&Op8XY1, &&Op8XY2, &&Op8XY3, &&Op8XY4, &&Op8XY5, &&Op8XY6, &&Op8XY7, &&Op8XYE,
+        &&Op9XY0, &&OpANNN, &&OpBNNN, &&OpCXNN, &&OpEX9E, &&OpEXA1,
+        &&OpFX07, &&OpFX15, &&OpFX18, &&OpFX1E, &&OpFX29, &&OpFX33, &&OpFX55, &&OpFX65,
+        &&Fuse6XNN6YNN, &&FuseANNNDXYN, &&Fuse3XNN1NNN, &&Fuse4XNN1NNN, &&Fuse7XNN3XNN1NNN, &&Fuse7XNN4XNN1NNN,
+    };
+
+    const chip8_quirk_set &Quirk = Chip8QuirkSets[Quirks];
+    unsigned char *V = Processor->V;
+    unsigned char *Memory = Processor->Memory;
+    unsigned short Pc = Processor->Pc;
+    unsigned short Opcode = Processor->Opcode;
+    unsigned long long FusedCycles = 0;
+    unsigned long long Sequences[Chip8Fused_Count] = {};
+    chip8_decoded *Instruction;
+
+    /* NOTE(koekeishiya): Odd addresses and addresses past the end of Memory have no slot. */
+#define DISPATCH()                                  \
+    if(!Cycles) goto Done;                          \
+    if(Pc & 0xF001) goto Interpret;                 \
+    Instruction = Cache->Slots + (Pc >> 1);         \
+    goto *Labels[Instruction->Entry]
+
+#define BEGIN() Opcode = Instruction->Opcode; Pc += 2
+#define END() --Cycles; DISPATCH()
+#define END_FUSED(Sequence, Count) Cycles -= (Count); ++Sequences[Sequence]; FusedCycles += (Count); DISPATCH()
+#define FITS(Count) if(Cycles < (Count)) goto *Labels[Instruction->Op]
+
+    DISPATCH();
+
+Decode:
+    Chip8CacheDecode(Cache, Processor, Pc, Instruction);
+    goto *Labels[Instruction->Entry];
+
+Interpret:
+    Processor->Pc = Pc;
+    Chip8Step<Quirks>(Processor);
+    Pc = Processor->Pc;
+    Opcode = Processor->Opcode;
+    END();
+
+Op00EE: BEGIN(); Pc = Processor->Stack[--Processor->Sp & 0xF]; END();
+Op1NNN: BEGIN(); Pc = Instruction->NNN; END();
+Op2NNN: BEGIN(); Processor->Stack[Processor->Sp++ & 0xF] = Pc; Pc = Instruction->NNN; END();
+Op3XNN: BEGIN(); if(V[Instruction->X] == Instruction->NN) Pc += 2; END();
+Op4XNN: BEGIN(); if(V[Instruction->X] != Instruction->NN) Pc += 2; END();
+Op5XY0: BEGIN(); if(V[Instruction->X] == V[Instruction->Y]) Pc += 2; END();
+Op6XNN: BEGIN(); V[Instruction->X] = Instruction->NN; END();
+Op7XNN: BEGIN(); V[Instruction->X] += Instruction->NN; END();
+Op8XY0: BEGIN(); V[Instruction->X] = V[Instruction->Y]; END();
+Op8XY1:
+    BEGIN();
+    V[Instruction->X] |= V[Instruction->Y];
+    if(Quirk.LogicResetsVF)
+        V[0xF] = 0;
+    END();
+Op8XY2:
+    BEGIN();
+    V[Instruction->X] &= V[Instruction->Y];
+    if(Quirk.LogicResetsVF)
+        V[0xF] = 0;
+    END();
+Op8XY3:
+    BEGIN();
+    V[Instruction->X] ^= V[Instruction->Y];
+    if(Quirk.LogicResetsVF)
+        V[0xF] = 0;
+    END();
+Op8XY4:
+    {
+        BEGIN();
+        unsigned short Sum = V[Instruction->X] + V[Instruction->Y];
+        V[Instruction->X] = Sum & 0xFF;
+        V[0xF] = Sum > 255;
+        END();
+    }
+Op8XY5:
+    {
+        BEGIN();
+        unsigned char NoBorrow = V[Instruction->X] >= V[Instruction->Y];
+        V[Instruction->X] -= V[Instruction->Y];
+        V[0xF] = NoBorrow;
+        END();
+    }
+Op8XY6:
+    {
+        BEGIN();
+        unsigned char Source = V[Quirk.ShiftReadsVY ? Instruction->Y : Instruction->X];
+        V[Instruction->X] = Source >> 1;
+        V[0xF] = Source & 0x1;
+        END();
+    }
+Op8XY7:
+    {
+        BEGIN();
+        unsigned char NoBorrow = V[Instruction->Y] >= V[Instruction->X];
+        V[Instruction->X] = V[Instruction->Y] - V[Instruction->X];
+        V[0xF] = NoBorrow;
+        END();
+    }
+Op8XYE:
+    {
+        BEGIN();
+        unsigned char Source = V[Quirk.ShiftReadsVY ? Instruction->Y : Instruction->X];
+        V[Instruction->X] = Source << 1;
+        V[0xF] = Source >> 7;
+        END();
+    }
+Op9XY0: BEGIN(); if(V[Instruction->X] != V[Instruction->Y]) Pc += 2; END();
+OpANNN: BEGIN(); Processor->I = Instruction->NNN; END();
+OpBNNN: BEGIN(); Pc = Instruction->NNN + V[Quirk.JumpUsesVX ? Instruction->X : 0]; END();
+OpCXNN: BEGIN(); V[Instruction->X] = Chip8NextRandom(&Processor->RandomState) & Instruction->NN; END();
+OpEX9E: BEGIN(); if(Processor->Key[V[Instruction->X] & 0xF] == 1) Pc += 2; END();
+OpEXA1: BEGIN(); if(Processor->Key[V[Instruction->X] & 0xF] != 1) Pc += 2; END();
+OpFX07: BEGIN(); V[Instruction->X] = Processor->DelayTimer; END();
+OpFX15: BEGIN(); Processor->DelayTimer = V[Instruction->X]; END();
+OpFX18: BEGIN(); Processor->SoundTimer = V[Instruction->X]; END();
+OpFX1E: BEGIN(); Processor->I += V[Instruction->X]; END();
+OpFX29: BEGIN(); Processor->I = V[Instruction->X] * 5; END();
+
+    /* NOTE(koekeishiya): FX33 and FX55 are the only instructions that write to Memory, and
+     * they may overwrite code that has already been decoded, including the slot that is
+     * running. Nothing of it is used after the write. */
+OpFX33:
+    {
+        BEGIN();
+        unsigned int Address = Processor->I & 0xFFF;
+        unsigned char Digit = V[Instruction->X];
+        Memory[(Address + 2) & 0xFFF] = Digit % 10;
+        Memory[(Address + 1) & 0xFFF] = (Digit / 10) % 10;
+        Memory[Address] = Digit / 100;
+        Chip8CacheInvalidate(Cache, Address, Address + 2);
+        END();
+    }
+OpFX55:
+    {
+        BEGIN();
+        unsigned int Address = Processor->I & 0xFFF;
+        unsigned int Last = Instruction->X;
+        for(unsigned int Index = 0; Index <= Last; ++Index)
+            Memory[(Address + Index) & 0xFFF] = V[Index];
+
+        if(Quirk.IndexAdvance != Chip8Index_Unchanged)
+            Processor->I += Last + (Quirk.IndexAdvance == Chip8Index_PlusXPlusOne);
+
+        Chip8CacheInvalidate(Cache, Address, Address + Last);
+        END();
+    }
+OpFX65:
+    {
+        BEGIN();
+        unsigned int Address = Processor->I & 0xFFF;
+        unsigned int Last = Instruction->X;
+        for(unsigned int Index = 0; Index <= Last; ++Index)
+            V[Index] = Memory[(Address + Index) & 0xFFF];
+
+        if(Quirk.IndexAdvance != Chip8Index_Unchanged)
+            Processor->I += Last + (Quirk.IndexAdvance == Chip8Index_PlusXPlusOne);
+        END();
+    }
+
+Fuse6XNN6YNN:
+    {
+        FITS(2);
+        unsigned short Second = Instruction->Next[0];
+        V[Instruction->X] = Instruction->NN;
+        V[(Second & 0x0F00) >> 8] = Second & 0x00FF;
+        Opcode = Second;
+        Pc += 4;
+        END_FUSED(Chip8Fused_Load, 2);
+    }
+FuseANNNDXYN:
+    FITS(2);
+    Processor->I = Instruction->NNN;
+    Processor->Pc = Pc + 2;
+    Chip8Step<Quirks>(Processor);
+    Pc = Processor->Pc;
+    Opcode = Processor->Opcode;
+    END_FUSED(Chip8Fused_Draw, 2);
+
+    /* NOTE(koekeishiya): A skip over a jump, i.e. 'if(!condition) goto'. */
+Fuse3XNN1NNN:
+    FITS(2);
+    if(V[Instruction->X] == Instruction->NN)
+    {
+        Opcode = Instruction->Opcode;
+        Pc += 4;
+        END_FUSED(Chip8Fused_Branch, 1);
+    }
+    Opcode = Instruction->Next[0];
+    Pc = Instruction->Next[0] & 0x0FFF;
+    END_FUSED(Chip8Fused_Branch, 2);
+Fuse4XNN1NNN:
+    FITS(2);
+    if(V[Instruction->X] != Instruction->NN)
+    {
+        Opcode = Instruction->Opcode;
+        Pc += 4;
+        END_FUSED(Chip8Fused_Branch, 1);
+    }
+    Opcode = Instruction->Next[0];
+    Pc = Instruction->Next[0] & 0x0FFF;
+    END_FUSED(Chip8Fused_Branch, 2);
+
+    /* NOTE(koekeishiya): Loop counters, e.g. 'V3 += 1; if(V3 != 10) goto Loop'. */
+Fuse7XNN3XNN1NNN:
+    FITS(3);
+    V[Instruction->X] += Instruction->NN;
+    if(V[Instruction->X] == (Instruction->Next[0] & 0x00FF))
+    {
+        Opcode = Instruction->Next[0];
+        Pc += 6;
+        END_FUSED(Chip8Fused_Counter, 2);
+    }
+    Opcode = Instruction->Next[1];
+    Pc = Instruction->Next[1] & 0x0FFF;
+    END_FUSED(Chip8Fused_Counter, 3);
+Fuse7XNN4XNN1NNN:
+    FITS(3);
+    V[Instruction->X] += Instruction->NN;
+    if(V[Instruction->X] != (Instruction->Next[0] & 0x00FF))
+    {
+        Opcode = Instruction->Next[0];
+        Pc += 6;
+        END_FUSED(Chip8Fused_Counter, 2);
+    }
+    Opcode = Instruction->Next[1];
+    Pc = Instruction->Next[1] & 0x0FFF;
+    END_FUSED(Chip8Fused_Counter, 3);
+
+#undef FITS
+#undef END_FUSED
+#undef END
+#undef BEGIN
+#undef DISPATCH
+
+Done:
+    Processor->Pc = Pc;
+    Processor->Opcode = Opcode;
+    Cache->Stats.FusedCycles += FusedCycles;
+    for(int Sequence = 0; Sequence < Chip8Fused_Count; ++Sequence)
+    {
+        Cache->Stats.FusedDispatches += Sequences[Sequence];
+        Cache->Stats.Sequences[Sequence] += Sequences[Sequence];
+    }
+}
+
+void Chip8CacheReset(chip8_cache *Cache)
+{
+    memset(Cache->Slots, 0, sizeof(Cache->Slots));
+    Cache->CodeLow = 0xFFFF;
+    Cache->CodeHigh = 0;
+}
+
+void Chip8CacheSetFusion(chip8_cache *Cache, bool Fuse)
+{
+    Cache->Fuse = Fuse;
+    Chip8CacheReset(Cache);
+}
+
+void Chip8CacheInvalidate(chip8_cache *Cache, unsigned int Low, unsigned int High)
+{
+    if(High > 0xFFF && Low <= 0xFFF)
+    {
+        Chip8CacheInvalidate(Cache, 0, High & 0xFFF);
+        High = 0xFFF;
+    }
+
+    if(High < Cache->CodeLow || Low > Cache->CodeHigh)
+        return;
+
+    unsigned int First = Low >> 1;
+    unsigned int Last = High >> 1;
+    if(First >= CHIP8_CACHE_SLOTS)
+        return;
+
+    if(Last >= CHIP8_CACHE_SLOTS)
+        Last = CHIP8_CACHE_SLOTS - 1;
+
+    /* NOTE(koekeishiya): A fused sequence starting up to two instructions earlier covers
+     * the written memory as well. */
+    First = First >= CHIP8_CACHE_MAX_FUSED - 1 ? First - (CHIP8_CACHE_MAX_FUSED - 1) : 0;
+
+    for(unsigned int Index = First; Index <= Last; ++Index)
+        Cache->Slots[Index].Entry = CacheOp_Decode;
+}
+
+void Chip8CacheRun(chip8_cache *Cache, chip8 *Processor, unsigned long long Cycles)
+{
+    /* NOTE(koekeishiya): Decoded slots belong to one profile. */
+    if(Cache->Quirks != Processor->Quirks)
+    {
+        Cache->Quirks = Processor->Quirks;
+        Chip8CacheReset(Cache);
+    }
+
+    switch(Processor->Quirks)
+    {
+        case Chip8Quirks_Chip8: Chip8CacheRunSpecialized<Chip8Quirks_Chip8>(Cache, Processor, Cycles); break;
+        case Chip8Quirks_Chip48: Chip8CacheRunSpecialized<Chip8Quirks_Chip48>(Cache, Processor, Cycles); break;
+        case Chip8Quirks_Schip: Chip8CacheRunSpecialized<Chip8Quirks_Schip>(Cache, Processor, Cycles); break;
+        case Chip8Quirks_XoChip: Chip8CacheRunSpecialized<Chip8Quirks_XoChip>(Cache, Processor, Cycles); break;
+        default: Chip8CacheRunSpecialized<Chip8Quirks_Default>(Cache, Processor, Cycles); break;
+    }
+}
+
+chip8_cache_stats Chip8CacheGetStats(chip8_cache *Cache)
+{
+    return Cache->Stats;
+}
+
+const char *Chip8CacheSequenceName(chip8_fused_sequence Sequence)
+{
+    return Sequence < Chip8Fused_Count ? Chip8CacheSequenceNames[Sequence] : "unknown";
+}
@@ -0,0 +1,96 @@
+#ifndef CHIP_8_CACHE
+#define CHIP_8_CACHE
+
+#include "chip8.h"
+
+#define CHIP8_CACHE_SLOTS (0x1000 / 2)
+
+/* NOTE(koekeishiya): Longest sequence of instructions run by a single fused dispatch. */
+#define CHIP8_CACHE_MAX_FUSED 3
+
+/* NOTE(koekeishiya): An instruction that has already been fetched and taken apart. Op
+ * names the code in Chip8CacheRun that executes it, so executing it is a single indirect
+ * jump instead of a fetch followed by up to three levels of switch. Entry is what a
+ * dispatch to the slot runs: Op, or the fused sequence starting here. 0 means the slot
+ * has not been decoded yet. */
+struct chip8_decoded
+{
+    unsigned char Entry;
+    unsigned char Op;
+    unsigned char X;
+    unsigned char Y;
+    unsigned char NN;
+
+    /* NOTE(koekeishiya): Set when fusion is enabled and this instruction starts one of the
+     * recognised sequences, Next holding the opcodes that follow it. FusedLength is the
+     * most instructions the sequence can execute, it only runs when the cycle budget
+     * covers all of them. */
+    unsigned char FusedLength;
+    unsigned short Opcode;
+    unsigned short NNN;
+    unsigned short Next[CHIP8_CACHE_MAX_FUSED - 1];
+};
+
+enum chip8_fused_sequence
+{
+    Chip8Fused_Load,     /* 6XNN;6YNN */
+    Chip8Fused_Draw,     /* ANNN;DXYN */
+    Chip8Fused_Branch,   /* 3XNN/4XNN;1NNN */
+    Chip8Fused_Counter,  /* 7XNN;3XNN/4XNN;1NNN */
+
+    Chip8Fused_Count
+};
+
+struct chip8_cache_stats
+{
+    unsigned long long FusedDispatches;
+    unsigned long long FusedCycles;
+
+    /* NOTE(koekeishiya): Dispatches per chip8_fused_sequence, to tell which of them a rom
+     * actually hits. */
+    unsigned long long Sequences[Chip8Fused_Count];
+};
+
+/* NOTE(koekeishiya): One slot per even address in the 4 KB address space. Slots start out
+ * empty and are decoded on first execution. */
+struct chip8_cache
+{
+    chip8_decoded Slots[CHIP8_CACHE_SLOTS];
+    bool Fuse;
+
+    /* NOTE(koekeishiya): The quirk profile the slots were decoded for. Chip8CacheRun
+     * resets the cache when the processor uses another one. */
+    unsigned char Quirks;
+    chip8_cache_stats Stats;
+
+    /* NOTE(koekeishiya): Every decoded slot, including the instructions its fused sequence
+     * reads, lies in Memory[CodeLow] to Memory[CodeHigh]. Writes outside of it, which is
+     * where roms keep their data, need not look at the slots. A zeroed cache is valid, it
+     * merely starts out covering Memory[0]. */
+    unsigned short CodeLow;
+    unsigned short CodeHigh;
+};
+
+/* NOTE(koekeishiya): Forget every decoded instruction. Must be called whenever Memory is
+ * changed behind the back of the cache, e.g. when a rom is loaded. Writes done by FX33
+ * and FX55 while running through Chip8CacheRun are tracked automatically. */
+void Chip8CacheReset(chip8_cache *Cache);
+
+/* NOTE(koekeishiya): Run common sequences (6XNN;6YNN, ANNN;DXYN, 3XNN/4XNN;1NNN and
+ * 7XNN;3XNN/4XNN;1NNN on the same register) as one dispatch. Off by default, changing it
+ * resets the cache. */
+void Chip8CacheSetFusion(chip8_cache *Cache, bool Fuse);
+
+/* NOTE(koekeishiya): Forget decoded instructions overlapping Memory[Low] to Memory[High],
+ * including fused sequences that extend into it. A High past the end of Memory wraps
+ * around to the start, like the writes of FX33 and FX55 do. */
+void Chip8CacheInvalidate(chip8_cache *Cache, unsigned int Low, unsigned int High);
+
+/* NOTE(koekeishiya): Execute the given number of cycles. The resulting state is identical
+ * to calling Chip8DoCycle the same number of times. */
+void Chip8CacheRun(chip8_cache *Cache, chip8 *Processor, unsigned long long Cycles);
+
+chip8_cache_stats Chip8CacheGetStats(chip8_cache *Cache);
+const char *Chip8CacheSequenceName(chip8_fused_sequence Sequence);
+
+#endif
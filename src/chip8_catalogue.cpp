@@ -0,0 +1,668 @@
+#include "chip8_catalogue.h"
+#include "chip8_state.h"
+#include "chip8_input.h"
+#include "chip8_export.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+
+#define internal static
+
+#define PACK_HEADER_SIZE 16
+#define QUIRKS_FILE "quirks.txt"
+
+/* NOTE(koekeishiya): What the tools write next to a rom, which a directory of roms ends up
+ * holding sooner or later. */
+internal const char *NotRomExtensions[] = { ".state", ".log", ".json", ".wav", ".txt", ".cpp", ".so" };
+
+/* NOTE(koekeishiya): Grow Array so that it holds at least Count + 1 elements. */
+template<typename T> internal bool
+Reserve(T **Array, unsigned int *Capacity, unsigned int Count)
+{
+    if(Count < *Capacity)
+        return true;
+
+    unsigned int NewCapacity = *Capacity ? *Capacity * 2 : 64;
+    T *Grown = (T *) realloc(*Array, NewCapacity * sizeof(T));
+    if(!Grown)
+        return false;
+
+    *Array = Grown;
+    *Capacity = NewCapacity;
+    return true;
+}
+
+internal unsigned long long
+Get(const unsigned char *At, int Bytes)
+{
+    unsigned long long Value = 0;
+    for(int Index = 0; Index < Bytes; ++Index)
+        Value |= (unsigned long long)At[Index] << (8 * Index);
+    return Value;
+}
+
+internal bool
+Put(FILE *File, unsigned long long Value, int Bytes)
+{
+    unsigned char Buffer[8];
+    for(int Index = 0; Index < Bytes; ++Index)
+        Buffer[Index] = (unsigned char)(Value >> (8 * Index));
+    return fwrite(Buffer, 1, Bytes, File) == (size_t) Bytes;
+}
+
+unsigned long long Chip8CatalogueHash(const unsigned char *Data, unsigned int Size)
+{
+    unsigned long long Hash = 0xCBF29CE484222325ULL;
+    for(unsigned int Index = 0; Index < Size; ++Index)
+    {
+        Hash ^= Data[Index];
+        Hash *= 0x100000001B3ULL;
+    }
+
+    /* NOTE(koekeishiya): The zeroes that follow the rom in a loaded chip8 leave the xor
+     * alone, so together they multiply the hash by the prime raised to their count. */
+    unsigned long long Factor = 0x100000001B3ULL;
+    for(unsigned int Zeroes = Size < CHIP8_ROM_CAPACITY ? CHIP8_ROM_CAPACITY - Size : 0; Zeroes; Zeroes >>= 1)
+    {
+        if(Zeroes & 1)
+            Hash *= Factor;
+        Factor *= Factor;
+    }
+
+    return Hash;
+}
+
+void Chip8CatalogueCreate(chip8_catalogue *Catalogue)
+{
+    memset(Catalogue, 0, sizeof(chip8_catalogue));
+}
+
+internal void
+ReleaseBlocks(chip8_catalogue *Catalogue, unsigned int First)
+{
+    for(unsigned int Index = First; Index < Catalogue->BlockCount; ++Index)
+    {
+        chip8_catalogue_block *Block = Catalogue->Blocks + Index;
+        if(Block->Mapped)
+            munmap(Block->Memory, Block->Size);
+        else
+            free(Block->Memory);
+    }
+
+    Catalogue->BlockCount = First;
+}
+
+/* NOTE(koekeishiya): Everything needed to drop whatever was added after the mark. */
+struct catalogue_mark
+{
+    unsigned int Count;
+    unsigned int BlockCount;
+    size_t LastUsed;
+    unsigned long long Bytes;
+    unsigned int SkippedCount;
+};
+
+internal catalogue_mark
+Mark(chip8_catalogue *Catalogue)
+{
+    catalogue_mark Result;
+    Result.Count = Catalogue->Count;
+    Result.BlockCount = Catalogue->BlockCount;
+    Result.LastUsed = Result.BlockCount ? Catalogue->Blocks[Result.BlockCount - 1].Used : 0;
+    Result.Bytes = Catalogue->Bytes;
+    Result.SkippedCount = Catalogue->SkippedCount;
+    return Result;
+}
+
+internal void
+Rollback(chip8_catalogue *Catalogue, catalogue_mark *Mark)
+{
+    for(unsigned int Index = Mark->Count; Index < Catalogue->Count; ++Index)
+        free(Catalogue->Roms[Index].Name);
+
+    for(unsigned int Index = Mark->SkippedCount; Index < Catalogue->SkippedCount; ++Index)
+        free(Catalogue->Skipped[Index].Path);
+
+    ReleaseBlocks(Catalogue, Mark->BlockCount);
+    if(Mark->BlockCount)
+        Catalogue->Blocks[Mark->BlockCount - 1].Used = Mark->LastUsed;
+
+    Catalogue->Count = Mark->Count;
+    Catalogue->Bytes = Mark->Bytes;
+    Catalogue->SkippedCount = Mark->SkippedCount;
+}
+
+void Chip8CatalogueDestroy(chip8_catalogue *Catalogue)
+{
+    for(unsigned int Index = 0; Index < Catalogue->Count; ++Index)
+        free(Catalogue->Roms[Index].Name);
+
+    for(unsigned int Index = 0; Index < Catalogue->SkippedCount; ++Index)
+        free(Catalogue->Skipped[Index].Path);
+
+    ReleaseBlocks(Catalogue, 0);
+
+    free(Catalogue->Roms);
+    free(Catalogue->ByHash);
+    free(Catalogue->Profiles);
+    free(Catalogue->Blocks);
+    free(Catalogue->Skipped);
+    memset(Catalogue, 0, sizeof(chip8_catalogue));
+}
+
+internal bool
+ReadAll(int Handle, unsigned char *Memory, size_t Size)
+{
+    size_t Done = 0;
+    while(Done < Size)
+    {
+        ssize_t Count = read(Handle, Memory + Done, Size - Done);
+        if(Count <= 0)
+            return false;
+        Done += Count;
+    }
+    return true;
+}
+
+/* NOTE(koekeishiya): Bring a whole regular file into memory owned by the catalogue, see
+ * chip8_catalogue_block. Empty files are never valid and fail too. Reason says what was
+ * wrong with the file, and stays NULL when the catalogue itself ran out of memory. */
+internal bool
+LoadFile(chip8_catalogue *Catalogue, const char *Path, const unsigned char **Data, size_t *Size,
+         const char **Reason)
+{
+    if(!Reserve(&Catalogue->Blocks, &Catalogue->BlockCapacity, Catalogue->BlockCount))
+        return false;
+
+    int Handle = open(Path, O_RDONLY);
+    if(Handle < 0)
+    {
+        *Reason = "cannot be opened";
+        return false;
+    }
+
+    struct stat Info;
+    if(fstat(Handle, &Info) != 0 || !S_ISREG(Info.st_mode) || Info.st_size == 0)
+    {
+        *Reason = "is empty or not a regular file";
+        close(Handle);
+        return false;
+    }
+
+    size_t Length = Info.st_size;
+    chip8_catalogue_block *Last = Catalogue->BlockCount ? Catalogue->Blocks + Catalogue->BlockCount - 1 : NULL;
+    bool Loaded;
+
+    if(Length >= CHIP8_CATALOGUE_MAP_SIZE)
+    {
+        void *Address = mmap(NULL, Length, PROT_READ, MAP_PRIVATE, Handle, 0);
+        Loaded = Address != MAP_FAILED;
+        if(!Loaded)
+            *Reason = "cannot be mapped";
+        else
+        {
+            madvise(Address, Length, MADV_WILLNEED);
+
+            chip8_catalogue_block *Block = Catalogue->Blocks + Catalogue->BlockCount++;
+            Block->Memory = (unsigned char *) Address;
+            Block->Size = Length;
+            Block->Used = Length;
+            Block->Mapped = true;
+            *Data = Block->Memory;
+        }
+    }
+    else
+    {
+        if(!Last || Last->Mapped || Last->Size - Last->Used < Length)
+        {
+            Last = Catalogue->Blocks + Catalogue->BlockCount;
+            Last->Memory = (unsigned char *) malloc(CHIP8_CATALOGUE_BLOCK_SIZE);
+            Last->Size = CHIP8_CATALOGUE_BLOCK_SIZE;
+            Last->Used = 0;
+            Last->Mapped = false;
+            if(Last->Memory)
+                ++Catalogue->BlockCount;
+        }
+
+        Loaded = Last->Memory && ReadAll(Handle, Last->Memory + Last->Used, Length);
+        if(!Loaded && Last->Memory)
+            *Reason = "cannot be read";
+        else if(Loaded)
+        {
+            *Data = Last->Memory + Last->Used;
+            Last->Used += Length;
+        }
+    }
+
+    close(Handle);
+    if(!Loaded)
+        return false;
+
+    Catalogue->Bytes += Length;
+    *Size = Length;
+    return true;
+}
+
+internal bool
+AddRom(chip8_catalogue *Catalogue, const char *Name, size_t NameLength,
+       const unsigned char *Data, size_t Size, const char **Reason)
+{
+    if(Size == 0 || Size > CHIP8_CATALOGUE_MAX_ROM)
+    {
+        *Reason = Size ? "is too large for a rom" : "is empty";
+        return false;
+    }
+
+    *Reason = NULL;
+    if(!Reserve(&Catalogue->Roms, &Catalogue->Capacity, Catalogue->Count))
+        return false;
+
+    char *Copy = (char *) malloc(NameLength + 1);
+    if(!Copy)
+        return false;
+
+    memcpy(Copy, Name, NameLength);
+    Copy[NameLength] = 0;
+
+    chip8_rom *Rom = Catalogue->Roms + Catalogue->Count++;
+    Rom->Name = Copy;
+    Rom->Data = Data;
+    Rom->Size = (unsigned int) Size;
+    Rom->Hash = Chip8CatalogueHash(Data, Rom->Size);
+    return true;
+}
+
+/* NOTE(koekeishiya): Profiles are collected while adding and only recorded once the whole
+ * path was read, so that a failed add leaves them alone too. */
+internal bool
+AddProfile(chip8_rom_profile **Profiles, unsigned int *Count, unsigned int *Capacity,
+           unsigned long long Hash, chip8_quirks Quirks)
+{
+    if(!Reserve(Profiles, Capacity, *Count))
+        return false;
+
+    (*Profiles)[*Count].Hash = Hash;
+    (*Profiles)[*Count].Quirks = Quirks;
+    ++*Count;
+    return true;
+}
+
+internal bool
+AddPack(chip8_catalogue *Catalogue, const unsigned char *Data, size_t Size,
+        chip8_rom_profile **Profiles, unsigned int *ProfileCount, unsigned int *ProfileCapacity,
+        const char **Reason)
+{
+    *Reason = "is a damaged archive";
+    if(Size < PACK_HEADER_SIZE || Get(Data + 4, 2) != CHIP8_PACK_VERSION)
+        return false;
+
+    unsigned long long RomCount = Get(Data + 8, 4);
+    unsigned long long Count = Get(Data + 12, 4);
+    size_t At = PACK_HEADER_SIZE;
+
+    for(unsigned long long Index = 0; Index < RomCount; ++Index)
+    {
+        if(Size - At < 2)
+            return false;
+
+        size_t NameLength = Get(Data + At, 2);
+        At += 2;
+        if(Size - At < NameLength + 4)
+            return false;
+
+        const char *Name = (const char *)(Data + At);
+        At += NameLength;
+        size_t RomSize = Get(Data + At, 4);
+        At += 4;
+        if(Size - At < RomSize)
+            return false;
+
+        const char *RomReason;
+        if(!AddRom(Catalogue, Name, NameLength, Data + At, RomSize, &RomReason))
+        {
+            if(!RomReason)
+                *Reason = NULL;
+            return false;
+        }
+
+        At += RomSize;
+    }
+
+    for(unsigned long long Index = 0; Index < Count; ++Index)
+    {
+        if(Size - At < 9 || Data[At + 8] >= Chip8Quirks_Count)
+            return false;
+
+        if(!AddProfile(Profiles, ProfileCount, ProfileCapacity, Get(Data + At, 8), (chip8_quirks) Data[At + 8]))
+        {
+            *Reason = NULL;
+            return false;
+        }
+
+        At += 9;
+    }
+
+    return At == Size;
+}
+
+/* NOTE(koekeishiya): Save states, input logs and frame exports start with a magic of their
+ * own, whatever they are named. */
+internal bool
+AddFile(chip8_catalogue *Catalogue, const char *Path,
+        chip8_rom_profile **Profiles, unsigned int *ProfileCount, unsigned int *ProfileCapacity,
+        const char **Reason)
+{
+    const unsigned char *Data;
+    size_t Size;
+    *Reason = NULL;
+    if(!LoadFile(Catalogue, Path, &Data, &Size, Reason))
+        return false;
+
+    if(Size >= 4 && memcmp(Data, CHIP8_PACK_MAGIC, 4) == 0)
+        return AddPack(Catalogue, Data, Size, Profiles, ProfileCount, ProfileCapacity, Reason);
+
+    if(Size >= 4 && (memcmp(Data, CHIP8_STATE_MAGIC, 4) == 0 ||
+                     memcmp(Data, CHIP8_INPUT_MAGIC, 4) == 0 ||
+                     memcmp(Data, CHIP8_EXPORT_MAGIC, 4) == 0))
+    {
+        *Reason = "is a save state, input log or frame export";
+        return false;
+    }
+
+    return AddRom(Catalogue, Path, strlen(Path), Data, Size, Reason);
+}
+
+internal bool
+HasRomExtension(const char *Name)
+{
+    size_t Length = strlen(Name);
+    for(size_t Index = 0; Index < sizeof(NotRomExtensions) / sizeof(NotRomExtensions[0]); ++Index)
+    {
+        size_t ExtensionLength = strlen(NotRomExtensions[Index]);
+        if(Length > ExtensionLength && strcmp(Name + Length - ExtensionLength, NotRomExtensions[Index]) == 0)
+            return false;
+    }
+    return true;
+}
+
+internal bool
+AddSkipped(chip8_catalogue *Catalogue, const char *Path, const char *Reason)
+{
+    if(!Reserve(&Catalogue->Skipped, &Catalogue->SkippedCapacity, Catalogue->SkippedCount))
+        return false;
+
+    chip8_catalogue_skip *Skip = Catalogue->Skipped + Catalogue->SkippedCount;
+    Skip->Path = strdup(Path);
+    Skip->Reason = Reason;
+    if(!Skip->Path)
+        return false;
+
+    ++Catalogue->SkippedCount;
+    return true;
+}
+
+internal bool
+ReadQuirksFile(const char *Path, chip8_rom_profile **Profiles, unsigned int *ProfileCount,
+               unsigned int *ProfileCapacity)
+{
+    FILE *File = fopen(Path, "r");
+    if(!File)
+        return false;
+
+    bool Valid = true;
+    char Line[256];
+    while(Valid && fgets(Line, sizeof(Line), File))
+    {
+        char *Start = Line + strspn(Line, " \t\r\n");
+        if(*Start == 0 || *Start == '#')
+            continue;
+
+        unsigned long long Hash;
+        char Name[32];
+        chip8_quirks Quirks;
+        Valid = sscanf(Start, "%llx %31s", &Hash, Name) == 2 &&
+                Chip8QuirksFromName(Name, &Quirks) &&
+                AddProfile(Profiles, ProfileCount, ProfileCapacity, Hash, Quirks);
+    }
+
+    Valid = Valid && !ferror(File);
+    fclose(File);
+    return Valid;
+}
+
+internal int
+CompareNames(const void *A, const void *B)
+{
+    return strcmp(*(char * const *) A, *(char * const *) B);
+}
+
+internal bool
+AddDirectory(chip8_catalogue *Catalogue, const char *Path, DIR *Directory,
+             chip8_rom_profile **Profiles, unsigned int *ProfileCount, unsigned int *ProfileCapacity)
+{
+    char **Names = NULL;
+    unsigned int Count = 0, Capacity = 0;
+    bool Valid = true;
+
+    struct dirent *Entry;
+    while(Valid && (Entry = readdir(Directory)) != NULL)
+    {
+        if(Entry->d_name[0] == '.')
+            continue;
+
+        /* NOTE(koekeishiya): Only regular files count, and most file systems say what an
+         * entry is without a stat. */
+        if(Entry->d_type != DT_REG)
+        {
+            char File[4096];
+            struct stat Info;
+            if(Entry->d_type != DT_UNKNOWN && Entry->d_type != DT_LNK)
+                continue;
+
+            int Length = snprintf(File, sizeof(File), "%s/%s", Path, Entry->d_name);
+            if(Length >= (int) sizeof(File) || stat(File, &Info) != 0 || !S_ISREG(Info.st_mode))
+                continue;
+        }
+
+        Valid = Reserve(&Names, &Capacity, Count);
+        if(Valid)
+        {
+            Names[Count] = strdup(Entry->d_name);
+            Valid = Names[Count++] != NULL;
+        }
+    }
+
+    /* NOTE(koekeishiya): readdir returns entries in no particular order; sorting them keeps
+     * instance numbers and output stable between runs and machines. */
+    qsort(Names, Count, sizeof(char *), CompareNames);
+
+    for(unsigned int Index = 0; Valid && Index < Count; ++Index)
+    {
+        char File[4096];
+        int Length = snprintf(File, sizeof(File), "%s/%s", Path, Names[Index]);
+        Valid = Length < (int) sizeof(File);
+        if(!Valid)
+            continue;
+
+        if(strcmp(Names[Index], QUIRKS_FILE) == 0)
+        {
+            Valid = ReadQuirksFile(File, Profiles, ProfileCount, ProfileCapacity);
+            continue;
+        }
+
+        if(!HasRomExtension(Names[Index]))
+        {
+            Valid = AddSkipped(Catalogue, File, "is not a rom");
+            continue;
+        }
+
+        /* NOTE(koekeishiya): One bad file leaves out only itself, including the roms and
+         * profiles a damaged archive managed to add before it failed. Running out of
+         * memory still fails the whole directory. */
+        catalogue_mark FileMark = Mark(Catalogue);
+        unsigned int FileProfiles = *ProfileCount;
+        const char *Reason;
+        if(!AddFile(Catalogue, File, Profiles, ProfileCount, ProfileCapacity, &Reason))
+        {
+            Rollback(Catalogue, &FileMark);
+            *ProfileCount = FileProfiles;
+            Valid = Reason && AddSkipped(Catalogue, File, Reason);
+        }
+    }
+
+    for(unsigned int Index = 0; Index < Count; ++Index)
+        free(Names[Index]);
+
+    free(Names);
+    return Valid;
+}
+
+internal void
+SortByHash(chip8_catalogue *Catalogue)
+{
+    chip8_rom *Roms = Catalogue->Roms;
+    for(unsigned int Index = 0; Index < Catalogue->Count; ++Index)
+        Catalogue->ByHash[Index] = Index;
+
+    std::stable_sort(Catalogue->ByHash, Catalogue->ByHash + Catalogue->Count,
+                     [Roms](unsigned int A, unsigned int B) { return Roms[A].Hash < Roms[B].Hash; });
+}
+
+bool Chip8CatalogueAdd(chip8_catalogue *Catalogue, const char *Path)
+{
+    catalogue_mark AddMark = Mark(Catalogue);
+
+    chip8_rom_profile *Profiles = NULL;
+    unsigned int ProfileCount = 0, ProfileCapacity = 0;
+
+    bool Valid;
+    DIR *Directory = opendir(Path);
+    if(Directory)
+    {
+        Valid = AddDirectory(Catalogue, Path, Directory, &Profiles, &ProfileCount, &ProfileCapacity);
+        closedir(Directory);
+    }
+    else
+    {
+        const char *Reason;
+        Valid = AddFile(Catalogue, Path, &Profiles, &ProfileCount, &ProfileCapacity, &Reason);
+
+        /* NOTE(koekeishiya): A single file picks up the quirks.txt of its directory. */
+        const char *Slash = strrchr(Path, '/');
+        int DirectoryLength = Slash ? (int)(Slash - Path) : 1;
+        const char *DirectoryPath = Slash ? Path : ".";
+
+        char Quirks[4096];
+        int Length = snprintf(Quirks, sizeof(Quirks), "%.*s/%s", DirectoryLength, DirectoryPath, QUIRKS_FILE);
+        if(Valid && Length < (int) sizeof(Quirks) && access(Quirks, F_OK) == 0)
+            Valid = ReadQuirksFile(Quirks, &Profiles, &ProfileCount, &ProfileCapacity);
+    }
+
+    if(Valid && Catalogue->Capacity)
+    {
+        unsigned int *ByHash = (unsigned int *) realloc(Catalogue->ByHash, Catalogue->Capacity * sizeof(unsigned int));
+        Valid = ByHash != NULL;
+        if(Valid)
+            Catalogue->ByHash = ByHash;
+    }
+
+    if(!Valid)
+    {
+        Rollback(Catalogue, &AddMark);
+        free(Profiles);
+        return false;
+    }
+
+    SortByHash(Catalogue);
+    for(unsigned int Index = 0; Index < ProfileCount; ++Index)
+        Chip8CatalogueSetQuirks(Catalogue, Profiles[Index].Hash, Profiles[Index].Quirks);
+
+    free(Profiles);
+    return true;
+}
+
+internal chip8_rom_profile *
+FindProfile(chip8_catalogue *Catalogue, unsigned long long Hash)
+{
+    chip8_rom_profile *End = Catalogue->Profiles + Catalogue->ProfileCount;
+    chip8_rom_profile *Found = std::lower_bound(Catalogue->Profiles, End, Hash,
+                                                [](const chip8_rom_profile &Profile, unsigned long long Key) { return Profile.Hash < Key; });
+    return Found;
+}
+
+void Chip8CatalogueSetQuirks(chip8_catalogue *Catalogue, unsigned long long Hash, chip8_quirks Quirks)
+{
+    chip8_rom_profile *Found = FindProfile(Catalogue, Hash);
+    if(Found < Catalogue->Profiles + Catalogue->ProfileCount && Found->Hash == Hash)
+    {
+        Found->Quirks = Quirks;
+        return;
+    }
+
+    unsigned int Position = (unsigned int)(Found - Catalogue->Profiles);
+    if(!Reserve(&Catalogue->Profiles, &Catalogue->ProfileCapacity, Catalogue->ProfileCount))
+        return;
+
+    memmove(Catalogue->Profiles + Position + 1, Catalogue->Profiles + Position,
+            (Catalogue->ProfileCount - Position) * sizeof(chip8_rom_profile));
+    Catalogue->Profiles[Position].Hash = Hash;
+    Catalogue->Profiles[Position].Quirks = Quirks;
+    ++Catalogue->ProfileCount;
+}
+
+bool Chip8CatalogueGetQuirks(chip8_catalogue *Catalogue, chip8_rom *Rom, chip8_quirks *Quirks)
+{
+    chip8_rom_profile *Found = FindProfile(Catalogue, Rom->Hash);
+    if(Found == Catalogue->Profiles + Catalogue->ProfileCount || Found->Hash != Rom->Hash)
+        return false;
+
+    *Quirks = Found->Quirks;
+    return true;
+}
+
+chip8_rom *Chip8CatalogueFind(chip8_catalogue *Catalogue, unsigned long long Hash)
+{
+    chip8_rom *Roms = Catalogue->Roms;
+    unsigned int *End = Catalogue->ByHash + Catalogue->Count;
+    unsigned int *Found = std::lower_bound(Catalogue->ByHash, End, Hash,
+                                           [Roms](unsigned int Index, unsigned long long Key) { return Roms[Index].Hash < Key; });
+
+    return Found != End && Roms[*Found].Hash == Hash ? Roms + *Found : NULL;
+}
+
+bool Chip8CatalogueWrite(chip8_catalogue *Catalogue, const char *Path)
+{
+    FILE *File = fopen(Path, "wb");
+    if(!File)
+        return false;
+
+    bool Valid = fwrite(CHIP8_PACK_MAGIC, 1, 4, File) == 4 &&
+                 Put(File, CHIP8_PACK_VERSION, 2) && Put(File, 0, 2) &&
+                 Put(File, Catalogue->Count, 4) && Put(File, Catalogue->ProfileCount, 4);
+
+    for(unsigned int Index = 0; Valid && Index < Catalogue->Count; ++Index)
+    {
+        chip8_rom *Rom = Catalogue->Roms + Index;
+        size_t NameLength = strlen(Rom->Name);
+        if(NameLength > 0xFFFF)
+            NameLength = 0xFFFF;
+
+        Valid = Put(File, NameLength, 2) && fwrite(Rom->Name, 1, NameLength, File) == NameLength &&
+                Put(File, Rom->Size, 4) && fwrite(Rom->Data, 1, Rom->Size, File) == Rom->Size;
+    }
+
+    for(unsigned int Index = 0; Valid && Index < Catalogue->ProfileCount; ++Index)
+    {
+        chip8_rom_profile *Profile = Catalogue->Profiles + Index;
+        Valid = Put(File, Profile->Hash, 8) && Put(File, Profile->Quirks, 1);
+    }
+
+    return fclose(File) == 0 && Valid;
+}
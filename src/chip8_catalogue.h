@@ -0,0 +1,118 @@
+#ifndef CHIP_8_CATALOGUE
+#define CHIP_8_CATALOGUE
+
+#include <stddef.h>
+#include "chip8.h"
+#include "chip8_extended.h"
+
+#define CHIP8_PACK_MAGIC "CH8P"
+#define CHIP8_PACK_VERSION 1
+
+/* NOTE(koekeishiya): A packed archive holds any number of roms and quirk profiles:
+ *
+ *     "CH8P"  u16 version  u16 reserved  u32 rom count  u32 profile count
+ *     rom:     u16 name length  name  u32 size  data
+ *     profile: u64 rom hash  u8 chip8_quirks
+ *
+ * with all roms before all profiles. All integers are little-endian. */
+
+/* NOTE(koekeishiya): Largest rom the catalogue takes, the most an extended machine holds. */
+#define CHIP8_CATALOGUE_MAX_ROM EXTENDED_ROM_CAPACITY
+
+/* NOTE(koekeishiya): Data points into a block owned by the catalogue, so it is shared by
+ * every instance started from it and only copied when it is loaded. Hash is
+ * Chip8CatalogueHash of the data. */
+struct chip8_rom
+{
+    char *Name;
+    const unsigned char *Data;
+    unsigned int Size;
+    unsigned long long Hash;
+};
+
+/* NOTE(koekeishiya): A file of a directory that was left out, and why. Reason is a
+ * static string that reads after the path, e.g. "is empty". */
+struct chip8_catalogue_skip
+{
+    char *Path;
+    const char *Reason;
+};
+
+struct chip8_rom_profile
+{
+    unsigned long long Hash;
+    chip8_quirks Quirks;
+};
+
+/* NOTE(koekeishiya): Files of at least CHIP8_CATALOGUE_MAP_SIZE, i.e. archives, are
+ * memory-mapped and get a block of their own. Mapping a single small rom costs more than
+ * reading it, so those are read into shared blocks of CHIP8_CATALOGUE_BLOCK_SIZE. */
+#define CHIP8_CATALOGUE_MAP_SIZE (64 << 10)
+#define CHIP8_CATALOGUE_BLOCK_SIZE (1 << 20)
+
+struct chip8_catalogue_block
+{
+    unsigned char *Memory;
+    size_t Size;
+    size_t Used;
+    bool Mapped;
+};
+
+/* NOTE(koekeishiya): Roms are kept in the order they were added. ByHash holds their
+ * indices sorted by hash and Profiles is sorted by hash, so lookups are binary searches. */
+struct chip8_catalogue
+{
+    chip8_rom *Roms;
+    unsigned int Count;
+    unsigned int Capacity;
+    unsigned int *ByHash;
+
+    chip8_rom_profile *Profiles;
+    unsigned int ProfileCount;
+    unsigned int ProfileCapacity;
+
+    chip8_catalogue_block *Blocks;
+    unsigned int BlockCount;
+    unsigned int BlockCapacity;
+    unsigned long long Bytes;
+
+    chip8_catalogue_skip *Skipped;
+    unsigned int SkippedCount;
+    unsigned int SkippedCapacity;
+};
+
+void Chip8CatalogueCreate(chip8_catalogue *Catalogue);
+void Chip8CatalogueDestroy(chip8_catalogue *Catalogue);
+
+/* NOTE(koekeishiya): Add a rom file, a packed archive (recognized by its magic) or every
+ * file of a directory, in name order and without descending into subdirectories. The
+ * directory of the path, or the directory itself, can hold a quirks.txt with one
+ * "<hash> <profile>" line per rom, the hash in hex as printed by chip8-pack -list; lines
+ * starting with # are ignored. Everything is read or mapped up front.
+ *
+ * Files of a directory that can not be read, are empty, larger than
+ * CHIP8_CATALOGUE_MAX_ROM, damaged archives, save states, input logs, frame exports or
+ * carry the extension of something else the tools write (.state, .log, .json, .wav, .txt,
+ * .cpp, .so) are left out and appended to Skipped. Returns false, with the catalogue
+ * unchanged, if a path given directly is not a rom or an archive, a quirks.txt is bad, or
+ * memory runs out. */
+bool Chip8CatalogueAdd(chip8_catalogue *Catalogue, const char *Path);
+
+/* NOTE(koekeishiya): Record the quirk profile of the rom with the given hash, replacing
+ * any earlier one. */
+void Chip8CatalogueSetQuirks(chip8_catalogue *Catalogue, unsigned long long Hash, chip8_quirks Quirks);
+
+/* NOTE(koekeishiya): The profile recorded for Rom, or false if there is none. */
+bool Chip8CatalogueGetQuirks(chip8_catalogue *Catalogue, chip8_rom *Rom, chip8_quirks *Quirks);
+
+/* NOTE(koekeishiya): A rom with the given hash, or NULL. */
+chip8_rom *Chip8CatalogueFind(chip8_catalogue *Catalogue, unsigned long long Hash);
+
+/* NOTE(koekeishiya): Write every rom and profile as a packed archive. */
+bool Chip8CatalogueWrite(chip8_catalogue *Catalogue, const char *Path);
+
+/* NOTE(koekeishiya): For roms that fit a chip8 this equals Chip8RomHash of a freshly
+ * loaded machine, which is what input logs identify their rom by. */
+unsigned long long Chip8CatalogueHash(const unsigned char *Data, unsigned int Size);
+
+#endif
@@ -0,0 +1,212 @@
+#include "chip8_debug.h"
+#include <stdio.h>
+#include <string.h>
+
+#define internal static
+
+internal void
+SetBit(unsigned long long *Bitmap, unsigned int Address, bool Set)
+{
+    unsigned long long Bit = 1ULL << (Address & 63);
+    if(Set)
+        Bitmap[(Address & 0xFFF) >> 6] |= Bit;
+    else
+        Bitmap[(Address & 0xFFF) >> 6] &= ~Bit;
+}
+
+/* NOTE(koekeishiya): Watchpoints may overlap, so the bitmap is rebuilt from all of them. */
+internal void
+RebuildWatched(chip8_debugger *Debugger)
+{
+    memset(Debugger->Watched, 0, sizeof(Debugger->Watched));
+    for(int Index = 0; Index < CHIP8_DEBUG_MAX_WATCHPOINTS; ++Index)
+    {
+        chip8_watchpoint *Watchpoint = Debugger->Watchpoints + Index;
+        if(!Watchpoint->Used)
+            continue;
+
+        for(unsigned int Address = Watchpoint->First; Address <= Watchpoint->Last; ++Address)
+            SetBit(Debugger->Watched, Address, true);
+    }
+}
+
+void Chip8DebugInit(chip8_debugger *Debugger)
+{
+    memset(Debugger, 0, sizeof(chip8_debugger));
+    Debugger->ReturnPc = -1;
+    Debugger->ReturnSp = -1;
+}
+
+void Chip8DebugSetBreakpoint(chip8_debugger *Debugger, unsigned int Address, bool Set)
+{
+    SetBit(Debugger->Breakpoints, Address, Set);
+}
+
+int Chip8DebugAddWatchpoint(chip8_debugger *Debugger, unsigned int First, unsigned int Last, unsigned char Access)
+{
+    if(First > Last || Last > 0xFFF || !(Access & Chip8Watch_ReadWrite))
+        return -1;
+
+    for(int Index = 0; Index < CHIP8_DEBUG_MAX_WATCHPOINTS; ++Index)
+    {
+        chip8_watchpoint *Watchpoint = Debugger->Watchpoints + Index;
+        if(Watchpoint->Used)
+            continue;
+
+        Watchpoint->Used = true;
+        Watchpoint->Access = Access;
+        Watchpoint->First = First;
+        Watchpoint->Last = Last;
+        RebuildWatched(Debugger);
+        return Index;
+    }
+
+    return -1;
+}
+
+bool Chip8DebugRemoveWatchpoint(chip8_debugger *Debugger, int Index)
+{
+    if(Index < 0 || Index >= CHIP8_DEBUG_MAX_WATCHPOINTS || !Debugger->Watchpoints[Index].Used)
+        return false;
+
+    Debugger->Watchpoints[Index].Used = false;
+    RebuildWatched(Debugger);
+    return true;
+}
+
+template<int Quirks> internal chip8_debug_stop
+RunSpecialized(chip8_debugger *Debugger, chip8 *Processor, unsigned long long Cycles,
+               bool Resume, unsigned long long *Executed)
+{
+    unsigned long long Count = 0;
+    chip8_debug_stop Stop = Chip8Stop_Cycles;
+
+    while(Count < Cycles)
+    {
+        if(Count > 0 || !Resume)
+        {
+            if(Processor->Pc == Debugger->ReturnPc && Processor->Sp == Debugger->ReturnSp)
+            {
+                Debugger->ReturnPc = Debugger->ReturnSp = -1;
+                Stop = Chip8Stop_Return;
+                break;
+            }
+
+            if(Chip8DebugTest(Debugger->Breakpoints, Processor->Pc))
+            {
+                Stop = Chip8Stop_Breakpoint;
+                break;
+            }
+        }
+
+        Debugger->Hit = false;
+        Chip8StepDebug<Quirks>(Processor, Debugger);
+        ++Count;
+
+        if(Debugger->Hit)
+        {
+            Stop = Chip8Stop_Watchpoint;
+            break;
+        }
+    }
+
+    *Executed = Count;
+    return Stop;
+}
+
+chip8_debug_stop Chip8DebugRun(chip8_debugger *Debugger, chip8 *Processor, unsigned long long Cycles,
+                               bool Resume, unsigned long long *Executed)
+{
+    switch(Processor->Quirks)
+    {
+        case Chip8Quirks_Chip8: return RunSpecialized<Chip8Quirks_Chip8>(Debugger, Processor, Cycles, Resume, Executed);
+        case Chip8Quirks_Chip48: return RunSpecialized<Chip8Quirks_Chip48>(Debugger, Processor, Cycles, Resume, Executed);
+        case Chip8Quirks_Schip: return RunSpecialized<Chip8Quirks_Schip>(Debugger, Processor, Cycles, Resume, Executed);
+        case Chip8Quirks_XoChip: return RunSpecialized<Chip8Quirks_XoChip>(Debugger, Processor, Cycles, Resume, Executed);
+        default: return RunSpecialized<Chip8Quirks_Default>(Debugger, Processor, Cycles, Resume, Executed);
+    }
+}
+
+bool Chip8DebugStepOver(chip8_debugger *Debugger, chip8 *Processor)
+{
+    unsigned int Pc = Processor->Pc & 0xFFF;
+    unsigned short Opcode = Processor->Memory[Pc] << 8 | Processor->Memory[(Pc + 1) & 0xFFF];
+    if((Opcode & 0xF000) != 0x2000)
+        return false;
+
+    Debugger->ReturnPc = Processor->Pc + 2;
+    Debugger->ReturnSp = Processor->Sp;
+    return true;
+}
+
+void Chip8Disassemble(unsigned short Opcode, chip8_quirks Quirks, char *Buffer, int Size)
+{
+    int X = (Opcode >> 8) & 0xF;
+    int Y = (Opcode >> 4) & 0xF;
+    int N = Opcode & 0xF;
+    int NN = Opcode & 0xFF;
+    int NNN = Opcode & 0xFFF;
+
+    switch(Opcode & 0xF000)
+    {
+        case 0x0000:
+        {
+            if(Opcode == 0x00E0) snprintf(Buffer, Size, "CLS");
+            else if(Opcode == 0x00EE) snprintf(Buffer, Size, "RET");
+            else snprintf(Buffer, Size, "SYS 0x%03X", NNN);
+        } break;
+        case 0x1000: snprintf(Buffer, Size, "JP 0x%03X", NNN); break;
+        case 0x2000: snprintf(Buffer, Size, "CALL 0x%03X", NNN); break;
+        case 0x3000: snprintf(Buffer, Size, "SE V%X, 0x%02X", X, NN); break;
+        case 0x4000: snprintf(Buffer, Size, "SNE V%X, 0x%02X", X, NN); break;
+        case 0x5000: snprintf(Buffer, Size, "SE V%X, V%X", X, Y); break;
+        case 0x6000: snprintf(Buffer, Size, "LD V%X, 0x%02X", X, NN); break;
+        case 0x7000: snprintf(Buffer, Size, "ADD V%X, 0x%02X", X, NN); break;
+        case 0x8000:
+        {
+            static const char *Operations[16] =
+            {
+                "LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN",
+                NULL, NULL, NULL, NULL, NULL, NULL, "SHL", NULL,
+            };
+
+            if(Operations[N])
+                snprintf(Buffer, Size, "%s V%X, V%X", Operations[N], X, Y);
+            else
+                snprintf(Buffer, Size, "DW 0x%04X", Opcode);
+        } break;
+        case 0x9000: snprintf(Buffer, Size, "SNE V%X, V%X", X, Y); break;
+        case 0xA000: snprintf(Buffer, Size, "LD I, 0x%03X", NNN); break;
+        case 0xB000:
+        {
+            if(Chip8QuirkSets[Quirks].JumpUsesVX)
+                snprintf(Buffer, Size, "JP V%X, 0x%03X", X, NNN);
+            else
+                snprintf(Buffer, Size, "JP V0, 0x%03X", NNN);
+        } break;
+        case 0xC000: snprintf(Buffer, Size, "RND V%X, 0x%02X", X, NN); break;
+        case 0xD000: snprintf(Buffer, Size, "DRW V%X, V%X, %d", X, Y, N); break;
+        case 0xE000:
+        {
+            if(NN == 0x9E) snprintf(Buffer, Size, "SKP V%X", X);
+            else if(NN == 0xA1) snprintf(Buffer, Size, "SKNP V%X", X);
+            else snprintf(Buffer, Size, "DW 0x%04X", Opcode);
+        } break;
+        case 0xF000:
+        {
+            switch(NN)
+            {
+                case 0x07: snprintf(Buffer, Size, "LD V%X, DT", X); break;
+                case 0x0A: snprintf(Buffer, Size, "LD V%X, K", X); break;
+                case 0x15: snprintf(Buffer, Size, "LD DT, V%X", X); break;
+                case 0x18: snprintf(Buffer, Size, "LD ST, V%X", X); break;
+                case 0x1E: snprintf(Buffer, Size, "ADD I, V%X", X); break;
+                case 0x29: snprintf(Buffer, Size, "LD F, V%X", X); break;
+                case 0x33: snprintf(Buffer, Size, "LD B, V%X", X); break;
+                case 0x55: snprintf(Buffer, Size, "LD [I], V%X", X); break;
+                case 0x65: snprintf(Buffer, Size, "LD V%X, [I]", X); break;
+                default: snprintf(Buffer, Size, "DW 0x%04X", Opcode); break;
+            }
+        } break;
+    }
+}
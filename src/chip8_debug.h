@@ -0,0 +1,113 @@
+#ifndef CHIP_8_DEBUG
+#define CHIP_8_DEBUG
+
+#include "chip8.h"
+
+#define CHIP8_DEBUG_MAX_WATCHPOINTS 16
+
+/* NOTE(koekeishiya): One bit per address of chip8 Memory. */
+#define CHIP8_DEBUG_WORDS (0x1000 / 64)
+
+enum chip8_watch_access
+{
+    Chip8Watch_Read = 1,
+    Chip8Watch_Write = 2,
+    Chip8Watch_ReadWrite = 3,
+};
+
+struct chip8_watchpoint
+{
+    bool Used;
+    unsigned char Access;
+    unsigned short First;
+    unsigned short Last;
+};
+
+enum chip8_debug_stop
+{
+    /* NOTE(koekeishiya): Ran all the cycles it was given. */
+    Chip8Stop_Cycles,
+
+    /* NOTE(koekeishiya): About to execute an instruction at a breakpoint. */
+    Chip8Stop_Breakpoint,
+
+    /* NOTE(koekeishiya): Executed an instruction that accessed a watched address. */
+    Chip8Stop_Watchpoint,
+
+    /* NOTE(koekeishiya): Returned from the call Chip8DebugStepOver stepped over. */
+    Chip8Stop_Return,
+};
+
+/* NOTE(koekeishiya): Breakpoints and watched addresses are bitmaps, so checking the next
+ * instruction is a single bit test and an access to memory nobody watches is another.
+ * Only accesses to watched addresses look at the watchpoints themselves. */
+struct chip8_debugger
+{
+    unsigned long long Breakpoints[CHIP8_DEBUG_WORDS];
+    unsigned long long Watched[CHIP8_DEBUG_WORDS];
+    chip8_watchpoint Watchpoints[CHIP8_DEBUG_MAX_WATCHPOINTS];
+
+    /* NOTE(koekeishiya): Where a call that is being stepped over returns to, or -1. */
+    int ReturnPc;
+    int ReturnSp;
+
+    /* NOTE(koekeishiya): The first watched access of the last instruction executed. */
+    bool Hit;
+    int HitWatchpoint;
+    unsigned short HitAddress;
+    unsigned char HitAccess;
+};
+
+inline bool Chip8DebugTest(const unsigned long long *Bitmap, unsigned int Address)
+{
+    return (Bitmap[(Address & 0xFFF) >> 6] >> (Address & 63)) & 1;
+}
+
+/* NOTE(koekeishiya): Called by Chip8StepDebug for every byte of memory an instruction
+ * reads or writes. */
+inline void Chip8DebugAccess(chip8_debugger *Debugger, unsigned int Address, chip8_watch_access Access)
+{
+    if(Debugger->Hit || !Chip8DebugTest(Debugger->Watched, Address))
+        return;
+
+    for(int Index = 0; Index < CHIP8_DEBUG_MAX_WATCHPOINTS; ++Index)
+    {
+        chip8_watchpoint *Watchpoint = Debugger->Watchpoints + Index;
+        if(Watchpoint->Used && (Watchpoint->Access & Access) &&
+           Address >= Watchpoint->First && Address <= Watchpoint->Last)
+        {
+            Debugger->Hit = true;
+            Debugger->HitWatchpoint = Index;
+            Debugger->HitAddress = Address;
+            Debugger->HitAccess = Access;
+            return;
+        }
+    }
+}
+
+void Chip8DebugInit(chip8_debugger *Debugger);
+
+void Chip8DebugSetBreakpoint(chip8_debugger *Debugger, unsigned int Address, bool Set);
+
+/* NOTE(koekeishiya): Watch First through Last for the given accesses. Returns the index of
+ * the watchpoint, or -1 if there are CHIP8_DEBUG_MAX_WATCHPOINTS already. */
+int Chip8DebugAddWatchpoint(chip8_debugger *Debugger, unsigned int First, unsigned int Last, unsigned char Access);
+bool Chip8DebugRemoveWatchpoint(chip8_debugger *Debugger, int Index);
+
+/* NOTE(koekeishiya): Execute up to Cycles instructions on the instrumented interpreter,
+ * stopping before an instruction at a breakpoint or after one that touched a watchpoint.
+ * With Resume a breakpoint at the current Pc is ignored, so that execution can continue
+ * from it. Executed is set to the instructions that ran. Timers are the caller's. */
+chip8_debug_stop Chip8DebugRun(chip8_debugger *Debugger, chip8 *Processor, unsigned long long Cycles,
+                               bool Resume, unsigned long long *Executed);
+
+/* NOTE(koekeishiya): If the next instruction is a call, arrange for Chip8DebugRun to stop
+ * with Chip8Stop_Return once it has returned and return true. Otherwise stepping over is
+ * a single step and it returns false. */
+bool Chip8DebugStepOver(chip8_debugger *Debugger, chip8 *Processor);
+
+/* NOTE(koekeishiya): Write the instruction as assembly, in the syntax of Cowgod's
+ * reference, e.g. "LD V1, 0x20" or "DRW V0, V1, 5". BNNN follows the profile. */
+void Chip8Disassemble(unsigned short Opcode, chip8_quirks Quirks, char *Buffer, int Size);
+
+#endif
@@ -0,0 +1,127 @@
+#include "chip8_engine.h"
+#include "chip8_cache.h"
+#include "chip8_jit.h"
+#include "chip8_aot.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *Chip8EngineNames[Chip8Engine_Count] =
+{
+    "interpreter",
+    "cached",
+    "fused",
+    "jit",
+    "jit-lockstep",
+    "aot",
+};
+
+bool Chip8EngineCreate(chip8_engine *Engine, chip8_engine_type Type)
+{
+    memset(Engine, 0, sizeof(chip8_engine));
+    Engine->Type = Type;
+
+    switch(Type)
+    {
+        case Chip8Engine_Interpreter:
+        case Chip8Engine_Aot:
+        {
+        } break;
+        case Chip8Engine_Cached:
+        case Chip8Engine_Fused:
+        {
+            Engine->Cache = (chip8_cache *) calloc(1, sizeof(chip8_cache));
+            if(!Engine->Cache)
+                return false;
+
+            Engine->Cache->Fuse = Type == Chip8Engine_Fused;
+        } break;
+        case Chip8Engine_Jit:
+        case Chip8Engine_JitLockstep:
+        {
+            Engine->Jit = Chip8JitCreate(Type == Chip8Engine_JitLockstep);
+            if(!Engine->Jit)
+                return false;
+        } break;
+        default:
+        {
+            return false;
+        } break;
+    }
+
+    Chip8EngineReset(Engine);
+    return true;
+}
+
+void Chip8EngineDestroy(chip8_engine *Engine)
+{
+    free(Engine->Cache);
+    Chip8JitDestroy(Engine->Jit);
+    Chip8AotDestroy(Engine->Aot);
+    memset(Engine, 0, sizeof(chip8_engine));
+}
+
+bool Chip8EngineLoadModule(chip8_engine *Engine, const char *Path)
+{
+    if(Engine->Type != Chip8Engine_Aot)
+        return false;
+
+    Chip8AotDestroy(Engine->Aot);
+    Engine->Aot = Chip8AotCreate(Path);
+    return Engine->Aot != NULL;
+}
+
+void Chip8EngineReset(chip8_engine *Engine)
+{
+    if(Engine->Cache)
+        Chip8CacheReset(Engine->Cache);
+
+    if(Engine->Jit)
+        Chip8JitReset(Engine->Jit);
+
+    if(Engine->Aot)
+        Chip8AotReset(Engine->Aot);
+}
+
+void Chip8EngineRun(chip8_engine *Engine, chip8 *Processor, unsigned long long Cycles)
+{
+    switch(Engine->Type)
+    {
+        case Chip8Engine_Cached:
+        case Chip8Engine_Fused:
+        {
+            Chip8CacheRun(Engine->Cache, Processor, Cycles);
+        } break;
+        case Chip8Engine_Jit:
+        case Chip8Engine_JitLockstep:
+        {
+            Chip8JitRun(Engine->Jit, Processor, Cycles);
+        } break;
+        case Chip8Engine_Aot:
+        {
+            Chip8AotRun(Engine->Aot, Processor, Cycles);
+        } break;
+        default:
+        {
+            Chip8RunCycles(Processor, Cycles);
+        } break;
+    }
+}
+
+const char *Chip8EngineName(chip8_engine_type Type)
+{
+    return Type < Chip8Engine_Count ? Chip8EngineNames[Type] : "unknown";
+}
+
+bool Chip8EngineFromName(const char *Name, chip8_engine_type *Type)
+{
+    for(int Index = 0; Index < Chip8Engine_Count; ++Index)
+    {
+        if(strcmp(Name, Chip8EngineNames[Index]) == 0)
+        {
+            *Type = (chip8_engine_type) Index;
+            return true;
+        }
+    }
+
+    return false;
+}
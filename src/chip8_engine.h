@@ -0,0 +1,48 @@
+#ifndef CHIP_8_ENGINE
+#define CHIP_8_ENGINE
+
+#include "chip8.h"
+
+struct chip8_cache;
+struct chip8_jit;
+struct chip8_aot;
+
+/* NOTE(koekeishiya): The different ways of executing chip-8 code. All engines produce
+ * exactly the same machine state for the same number of cycles, they only differ in speed. */
+enum chip8_engine_type
+{
+    Chip8Engine_Interpreter,
+    Chip8Engine_Cached,
+    Chip8Engine_Fused,
+    Chip8Engine_Jit,
+    Chip8Engine_JitLockstep,
+    Chip8Engine_Aot,
+
+    Chip8Engine_Count
+};
+
+struct chip8_engine
+{
+    chip8_engine_type Type;
+    chip8_cache *Cache;
+    chip8_jit *Jit;
+    chip8_aot *Aot;
+};
+
+bool Chip8EngineCreate(chip8_engine *Engine, chip8_engine_type Type);
+void Chip8EngineDestroy(chip8_engine *Engine);
+
+/* NOTE(koekeishiya): Load the recompiled rom used by the aot engine, see chip8_aot.h. Until
+ * a module is loaded the aot engine interprets everything. */
+bool Chip8EngineLoadModule(chip8_engine *Engine, const char *Path);
+
+/* NOTE(koekeishiya): Drop everything the engine derived from Memory. Must be called after
+ * loading a rom or otherwise changing Memory outside of Chip8EngineRun. */
+void Chip8EngineReset(chip8_engine *Engine);
+
+void Chip8EngineRun(chip8_engine *Engine, chip8 *Processor, unsigned long long Cycles);
+
+const char *Chip8EngineName(chip8_engine_type Type);
+bool Chip8EngineFromName(const char *Name, chip8_engine_type *Type);
+
+#endif
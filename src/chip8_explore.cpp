@@ -0,0 +1,728 @@
+#include "chip8_explore.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define internal static
+
+/* NOTE(koekeishiya): Frontier nodes handed out per task. Small enough that a level with a
+ * handful of states still spreads over every worker, large enough that the deques are not
+ * touched for every node. */
+#define EXPLORE_TASK_NODES 16
+#define EXPLORE_ARENA_BLOCK (1 << 20)
+
+/* NOTE(koekeishiya): Bump allocator that nodes and chunks are forked from. Memory is only
+ * ever returned all at once, when the explorer is destroyed. */
+struct explore_arena_block
+{
+    explore_arena_block *Next;
+};
+
+struct explore_arena
+{
+    explore_arena_block *Blocks;
+    unsigned char *At;
+    unsigned char *End;
+    unsigned long long Bytes;
+};
+
+struct explore_task
+{
+    unsigned int First;
+    unsigned int Count;
+};
+
+/* NOTE(koekeishiya): The owner takes tasks from the back and thieves from the front, so
+ * they only meet on the last task. Tasks are only added while no worker is running, the
+ * lock is there for the pops. */
+struct explore_deque
+{
+    std::atomic_flag Lock = ATOMIC_FLAG_INIT;
+    std::vector<explore_task> Tasks;
+    unsigned int Head;
+};
+
+struct alignas(64) explore_worker
+{
+    chip8 Scratch;
+
+    /* NOTE(koekeishiya): The chunk each part of Scratch.Memory currently holds, so that
+     * switching between related nodes only copies the chunks they do not share. */
+    chip8_explore_chunk *Loaded[CHIP8_EXPLORE_CHUNKS];
+
+    explore_arena Arena;
+    explore_deque Deque;
+    std::vector<chip8_explore_node *> Next;
+
+    unsigned long long Expansions;
+    unsigned long long Duplicates;
+    unsigned long long Chunks;
+    unsigned long long Steals;
+};
+
+struct chip8_explore
+{
+    chip8_explore_config Config;
+    std::vector<unsigned short> Inputs;
+
+    /* NOTE(koekeishiya): Open-addressed set of state hashes, 0 marks an empty slot. */
+    std::atomic<unsigned long long> *Seen;
+    unsigned long long SeenMask;
+    std::atomic<unsigned long long> States;
+
+    explore_arena Arena;
+    explore_worker *Workers;
+    int WorkerCount;
+
+    std::vector<chip8_explore_node *> Frontier;
+    std::atomic<chip8_explore_node *> Found;
+    std::atomic<bool> Stop;
+    std::atomic<bool> OutOfMemory;
+
+    std::mutex Mutex;
+    std::condition_variable Wake;
+    std::condition_variable Done;
+    unsigned long long Generation;
+    int Pending;
+    bool Quit;
+};
+
+internal unsigned long long
+GetTimeNanos()
+{
+    using namespace std::chrono;
+    return (duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())).count();
+}
+
+internal void *
+ArenaPush(explore_arena *Arena, size_t Size)
+{
+    Size = (Size + 15) & ~(size_t)15;
+    if(Arena->At + Size > Arena->End)
+    {
+        size_t BlockSize = sizeof(explore_arena_block) + 16 + (Size > EXPLORE_ARENA_BLOCK ? Size : EXPLORE_ARENA_BLOCK);
+        explore_arena_block *Block = (explore_arena_block *) malloc(BlockSize);
+        if(!Block)
+            return NULL;
+
+        Block->Next = Arena->Blocks;
+        Arena->Blocks = Block;
+        Arena->At = (unsigned char *)(((size_t)(Block + 1) + 15) & ~(size_t)15);
+        Arena->End = (unsigned char *) Block + BlockSize;
+        Arena->Bytes += BlockSize;
+    }
+
+    void *Result = Arena->At;
+    Arena->At += Size;
+    return Result;
+}
+
+internal void
+ArenaFree(explore_arena *Arena)
+{
+    while(Arena->Blocks)
+    {
+        explore_arena_block *Next = Arena->Blocks->Next;
+        free(Arena->Blocks);
+        Arena->Blocks = Next;
+    }
+
+    Arena->At = Arena->End = NULL;
+    Arena->Bytes = 0;
+}
+
+internal inline unsigned long long
+Mix(unsigned long long X)
+{
+    X ^= X >> 30;
+    X *= 0xBF58476D1CE4E5B9ULL;
+    X ^= X >> 27;
+    X *= 0x94D049BB133111EBULL;
+    X ^= X >> 31;
+    return X;
+}
+
+/* NOTE(koekeishiya): Memory and Graphics are hashed as an xor of independent per-chunk and
+ * per-row terms, so a child only has to swap the terms of what changed in its frame. */
+internal unsigned long long
+ChunkHash(const unsigned char *Data)
+{
+    unsigned long long Hash = CHIP8_EXPLORE_CHUNK_SIZE;
+    for(int Index = 0; Index < CHIP8_EXPLORE_CHUNK_SIZE; Index += 8)
+    {
+        unsigned long long Word;
+        memcpy(&Word, Data + Index, 8);
+        Hash = Mix(Hash ^ Word) + Index;
+    }
+
+    return Hash;
+}
+
+internal inline unsigned long long
+ChunkTerm(int Chunk, unsigned long long Hash)
+{
+    return Mix(Hash + (Chunk + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+internal inline unsigned long long
+RowTerm(int Row, unsigned long long Bits)
+{
+    return Mix(Bits ^ (Row + 1) * 0xC2B2AE3D27D4EB4FULL);
+}
+
+internal unsigned long long
+RegisterHash(chip8 *Processor)
+{
+    unsigned long long Hash = 0;
+    unsigned long long Words[2];
+    memcpy(Words, Processor->V, sizeof(Words));
+    Hash = Mix(Hash ^ Words[0]);
+    Hash = Mix(Hash ^ Words[1]);
+
+    for(int Index = 0; Index < 16; Index += 4)
+    {
+        unsigned long long Word;
+        memcpy(&Word, Processor->Stack + Index, 8);
+        Hash = Mix(Hash ^ Word);
+    }
+
+    Hash = Mix(Hash ^ ((unsigned long long) Processor->I |
+                       (unsigned long long) Processor->Pc << 16 |
+                       (unsigned long long) Processor->Sp << 32 |
+                       (unsigned long long) Processor->DelayTimer << 48 |
+                       (unsigned long long) Processor->SoundTimer << 56));
+    return Mix(Hash ^ Processor->RandomState);
+}
+
+internal inline unsigned long long
+StateHash(unsigned long long Registers, unsigned long long MemoryHash, unsigned long long GraphicsHash)
+{
+    unsigned long long Hash = Mix(Registers ^ Mix(MemoryHash + 1) ^ Mix(GraphicsHash + 2));
+    return Hash ? Hash : 1;
+}
+
+/* NOTE(koekeishiya): Returns false if the hash was already in the set. */
+internal bool
+SeenInsert(chip8_explore *Explore, unsigned long long Hash)
+{
+    unsigned long long Slot = Mix(Hash) & Explore->SeenMask;
+    for(;;)
+    {
+        unsigned long long Current = Explore->Seen[Slot].load(std::memory_order_relaxed);
+        if(Current == Hash)
+            return false;
+
+        if(Current == 0)
+        {
+            if(Explore->Seen[Slot].compare_exchange_strong(Current, Hash, std::memory_order_relaxed))
+                return true;
+            if(Current == Hash)
+                return false;
+        }
+
+        Slot = (Slot + 1) & Explore->SeenMask;
+    }
+}
+
+internal void
+LoadRegisters(chip8 *Processor, chip8_explore_node *Node)
+{
+    Processor->I = Node->I;
+    Processor->Pc = Node->Pc;
+    Processor->Sp = Node->Sp;
+    memcpy(Processor->Stack, Node->Stack, sizeof(Processor->Stack));
+    memcpy(Processor->V, Node->V, sizeof(Processor->V));
+    Processor->DelayTimer = Node->DelayTimer;
+    Processor->SoundTimer = Node->SoundTimer;
+    Processor->RandomState = Node->RandomState;
+    Processor->Quirks = Node->Quirks;
+    memcpy(Processor->Graphics, Node->Graphics, sizeof(Processor->Graphics));
+}
+
+internal void
+LoadNode(explore_worker *Worker, chip8_explore_node *Node)
+{
+    chip8 *Processor = &Worker->Scratch;
+    for(int Chunk = 0; Chunk < CHIP8_EXPLORE_CHUNKS; ++Chunk)
+    {
+        if(Worker->Loaded[Chunk] != Node->Chunks[Chunk])
+        {
+            memcpy(Processor->Memory + Chunk * CHIP8_EXPLORE_CHUNK_SIZE, Node->Chunks[Chunk]->Data, CHIP8_EXPLORE_CHUNK_SIZE);
+            Worker->Loaded[Chunk] = Node->Chunks[Chunk];
+        }
+    }
+
+    LoadRegisters(Processor, Node);
+}
+
+internal void
+StoreRegisters(chip8_explore_node *Node, chip8 *Processor)
+{
+    Node->I = Processor->I;
+    Node->Pc = Processor->Pc;
+    Node->Sp = Processor->Sp;
+    memcpy(Node->Stack, Processor->Stack, sizeof(Node->Stack));
+    memcpy(Node->V, Processor->V, sizeof(Node->V));
+    Node->DelayTimer = Processor->DelayTimer;
+    Node->SoundTimer = Processor->SoundTimer;
+    Node->RandomState = Processor->RandomState;
+    Node->Quirks = Processor->Quirks;
+    memcpy(Node->Graphics, Processor->Graphics, sizeof(Node->Graphics));
+}
+
+/* NOTE(koekeishiya): Chunks holding Memory[First] to Memory[Last], First being masked
+ * already. A Last past the end of Memory wraps around to the start, like the writes of
+ * FX33 and FX55 do. */
+internal inline unsigned int
+ChunkRange(unsigned int First, unsigned int Last)
+{
+    if(Last > 0xFFF)
+        return ChunkRange(First, 0xFFF) | ChunkRange(0, Last & 0xFFF);
+
+    unsigned int Low = First / CHIP8_EXPLORE_CHUNK_SIZE;
+    unsigned int High = Last / CHIP8_EXPLORE_CHUNK_SIZE;
+    return (unsigned int)(((2ULL << High) - 1) & ~((1ULL << Low) - 1));
+}
+
+/* NOTE(koekeishiya): Run one frame the way Chip8SchedulerRunFrame does on the interpreter,
+ * and return the chunks FX33 and FX55 may have written to. The opcode and I are peeked
+ * before each cycle, which is much cheaper than comparing all of memory afterwards. */
+template<int Quirks> internal unsigned int
+RunFrame(chip8_explore *Explore, chip8 *Processor)
+{
+    unsigned long long Cycles = Explore->Config.InstructionsPerFrame;
+    if(Explore->Config.SkipIdle)
+    {
+        unsigned int MaxPeriod = Cycles / 2 < CHIP8_IDLE_MAX_PERIOD ? Cycles / 2 : CHIP8_IDLE_MAX_PERIOD;
+        chip8_idle Idle = Chip8DetectIdle(Processor, MaxPeriod);
+        if(Idle.Type != Chip8Idle_None)
+            Cycles = Chip8IdleCycles(&Idle, Cycles);
+    }
+
+    unsigned int Written = 0;
+    while(Cycles--)
+    {
+        unsigned short Opcode = Processor->Memory[Processor->Pc & 0xFFF] << 8 |
+                                Processor->Memory[(Processor->Pc + 1) & 0xFFF];
+        unsigned int Address = Processor->I & 0xFFF;
+
+        Chip8Step<Quirks>(Processor);
+
+        if((Opcode & 0xF0FF) == 0xF033)
+            Written |= ChunkRange(Address, Address + 2);
+        else if((Opcode & 0xF0FF) == 0xF055)
+            Written |= ChunkRange(Address, Address + ((Opcode & 0x0F00) >> 8));
+    }
+
+    Chip8TickTimers(Processor);
+    return Written;
+}
+
+internal unsigned int
+RunFrame(chip8_explore *Explore, chip8 *Processor)
+{
+    switch(Processor->Quirks)
+    {
+        case Chip8Quirks_Chip8: return RunFrame<Chip8Quirks_Chip8>(Explore, Processor);
+        case Chip8Quirks_Chip48: return RunFrame<Chip8Quirks_Chip48>(Explore, Processor);
+        case Chip8Quirks_Schip: return RunFrame<Chip8Quirks_Schip>(Explore, Processor);
+        case Chip8Quirks_XoChip: return RunFrame<Chip8Quirks_XoChip>(Explore, Processor);
+        default: return RunFrame<Chip8Quirks_Default>(Explore, Processor);
+    }
+}
+
+internal void
+ExpandNode(chip8_explore *Explore, explore_worker *Worker, chip8_explore_node *Parent)
+{
+    chip8 *Processor = &Worker->Scratch;
+    unsigned long long MaxStates = Explore->Config.MaxStates;
+
+    for(size_t Choice = 0; Choice < Explore->Inputs.size(); ++Choice)
+    {
+        if(Explore->Stop.load(std::memory_order_relaxed))
+            return;
+
+        unsigned short Input = Explore->Inputs[Choice];
+        LoadNode(Worker, Parent);
+        for(int Key = 0; Key < 16; ++Key)
+            Processor->Key[Key] = (Input >> Key) & 1;
+
+        unsigned int Written = RunFrame(Explore, Processor);
+        ++Worker->Expansions;
+
+        unsigned int Changed = 0;
+        unsigned long long ChunkHashes[CHIP8_EXPLORE_CHUNKS];
+        unsigned long long MemoryHash = Parent->MemoryHash;
+        for(int Chunk = 0; Written; ++Chunk, Written >>= 1)
+        {
+            if(!(Written & 1))
+                continue;
+
+            unsigned char *Data = Processor->Memory + Chunk * CHIP8_EXPLORE_CHUNK_SIZE;
+            if(memcmp(Data, Worker->Loaded[Chunk]->Data, CHIP8_EXPLORE_CHUNK_SIZE) != 0)
+            {
+                Changed |= 1u << Chunk;
+                ChunkHashes[Chunk] = ChunkHash(Data);
+                MemoryHash ^= ChunkTerm(Chunk, Worker->Loaded[Chunk]->Hash) ^ ChunkTerm(Chunk, ChunkHashes[Chunk]);
+            }
+        }
+
+        unsigned long long GraphicsHash = Parent->GraphicsHash;
+        for(int Row = 0; Row < DISPLAY_HEIGHT; ++Row)
+        {
+            if(Processor->Graphics[Row] != Parent->Graphics[Row])
+                GraphicsHash ^= RowTerm(Row, Parent->Graphics[Row]) ^ RowTerm(Row, Processor->Graphics[Row]);
+        }
+
+        unsigned long long Hash = StateHash(RegisterHash(Processor), MemoryHash, GraphicsHash);
+        if(!SeenInsert(Explore, Hash))
+        {
+            /* NOTE(koekeishiya): Put back what the frame wrote so that Scratch matches
+             * Loaded again. */
+            for(int Chunk = 0; Chunk < CHIP8_EXPLORE_CHUNKS; ++Chunk)
+            {
+                if(Changed & (1u << Chunk))
+                    memcpy(Processor->Memory + Chunk * CHIP8_EXPLORE_CHUNK_SIZE, Worker->Loaded[Chunk]->Data, CHIP8_EXPLORE_CHUNK_SIZE);
+            }
+
+            ++Worker->Duplicates;
+            continue;
+        }
+
+        chip8_explore_node *Node = (chip8_explore_node *) ArenaPush(&Worker->Arena, sizeof(chip8_explore_node));
+        if(!Node)
+        {
+            Explore->OutOfMemory.store(true, std::memory_order_relaxed);
+            Explore->Stop.store(true, std::memory_order_relaxed);
+            return;
+        }
+
+        Node->Parent = Parent;
+        Node->Hash = Hash;
+        Node->MemoryHash = MemoryHash;
+        Node->GraphicsHash = GraphicsHash;
+        Node->Depth = Parent->Depth + 1;
+        Node->Input = Input;
+        StoreRegisters(Node, Processor);
+        memcpy(Node->Chunks, Parent->Chunks, sizeof(Node->Chunks));
+
+        for(int Chunk = 0; Chunk < CHIP8_EXPLORE_CHUNKS; ++Chunk)
+        {
+            if(!(Changed & (1u << Chunk)))
+                continue;
+
+            chip8_explore_chunk *Copy = (chip8_explore_chunk *) ArenaPush(&Worker->Arena, sizeof(chip8_explore_chunk));
+            if(!Copy)
+            {
+                Explore->OutOfMemory.store(true, std::memory_order_relaxed);
+                Explore->Stop.store(true, std::memory_order_relaxed);
+                return;
+            }
+
+            Copy->Hash = ChunkHashes[Chunk];
+            memcpy(Copy->Data, Processor->Memory + Chunk * CHIP8_EXPLORE_CHUNK_SIZE, CHIP8_EXPLORE_CHUNK_SIZE);
+            Node->Chunks[Chunk] = Copy;
+            Worker->Loaded[Chunk] = Copy;
+            ++Worker->Chunks;
+        }
+
+        Worker->Next.push_back(Node);
+
+        if(Explore->Config.Goal && Explore->Config.Goal(Processor, Explore->Config.User))
+        {
+            chip8_explore_node *Expected = NULL;
+            Explore->Found.compare_exchange_strong(Expected, Node);
+            Explore->Stop.store(true, std::memory_order_relaxed);
+            return;
+        }
+
+        if(Explore->States.fetch_add(1, std::memory_order_relaxed) + 1 >= MaxStates)
+        {
+            Explore->Stop.store(true, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+internal bool
+PopTask(explore_deque *Deque, explore_task *Task, bool Steal)
+{
+    while(Deque->Lock.test_and_set(std::memory_order_acquire))
+        std::this_thread::yield();
+
+    bool Result = Deque->Head < Deque->Tasks.size();
+    if(Result)
+    {
+        if(Steal)
+        {
+            *Task = Deque->Tasks[Deque->Head++];
+        }
+        else
+        {
+            *Task = Deque->Tasks.back();
+            Deque->Tasks.pop_back();
+        }
+    }
+
+    Deque->Lock.clear(std::memory_order_release);
+    return Result;
+}
+
+internal void
+ExpandLevel(chip8_explore *Explore, int Index)
+{
+    explore_worker *Worker = Explore->Workers + Index;
+    explore_task Task;
+
+    for(;;)
+    {
+        bool Have = PopTask(&Worker->Deque, &Task, false);
+        for(int Offset = 1; !Have && Offset < Explore->WorkerCount; ++Offset)
+        {
+            Have = PopTask(&Explore->Workers[(Index + Offset) % Explore->WorkerCount].Deque, &Task, true);
+            Worker->Steals += Have;
+        }
+
+        /* NOTE(koekeishiya): No tasks are added during a level, so once every deque has
+         * been found empty this worker is done. */
+        if(!Have)
+            return;
+
+        for(unsigned int Node = Task.First; Node < Task.First + Task.Count; ++Node)
+        {
+            if(Explore->Stop.load(std::memory_order_relaxed))
+                break;
+
+            ExpandNode(Explore, Worker, Explore->Frontier[Node]);
+        }
+    }
+}
+
+internal void
+WorkerThread(chip8_explore *Explore, int Index)
+{
+    unsigned long long Generation = 0;
+    for(;;)
+    {
+        {
+            std::unique_lock<std::mutex> Lock(Explore->Mutex);
+            Explore->Wake.wait(Lock, [&] { return Explore->Quit || Explore->Generation != Generation; });
+            if(Explore->Quit)
+                return;
+            Generation = Explore->Generation;
+        }
+
+        ExpandLevel(Explore, Index);
+
+        std::lock_guard<std::mutex> Lock(Explore->Mutex);
+        if(--Explore->Pending == 0)
+            Explore->Done.notify_one();
+    }
+}
+
+chip8_explore *Chip8ExploreCreate(chip8_explore_config *Config)
+{
+    chip8_explore *Explore = new chip8_explore();
+    Explore->Config = *Config;
+
+    if(Explore->Config.Threads < 1)
+        Explore->Config.Threads = 1;
+    if(Explore->Config.InstructionsPerFrame < 1)
+        Explore->Config.InstructionsPerFrame = 1;
+    if(Explore->Config.MaxStates < 1)
+        Explore->Config.MaxStates = 1;
+
+    if(Config->Inputs && Config->InputCount > 0)
+        Explore->Inputs.assign(Config->Inputs, Config->Inputs + Config->InputCount);
+    else
+        Explore->Inputs.push_back(0);
+
+    /* NOTE(koekeishiya): At most half full, so probes stay short. */
+    unsigned long long Slots = 1024;
+    while(Slots < Explore->Config.MaxStates * 2)
+        Slots <<= 1;
+
+    Explore->Seen = new std::atomic<unsigned long long>[Slots];
+    for(unsigned long long Slot = 0; Slot < Slots; ++Slot)
+        Explore->Seen[Slot].store(0, std::memory_order_relaxed);
+    Explore->SeenMask = Slots - 1;
+
+    Explore->WorkerCount = Explore->Config.Threads;
+    Explore->Workers = new explore_worker[Explore->WorkerCount]();
+    for(int Index = 0; Index < Explore->WorkerCount; ++Index)
+        Chip8Initialize(&Explore->Workers[Index].Scratch);
+
+    return Explore;
+}
+
+void Chip8ExploreDestroy(chip8_explore *Explore)
+{
+    for(int Index = 0; Index < Explore->WorkerCount; ++Index)
+        ArenaFree(&Explore->Workers[Index].Arena);
+    ArenaFree(&Explore->Arena);
+
+    delete[] Explore->Workers;
+    delete[] Explore->Seen;
+    delete Explore;
+}
+
+chip8_explore_result Chip8ExploreRun(chip8_explore *Explore, chip8 *Start)
+{
+    chip8_explore_result Result = {};
+    unsigned long long Begin = GetTimeNanos();
+
+    /* NOTE(koekeishiya): Nodes of an earlier run stay allocated, but are no longer known
+     * to the search. */
+    for(unsigned long long Slot = 0; Slot <= Explore->SeenMask; ++Slot)
+        Explore->Seen[Slot].store(0, std::memory_order_relaxed);
+
+    for(int Index = 0; Index < Explore->WorkerCount; ++Index)
+    {
+        explore_worker *Worker = Explore->Workers + Index;
+        memset(Worker->Loaded, 0, sizeof(Worker->Loaded));
+        Worker->Expansions = Worker->Duplicates = Worker->Chunks = Worker->Steals = 0;
+    }
+
+    chip8_explore_node *Root = (chip8_explore_node *) ArenaPush(&Explore->Arena, sizeof(chip8_explore_node));
+    if(!Root)
+    {
+        Result.OutOfMemory = true;
+        return Result;
+    }
+
+    memset(Root, 0, sizeof(*Root));
+    StoreRegisters(Root, Start);
+
+    for(int Chunk = 0; Chunk < CHIP8_EXPLORE_CHUNKS; ++Chunk)
+    {
+        chip8_explore_chunk *Copy = (chip8_explore_chunk *) ArenaPush(&Explore->Arena, sizeof(chip8_explore_chunk));
+        if(!Copy)
+        {
+            Result.OutOfMemory = true;
+            return Result;
+        }
+
+        memcpy(Copy->Data, Start->Memory + Chunk * CHIP8_EXPLORE_CHUNK_SIZE, CHIP8_EXPLORE_CHUNK_SIZE);
+        Copy->Hash = ChunkHash(Copy->Data);
+        Root->Chunks[Chunk] = Copy;
+        Root->MemoryHash ^= ChunkTerm(Chunk, Copy->Hash);
+    }
+
+    for(int Row = 0; Row < DISPLAY_HEIGHT; ++Row)
+        Root->GraphicsHash ^= RowTerm(Row, Root->Graphics[Row]);
+
+    Root->Hash = StateHash(RegisterHash(Start), Root->MemoryHash, Root->GraphicsHash);
+    SeenInsert(Explore, Root->Hash);
+
+    Explore->States.store(1, std::memory_order_relaxed);
+    Explore->Found.store(NULL, std::memory_order_relaxed);
+    Explore->Stop.store(false, std::memory_order_relaxed);
+    Explore->OutOfMemory.store(false, std::memory_order_relaxed);
+    Explore->Frontier.assign(1, Root);
+    Explore->Quit = false;
+
+    std::vector<std::thread> Threads;
+    for(int Index = 0; Index < Explore->WorkerCount; ++Index)
+        Threads.push_back(std::thread(WorkerThread, Explore, Index));
+
+    chip8_explore_node *Deepest = Root;
+    unsigned int Depth = 0;
+    while(Depth < Explore->Config.MaxDepth && !Explore->Frontier.empty() && !Explore->Stop.load())
+    {
+        /* NOTE(koekeishiya): Deal the level out round-robin; whoever runs out first steals
+         * from the others. */
+        unsigned int Tasks = 0;
+        for(unsigned int First = 0; First < Explore->Frontier.size(); First += EXPLORE_TASK_NODES, ++Tasks)
+        {
+            explore_task Task;
+            Task.First = First;
+            Task.Count = Explore->Frontier.size() - First < EXPLORE_TASK_NODES ? Explore->Frontier.size() - First : EXPLORE_TASK_NODES;
+
+            explore_deque *Deque = &Explore->Workers[Tasks % Explore->WorkerCount].Deque;
+            Deque->Tasks.push_back(Task);
+        }
+
+        {
+            std::unique_lock<std::mutex> Lock(Explore->Mutex);
+            Explore->Pending = Explore->WorkerCount;
+            ++Explore->Generation;
+            Explore->Wake.notify_all();
+            Explore->Done.wait(Lock, [&] { return Explore->Pending == 0; });
+        }
+
+        Explore->Frontier.clear();
+        for(int Index = 0; Index < Explore->WorkerCount; ++Index)
+        {
+            explore_worker *Worker = Explore->Workers + Index;
+            Explore->Frontier.insert(Explore->Frontier.end(), Worker->Next.begin(), Worker->Next.end());
+            Worker->Next.clear();
+            Worker->Deque.Tasks.clear();
+            Worker->Deque.Head = 0;
+        }
+
+        if(Explore->Frontier.empty())
+            break;
+
+        Deepest = Explore->Frontier[0];
+        ++Depth;
+    }
+
+    {
+        std::lock_guard<std::mutex> Lock(Explore->Mutex);
+        Explore->Quit = true;
+        Explore->Wake.notify_all();
+    }
+
+    for(size_t Index = 0; Index < Threads.size(); ++Index)
+        Threads[Index].join();
+
+    Result.Found = Explore->Found.load();
+    Result.Deepest = Deepest;
+    Result.Depth = Result.Found ? Result.Found->Depth : Depth;
+    Result.OutOfMemory = Explore->OutOfMemory.load();
+    Result.Truncated = !Result.Found && !Result.OutOfMemory && Explore->Stop.load();
+    Result.States = Explore->States.load();
+    Result.ArenaBytes = Explore->Arena.Bytes;
+
+    for(int Index = 0; Index < Explore->WorkerCount; ++Index)
+    {
+        explore_worker *Worker = Explore->Workers + Index;
+        Result.Expansions += Worker->Expansions;
+        Result.Duplicates += Worker->Duplicates;
+        Result.Chunks += Worker->Chunks;
+        Result.Steals += Worker->Steals;
+        Result.ArenaBytes += Worker->Arena.Bytes;
+    }
+
+    Result.Nanos = GetTimeNanos() - Begin;
+    return Result;
+}
+
+unsigned int Chip8ExplorePath(chip8_explore_node *Node, unsigned short *Inputs, unsigned int Max)
+{
+    unsigned int Length = Node->Depth < Max ? Node->Depth : Max;
+    for(; Node->Parent; Node = Node->Parent)
+    {
+        if(Node->Depth <= Length)
+            Inputs[Node->Depth - 1] = Node->Input;
+    }
+
+    return Length;
+}
+
+void Chip8ExploreMaterialize(chip8_explore_node *Node, chip8 *Processor)
+{
+    for(int Chunk = 0; Chunk < CHIP8_EXPLORE_CHUNKS; ++Chunk)
+        memcpy(Processor->Memory + Chunk * CHIP8_EXPLORE_CHUNK_SIZE, Node->Chunks[Chunk]->Data, CHIP8_EXPLORE_CHUNK_SIZE);
+
+    LoadRegisters(Processor, Node);
+    memset(Processor->Key, 0, sizeof(Processor->Key));
+    Processor->DirtyRows = 0xFFFFFFFF;
+    Processor->Draw = true;
+}
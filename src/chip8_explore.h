@@ -0,0 +1,107 @@
+#ifndef CHIP_8_EXPLORE
+#define CHIP_8_EXPLORE
+
+#include "chip8.h"
+
+/* NOTE(koekeishiya): Memory of an explored state is split into chunks that are shared
+ * between a state and its children until one of them writes to it. */
+#define CHIP8_EXPLORE_CHUNK_SIZE 128
+#define CHIP8_EXPLORE_CHUNKS (0x1000 / CHIP8_EXPLORE_CHUNK_SIZE)
+
+struct chip8_explore_chunk
+{
+    unsigned long long Hash;
+    unsigned char Data[CHIP8_EXPLORE_CHUNK_SIZE];
+};
+
+/* NOTE(koekeishiya): Everything about a machine that can influence the frames after it,
+ * i.e. a chip8 without Key, Opcode and the presentation flags, with Memory replaced by
+ * references to immutable chunks. About an eighth of the size of a chip8. Input is the
+ * key mask that was held during the frame leading here from Parent. */
+struct chip8_explore_node
+{
+    chip8_explore_node *Parent;
+    unsigned long long Hash;
+    unsigned long long MemoryHash;
+    unsigned long long GraphicsHash;
+    unsigned int Depth;
+    unsigned short Input;
+
+    unsigned short I;
+    unsigned short Pc;
+    unsigned short Sp;
+    unsigned short Stack[16];
+    unsigned char V[16];
+    unsigned char DelayTimer;
+    unsigned char SoundTimer;
+    unsigned long long RandomState;
+    unsigned char Quirks;
+    unsigned long long Graphics[DISPLAY_HEIGHT];
+
+    chip8_explore_chunk *Chunks[CHIP8_EXPLORE_CHUNKS];
+};
+
+/* NOTE(koekeishiya): Called on the worker thread for every new unique state, with the
+ * machine right after its frame. Returning true ends the search with that state. */
+typedef bool chip8_explore_goal(chip8 *Processor, void *User);
+
+struct chip8_explore_config
+{
+    int Threads;
+    int InstructionsPerFrame;
+    bool SkipIdle;
+
+    /* NOTE(koekeishiya): Frames to search, and the most unique states to keep. States
+     * are deduplicated by a 64-bit hash; two different states with the same hash are
+     * treated as one. */
+    unsigned int MaxDepth;
+    unsigned long long MaxStates;
+
+    /* NOTE(koekeishiya): Key masks (bit k is key k) to try from every state, each held
+     * for one whole frame. */
+    const unsigned short *Inputs;
+    int InputCount;
+
+    chip8_explore_goal *Goal;
+    void *User;
+};
+
+/* NOTE(koekeishiya): Deepest is one of the states on the last level that was reached.
+ * OutOfMemory is set when an arena could not grow; the search stopped there, and when it
+ * happens before the first state is stored Deepest is NULL. */
+struct chip8_explore_result
+{
+    chip8_explore_node *Found;
+    chip8_explore_node *Deepest;
+    unsigned int Depth;
+    bool Truncated;
+    bool OutOfMemory;
+
+    unsigned long long Expansions;
+    unsigned long long States;
+    unsigned long long Duplicates;
+    unsigned long long Chunks;
+    unsigned long long ArenaBytes;
+    unsigned long long Steals;
+    unsigned long long Nanos;
+};
+
+struct chip8_explore;
+
+chip8_explore *Chip8ExploreCreate(chip8_explore_config *Config);
+void Chip8ExploreDestroy(chip8_explore *Explore);
+
+/* NOTE(koekeishiya): Breadth-first search from Start, one frame per level, until a goal
+ * is found, MaxDepth is reached, MaxStates is exceeded or no new states turn up. Every
+ * state runs with the quirk profile of Start. Nodes stay valid until the explorer is
+ * destroyed. */
+chip8_explore_result Chip8ExploreRun(chip8_explore *Explore, chip8 *Start);
+
+/* NOTE(koekeishiya): Write the inputs leading from the start to Node, oldest first, and
+ * return how many there are. At most Max are written. */
+unsigned int Chip8ExplorePath(chip8_explore_node *Node, unsigned short *Inputs, unsigned int Max);
+
+/* NOTE(koekeishiya): Turn a node back into a complete machine. Key is cleared. */
+void Chip8ExploreMaterialize(chip8_explore_node *Node, chip8 *Processor);
+
+#endif
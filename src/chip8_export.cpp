@@ -0,0 +1,350 @@
+#include "chip8_export.h"
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <chrono>
+
+#define internal static
+
+#define QUEUE_MASK (CHIP8_EXPORT_QUEUE_SIZE - 1)
+
+/* NOTE(koekeishiya): How long the writer sleeps when the queue is empty, well below one
+ * 60 Hz frame. */
+#define WRITER_SLEEP_MICROS 1000
+
+unsigned char *Chip8ExportPutVarint(unsigned char *At, unsigned long long Value)
+{
+    while(Value >= 0x80)
+    {
+        *At++ = (unsigned char)(Value | 0x80);
+        Value >>= 7;
+    }
+
+    *At++ = (unsigned char) Value;
+    return At;
+}
+
+const unsigned char *Chip8ExportGetVarint(const unsigned char *At, const unsigned char *End, unsigned long long *Value)
+{
+    *Value = 0;
+    for(int Shift = 0; Shift < 64 && At < End; Shift += 7)
+    {
+        unsigned char Byte = *At++;
+        *Value |= (unsigned long long)(Byte & 0x7F) << Shift;
+        if(!(Byte & 0x80))
+            return At;
+    }
+    return NULL;
+}
+
+/* NOTE(koekeishiya): A single unchanged byte between two changed ones is cheaper as a
+ * literal than as a run of its own, so literals only end at two unchanged bytes or at the
+ * end of the frame. */
+unsigned int Chip8ExportEncode(const unsigned char *Frame, const unsigned char *Previous, unsigned int Bytes, unsigned char *Out)
+{
+    unsigned char *At = Out;
+    unsigned int Index = 0;
+
+    while(Index < Bytes)
+    {
+        unsigned int Start = Index;
+        while(Index < Bytes && Frame[Index] == Previous[Index])
+            ++Index;
+
+        if(Index == Bytes)
+            break;
+
+        unsigned int First = Index;
+        while(Index < Bytes)
+        {
+            bool Same = Frame[Index] == Previous[Index];
+            bool NextSame = Index + 1 == Bytes || Frame[Index + 1] == Previous[Index + 1];
+            if(Same && NextSame)
+                break;
+            ++Index;
+        }
+
+        At = Chip8ExportPutVarint(At, First - Start);
+        At = Chip8ExportPutVarint(At, Index - First);
+        for(unsigned int Literal = First; Literal < Index; ++Literal)
+            *At++ = Frame[Literal] ^ Previous[Literal];
+    }
+
+    return At - Out;
+}
+
+bool Chip8ExportApply(unsigned char *Frame, unsigned int Bytes, const unsigned char *Runs, unsigned int Length)
+{
+    const unsigned char *At = Runs;
+    const unsigned char *End = Runs + Length;
+    unsigned long long Index = 0;
+
+    while(At < End)
+    {
+        unsigned long long Zeros, Literals;
+        At = Chip8ExportGetVarint(At, End, &Zeros);
+        if(!At || !(At = Chip8ExportGetVarint(At, End, &Literals)))
+            return false;
+
+        if(Zeros > Bytes - Index)
+            return false;
+        Index += Zeros;
+
+        if(Literals > Bytes - Index || Literals > (unsigned long long)(End - At))
+            return false;
+
+        for(unsigned long long Literal = 0; Literal < Literals; ++Literal)
+            Frame[Index++] ^= *At++;
+    }
+
+    return true;
+}
+
+internal void
+WriteBytes(chip8_export *Export, const unsigned char *Data, size_t Size)
+{
+    if(Export->Stats.Failed)
+        return;
+
+    if(Export->File)
+    {
+        Export->Stats.Failed = fwrite(Data, 1, Size, Export->File) != Size;
+        return;
+    }
+
+    while(Size > 0)
+    {
+        ssize_t Sent = send(Export->Socket, Data, Size, MSG_NOSIGNAL);
+        if(Sent <= 0)
+        {
+            Export->Stats.Failed = true;
+            return;
+        }
+
+        Data += Sent;
+        Size -= Sent;
+    }
+}
+
+/* NOTE(koekeishiya): Encode Current against the frame written before it. Words are
+ * written most significant byte first, so the bytes are in pixel order. */
+internal void
+WriteRecord(chip8_export *Export, unsigned long long Cycle)
+{
+    unsigned int Bytes = Export->Words * 8;
+    for(int Word = 0; Word < Export->Words; ++Word)
+    {
+        for(int Byte = 0; Byte < 8; ++Byte)
+            Export->Frame[Word * 8 + Byte] = (unsigned char)(Export->Current[Word] >> (56 - 8 * Byte));
+    }
+
+    unsigned char Runs[CHIP8_EXPORT_MAX_BYTES * 2 + 16];
+    unsigned int Length = Chip8ExportEncode(Export->Frame, Export->Previous, Bytes, Runs);
+
+    unsigned char *At = Chip8ExportPutVarint(Export->Record, Cycle);
+    At = Chip8ExportPutVarint(At, Length);
+    memcpy(At, Runs, Length);
+    At += Length;
+
+    WriteBytes(Export, Export->Record, At - Export->Record);
+    memcpy(Export->Previous, Export->Frame, Bytes);
+
+    ++Export->Stats.Written;
+    Export->Stats.Bytes += At - Export->Record;
+}
+
+/* NOTE(koekeishiya): Take the oldest frame still in the queue into Current. A slot whose
+ * sequence is not the expected one before and after copying was overwritten by a newer
+ * frame, which counts as dropped like everything the producer lapped. */
+internal bool
+TakeFrame(chip8_export *Export, unsigned long long *Cycle)
+{
+    for(;;)
+    {
+        unsigned long long Head = Export->Head.load(std::memory_order_acquire);
+        if(Export->Tail == Head)
+            return false;
+
+        if(Head - Export->Tail > CHIP8_EXPORT_QUEUE_SIZE)
+        {
+            Export->Stats.Dropped += Head - CHIP8_EXPORT_QUEUE_SIZE - Export->Tail;
+            Export->Tail = Head - CHIP8_EXPORT_QUEUE_SIZE;
+        }
+
+        chip8_export_slot *Slot = Export->Slots + (Export->Tail & QUEUE_MASK);
+        unsigned long long Expected = 2 * (Export->Tail + 1);
+        ++Export->Tail;
+
+        if(Slot->Sequence.load(std::memory_order_acquire) != Expected)
+        {
+            ++Export->Stats.Dropped;
+            continue;
+        }
+
+        *Cycle = Slot->Cycle;
+        memcpy(Export->Current, Slot->Words, Export->Words * sizeof(unsigned long long));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(Slot->Sequence.load(std::memory_order_relaxed) != Expected)
+        {
+            ++Export->Stats.Dropped;
+            continue;
+        }
+
+        return true;
+    }
+}
+
+internal void
+WriterThread(chip8_export *Export)
+{
+    for(;;)
+    {
+        bool Running = Export->Running.load(std::memory_order_acquire);
+
+        unsigned long long Cycle;
+        bool Wrote = false;
+        while(TakeFrame(Export, &Cycle))
+        {
+            WriteRecord(Export, Cycle);
+            Wrote = true;
+        }
+
+        /* NOTE(koekeishiya): Flush whenever the queue ran dry, so a reader following the
+         * file sees frames as they happen. */
+        if(Wrote && Export->File)
+            fflush(Export->File);
+
+        if(!Running)
+            break;
+
+        std::this_thread::sleep_for(std::chrono::microseconds(WRITER_SLEEP_MICROS));
+    }
+}
+
+internal int
+ConnectSocket(const char *Path)
+{
+    struct sockaddr_un Address;
+    memset(&Address, 0, sizeof(Address));
+    Address.sun_family = AF_UNIX;
+    if(strlen(Path) >= sizeof(Address.sun_path))
+        return -1;
+    strcpy(Address.sun_path, Path);
+
+    int Socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(Socket < 0)
+        return -1;
+
+    if(connect(Socket, (struct sockaddr *) &Address, sizeof(Address)) != 0)
+    {
+        close(Socket);
+        return -1;
+    }
+
+    return Socket;
+}
+
+chip8_export *Chip8ExportOpen(const char *Path, int Planes, int Width, int Height)
+{
+    chip8_export *Export = new chip8_export();
+    Export->Planes = Planes;
+    Export->Width = Width;
+    Export->Height = Height;
+    Export->Words = Planes * Height * (Width / 64);
+    Export->File = NULL;
+    Export->Socket = -1;
+    Export->Head.store(0, std::memory_order_relaxed);
+    Export->HasLast = false;
+    Export->Tail = 0;
+    memset(Export->Previous, 0, sizeof(Export->Previous));
+    Export->Threaded = false;
+    Export->Running.store(false, std::memory_order_relaxed);
+    memset(&Export->Stats, 0, sizeof(Export->Stats));
+
+    for(int Index = 0; Index < CHIP8_EXPORT_QUEUE_SIZE; ++Index)
+        Export->Slots[Index].Sequence.store(0, std::memory_order_relaxed);
+
+    if(strncmp(Path, "unix:", 5) == 0)
+        Export->Socket = ConnectSocket(Path + 5);
+    else
+        Export->File = fopen(Path, "wb");
+
+    if(!Export->File && Export->Socket < 0)
+    {
+        delete Export;
+        return NULL;
+    }
+
+    unsigned char Header[CHIP8_EXPORT_HEADER_SIZE];
+    memcpy(Header, CHIP8_EXPORT_MAGIC, 4);
+    Header[4] = CHIP8_EXPORT_VERSION;
+    Header[5] = (unsigned char) Planes;
+    Header[6] = (unsigned char) Width;
+    Header[7] = (unsigned char)(Width >> 8);
+    Header[8] = (unsigned char) Height;
+    Header[9] = (unsigned char)(Height >> 8);
+    WriteBytes(Export, Header, sizeof(Header));
+
+    return Export;
+}
+
+void Chip8ExportStart(chip8_export *Export)
+{
+    Export->Threaded = true;
+    Export->Running.store(true, std::memory_order_release);
+    Export->Thread = std::thread(WriterThread, Export);
+}
+
+chip8_export_stats Chip8ExportClose(chip8_export *Export)
+{
+    if(Export->Threaded)
+    {
+        Export->Running.store(false, std::memory_order_release);
+        Export->Thread.join();
+    }
+
+    if(Export->File && fclose(Export->File) != 0)
+        Export->Stats.Failed = true;
+    if(Export->Socket >= 0)
+        close(Export->Socket);
+
+    chip8_export_stats Stats = Export->Stats;
+    delete Export;
+    return Stats;
+}
+
+/* NOTE(koekeishiya): The slot is marked odd before and even after it is written, with a
+ * release fence in between, so a writer that copies it while it changes sees a sequence
+ * other than the one it expected afterwards. */
+void Chip8ExportFrame(chip8_export *Export, const unsigned long long *Words, unsigned long long Cycle)
+{
+    size_t Size = Export->Words * sizeof(unsigned long long);
+    if(Export->HasLast && memcmp(Export->Last, Words, Size) == 0)
+        return;
+
+    memcpy(Export->Last, Words, Size);
+    Export->HasLast = true;
+    ++Export->Stats.Pushed;
+
+    if(!Export->Threaded)
+    {
+        memcpy(Export->Current, Words, Size);
+        WriteRecord(Export, Cycle);
+        return;
+    }
+
+    unsigned long long Head = Export->Head.load(std::memory_order_relaxed);
+    chip8_export_slot *Slot = Export->Slots + (Head & QUEUE_MASK);
+
+    Slot->Sequence.store(2 * Head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    Slot->Cycle = Cycle;
+    memcpy(Slot->Words, Words, Size);
+
+    Slot->Sequence.store(2 * (Head + 1), std::memory_order_release);
+    Export->Head.store(Head + 1, std::memory_order_release);
+}
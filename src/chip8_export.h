@@ -0,0 +1,119 @@
+#ifndef CHIP_8_EXPORT
+#define CHIP_8_EXPORT
+
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include "chip8.h"
+#include "chip8_extended.h"
+
+#define CHIP8_EXPORT_MAGIC "CH8F"
+#define CHIP8_EXPORT_VERSION 1
+
+/* NOTE(koekeishiya): A frame stream starts with
+ *
+ *     "CH8F"  u8 version  u8 planes  u16 width  u16 height
+ *
+ * followed by one record per changed frame:
+ *
+ *     varint cycle  varint length  length bytes of runs
+ *
+ * A frame is its rows one plane after the other, each pixel one bit, most significant
+ * bit first. A record holds the frame XORed with the one before it, all zero before the
+ * first, as runs of "varint zero bytes  varint literal bytes  literals" until its end;
+ * whatever it does not cover is unchanged. Integers in the header are little-endian,
+ * varints are LEB128. */
+
+/* NOTE(koekeishiya): The largest frame, that of an extended machine. */
+#define CHIP8_EXPORT_MAX_WORDS (EXTENDED_PLANES * EXTENDED_HEIGHT * EXTENDED_WORDS)
+#define CHIP8_EXPORT_MAX_BYTES (CHIP8_EXPORT_MAX_WORDS * 8)
+#define CHIP8_EXPORT_HEADER_SIZE 10
+
+/* NOTE(koekeishiya): Must be a power of two. */
+#define CHIP8_EXPORT_QUEUE_SIZE 64
+
+/* NOTE(koekeishiya): Sequence is odd while the producer writes the slot and 2 * (n + 1)
+ * once it holds the frame pushed n-th, so the consumer can tell a slot it copied was
+ * overwritten under it. */
+struct chip8_export_slot
+{
+    std::atomic<unsigned long long> Sequence;
+    unsigned long long Cycle;
+    unsigned long long Words[CHIP8_EXPORT_MAX_WORDS];
+};
+
+struct chip8_export_stats
+{
+    /* NOTE(koekeishiya): Frames pushed and frames lost because the queue overflowed,
+     * then frames and bytes that made it into the stream. */
+    unsigned long long Pushed;
+    unsigned long long Dropped;
+    unsigned long long Written;
+    unsigned long long Bytes;
+    bool Failed;
+};
+
+/* NOTE(koekeishiya): Bounded queue from a single producer to the writer that never makes
+ * the producer wait: when the writer falls behind the oldest frames are overwritten. The
+ * writer encodes each frame against the last frame it wrote, so dropping frames never
+ * breaks the stream, it only leaves gaps in the cycle numbers. */
+struct chip8_export
+{
+    int Planes;
+    int Width;
+    int Height;
+    int Words;
+
+    FILE *File;
+    int Socket;
+
+    chip8_export_slot Slots[CHIP8_EXPORT_QUEUE_SIZE];
+    alignas(64) std::atomic<unsigned long long> Head;
+
+    /* NOTE(koekeishiya): Owned by the producer, to skip frames that did not change. */
+    alignas(64) unsigned long long Last[CHIP8_EXPORT_MAX_WORDS];
+    bool HasLast;
+
+    /* NOTE(koekeishiya): Owned by the writer. */
+    alignas(64) unsigned long long Tail;
+    unsigned long long Current[CHIP8_EXPORT_MAX_WORDS];
+    unsigned char Frame[CHIP8_EXPORT_MAX_BYTES];
+    unsigned char Previous[CHIP8_EXPORT_MAX_BYTES];
+    unsigned char Record[CHIP8_EXPORT_MAX_BYTES * 2 + 32];
+
+    bool Threaded;
+    std::thread Thread;
+    std::atomic<bool> Running;
+    chip8_export_stats Stats;
+};
+
+/* NOTE(koekeishiya): Open a stream of frames of the given layout to a file, or with a
+ * path of the form unix:/path to the listening Unix domain socket at /path. Returns NULL
+ * if the file or socket could not be opened. */
+chip8_export *Chip8ExportOpen(const char *Path, int Planes, int Width, int Height);
+
+/* NOTE(koekeishiya): Write from a thread of its own. Without it Chip8ExportFrame encodes
+ * and writes on the calling thread and never drops anything, which is what a headless
+ * run that records everything wants. */
+void Chip8ExportStart(chip8_export *Export);
+
+/* NOTE(koekeishiya): Drain what is queued, stop the writer, close the stream and free
+ * the export. Returns what happened to the frames pushed. */
+chip8_export_stats Chip8ExportClose(chip8_export *Export);
+
+/* NOTE(koekeishiya): Producer side, called after every emulated frame. Frames equal to
+ * the previous one are skipped. Never blocks and never allocates once started. */
+void Chip8ExportFrame(chip8_export *Export, const unsigned long long *Words, unsigned long long Cycle);
+
+/* NOTE(koekeishiya): Shared with the chip8-frames decoder. Encode the difference between
+ * two frames of Bytes bytes into Out, which needs room for 2 * Bytes + 16, and return its
+ * length. Apply XORs such runs back into Frame and fails on a malformed record. */
+unsigned int Chip8ExportEncode(const unsigned char *Frame, const unsigned char *Previous, unsigned int Bytes, unsigned char *Out);
+bool Chip8ExportApply(unsigned char *Frame, unsigned int Bytes, const unsigned char *Runs, unsigned int Length);
+
+/* NOTE(koekeishiya): Little-endian LEB128. Get returns NULL if the varint does not end
+ * before End. */
+unsigned char *Chip8ExportPutVarint(unsigned char *At, unsigned long long Value);
+const unsigned char *Chip8ExportGetVarint(const unsigned char *At, const unsigned char *End, unsigned long long *Value);
+
+#endif
@@ -0,0 +1,513 @@
+#include "chip8_extended.h"
+#include <stdio.h>
+#include <string.h>
+
+#define internal static
+
+/* NOTE(koekeishiya): SUPER-CHIP digits 0-9 and the XO-CHIP letters A-F, 8x10 pixels. */
+static const unsigned char Chip8BigFont[160] =
+{
+    0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+    0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+    0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+    0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+    0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+    0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+    0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+    0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+    0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+    0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+    0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+    0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+};
+
+void Chip8ExtendedInitialize(chip8_extended *Processor)
+{
+    memset(Processor, 0, sizeof(chip8_extended));
+
+    Processor->Pc = 0x200;
+    memcpy(Processor->Memory, Chip8Font, sizeof(Chip8Font));
+    memcpy(Processor->Memory + EXTENDED_BIG_FONT, Chip8BigFont, sizeof(Chip8BigFont));
+
+    Processor->PlaneMask = 0x1;
+    Processor->DirtyRows = ~0ULL;
+    Processor->RandomState = Chip8RandomState(0);
+}
+
+void Chip8ExtendedSeed(chip8_extended *Processor, unsigned long long Seed)
+{
+    Processor->RandomState = Chip8RandomState(Seed);
+}
+
+void Chip8ExtendedSetQuirks(chip8_extended *Processor, chip8_quirks Quirks)
+{
+    Processor->Quirks = Quirks < Chip8Quirks_Count ? Quirks : Chip8Quirks_Default;
+}
+
+bool Chip8ExtendedLoadRom(chip8_extended *Processor, const char *Rom)
+{
+    FILE *FileHandle = fopen(Rom, "rb");
+    if(!FileHandle)
+        return false;
+
+    /* NOTE(koekeishiya): Read one byte more than fits to notice roms that are too long. */
+    unsigned int Capacity = EXTENDED_ROM_CAPACITY;
+    unsigned char *Buffer = Processor->Memory + 0x200;
+    size_t Length = fread(Buffer, 1, Capacity, FileHandle);
+    bool TooLong = Length == Capacity && fgetc(FileHandle) != EOF;
+    bool Failed = ferror(FileHandle) != 0;
+    fclose(FileHandle);
+
+    return Length > 0 && !TooLong && !Failed;
+}
+
+bool Chip8ExtendedLoadRomImage(chip8_extended *Processor, const unsigned char *Data, unsigned int Size)
+{
+    if(Size == 0 || Size > EXTENDED_ROM_CAPACITY)
+        return false;
+
+    memcpy(Processor->Memory + 0x200, Data, Size);
+    return true;
+}
+
+/* NOTE(koekeishiya): Skip instructions step over both words of F000 NNNN. */
+internal inline void
+ExtendedSkip(chip8_extended *Processor)
+{
+    unsigned short Next = Processor->Memory[Processor->Pc] << 8 |
+                          Processor->Memory[(unsigned short)(Processor->Pc + 1)];
+    Processor->Pc += Next == 0xF000 ? 4 : 2;
+}
+
+/* NOTE(koekeishiya): Spread 16 bits over 32 so that every bit appears twice in a row,
+ * which is how a low resolution sprite row covers the high resolution display. */
+internal inline unsigned int
+ExtendedWiden(unsigned int Bits)
+{
+    Bits = (Bits | (Bits << 8)) & 0x00FF00FF;
+    Bits = (Bits | (Bits << 4)) & 0x0F0F0F0F;
+    Bits = (Bits | (Bits << 2)) & 0x33333333;
+    Bits = (Bits | (Bits << 1)) & 0x55555555;
+    return Bits | (Bits << 1);
+}
+
+/* NOTE(koekeishiya): Draw an 8xN sprite, or 16x16 for N = 0, into every selected plane.
+ * Each plane takes the next sprite from memory. As on the classic machine the position
+ * wraps and the sprite is clipped at the right and bottom edges. VF is set when any pixel
+ * of any plane is turned off. */
+internal void
+ExtendedDraw(chip8_extended *Processor, unsigned char RegisterX, unsigned char RegisterY, int N)
+{
+    int Scale = Processor->HighRes ? 1 : 2;
+    int Rows = N ? N : 16;
+    int BytesPerRow = N ? 1 : 2;
+    int SpriteWidth = 8 * BytesPerRow * Scale;
+    int Column = (RegisterX % (EXTENDED_WIDTH / Scale)) * Scale;
+    int Top = (RegisterY % (EXTENDED_HEIGHT / Scale)) * Scale;
+
+    unsigned short Address = Processor->I;
+    Processor->V[0xF] = 0;
+
+    for(int Plane = 0; Plane < EXTENDED_PLANES; ++Plane)
+    {
+        if(!(Processor->PlaneMask & (1 << Plane)))
+            continue;
+
+        for(int Row = 0; Row < Rows; ++Row)
+        {
+            int Line = Top + Row * Scale;
+            if(Line >= EXTENDED_HEIGHT)
+                break;
+
+            unsigned int Sprite = Processor->Memory[(unsigned short)(Address + Row * BytesPerRow)];
+            if(BytesPerRow == 2)
+                Sprite = Sprite << 8 | Processor->Memory[(unsigned short)(Address + Row * 2 + 1)];
+            if(Scale == 2)
+                Sprite = ExtendedWiden(Sprite);
+
+            /* NOTE(koekeishiya): Line the sprite up with the two words of a row; whatever
+             * is shifted out on the right is clipped. */
+            unsigned long long Bits = (unsigned long long) Sprite << (64 - SpriteWidth);
+            unsigned long long Left = Column < 64 ? Bits >> Column : 0;
+            unsigned long long Right = Column < 64 ? (Column ? Bits << (64 - Column) : 0) : Bits >> (Column - 64);
+            if(!(Left | Right))
+                continue;
+
+            for(int Copy = 0; Copy < Scale && Line + Copy < EXTENDED_HEIGHT; ++Copy)
+            {
+                unsigned long long *Words = Processor->Planes[Plane][Line + Copy];
+                if((Words[0] & Left) | (Words[1] & Right))
+                    Processor->V[0xF] = 1;
+
+                Words[0] ^= Left;
+                Words[1] ^= Right;
+                Processor->DirtyRows |= 1ULL << (Line + Copy);
+            }
+        }
+
+        Address += Rows * BytesPerRow;
+    }
+
+    Processor->Draw = true;
+}
+
+internal void
+ExtendedClear(chip8_extended *Processor, unsigned char PlaneMask)
+{
+    for(int Plane = 0; Plane < EXTENDED_PLANES; ++Plane)
+    {
+        if(PlaneMask & (1 << Plane))
+            memset(Processor->Planes[Plane], 0, sizeof(Processor->Planes[Plane]));
+    }
+
+    Processor->DirtyRows = ~0ULL;
+    Processor->Draw = true;
+}
+
+/* NOTE(koekeishiya): Rows are contiguous, so moving the picture up or down is a single
+ * memmove per plane. Positive scrolls down. */
+internal void
+ExtendedScrollVertical(chip8_extended *Processor, int Rows)
+{
+    if(!Processor->HighRes)
+        Rows *= 2;
+
+    if(Rows > EXTENDED_HEIGHT)
+        Rows = EXTENDED_HEIGHT;
+    if(Rows < -EXTENDED_HEIGHT)
+        Rows = -EXTENDED_HEIGHT;
+
+    size_t RowSize = sizeof(Processor->Planes[0][0]);
+    for(int Plane = 0; Plane < EXTENDED_PLANES; ++Plane)
+    {
+        if(!(Processor->PlaneMask & (1 << Plane)))
+            continue;
+
+        unsigned long long (*Lines)[EXTENDED_WORDS] = Processor->Planes[Plane];
+        if(Rows > 0)
+        {
+            memmove(Lines + Rows, Lines, (EXTENDED_HEIGHT - Rows) * RowSize);
+            memset(Lines, 0, Rows * RowSize);
+        }
+        else if(Rows < 0)
+        {
+            memmove(Lines, Lines - Rows, (EXTENDED_HEIGHT + Rows) * RowSize);
+            memset(Lines + EXTENDED_HEIGHT + Rows, 0, -Rows * RowSize);
+        }
+    }
+
+    Processor->DirtyRows = ~0ULL;
+    Processor->Draw = true;
+}
+
+/* NOTE(koekeishiya): Moving sideways shifts both words of a row and carries the bits that
+ * cross between them. Positive scrolls right. */
+internal void
+ExtendedScrollHorizontal(chip8_extended *Processor, int Pixels)
+{
+    if(!Processor->HighRes)
+        Pixels *= 2;
+
+    for(int Plane = 0; Plane < EXTENDED_PLANES; ++Plane)
+    {
+        if(!(Processor->PlaneMask & (1 << Plane)))
+            continue;
+
+        for(int Line = 0; Line < EXTENDED_HEIGHT; ++Line)
+        {
+            unsigned long long *Words = Processor->Planes[Plane][Line];
+            if(Pixels > 0)
+            {
+                Words[1] = (Words[1] >> Pixels) | (Words[0] << (64 - Pixels));
+                Words[0] >>= Pixels;
+            }
+            else
+            {
+                Words[0] = (Words[0] << -Pixels) | (Words[1] >> (64 + Pixels));
+                Words[1] <<= -Pixels;
+            }
+        }
+    }
+
+    Processor->DirtyRows = ~0ULL;
+    Processor->Draw = true;
+}
+
+template<int Quirks> void Chip8ExtendedStep(chip8_extended *Processor)
+{
+    const chip8_quirk_set &Quirk = Chip8QuirkSets[Quirks];
+    unsigned char *Memory = Processor->Memory;
+
+    Processor->Opcode = Memory[Processor->Pc] << 8 | Memory[(unsigned short)(Processor->Pc + 1)];
+    Processor->Pc += 2;
+
+    unsigned short Opcode = Processor->Opcode;
+    unsigned short X = (Opcode & 0x0F00) >> 8;
+    unsigned short Y = (Opcode & 0x00F0) >> 4;
+    unsigned short N = Opcode & 0x000F;
+
+    switch(Opcode & 0xF000)
+    {
+        case 0x0000:
+        {
+            if((Opcode & 0xFFF0) == 0x00C0) // 00CN: Scrolls the display down by N pixels.
+            {
+                ExtendedScrollVertical(Processor, N);
+                break;
+            }
+
+            if((Opcode & 0xFFF0) == 0x00D0) // 00DN: Scrolls the display up by N pixels.
+            {
+                ExtendedScrollVertical(Processor, -N);
+                break;
+            }
+
+            switch(Opcode)
+            {
+                case 0x00E0: ExtendedClear(Processor, Processor->PlaneMask); break; // 00E0: Clears the selected planes.
+                case 0x00EE: Processor->Pc = Processor->Stack[--Processor->Sp & 0xF]; break; // 00EE: Returns from subroutine.
+                case 0x00FB: ExtendedScrollHorizontal(Processor, 4); break; // 00FB: Scrolls right by 4 pixels.
+                case 0x00FC: ExtendedScrollHorizontal(Processor, -4); break; // 00FC: Scrolls left by 4 pixels.
+                case 0x00FD: Processor->Pc -= 2; break; // 00FD: Exits, which here means halting.
+                case 0x00FE: // 00FE: Switches to low resolution and clears the display.
+                {
+                    Processor->HighRes = false;
+                    ExtendedClear(Processor, 0x3);
+                } break;
+                case 0x00FF: // 00FF: Switches to high resolution and clears the display.
+                {
+                    Processor->HighRes = true;
+                    ExtendedClear(Processor, 0x3);
+                } break;
+            }
+        } break;
+        case 0x1000: Processor->Pc = Opcode & 0x0FFF; break; // 1NNN: Jumps to address NNN.
+        case 0x2000: // 2NNN: Calls subroutine at address NNN.
+        {
+            Processor->Stack[Processor->Sp++ & 0xF] = Processor->Pc;
+            Processor->Pc = Opcode & 0x0FFF;
+        } break;
+        case 0x3000: if(Processor->V[X] == (Opcode & 0x00FF)) ExtendedSkip(Processor); break; // 3XNN
+        case 0x4000: if(Processor->V[X] != (Opcode & 0x00FF)) ExtendedSkip(Processor); break; // 4XNN
+        case 0x5000:
+        {
+            if(N == 0x0) // 5XY0: Skips the next instruction if VX equals VY.
+            {
+                if(Processor->V[X] == Processor->V[Y])
+                    ExtendedSkip(Processor);
+            }
+            else if(N == 0x2 || N == 0x3) // 5XY2/5XY3: Saves or loads VX through VY at I, in either order.
+            {
+                int Step = X <= Y ? 1 : -1;
+                for(int Register = X, Offset = 0;; Register += Step, ++Offset)
+                {
+                    unsigned short Address = Processor->I + Offset;
+                    if(N == 0x2)
+                        Memory[Address] = Processor->V[Register];
+                    else
+                        Processor->V[Register] = Memory[Address];
+
+                    if(Register == Y)
+                        break;
+                }
+            }
+        } break;
+        case 0x6000: Processor->V[X] = Opcode & 0x00FF; break; // 6XNN: Sets VX to NN.
+        case 0x7000: Processor->V[X] += Opcode & 0x00FF; break; // 7XNN: Adds NN to VX.
+        case 0x8000:
+        {
+            unsigned char *V = Processor->V;
+            switch(N)
+            {
+                case 0x0: V[X] = V[Y]; break;
+                case 0x1: V[X] |= V[Y]; if(Quirk.LogicResetsVF) V[0xF] = 0; break;
+                case 0x2: V[X] &= V[Y]; if(Quirk.LogicResetsVF) V[0xF] = 0; break;
+                case 0x3: V[X] ^= V[Y]; if(Quirk.LogicResetsVF) V[0xF] = 0; break;
+                case 0x4:
+                {
+                    unsigned short Sum = V[X] + V[Y];
+                    V[X] = Sum & 0xFF;
+                    V[0xF] = Sum > 255;
+                } break;
+                case 0x5:
+                {
+                    unsigned char NoBorrow = V[X] >= V[Y];
+                    V[X] -= V[Y];
+                    V[0xF] = NoBorrow;
+                } break;
+                case 0x6:
+                {
+                    unsigned char Source = Quirk.ShiftReadsVY ? V[Y] : V[X];
+                    V[X] = Source >> 1;
+                    V[0xF] = Source & 0x1;
+                } break;
+                case 0x7:
+                {
+                    unsigned char NoBorrow = V[Y] >= V[X];
+                    V[X] = V[Y] - V[X];
+                    V[0xF] = NoBorrow;
+                } break;
+                case 0xE:
+                {
+                    unsigned char Source = Quirk.ShiftReadsVY ? V[Y] : V[X];
+                    V[X] = Source << 1;
+                    V[0xF] = Source >> 7;
+                } break;
+            }
+        } break;
+        case 0x9000: if(Processor->V[X] != Processor->V[Y]) ExtendedSkip(Processor); break; // 9XY0
+        case 0xA000: Processor->I = Opcode & 0x0FFF; break; // ANNN: Sets I to the address NNN.
+        case 0xB000: Processor->Pc = (Opcode & 0x0FFF) + Processor->V[Quirk.JumpUsesVX ? X : 0]; break; // BNNN
+        case 0xC000: Processor->V[X] = Chip8NextRandom(&Processor->RandomState) & (Opcode & 0x00FF); break; // CXNN
+        case 0xD000: ExtendedDraw(Processor, Processor->V[X], Processor->V[Y], N); break; // DXYN
+        case 0xE000:
+        {
+            unsigned char Pressed = Processor->Key[Processor->V[X] & 0xF];
+            if((Opcode & 0x00FF) == 0x009E && Pressed == 1) // EX9E: Skips if the key in VX is pressed.
+                ExtendedSkip(Processor);
+            else if((Opcode & 0x00FF) == 0x00A1 && Pressed != 1) // EXA1: Skips if it is not pressed.
+                ExtendedSkip(Processor);
+        } break;
+        case 0xF000:
+        {
+            if(Opcode == 0xF000) // F000 NNNN: Sets I to the 16-bit address in the next word.
+            {
+                Processor->I = Memory[Processor->Pc] << 8 | Memory[(unsigned short)(Processor->Pc + 1)];
+                Processor->Pc += 2;
+                break;
+            }
+
+            switch(Opcode & 0x00FF)
+            {
+                case 0x01: Processor->PlaneMask = X & 0x3; break; // FN01: Selects the planes in N.
+                case 0x02: // F002: Loads the 16 byte audio pattern at I.
+                {
+                    for(int Index = 0; Index < 16; ++Index)
+                        Processor->Pattern[Index] = Memory[(unsigned short)(Processor->I + Index)];
+                } break;
+                case 0x07: Processor->V[X] = Processor->DelayTimer; break; // FX07
+                case 0x0A: // FX0A: A keypress is awaited and stored in VX.
+                {
+                    bool Keypress = false;
+                    for(int Index = 0; Index < 16; ++Index)
+                    {
+                        if(Processor->Key[Index] == 1)
+                        {
+                            Processor->V[X] = Index;
+                            Keypress = true;
+                        }
+                    }
+
+                    if(!Keypress)
+                        Processor->Pc -= 2;
+                } break;
+                case 0x15: Processor->DelayTimer = Processor->V[X]; break; // FX15
+                case 0x18: Processor->SoundTimer = Processor->V[X]; break; // FX18
+                case 0x1E: Processor->I += Processor->V[X]; break; // FX1E
+                case 0x29: Processor->I = (Processor->V[X] & 0xF) * 5; break; // FX29: Small digit in VX.
+                case 0x30: Processor->I = EXTENDED_BIG_FONT + (Processor->V[X] & 0xF) * 10; break; // FX30: Big digit.
+                case 0x33: // FX33: Stores the binary-coded decimal representation of VX at I.
+                {
+                    unsigned char Digit = Processor->V[X];
+                    Memory[(unsigned short)(Processor->I + 2)] = Digit % 10;
+                    Memory[(unsigned short)(Processor->I + 1)] = (Digit / 10) % 10;
+                    Memory[Processor->I] = Digit / 100;
+                } break;
+                case 0x3A: Processor->Pitch = Processor->V[X]; break; // FX3A: Sets the audio pitch.
+                case 0x55: // FX55: Stores V0 through VX at I.
+                {
+                    for(int Index = 0; Index <= X; ++Index)
+                        Memory[(unsigned short)(Processor->I + Index)] = Processor->V[Index];
+
+                    if(Quirk.IndexAdvance != Chip8Index_Unchanged)
+                        Processor->I += X + (Quirk.IndexAdvance == Chip8Index_PlusXPlusOne);
+                } break;
+                case 0x65: // FX65: Reads V0 through VX from I.
+                {
+                    for(int Index = 0; Index <= X; ++Index)
+                        Processor->V[Index] = Memory[(unsigned short)(Processor->I + Index)];
+
+                    if(Quirk.IndexAdvance != Chip8Index_Unchanged)
+                        Processor->I += X + (Quirk.IndexAdvance == Chip8Index_PlusXPlusOne);
+                } break;
+                case 0x75: memcpy(Processor->Flags, Processor->V, X + 1); break; // FX75: Saves V0-VX to the flags.
+                case 0x85: memcpy(Processor->V, Processor->Flags, X + 1); break; // FX85: Restores them.
+            }
+        } break;
+    }
+}
+
+template void Chip8ExtendedStep<Chip8Quirks_Default>(chip8_extended *Processor);
+template void Chip8ExtendedStep<Chip8Quirks_Chip8>(chip8_extended *Processor);
+template void Chip8ExtendedStep<Chip8Quirks_Chip48>(chip8_extended *Processor);
+template void Chip8ExtendedStep<Chip8Quirks_Schip>(chip8_extended *Processor);
+template void Chip8ExtendedStep<Chip8Quirks_XoChip>(chip8_extended *Processor);
+
+template<int Quirks> internal void
+ExtendedRunSpecialized(chip8_extended *Processor, unsigned long long Cycles)
+{
+    while(Cycles--)
+        Chip8ExtendedStep<Quirks>(Processor);
+}
+
+void Chip8ExtendedRunCycles(chip8_extended *Processor, unsigned long long Cycles)
+{
+    switch(Processor->Quirks)
+    {
+        case Chip8Quirks_Chip8: ExtendedRunSpecialized<Chip8Quirks_Chip8>(Processor, Cycles); break;
+        case Chip8Quirks_Chip48: ExtendedRunSpecialized<Chip8Quirks_Chip48>(Processor, Cycles); break;
+        case Chip8Quirks_Schip: ExtendedRunSpecialized<Chip8Quirks_Schip>(Processor, Cycles); break;
+        case Chip8Quirks_XoChip: ExtendedRunSpecialized<Chip8Quirks_XoChip>(Processor, Cycles); break;
+        default: ExtendedRunSpecialized<Chip8Quirks_Default>(Processor, Cycles); break;
+    }
+}
+
+void Chip8ExtendedTickTimers(chip8_extended *Processor)
+{
+    if(Processor->DelayTimer > 0)
+        --Processor->DelayTimer;
+
+    if(Processor->SoundTimer > 0)
+        --Processor->SoundTimer;
+}
+
+unsigned long long Chip8ExtendedGraphicsHash(chip8_extended *Processor)
+{
+    /* NOTE(koekeishiya): FNV-1a like Chip8GraphicsHash, plane by plane and row by row. */
+    unsigned long long Hash = 0xcbf29ce484222325ULL;
+    for(int Plane = 0; Plane < EXTENDED_PLANES; ++Plane)
+    {
+        for(int Line = 0; Line < EXTENDED_HEIGHT; ++Line)
+        {
+            for(int Word = 0; Word < EXTENDED_WORDS; ++Word)
+            {
+                for(int Shift = 56; Shift >= 0; Shift -= 8)
+                {
+                    Hash ^= (Processor->Planes[Plane][Line][Word] >> Shift) & 0xFF;
+                    Hash *= 0x100000001b3ULL;
+                }
+            }
+        }
+    }
+
+    return Hash;
+}
+
+void Chip8ExtendedUnpackGraphics(chip8_extended *Processor, unsigned char *Pixels)
+{
+    for(int Line = 0; Line < EXTENDED_HEIGHT; ++Line)
+    {
+        for(int X = 0; X < EXTENDED_WIDTH; ++X)
+        {
+            int Word = X / 64;
+            int Shift = 63 - (X % 64);
+            unsigned char Low = (Processor->Planes[0][Line][Word] >> Shift) & 1;
+            unsigned char High = (Processor->Planes[1][Line][Word] >> Shift) & 1;
+            *Pixels++ = (High << 1) | Low;
+        }
+    }
+}
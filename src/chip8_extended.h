@@ -0,0 +1,91 @@
+#ifndef CHIP_8_EXTENDED
+#define CHIP_8_EXTENDED
+
+#include "chip8.h"
+
+/* NOTE(koekeishiya): SUPER-CHIP and XO-CHIP roms run on a machine of their own, so that a
+ * classic chip8 keeps its 4 KB of memory and 256 byte framebuffer. The display is always
+ * kept at the high resolution; in low resolution mode every pixel covers 2x2 of it. */
+#define EXTENDED_WIDTH 128
+#define EXTENDED_HEIGHT 64
+#define EXTENDED_WORDS (EXTENDED_WIDTH / 64)
+#define EXTENDED_PLANES 2
+
+#define EXTENDED_MEMORY 0x10000
+
+/* NOTE(koekeishiya): Where the 8x10 digits used by FX30 live, right after the small font. */
+#define EXTENDED_BIG_FONT 0x50
+
+struct chip8_extended
+{
+    unsigned short Opcode;
+
+    /* NOTE(koekeishiya): XO-CHIP addresses 64 KB. Every address is an unsigned short, so
+     * nothing can index past the end. */
+    unsigned char Memory[EXTENDED_MEMORY];
+
+    unsigned short I;
+    unsigned short Pc;
+    unsigned char V[16];
+
+    /* NOTE(koekeishiya): The HP-48 RPL user flags saved and restored by FX75 and FX85. */
+    unsigned char Flags[16];
+
+    /* NOTE(koekeishiya): Each bitplane packs a row of 128 pixels into two 64-bit words,
+     * the leftmost pixel being the most significant bit of the first one. A pixel has the
+     * colour formed by its bit in plane 1 (high) and plane 0 (low). */
+    unsigned long long Planes[EXTENDED_PLANES][EXTENDED_HEIGHT][EXTENDED_WORDS];
+
+    /* NOTE(koekeishiya): One bit per row of the high resolution display. */
+    unsigned long long DirtyRows;
+
+    unsigned short Stack[16];
+    unsigned short Sp;
+
+    unsigned char DelayTimer;
+    unsigned char SoundTimer;
+    unsigned char Key[16];
+    bool Draw;
+    bool Paused;
+
+    /* NOTE(koekeishiya): Set by 00FF and cleared by 00FE. */
+    bool HighRes;
+
+    /* NOTE(koekeishiya): Planes that drawing, clearing and scrolling apply to, bit k being
+     * plane k. Selected with FN01, plane 0 only at reset. */
+    unsigned char PlaneMask;
+
+    /* NOTE(koekeishiya): The XO-CHIP sample buffer loaded by F002 and its playback pitch,
+     * set by FX3A. 1-bit samples, played from the most significant bit. */
+    unsigned char Pattern[16];
+    unsigned char Pitch;
+
+    unsigned long long RandomState;
+    unsigned char Quirks;
+};
+
+void Chip8ExtendedInitialize(chip8_extended *Processor);
+void Chip8ExtendedSeed(chip8_extended *Processor, unsigned long long Seed);
+void Chip8ExtendedSetQuirks(chip8_extended *Processor, chip8_quirks Quirks);
+
+/* NOTE(koekeishiya): Roms can be up to 64 KB minus the 512 bytes below 0x200. */
+#define EXTENDED_ROM_CAPACITY (EXTENDED_MEMORY - 0x200)
+
+bool Chip8ExtendedLoadRom(chip8_extended *Processor, const char *Rom);
+bool Chip8ExtendedLoadRomImage(chip8_extended *Processor, const unsigned char *Data, unsigned int Size);
+
+/* NOTE(koekeishiya): Adds 00CN, 00DN, 00FB, 00FC, 00FD, 00FE, 00FF, DXY0, FX30, FX75 and
+ * FX85 from SUPER-CHIP, and 5XY2, 5XY3, F000 NNNN, FN01, F002 and FX3A from XO-CHIP to the
+ * classic set. Scrolling is measured in pixels of the current resolution. 00FD halts the
+ * machine by jumping to itself. Specialized for every chip8_quirks like Chip8Step. */
+template<int Quirks> void Chip8ExtendedStep(chip8_extended *Processor);
+void Chip8ExtendedRunCycles(chip8_extended *Processor, unsigned long long Cycles);
+void Chip8ExtendedTickTimers(chip8_extended *Processor);
+
+unsigned long long Chip8ExtendedGraphicsHash(chip8_extended *Processor);
+
+/* NOTE(koekeishiya): Expand the display to one byte per high resolution pixel, row by row,
+ * holding the colour index 0-3. */
+void Chip8ExtendedUnpackGraphics(chip8_extended *Processor, unsigned char *Pixels);
+
+#endif
@@ -0,0 +1,79 @@
+#include "chip8_frame.h"
+#include <string.h>
+
+#include <chrono>
+
+#define internal static
+
+internal unsigned long long
+GetTimeNanos()
+{
+    using namespace std::chrono;
+    return (duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())).count();
+}
+
+void Chip8FrameExchangeInit(chip8_frame_exchange *Exchange)
+{
+    memset(Exchange->Frames, 0, sizeof(Exchange->Frames));
+    Exchange->Back = 0;
+    Exchange->Middle.store(1, std::memory_order_relaxed);
+    Exchange->Front = 2;
+    Exchange->Published = 0;
+    Exchange->Replaced = 0;
+    memset(&Exchange->Stats, 0, sizeof(Exchange->Stats));
+}
+
+chip8_frame *Chip8FrameBack(chip8_frame_exchange *Exchange)
+{
+    return Exchange->Frames + Exchange->Back;
+}
+
+void Chip8FramePublish(chip8_frame_exchange *Exchange)
+{
+    Exchange->Frames[Exchange->Back].PublishNanos = GetTimeNanos();
+
+    /* NOTE(koekeishiya): Release makes the frame contents visible to the consumer that
+     * acquires this index. If the buffer we get back is still marked fresh, the consumer
+     * never saw it. */
+    unsigned int Previous = Exchange->Middle.exchange(Exchange->Back | CHIP8_FRAME_FRESH, std::memory_order_acq_rel);
+    Exchange->Back = Previous & ~CHIP8_FRAME_FRESH;
+
+    ++Exchange->Published;
+    if(Previous & CHIP8_FRAME_FRESH)
+        ++Exchange->Replaced;
+}
+
+chip8_frame *Chip8FrameAcquire(chip8_frame_exchange *Exchange)
+{
+    if(!(Exchange->Middle.load(std::memory_order_relaxed) & CHIP8_FRAME_FRESH))
+        return NULL;
+
+    unsigned int Previous = Exchange->Middle.exchange(Exchange->Front, std::memory_order_acq_rel);
+    Exchange->Front = Previous & ~CHIP8_FRAME_FRESH;
+
+    chip8_frame *Frame = Exchange->Frames + Exchange->Front;
+    unsigned long long Handoff = GetTimeNanos() - Frame->PublishNanos;
+
+    ++Exchange->Stats.Acquired;
+    Exchange->Stats.HandoffNanos += Handoff;
+    if(Handoff > Exchange->Stats.MaxHandoffNanos)
+        Exchange->Stats.MaxHandoffNanos = Handoff;
+
+    return Frame;
+}
+
+void Chip8FramePresented(chip8_frame_exchange *Exchange, chip8_frame *Frame)
+{
+    unsigned long long Present = GetTimeNanos() - Frame->PublishNanos;
+    Exchange->Stats.PresentNanos += Present;
+    if(Present > Exchange->Stats.MaxPresentNanos)
+        Exchange->Stats.MaxPresentNanos = Present;
+}
+
+chip8_frame_stats Chip8FrameGetStats(chip8_frame_exchange *Exchange)
+{
+    chip8_frame_stats Stats = Exchange->Stats;
+    Stats.Published = Exchange->Published;
+    Stats.Replaced = Exchange->Replaced;
+    return Stats;
+}
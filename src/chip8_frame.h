@@ -0,0 +1,77 @@
+#ifndef CHIP_8_FRAME
+#define CHIP_8_FRAME
+
+#include <atomic>
+#include "chip8.h"
+#include "chip8_extended.h"
+#include "chip8_latency.h"
+
+/* NOTE(koekeishiya): A finished frame as handed from the emulation thread to the render
+ * thread. Sequence is the emulated frame it was taken after. Frames of a chip8_extended
+ * fill Planes instead of Graphics. Trace is the newest key change that had been drawn. */
+struct chip8_frame
+{
+    unsigned long long Graphics[DISPLAY_HEIGHT];
+    bool Extended;
+    unsigned long long Planes[EXTENDED_PLANES][EXTENDED_HEIGHT][EXTENDED_WORDS];
+    unsigned long long Sequence;
+    unsigned long long PublishNanos;
+    chip8_latency_trace Trace;
+};
+
+struct chip8_frame_stats
+{
+    /* NOTE(koekeishiya): Written by the emulation thread. Replaced counts frames that were
+     * published again before the render thread picked them up. */
+    unsigned long long Published;
+    unsigned long long Replaced;
+
+    /* NOTE(koekeishiya): Written by the render thread. Handoff is the time from publishing
+     * a frame to the render thread acquiring it, Present the time until its buffer swap
+     * returned. */
+    unsigned long long Acquired;
+    unsigned long long HandoffNanos;
+    unsigned long long MaxHandoffNanos;
+    unsigned long long PresentNanos;
+    unsigned long long MaxPresentNanos;
+};
+
+#define CHIP8_FRAME_FRESH 0x4
+
+/* NOTE(koekeishiya): Lock-free triple buffer for a single producer and a single consumer.
+ * The producer always owns Back and the consumer Front; the third buffer sits in Middle
+ * and the two sides swap their buffer with it atomically. The producer never waits for
+ * the consumer, a frame that was not picked up in time is simply replaced by a newer one,
+ * and the consumer always gets the newest complete frame. The fields used by each side
+ * are kept on separate cache lines. */
+struct chip8_frame_exchange
+{
+    chip8_frame Frames[3];
+
+    alignas(64) std::atomic<unsigned int> Middle;
+
+    alignas(64) unsigned int Back;
+    unsigned long long Published;
+    unsigned long long Replaced;
+
+    alignas(64) unsigned int Front;
+    chip8_frame_stats Stats;
+};
+
+void Chip8FrameExchangeInit(chip8_frame_exchange *Exchange);
+
+/* NOTE(koekeishiya): Producer side: fill in the frame returned by Chip8FrameBack, then
+ * publish it, after which it must no longer be touched. */
+chip8_frame *Chip8FrameBack(chip8_frame_exchange *Exchange);
+void Chip8FramePublish(chip8_frame_exchange *Exchange);
+
+/* NOTE(koekeishiya): Consumer side: the newest frame published since the last call, or
+ * NULL if there is none. It stays valid until the next call. Call Chip8FramePresented
+ * once it is on screen to measure the whole handoff. */
+chip8_frame *Chip8FrameAcquire(chip8_frame_exchange *Exchange);
+void Chip8FramePresented(chip8_frame_exchange *Exchange, chip8_frame *Frame);
+
+/* NOTE(koekeishiya): Only consistent once the producer has stopped. */
+chip8_frame_stats Chip8FrameGetStats(chip8_frame_exchange *Exchange);
+
+#endif
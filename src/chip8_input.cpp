@@ -0,0 +1,285 @@
+#include "chip8_input.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define internal static
+
+internal void
+WriteInteger(FILE *File, unsigned long long Value, int Bytes)
+{
+    for(int Index = 0; Index < Bytes; ++Index)
+        fputc((int)((Value >> (8 * Index)) & 0xFF), File);
+}
+
+internal bool
+ReadInteger(FILE *File, unsigned long long *Value, int Bytes)
+{
+    *Value = 0;
+    for(int Index = 0; Index < Bytes; ++Index)
+    {
+        int Byte = fgetc(File);
+        if(Byte == EOF)
+            return false;
+        *Value |= (unsigned long long)Byte << (8 * Index);
+    }
+    return true;
+}
+
+internal void
+WriteVarint(FILE *File, unsigned long long Value)
+{
+    while(Value >= 0x80)
+    {
+        fputc((int)(Value & 0x7F) | 0x80, File);
+        Value >>= 7;
+    }
+    fputc((int)Value, File);
+}
+
+internal bool
+ReadVarint(FILE *File, unsigned long long *Value)
+{
+    *Value = 0;
+    for(int Shift = 0; Shift < 64; Shift += 7)
+    {
+        int Byte = fgetc(File);
+        if(Byte == EOF)
+            return false;
+
+        *Value |= (unsigned long long)(Byte & 0x7F) << Shift;
+        if(!(Byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+unsigned long long Chip8RomHash(chip8 *Processor)
+{
+    unsigned long long Hash = 0xCBF29CE484222325ULL;
+    for(int Address = 0x200; Address < 0x1000; ++Address)
+    {
+        Hash ^= Processor->Memory[Address];
+        Hash *= 0x100000001B3ULL;
+    }
+    return Hash;
+}
+
+internal void
+WriteRecord(chip8_input_recorder *Recorder, unsigned long long Cycle, unsigned char Tag)
+{
+    /* NOTE(koekeishiya): Cycles never go backwards while recording. */
+    WriteVarint(Recorder->File, Cycle - Recorder->Cycle);
+    fputc(Tag, Recorder->File);
+    Recorder->Cycle = Cycle;
+    ++Recorder->Events;
+}
+
+bool Chip8RecorderOpen(chip8_input_recorder *Recorder, const char *Path, chip8_input_header *Header)
+{
+    memset(Recorder, 0, sizeof(chip8_input_recorder));
+
+    /* NOTE(koekeishiya): The header stores the instructions per frame in 16 bits. */
+    if(Header->InstructionsPerFrame > 0xFFFF)
+        return false;
+
+    Recorder->File = fopen(Path, "wb");
+    if(!Recorder->File)
+        return false;
+
+    bool Written = fwrite(CHIP8_INPUT_MAGIC, 1, 4, Recorder->File) == 4;
+    WriteInteger(Recorder->File, CHIP8_INPUT_VERSION, 2);
+    WriteInteger(Recorder->File, Header->InstructionsPerFrame, 2);
+    WriteInteger(Recorder->File, Header->Seed, 8);
+    WriteInteger(Recorder->File, Header->RomHash, 8);
+    WriteInteger(Recorder->File, Header->Quirks, 1);
+
+    if(!Written || fflush(Recorder->File) != 0 || ferror(Recorder->File))
+    {
+        fclose(Recorder->File);
+        Recorder->File = NULL;
+        return false;
+    }
+    return true;
+}
+
+void Chip8RecordKey(chip8_input_recorder *Recorder, unsigned long long Cycle, int Key, bool Pressed)
+{
+    if(Recorder->File)
+        WriteRecord(Recorder, Cycle, (Pressed ? Chip8Input_Press : Chip8Input_Release) | (Key & 0xF));
+}
+
+void Chip8RecordCheckpoint(chip8_input_recorder *Recorder, unsigned long long Cycle, unsigned long long Hash)
+{
+    if(Recorder->File)
+    {
+        WriteRecord(Recorder, Cycle, Chip8Input_Checkpoint);
+        WriteInteger(Recorder->File, Hash, 8);
+    }
+}
+
+bool Chip8RecorderClose(chip8_input_recorder *Recorder, unsigned long long Cycle, unsigned long long Hash)
+{
+    bool Written = true;
+    if(Recorder->File)
+    {
+        WriteRecord(Recorder, Cycle, Chip8Input_End);
+        WriteInteger(Recorder->File, Hash, 8);
+
+        /* NOTE(koekeishiya): The stream error flag is sticky, so checking it once here
+         * covers every record written since the file was opened. */
+        Written = !ferror(Recorder->File);
+        Written = (fclose(Recorder->File) == 0) && Written;
+        Recorder->File = NULL;
+    }
+    return Written;
+}
+
+bool Chip8InputLoad(chip8_input_log *Log, const char *Path)
+{
+    memset(Log, 0, sizeof(chip8_input_log));
+
+    FILE *File = fopen(Path, "rb");
+    if(!File)
+        return false;
+
+    char Magic[4];
+    unsigned long long Version, Value;
+    if(fread(Magic, 1, 4, File) != 4 || memcmp(Magic, CHIP8_INPUT_MAGIC, 4) != 0 ||
+       !ReadInteger(File, &Version, 2) || Version < 1 || Version > CHIP8_INPUT_VERSION)
+    {
+        fclose(File);
+        return false;
+    }
+
+    bool Valid = ReadInteger(File, &Value, 2);
+    Log->Header.InstructionsPerFrame = (unsigned int) Value;
+    Valid = Valid && ReadInteger(File, &Log->Header.Seed, 8);
+    Valid = Valid && ReadInteger(File, &Log->Header.RomHash, 8);
+
+    Value = Chip8Quirks_Default;
+    if(Version >= 2)
+        Valid = Valid && ReadInteger(File, &Value, 1) && Value < Chip8Quirks_Count;
+    Log->Header.Quirks = (chip8_quirks) Value;
+
+    unsigned int Capacity = 0;
+    unsigned long long Cycle = 0;
+    unsigned long long Delta;
+
+    while(Valid && ReadVarint(File, &Delta))
+    {
+        int Tag = fgetc(File);
+        if(Tag == EOF)
+            break;
+
+        chip8_input_event Event;
+        Cycle += Delta;
+        Event.Cycle = Cycle;
+        Event.Tag = (unsigned char) Tag;
+        Event.Hash = 0;
+
+        if(Tag == Chip8Input_Checkpoint || Tag == Chip8Input_End)
+        {
+            if(!ReadInteger(File, &Event.Hash, 8))
+                break;
+        }
+        else if(Tag > (Chip8Input_Press | 0xF))
+        {
+            Valid = false;
+            break;
+        }
+
+        if(Log->Count == Capacity)
+        {
+            Capacity = Capacity ? 2 * Capacity : 256;
+            chip8_input_event *Events = (chip8_input_event *) realloc(Log->Events, Capacity * sizeof(chip8_input_event));
+            if(!Events)
+            {
+                Valid = false;
+                break;
+            }
+            Log->Events = Events;
+        }
+
+        Log->Events[Log->Count++] = Event;
+        if(Tag == Chip8Input_End)
+            break;
+    }
+
+    fclose(File);
+    if(!Valid || Log->Header.InstructionsPerFrame < 1)
+    {
+        Chip8InputFree(Log);
+        return false;
+    }
+
+    return true;
+}
+
+void Chip8InputFree(chip8_input_log *Log)
+{
+    free(Log->Events);
+    memset(Log, 0, sizeof(chip8_input_log));
+}
+
+/* NOTE(koekeishiya): Execute Cycles instructions during which neither keys nor timers
+ * change, which is exactly when an idle loop can be fast-forwarded. */
+internal unsigned long long
+ReplayRun(chip8_engine *Engine, chip8 *Processor, unsigned long long Cycles, bool SkipIdle)
+{
+    unsigned long long Run = Cycles;
+    if(SkipIdle && Cycles > 1)
+    {
+        unsigned int MaxPeriod = Cycles / 2 < CHIP8_IDLE_MAX_PERIOD ? Cycles / 2 : CHIP8_IDLE_MAX_PERIOD;
+        chip8_idle Idle = Chip8DetectIdle(Processor, MaxPeriod);
+        if(Idle.Type != Chip8Idle_None)
+            Run = Chip8IdleCycles(&Idle, Cycles);
+    }
+
+    Chip8EngineRun(Engine, Processor, Run);
+    return Cycles - Run;
+}
+
+chip8_replay_result Chip8InputReplay(chip8_input_log *Log, chip8_engine *Engine, chip8 *Processor, bool SkipIdle)
+{
+    chip8_replay_result Result = {};
+    unsigned long long FrameCycles = Log->Header.InstructionsPerFrame;
+    unsigned long long Cycle = 0;
+
+    for(unsigned int Index = 0; Index < Log->Count; ++Index)
+    {
+        chip8_input_event *Event = Log->Events + Index;
+
+        /* NOTE(koekeishiya): Run up to the event, stopping at every frame boundary on the
+         * way to tick the timers. */
+        while(Cycle < Event->Cycle)
+        {
+            unsigned long long FrameEnd = (Cycle / FrameCycles + 1) * FrameCycles;
+            unsigned long long Until = FrameEnd < Event->Cycle ? FrameEnd : Event->Cycle;
+
+            Result.IdleCycles += ReplayRun(Engine, Processor, Until - Cycle, SkipIdle);
+            Cycle = Until;
+
+            if(Cycle == FrameEnd)
+                Chip8TickTimers(Processor);
+        }
+
+        if(Event->Tag == Chip8Input_Checkpoint || Event->Tag == Chip8Input_End)
+        {
+            if(Chip8GraphicsHash(Processor) != Event->Hash)
+            {
+                if(!Result.Mismatches)
+                    Result.FirstMismatch = Cycle;
+                ++Result.Mismatches;
+            }
+            ++Result.Checkpoints;
+        }
+        else
+        {
+            Processor->Key[Event->Tag & 0xF] = (Event->Tag & Chip8Input_Press) ? 1 : 0;
+            ++Result.Keys;
+        }
+    }
+
+    Result.Cycles = Cycle;
+    return Result;
+}
@@ -0,0 +1,96 @@
+#ifndef CHIP_8_INPUT
+#define CHIP_8_INPUT
+
+#include <stdio.h>
+#include "chip8.h"
+#include "chip8_engine.h"
+
+#define CHIP8_INPUT_MAGIC "CH8I"
+#define CHIP8_INPUT_VERSION 2
+
+/* NOTE(koekeishiya): An input log starts with a fixed header:
+ *
+ *     "CH8I"  u16 version  u16 instructions per frame  u64 seed  u64 rom hash  u8 quirks
+ *
+ * followed by records, each being the number of cycles since the previous record as an
+ * unsigned LEB128 varint and a tag byte. Tags 0x00-0x0F release key 0-F, 0x10-0x1F press
+ * it, and Checkpoint and End are followed by a u64 framebuffer hash. All integers are
+ * little-endian. Cycles count every instruction the machine was asked to execute since
+ * the rom was loaded, whether or not it was fast-forwarded. The quirks byte, the
+ * chip8_quirks profile of the session, was added in version 2; version 1 logs are still
+ * read and use the default profile. */
+enum chip8_input_tag
+{
+    Chip8Input_Release    = 0x00,
+    Chip8Input_Press      = 0x10,
+    Chip8Input_Checkpoint = 0x20,
+    Chip8Input_End        = 0x21,
+};
+
+struct chip8_input_header
+{
+    unsigned int InstructionsPerFrame;
+    unsigned long long Seed;
+    unsigned long long RomHash;
+    chip8_quirks Quirks;
+};
+
+struct chip8_input_event
+{
+    unsigned long long Cycle;
+    unsigned char Tag;
+    unsigned long long Hash;
+};
+
+struct chip8_input_recorder
+{
+    FILE *File;
+    unsigned long long Cycle;
+    unsigned long long Events;
+};
+
+/* NOTE(koekeishiya): Identifies the rom a log was recorded with, hashed over everything a
+ * rom can occupy after it has been loaded. */
+unsigned long long Chip8RomHash(chip8 *Processor);
+
+/* NOTE(koekeishiya): Fails when the file cannot be written, or when the instructions per
+ * frame do not fit the 16 bits the header stores them in. */
+bool Chip8RecorderOpen(chip8_input_recorder *Recorder, const char *Path, chip8_input_header *Header);
+void Chip8RecordKey(chip8_input_recorder *Recorder, unsigned long long Cycle, int Key, bool Pressed);
+void Chip8RecordCheckpoint(chip8_input_recorder *Recorder, unsigned long long Cycle, unsigned long long Hash);
+
+/* NOTE(koekeishiya): Write the End record and close the file. Returns false if any write
+ * since Chip8RecorderOpen failed, in which case the log is incomplete. */
+bool Chip8RecorderClose(chip8_input_recorder *Recorder, unsigned long long Cycle, unsigned long long Hash);
+
+struct chip8_input_log
+{
+    chip8_input_header Header;
+    chip8_input_event *Events;
+    unsigned int Count;
+};
+
+/* NOTE(koekeishiya): Read a whole log into memory. A log without an End record, e.g. from
+ * a session that crashed, is accepted and ends at its last record. */
+bool Chip8InputLoad(chip8_input_log *Log, const char *Path);
+void Chip8InputFree(chip8_input_log *Log);
+
+struct chip8_replay_result
+{
+    unsigned long long Cycles;
+    unsigned long long Keys;
+    unsigned long long Checkpoints;
+    unsigned long long Mismatches;
+    unsigned long long IdleCycles;
+
+    /* NOTE(koekeishiya): Cycle of the first checkpoint whose hash did not match. */
+    unsigned long long FirstMismatch;
+};
+
+/* NOTE(koekeishiya): Run a freshly loaded processor through the log as fast as possible,
+ * applying every key at its cycle, ticking the timers once per frame and comparing the
+ * framebuffer hash at every checkpoint. Idle loops are fast-forwarded when SkipIdle is set,
+ * which does not change the outcome. */
+chip8_replay_result Chip8InputReplay(chip8_input_log *Log, chip8_engine *Engine, chip8 *Processor, bool SkipIdle);
+
+#endif
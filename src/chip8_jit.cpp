@@ -0,0 +1,1185 @@
+#include "chip8_jit.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <sys/mman.h>
+#define CHIP8_JIT_SUPPORTED 1
+#endif
+
+#define internal static
+
+#ifdef CHIP8_JIT_SUPPORTED
+
+#define JIT_CODE_SIZE (1024 * 1024)
+#define JIT_BLOCK_RESERVE 4096
+#define JIT_MAX_INSTRUCTION_SIZE 1024
+#define JIT_MAX_BLOCKS 4096
+#define JIT_MAX_LINKS 8192
+#define JIT_MAX_BLOCK_LENGTH 64
+#define JIT_SLOTS (0x1000 / 2)
+
+#define JIT_NO_BLOCK -1
+#define JIT_UNTRANSLATABLE -2
+
+enum host_register
+{
+    RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+    R8 = 8, R9 = 9, R10 = 10, R11 = 11, R12 = 12, R13 = 13, R14 = 14, R15 = 15
+};
+
+/* NOTE(koekeishiya): Register convention inside translated code:
+ *   rdi  points at the chip8 struct
+ *   rbp  remaining cycle budget
+ *   rax, rcx  scratch
+ *   everything else caches V registers for the duration of a block. */
+static const int HostPool[] = { RDX, RBX, RSI, R8, R9, R10, R11, R12, R13, R14, R15 };
+#define HOST_POOL_SIZE (int)(sizeof(HostPool) / sizeof(HostPool[0]))
+
+enum alu_op
+{
+    Alu_Add = 0x01,
+    Alu_Or  = 0x09,
+    Alu_And = 0x21,
+    Alu_Sub = 0x29,
+    Alu_Xor = 0x31,
+    Alu_Cmp = 0x39,
+};
+
+typedef unsigned int chip8_jit_enter(chip8 *Processor, long long *Budget, unsigned char *Code);
+
+struct chip8_jit_block
+{
+    unsigned char *Code;
+    unsigned short Start;
+    unsigned short End;
+    unsigned short Length;
+    bool Valid;
+};
+
+/* NOTE(koekeishiya): Every static exit of a block starts with a 'jmp rel32' that initially
+ * jumps to the very next instruction, which returns to the dispatcher. Once the target
+ * block exists the jump is patched to go there directly. */
+struct chip8_jit_link
+{
+    unsigned char *Site;
+    unsigned short Target;
+    short Owner;
+    bool Linked;
+};
+
+struct chip8_jit
+{
+    unsigned char *Code;
+    unsigned int CodeUsed;
+    unsigned int CodeStart;
+
+    chip8_jit_enter *Enter;
+    unsigned char *Exit;
+
+    short BlockAt[JIT_SLOTS];
+    unsigned char Covered[JIT_SLOTS];
+    chip8_jit_block Blocks[JIT_MAX_BLOCKS];
+    int BlockCount;
+
+    chip8_jit_link Links[JIT_MAX_LINKS];
+    int LinkCount;
+
+    /* NOTE(koekeishiya): Code of the block starting at each slot, or Exit. 00EE jumps
+     * through it, since its target is only known at runtime. */
+    unsigned char *Entries[JIT_SLOTS];
+
+    /* NOTE(koekeishiya): Every translated or untranslatable slot lies in Memory[CodeLow]
+     * to Memory[CodeHigh]. Translated FX33 and FX55 compare the written range against it,
+     * and on overlap return to the dispatcher with the range in WrittenLow to WrittenHigh,
+     * which is then invalidated. WrittenLow > WrittenHigh when nothing is pending. Code
+     * reads these fields through a fixed address, so their order matters. */
+    unsigned short CodeLow;
+    unsigned short CodeHigh;
+    unsigned short WrittenLow;
+    unsigned short WrittenHigh;
+
+    bool Lockstep;
+
+    /* NOTE(koekeishiya): Profile the translated code was generated for, the quirks are
+     * decided while emitting and cost nothing at runtime. */
+    unsigned char Quirks;
+
+    chip8_jit_stats Stats;
+};
+
+struct jit_emitter
+{
+    unsigned char *At;
+
+    /* NOTE(koekeishiya): Register cache for the block being translated. */
+    int HostOf[16];
+    int PoolUsed;
+    unsigned short Dirty;
+
+    unsigned short LinkTargets[2];
+    unsigned char *LinkSites[2];
+    int LinkCount;
+};
+
+#define OFFSET_V(Index) (int)(offsetof(chip8, V) + (Index))
+#define OFFSET_I (int)offsetof(chip8, I)
+#define OFFSET_OPCODE (int)offsetof(chip8, Opcode)
+#define OFFSET_DELAY (int)offsetof(chip8, DelayTimer)
+#define OFFSET_SOUND (int)offsetof(chip8, SoundTimer)
+#define OFFSET_MEMORY (int)offsetof(chip8, Memory)
+#define OFFSET_STACK (int)offsetof(chip8, Stack)
+#define OFFSET_SP (int)offsetof(chip8, Sp)
+
+internal inline void Emit8(jit_emitter *E, unsigned char Value) { *E->At++ = Value; }
+internal inline void Emit16(jit_emitter *E, unsigned short Value) { memcpy(E->At, &Value, 2); E->At += 2; }
+internal inline void Emit32(jit_emitter *E, unsigned int Value) { memcpy(E->At, &Value, 4); E->At += 4; }
+
+internal inline unsigned char
+ModRM(int Mod, int Reg, int Rm)
+{
+    return (unsigned char)((Mod << 6) | ((Reg & 7) << 3) | (Rm & 7));
+}
+
+internal inline void
+EmitRex(jit_emitter *E, bool W, int Reg, int Rm, bool Force)
+{
+    unsigned char Rex = 0x40 | (W ? 8 : 0) | ((Reg & 8) ? 4 : 0) | ((Rm & 8) ? 1 : 0);
+    if(Rex != 0x40 || Force)
+        Emit8(E, Rex);
+}
+
+internal void
+EmitMovRegImm(jit_emitter *E, int Dst, unsigned int Value)
+{
+    EmitRex(E, false, 0, Dst, false);
+    Emit8(E, 0xB8 + (Dst & 7));
+    Emit32(E, Value);
+}
+
+internal void
+EmitMovRegImm64(jit_emitter *E, int Dst, void *Value)
+{
+    unsigned long long Address = (unsigned long long) Value;
+    EmitRex(E, true, 0, Dst, false);
+    Emit8(E, 0xB8 + (Dst & 7));
+    memcpy(E->At, &Address, 8);
+    E->At += 8;
+}
+
+internal void
+EmitMovRegReg(jit_emitter *E, int Dst, int Src)
+{
+    EmitRex(E, false, Src, Dst, false);
+    Emit8(E, 0x89);
+    Emit8(E, ModRM(3, Src, Dst));
+}
+
+internal void
+EmitAluRegReg(jit_emitter *E, alu_op Op, int Dst, int Src)
+{
+    EmitRex(E, false, Src, Dst, false);
+    Emit8(E, Op);
+    Emit8(E, ModRM(3, Src, Dst));
+}
+
+internal void
+EmitAluRegImm(jit_emitter *E, alu_op Op, int Dst, unsigned int Value)
+{
+    /* NOTE(koekeishiya): 81 /digit, where the digit is the middle bits of the reg-reg form. */
+    EmitRex(E, false, 0, Dst, false);
+    Emit8(E, 0x81);
+    Emit8(E, ModRM(3, Op >> 3, Dst));
+    Emit32(E, Value);
+}
+
+internal void
+EmitNegReg(jit_emitter *E, int Dst)
+{
+    EmitRex(E, false, 0, Dst, false);
+    Emit8(E, 0xF7);
+    Emit8(E, ModRM(3, 3, Dst));
+}
+
+internal void
+EmitShiftRegImm(jit_emitter *E, bool Left, int Dst, unsigned char Count)
+{
+    EmitRex(E, false, 0, Dst, false);
+    Emit8(E, 0xC1);
+    Emit8(E, ModRM(3, Left ? 4 : 5, Dst));
+    Emit8(E, Count);
+}
+
+internal void
+EmitZeroExtendByte(jit_emitter *E, int Dst, int Src)
+{
+    /* NOTE(koekeishiya): Always emit REX so that 6 and 7 mean sil/dil and not dh/bh. */
+    EmitRex(E, false, Dst, Src, true);
+    Emit8(E, 0x0F);
+    Emit8(E, 0xB6);
+    Emit8(E, ModRM(3, Dst, Src));
+}
+
+internal void
+EmitLoadByte(jit_emitter *E, int Dst, int Offset)
+{
+    EmitRex(E, false, Dst, RDI, false);
+    Emit8(E, 0x0F);
+    Emit8(E, 0xB6);
+    Emit8(E, ModRM(2, Dst, RDI));
+    Emit32(E, Offset);
+}
+
+internal void
+EmitStoreByte(jit_emitter *E, int Src, int Offset)
+{
+    EmitRex(E, false, Src, RDI, true);
+    Emit8(E, 0x88);
+    Emit8(E, ModRM(2, Src, RDI));
+    Emit32(E, Offset);
+}
+
+internal void
+EmitLoadWord(jit_emitter *E, int Dst, int Offset)
+{
+    EmitRex(E, false, Dst, RDI, false);
+    Emit8(E, 0x0F);
+    Emit8(E, 0xB7);
+    Emit8(E, ModRM(2, Dst, RDI));
+    Emit32(E, Offset);
+}
+
+internal void
+EmitStoreWord(jit_emitter *E, int Src, int Offset)
+{
+    Emit8(E, 0x66);
+    EmitRex(E, false, Src, RDI, false);
+    Emit8(E, 0x89);
+    Emit8(E, ModRM(2, Src, RDI));
+    Emit32(E, Offset);
+}
+
+internal void
+EmitStoreWordImm(jit_emitter *E, int Offset, unsigned short Value)
+{
+    Emit8(E, 0x66);
+    Emit8(E, 0xC7);
+    Emit8(E, ModRM(2, 0, RDI));
+    Emit32(E, Offset);
+    Emit16(E, Value);
+}
+
+/* NOTE(koekeishiya): [rdi + Index * (1 << Scale) + Offset]. Index has to be one of the
+ * first eight registers, since no REX.X is emitted. */
+internal void
+EmitIndexedOperand(jit_emitter *E, int Reg, int Index, int Scale, int Offset)
+{
+    Emit8(E, ModRM(2, Reg, RSP));
+    Emit8(E, (unsigned char)((Scale << 6) | ((Index & 7) << 3) | RDI));
+    Emit32(E, Offset);
+}
+
+internal void
+EmitLoadByteIndexed(jit_emitter *E, int Dst, int Index, int Offset)
+{
+    EmitRex(E, false, Dst, RDI, false);
+    Emit8(E, 0x0F);
+    Emit8(E, 0xB6);
+    EmitIndexedOperand(E, Dst, Index, 0, Offset);
+}
+
+internal void
+EmitStoreByteIndexed(jit_emitter *E, int Src, int Index, int Offset)
+{
+    EmitRex(E, false, Src, RDI, true);
+    Emit8(E, 0x88);
+    EmitIndexedOperand(E, Src, Index, 0, Offset);
+}
+
+internal void
+EmitLoadWordIndexed(jit_emitter *E, int Dst, int Index, int Offset)
+{
+    EmitRex(E, false, Dst, RDI, false);
+    Emit8(E, 0x0F);
+    Emit8(E, 0xB7);
+    EmitIndexedOperand(E, Dst, Index, 1, Offset);
+}
+
+internal void
+EmitStoreWordImmIndexed(jit_emitter *E, int Index, int Offset, unsigned short Value)
+{
+    Emit8(E, 0x66);
+    Emit8(E, 0xC7);
+    EmitIndexedOperand(E, 0, Index, 1, Offset);
+    Emit16(E, Value);
+}
+
+internal void
+EmitImulRegRegImm(jit_emitter *E, int Dst, int Src, unsigned int Value)
+{
+    EmitRex(E, false, Dst, Src, false);
+    if(Value < 0x80)
+    {
+        Emit8(E, 0x6B);
+        Emit8(E, ModRM(3, Dst, Src));
+        Emit8(E, (unsigned char) Value);
+    }
+    else
+    {
+        Emit8(E, 0x69);
+        Emit8(E, ModRM(3, Dst, Src));
+        Emit32(E, Value);
+    }
+}
+
+internal unsigned char *
+EmitJump(jit_emitter *E, unsigned char Op)
+{
+    /* NOTE(koekeishiya): Op is either 0xE9 (jmp) or the second byte of a 0F 8x jcc.
+     * Returns the location of the rel32 so it can be patched. */
+    if(Op != 0xE9)
+        Emit8(E, 0x0F);
+
+    Emit8(E, Op);
+    unsigned char *Site = E->At;
+    Emit32(E, 0);
+    return Site;
+}
+
+internal inline void
+PatchJump(unsigned char *Site, unsigned char *Target)
+{
+    int Relative = (int)(Target - (Site + 4));
+    memcpy(Site, &Relative, 4);
+}
+
+/* NOTE(koekeishiya): Host register holding V[Index], allocating one if necessary. */
+internal int
+JitRegister(jit_emitter *E, int Index, bool Load)
+{
+    if(E->HostOf[Index] < 0)
+    {
+        E->HostOf[Index] = HostPool[E->PoolUsed++];
+        if(Load)
+            EmitLoadByte(E, E->HostOf[Index], OFFSET_V(Index));
+    }
+
+    return E->HostOf[Index];
+}
+
+internal void
+JitWriteBack(jit_emitter *E)
+{
+    for(int Index = 0; Index < 16; ++Index)
+    {
+        if(E->Dirty & (1 << Index))
+            EmitStoreByte(E, E->HostOf[Index], OFFSET_V(Index));
+    }
+}
+
+internal void
+JitEmitExit(chip8_jit *Jit, jit_emitter *E, unsigned short Target)
+{
+    E->LinkSites[E->LinkCount] = EmitJump(E, 0xE9);
+    E->LinkTargets[E->LinkCount] = Target;
+    ++E->LinkCount;
+
+    EmitMovRegImm(E, RAX, Target);
+    PatchJump(EmitJump(E, 0xE9), Jit->Exit);
+}
+
+/* NOTE(koekeishiya): Exit to wherever the pc in eax points, straight into its block when
+ * there is one. */
+internal void
+JitEmitIndirectExit(chip8_jit *Jit, jit_emitter *E)
+{
+    Emit8(E, 0xA9); Emit32(E, 0xF001);
+    PatchJump(EmitJump(E, 0x85), Jit->Exit);
+
+    EmitMovRegImm64(E, RCX, Jit->Entries);
+    Emit8(E, 0xFF); Emit8(E, ModRM(0, 4, RSP)); Emit8(E, (unsigned char)((2 << 6) | (RAX << 3) | RCX));
+}
+
+/* NOTE(koekeishiya): Ends a block after FX33 or FX55 stored Count + 1 bytes starting at the
+ * address in eax. Writes that stay clear of translated code chain on to Target, the others
+ * return to the dispatcher to have the range invalidated first. A write that wraps around
+ * the end of Memory always does. */
+internal void
+JitEmitWriteExit(chip8_jit *Jit, jit_emitter *E, unsigned int Count, unsigned short Target)
+{
+    EmitMovRegImm64(E, RCX, &Jit->CodeLow);
+    EmitAluRegImm(E, Alu_Add, RAX, Count);
+    EmitAluRegImm(E, Alu_Cmp, RAX, 0xFFF);
+    unsigned char *WrapSite = EmitJump(E, 0x87);
+
+    /* NOTE(koekeishiya): cmp ax, [rcx] and cmp ax, [rcx + 2]. */
+    Emit8(E, 0x66); Emit8(E, 0x3B); Emit8(E, ModRM(0, RAX, RCX));
+    unsigned char *BelowSite = EmitJump(E, 0x82);
+    EmitAluRegImm(E, Alu_Sub, RAX, Count);
+    Emit8(E, 0x66); Emit8(E, 0x3B); Emit8(E, ModRM(1, RAX, RCX)); Emit8(E, 2);
+    unsigned char *AboveSite = EmitJump(E, 0x87);
+    EmitAluRegImm(E, Alu_Add, RAX, Count);
+
+    /* NOTE(koekeishiya): mov [rcx + 6], ax and mov [rcx + 4], ax. */
+    PatchJump(WrapSite, E->At);
+    Emit8(E, 0x66); Emit8(E, 0x89); Emit8(E, ModRM(1, RAX, RCX)); Emit8(E, 6);
+    EmitAluRegImm(E, Alu_Sub, RAX, Count);
+    Emit8(E, 0x66); Emit8(E, 0x89); Emit8(E, ModRM(1, RAX, RCX)); Emit8(E, 4);
+    EmitMovRegImm(E, RAX, Target);
+    PatchJump(EmitJump(E, 0xE9), Jit->Exit);
+
+    PatchJump(BelowSite, E->At);
+    PatchJump(AboveSite, E->At);
+    JitEmitExit(Jit, E, Target);
+}
+
+/* NOTE(koekeishiya): I += X or X + 1 after FX55 and FX65, depending on the profile. */
+internal void
+JitEmitIndexAdvance(jit_emitter *E, const chip8_quirk_set *Quirk, int X)
+{
+    if(Quirk->IndexAdvance != Chip8Index_Unchanged)
+    {
+        EmitLoadWord(E, RCX, OFFSET_I);
+        EmitAluRegImm(E, Alu_Add, RCX, X + (Quirk->IndexAdvance == Chip8Index_PlusXPlusOne));
+        EmitStoreWord(E, RCX, OFFSET_I);
+    }
+}
+
+/* NOTE(koekeishiya): Which V registers an instruction touches, or -1 if the instruction is
+ * not translated. VF-producing instructions that also read or write VF through X or Y are
+ * left to the interpreter, whose exact ordering of flag updates is awkward to mirror. */
+internal int
+JitRegistersUsed(unsigned short Opcode, const chip8_quirk_set *Quirk)
+{
+    int X = (Opcode & 0x0F00) >> 8;
+    int Y = (Opcode & 0x00F0) >> 4;
+
+    switch(Opcode & 0xF000)
+    {
+        case 0x0000: return Opcode == 0x00EE ? 0 : -1;
+        case 0x1000: case 0x2000: return 0;
+        case 0x3000: case 0x4000: case 0x6000: case 0x7000: return 1 << X;
+        case 0x5000: case 0x9000: return (1 << X) | (1 << Y);
+        case 0xA000: return 0;
+        case 0x8000:
+        {
+            switch(Opcode & 0x000F)
+            {
+                case 0x0000:
+                    return (1 << X) | (1 << Y);
+                case 0x0001: case 0x0002: case 0x0003:
+                    return (1 << X) | (1 << Y) | (Quirk->LogicResetsVF ? 1 << 0xF : 0);
+                case 0x0004: case 0x0005: case 0x0007:
+                    return (X == 0xF || Y == 0xF) ? -1 : (1 << X) | (1 << Y) | (1 << 0xF);
+                case 0x0006: case 0x000E:
+                    return X == 0xF ? -1 : (1 << X) | (1 << 0xF) | (Quirk->ShiftReadsVY ? 1 << Y : 0);
+            }
+        } break;
+        case 0xF000:
+        {
+            switch(Opcode & 0x00FF)
+            {
+                case 0x0007: case 0x0015: case 0x0018: case 0x001E: case 0x0029: case 0x0033:
+                    return 1 << X;
+                case 0x0055: case 0x0065:
+                    return 0;
+            }
+        } break;
+    }
+
+    return -1;
+}
+
+internal void
+JitLink(chip8_jit *Jit, chip8_jit_link *Link)
+{
+    int Index = Jit->BlockAt[Link->Target >> 1];
+    if(!(Link->Target & 0xF001) && Index >= 0)
+    {
+        PatchJump(Link->Site, Jit->Blocks[Index].Code);
+        Link->Linked = true;
+    }
+}
+
+internal void
+JitFlush(chip8_jit *Jit)
+{
+    Jit->CodeUsed = Jit->CodeStart;
+    Jit->BlockCount = 0;
+    Jit->LinkCount = 0;
+    for(int Index = 0; Index < JIT_SLOTS; ++Index)
+        Jit->BlockAt[Index] = JIT_NO_BLOCK;
+
+    memset(Jit->Covered, 0, sizeof(Jit->Covered));
+    for(int Index = 0; Index < JIT_SLOTS; ++Index)
+        Jit->Entries[Index] = Jit->Exit;
+
+    Jit->CodeLow = 0xFFFF;
+    Jit->CodeHigh = 0;
+    Jit->WrittenLow = 1;
+    Jit->WrittenHigh = 0;
+
+    ++Jit->Stats.Flushes;
+}
+
+internal chip8_jit_block *
+JitCompile(chip8_jit *Jit, chip8 *Processor, unsigned short Pc)
+{
+    if(Jit->BlockCount >= JIT_MAX_BLOCKS ||
+       Jit->LinkCount + 2 > JIT_MAX_LINKS ||
+       Jit->CodeUsed + JIT_BLOCK_RESERVE > JIT_CODE_SIZE)
+    {
+        JitFlush(Jit);
+    }
+
+    jit_emitter Emitter = {};
+    jit_emitter *E = &Emitter;
+    for(int Index = 0; Index < 16; ++Index)
+        E->HostOf[Index] = -1;
+
+    unsigned char *Code = Jit->Code + Jit->CodeUsed;
+    E->At = Code;
+
+    /* NOTE(koekeishiya): Entry: bail out to the dispatcher if the budget cannot cover the
+     * whole block, so that a run always stops after exactly the requested cycle count.
+     * The entry is at least 10 bytes, which is what invalidation overwrites. */
+    Emit8(E, 0x48); Emit8(E, 0x81); Emit8(E, ModRM(3, 7, RBP));
+    unsigned char *CompareLength = E->At; Emit32(E, 0);
+    unsigned char *BailSite = EmitJump(E, 0x8C);
+    Emit8(E, 0x48); Emit8(E, 0x81); Emit8(E, ModRM(3, 5, RBP));
+    unsigned char *SubtractLength = E->At; Emit32(E, 0);
+
+    const chip8_quirk_set *Quirk = Chip8QuirkSets + Jit->Quirks;
+    unsigned short Address = Pc;
+    unsigned short Length = 0;
+    unsigned short LastOpcode = 0;
+    bool Terminated = false;
+
+    while(Length < JIT_MAX_BLOCK_LENGTH && Address < 0x1000 &&
+          E->At - Code <= JIT_BLOCK_RESERVE - JIT_MAX_INSTRUCTION_SIZE)
+    {
+        unsigned short Opcode = Processor->Memory[Address] << 8 | Processor->Memory[Address + 1];
+        int Used = JitRegistersUsed(Opcode, Quirk);
+        if(Used < 0)
+            break;
+
+        int Needed = 0;
+        for(int Index = 0; Index < 16; ++Index)
+        {
+            if((Used & (1 << Index)) && E->HostOf[Index] < 0)
+                ++Needed;
+        }
+
+        if(E->PoolUsed + Needed > HOST_POOL_SIZE)
+            break;
+
+        int X = (Opcode & 0x0F00) >> 8;
+        int Y = (Opcode & 0x00F0) >> 4;
+        unsigned char NN = Opcode & 0x00FF;
+
+        ++Length;
+        LastOpcode = Opcode;
+        Address += 2;
+
+        switch(Opcode & 0xF000)
+        {
+            case 0x0000:
+            {
+                /* NOTE(koekeishiya): 00EE. Sp is 16 bits and indexes Stack masked to its
+                 * 16 entries, like in the interpreter. */
+                JitWriteBack(E);
+                EmitStoreWordImm(E, OFFSET_OPCODE, Opcode);
+                EmitLoadWord(E, RAX, OFFSET_SP);
+                EmitAluRegImm(E, Alu_Sub, RAX, 1);
+                EmitStoreWord(E, RAX, OFFSET_SP);
+                EmitAluRegImm(E, Alu_And, RAX, 0xF);
+                EmitLoadWordIndexed(E, RAX, RAX, OFFSET_STACK);
+                JitEmitIndirectExit(Jit, E);
+                Terminated = true;
+            } break;
+            case 0x1000:
+            {
+                JitWriteBack(E);
+                EmitStoreWordImm(E, OFFSET_OPCODE, Opcode);
+                JitEmitExit(Jit, E, Opcode & 0x0FFF);
+                Terminated = true;
+            } break;
+            case 0x2000:
+            {
+                JitWriteBack(E);
+                EmitStoreWordImm(E, OFFSET_OPCODE, Opcode);
+                /* NOTE(koekeishiya): The push wraps around Stack, like the interpreter
+                 * does, so a runaway rom never writes past its 16 entries. */
+                EmitLoadWord(E, RAX, OFFSET_SP);
+                EmitMovRegReg(E, RCX, RAX);
+                EmitAluRegImm(E, Alu_Add, RCX, 1);
+                EmitStoreWord(E, RCX, OFFSET_SP);
+                EmitAluRegImm(E, Alu_And, RAX, 0xF);
+                EmitStoreWordImmIndexed(E, RAX, OFFSET_STACK, Address);
+                JitEmitExit(Jit, E, Opcode & 0x0FFF);
+                Terminated = true;
+            } break;
+            case 0x3000:
+            case 0x4000:
+            case 0x5000:
+            case 0x9000:
+            {
+                int RegX = JitRegister(E, X, true);
+                JitWriteBack(E);
+                EmitStoreWordImm(E, OFFSET_OPCODE, Opcode);
+
+                if((Opcode & 0xF000) == 0x3000 || (Opcode & 0xF000) == 0x4000)
+                    EmitAluRegImm(E, Alu_Cmp, RegX, NN);
+                else
+                    EmitAluRegReg(E, Alu_Cmp, RegX, JitRegister(E, Y, true));
+
+                /* NOTE(koekeishiya): 3XNN and 5XY0 skip on equal, 4XNN and 9XY0 on not equal. */
+                bool SkipOnEqual = (Opcode & 0xF000) == 0x3000 || (Opcode & 0xF000) == 0x5000;
+                unsigned char *SkipSite = EmitJump(E, SkipOnEqual ? 0x84 : 0x85);
+                JitEmitExit(Jit, E, Address);
+                PatchJump(SkipSite, E->At);
+                JitEmitExit(Jit, E, Address + 2);
+                Terminated = true;
+            } break;
+            case 0x6000:
+            {
+                EmitMovRegImm(E, JitRegister(E, X, false), NN);
+                E->Dirty |= 1 << X;
+            } break;
+            case 0x7000:
+            {
+                int RegX = JitRegister(E, X, true);
+                EmitAluRegImm(E, Alu_Add, RegX, NN);
+                EmitZeroExtendByte(E, RegX, RegX);
+                E->Dirty |= 1 << X;
+            } break;
+            case 0x8000:
+            {
+                bool Shift = (Opcode & 0x000F) == 0x0006 || (Opcode & 0x000F) == 0x000E;
+                bool Logic = (Opcode & 0x000F) >= 0x0001 && (Opcode & 0x000F) <= 0x0003;
+                int RegY = (Shift && !Quirk->ShiftReadsVY) ? -1 : JitRegister(E, Y, true);
+                int RegX = JitRegister(E, X, (Opcode & 0x000F) != 0);
+                int RegF = -1;
+                if((Opcode & 0x000F) >= 0x0004 || (Logic && Quirk->LogicResetsVF))
+                    RegF = JitRegister(E, 0xF, false);
+
+                /* NOTE(koekeishiya): Shifts go through rax, which also covers VY = VF. */
+                int Source = (Shift && Quirk->ShiftReadsVY) ? RegY : RegX;
+
+                switch(Opcode & 0x000F)
+                {
+                    case 0x0000: EmitMovRegReg(E, RegX, RegY); break;
+                    case 0x0001: EmitAluRegReg(E, Alu_Or, RegX, RegY); break;
+                    case 0x0002: EmitAluRegReg(E, Alu_And, RegX, RegY); break;
+                    case 0x0003: EmitAluRegReg(E, Alu_Xor, RegX, RegY); break;
+                    case 0x0004:
+                    {
+                        EmitAluRegReg(E, Alu_Add, RegX, RegY);
+                        EmitMovRegReg(E, RegF, RegX);
+                        EmitShiftRegImm(E, false, RegF, 8);
+                        EmitZeroExtendByte(E, RegX, RegX);
+                    } break;
+                    case 0x0005:
+                    case 0x0007:
+                    {
+                        /* NOTE(koekeishiya): The 32-bit difference of two bytes is negative
+                         * exactly when there is a borrow, so VF is the inverted sign bit. */
+                        bool Reverse = (Opcode & 0x000F) == 0x0007;
+                        EmitMovRegReg(E, RAX, Reverse ? RegY : RegX);
+                        EmitAluRegReg(E, Alu_Sub, RAX, Reverse ? RegX : RegY);
+                        EmitMovRegReg(E, RegF, RAX);
+                        EmitShiftRegImm(E, false, RegF, 31);
+                        EmitAluRegImm(E, Alu_Xor, RegF, 1);
+                        EmitZeroExtendByte(E, RegX, RAX);
+                    } break;
+                    case 0x0006:
+                    {
+                        EmitMovRegReg(E, RAX, Source);
+                        EmitMovRegReg(E, RegX, RAX);
+                        EmitShiftRegImm(E, false, RegX, 1);
+                        EmitAluRegImm(E, Alu_And, RAX, 0x1);
+                        EmitMovRegReg(E, RegF, RAX);
+                    } break;
+                    case 0x000E:
+                    {
+                        EmitMovRegReg(E, RAX, Source);
+                        EmitMovRegReg(E, RegX, RAX);
+                        EmitShiftRegImm(E, true, RegX, 1);
+                        EmitZeroExtendByte(E, RegX, RegX);
+                        EmitShiftRegImm(E, false, RAX, 7);
+                        EmitMovRegReg(E, RegF, RAX);
+                    } break;
+                }
+
+                if(Logic && Quirk->LogicResetsVF)
+                    EmitMovRegImm(E, RegF, 0);
+
+                E->Dirty |= 1 << X;
+                if(RegF >= 0)
+                    E->Dirty |= 1 << 0xF;
+            } break;
+            case 0xA000:
+            {
+                EmitStoreWordImm(E, OFFSET_I, Opcode & 0x0FFF);
+            } break;
+            case 0xF000:
+            {
+                switch(Opcode & 0x00FF)
+                {
+                    case 0x0007:
+                    {
+                        EmitLoadByte(E, JitRegister(E, X, false), OFFSET_DELAY);
+                        E->Dirty |= 1 << X;
+                    } break;
+                    case 0x0015: EmitStoreByte(E, JitRegister(E, X, true), OFFSET_DELAY); break;
+                    case 0x0018: EmitStoreByte(E, JitRegister(E, X, true), OFFSET_SOUND); break;
+                    case 0x001E:
+                    {
+                        EmitLoadWord(E, RAX, OFFSET_I);
+                        EmitAluRegReg(E, Alu_Add, RAX, JitRegister(E, X, true));
+                        EmitStoreWord(E, RAX, OFFSET_I);
+                    } break;
+                    case 0x0029:
+                    {
+                        EmitImulRegRegImm(E, RAX, JitRegister(E, X, true), 5);
+                        EmitStoreWord(E, RAX, OFFSET_I);
+                    } break;
+                    case 0x0033:
+                    {
+                        /* NOTE(koekeishiya): V / 10 is (V * 205) >> 11 and V / 100 is
+                         * (V * 41) >> 12 for every byte. Each digit is computed in ecx
+                         * and stored to (I + n) & 0xFFF through eax, hundreds last so
+                         * that eax ends up holding the start of the range. */
+                        int RegX = JitRegister(E, X, true);
+                        JitWriteBack(E);
+                        EmitStoreWordImm(E, OFFSET_OPCODE, Opcode);
+
+                        EmitImulRegRegImm(E, RCX, RegX, 205);
+                        EmitShiftRegImm(E, false, RCX, 11);
+                        EmitImulRegRegImm(E, RCX, RCX, 10);
+                        EmitNegReg(E, RCX);
+                        EmitAluRegReg(E, Alu_Add, RCX, RegX);
+                        EmitLoadWord(E, RAX, OFFSET_I);
+                        EmitAluRegImm(E, Alu_Add, RAX, 2);
+                        EmitAluRegImm(E, Alu_And, RAX, 0xFFF);
+                        EmitStoreByteIndexed(E, RCX, RAX, OFFSET_MEMORY);
+
+                        EmitImulRegRegImm(E, RCX, RegX, 205);
+                        EmitShiftRegImm(E, false, RCX, 11);
+                        EmitImulRegRegImm(E, RAX, RegX, 41);
+                        EmitShiftRegImm(E, false, RAX, 12);
+                        EmitImulRegRegImm(E, RAX, RAX, 10);
+                        EmitAluRegReg(E, Alu_Sub, RCX, RAX);
+                        EmitLoadWord(E, RAX, OFFSET_I);
+                        EmitAluRegImm(E, Alu_Add, RAX, 1);
+                        EmitAluRegImm(E, Alu_And, RAX, 0xFFF);
+                        EmitStoreByteIndexed(E, RCX, RAX, OFFSET_MEMORY);
+
+                        EmitImulRegRegImm(E, RCX, RegX, 41);
+                        EmitShiftRegImm(E, false, RCX, 12);
+                        EmitLoadWord(E, RAX, OFFSET_I);
+                        EmitAluRegImm(E, Alu_And, RAX, 0xFFF);
+                        EmitStoreByteIndexed(E, RCX, RAX, OFFSET_MEMORY);
+
+                        JitEmitWriteExit(Jit, E, 2, Address);
+                        Terminated = true;
+                    } break;
+                    case 0x0055:
+                    {
+                        /* NOTE(koekeishiya): Registers held in host registers are stored
+                         * from there, the others go through ecx. */
+                        JitWriteBack(E);
+                        EmitStoreWordImm(E, OFFSET_OPCODE, Opcode);
+
+                        EmitLoadWord(E, RAX, OFFSET_I);
+                        EmitAluRegImm(E, Alu_And, RAX, 0xFFF);
+                        for(int Index = 0; Index <= X; ++Index)
+                        {
+                            int Source = E->HostOf[Index];
+                            if(Source < 0)
+                            {
+                                Source = RCX;
+                                EmitLoadByte(E, RCX, OFFSET_V(Index));
+                            }
+
+                            EmitStoreByteIndexed(E, Source, RAX, OFFSET_MEMORY);
+                            EmitAluRegImm(E, Alu_Add, RAX, 1);
+                            EmitAluRegImm(E, Alu_And, RAX, 0xFFF);
+                        }
+
+                        EmitLoadWord(E, RAX, OFFSET_I);
+                        EmitAluRegImm(E, Alu_And, RAX, 0xFFF);
+                        JitEmitIndexAdvance(E, Quirk, X);
+                        JitEmitWriteExit(Jit, E, X, Address);
+                        Terminated = true;
+                    } break;
+                    case 0x0065:
+                    {
+                        EmitLoadWord(E, RAX, OFFSET_I);
+                        EmitAluRegImm(E, Alu_And, RAX, 0xFFF);
+                        for(int Index = 0; Index <= X; ++Index)
+                        {
+                            int Target = E->HostOf[Index];
+                            if(Target >= 0)
+                            {
+                                EmitLoadByteIndexed(E, Target, RAX, OFFSET_MEMORY);
+                                E->Dirty |= 1 << Index;
+                            }
+                            else
+                            {
+                                EmitLoadByteIndexed(E, RCX, RAX, OFFSET_MEMORY);
+                                EmitStoreByte(E, RCX, OFFSET_V(Index));
+                            }
+
+                            EmitAluRegImm(E, Alu_Add, RAX, 1);
+                            EmitAluRegImm(E, Alu_And, RAX, 0xFFF);
+                        }
+
+                        JitEmitIndexAdvance(E, Quirk, X);
+                    } break;
+                }
+            } break;
+        }
+
+        if(Terminated)
+            break;
+    }
+
+    if(Length == 0)
+    {
+        Jit->BlockAt[Pc >> 1] = JIT_UNTRANSLATABLE;
+        if(Pc < Jit->CodeLow)
+            Jit->CodeLow = Pc;
+        if(Pc + 1 > Jit->CodeHigh)
+            Jit->CodeHigh = Pc + 1;
+        return NULL;
+    }
+
+    if(!Terminated)
+    {
+        JitWriteBack(E);
+        EmitStoreWordImm(E, OFFSET_OPCODE, LastOpcode);
+        JitEmitExit(Jit, E, Address);
+    }
+
+    PatchJump(BailSite, E->At);
+    EmitMovRegImm(E, RAX, Pc);
+    PatchJump(EmitJump(E, 0xE9), Jit->Exit);
+
+    memcpy(CompareLength, &Length, 2);
+    memcpy(SubtractLength, &Length, 2);
+
+    int BlockIndex = Jit->BlockCount++;
+    chip8_jit_block *Block = Jit->Blocks + BlockIndex;
+    Block->Code = Code;
+    Block->Start = Pc;
+    Block->End = Address;
+    Block->Length = Length;
+    Block->Valid = true;
+
+    Jit->BlockAt[Pc >> 1] = BlockIndex;
+    Jit->Entries[Pc >> 1] = Code;
+    if(Pc < Jit->CodeLow)
+        Jit->CodeLow = Pc;
+    if(Address - 1 > Jit->CodeHigh)
+        Jit->CodeHigh = Address - 1;
+
+    for(unsigned int Slot = Pc >> 1; Slot < (unsigned int)(Address >> 1); ++Slot)
+        Jit->Covered[Slot] = 1;
+
+    Jit->CodeUsed += (unsigned int)(E->At - Code);
+    ++Jit->Stats.BlocksCompiled;
+
+    /* NOTE(koekeishiya): Chain this block to existing blocks, and existing blocks to it. */
+    for(int Index = 0; Index < Jit->LinkCount; ++Index)
+    {
+        chip8_jit_link *Link = Jit->Links + Index;
+        if(!Link->Linked && Link->Owner >= 0 && Link->Target == Pc)
+            JitLink(Jit, Link);
+    }
+
+    for(int Index = 0; Index < E->LinkCount; ++Index)
+    {
+        chip8_jit_link *Link = Jit->Links + Jit->LinkCount++;
+        Link->Site = E->LinkSites[Index];
+        Link->Target = E->LinkTargets[Index];
+        Link->Owner = BlockIndex;
+        Link->Linked = false;
+        JitLink(Jit, Link);
+    }
+
+    return Block;
+}
+
+internal void
+JitInvalidate(chip8_jit *Jit, unsigned int Low, unsigned int High)
+{
+    /* NOTE(koekeishiya): Most writes go to data, so only look at the blocks when one of
+     * the written slots has ever been translated. Covered is conservative, it is only
+     * cleared when everything is flushed. */
+    if(High > 0xFFF && Low <= 0xFFF)
+    {
+        JitInvalidate(Jit, 0, High & 0xFFF);
+        High = 0xFFF;
+    }
+
+    bool Hit = false;
+    for(unsigned int Address = Low & ~1u; Address <= High && Address < 0x1000; Address += 2)
+    {
+        if(Jit->BlockAt[Address >> 1] == JIT_UNTRANSLATABLE)
+            Jit->BlockAt[Address >> 1] = JIT_NO_BLOCK;
+
+        Hit |= Jit->Covered[Address >> 1] != 0;
+    }
+
+    if(!Hit)
+        return;
+
+    for(int BlockIndex = 0; BlockIndex < Jit->BlockCount; ++BlockIndex)
+    {
+        chip8_jit_block *Block = Jit->Blocks + BlockIndex;
+        if(!Block->Valid || Block->Start > High || Block->End <= Low)
+            continue;
+
+        /* NOTE(koekeishiya): Chained jumps may still arrive at the old entry, so it is
+         * overwritten to return straight to the dispatcher with the block's own address. */
+        jit_emitter Emitter = {};
+        Emitter.At = Block->Code;
+        EmitMovRegImm(&Emitter, RAX, Block->Start);
+        PatchJump(EmitJump(&Emitter, 0xE9), Jit->Exit);
+
+        Block->Valid = false;
+        Jit->BlockAt[Block->Start >> 1] = JIT_NO_BLOCK;
+        Jit->Entries[Block->Start >> 1] = Jit->Exit;
+        ++Jit->Stats.BlocksInvalidated;
+
+        for(int Index = 0; Index < Jit->LinkCount; ++Index)
+        {
+            chip8_jit_link *Link = Jit->Links + Index;
+            if(Link->Owner == BlockIndex)
+            {
+                Link->Owner = -1;
+            }
+            else if(Link->Linked && Link->Target == Block->Start)
+            {
+                PatchJump(Link->Site, Link->Site + 4);
+                Link->Linked = false;
+            }
+        }
+    }
+}
+
+/* NOTE(koekeishiya): Run a single instruction through the interpreter, and throw away any
+ * translated code that the instruction wrote over. */
+internal void
+JitInterpret(chip8_jit *Jit, chip8 *Processor)
+{
+    unsigned short Opcode = 0;
+    if(Processor->Pc < 0x0FFF)
+        Opcode = Processor->Memory[Processor->Pc] << 8 | Processor->Memory[Processor->Pc + 1];
+
+    unsigned int Address = Processor->I & 0xFFF;
+    Chip8DoCycle(Processor);
+    ++Jit->Stats.InterpretedCycles;
+
+    if((Opcode & 0xF0FF) == 0xF033)
+        JitInvalidate(Jit, Address, Address + 2);
+    else if((Opcode & 0xF0FF) == 0xF055)
+        JitInvalidate(Jit, Address, Address + ((Opcode & 0x0F00) >> 8));
+}
+
+/* NOTE(koekeishiya): Invalidate what translated FX33 or FX55 wrote over, see WrittenLow. */
+internal void
+JitFinishWrites(chip8_jit *Jit)
+{
+    if(Jit->WrittenLow <= Jit->WrittenHigh)
+    {
+        JitInvalidate(Jit, Jit->WrittenLow, Jit->WrittenHigh);
+        Jit->WrittenLow = 1;
+        Jit->WrittenHigh = 0;
+    }
+}
+
+internal const char *
+JitCompare(chip8 *A, chip8 *B)
+{
+    if(A->Pc != B->Pc) return "Pc";
+    if(A->Opcode != B->Opcode) return "Opcode";
+    if(A->I != B->I) return "I";
+    if(memcmp(A->V, B->V, sizeof(A->V)) != 0) return "V";
+    if(A->Sp != B->Sp) return "Sp";
+    if(memcmp(A->Stack, B->Stack, sizeof(A->Stack)) != 0) return "Stack";
+    if(A->DelayTimer != B->DelayTimer) return "DelayTimer";
+    if(A->SoundTimer != B->SoundTimer) return "SoundTimer";
+    if(A->RandomState != B->RandomState) return "RandomState";
+    if(A->Draw != B->Draw) return "Draw";
+    if(A->DirtyRows != B->DirtyRows) return "DirtyRows";
+    if(memcmp(A->Memory, B->Memory, sizeof(A->Memory)) != 0) return "Memory";
+    if(memcmp(A->Graphics, B->Graphics, sizeof(A->Graphics)) != 0) return "Graphics";
+    return NULL;
+}
+
+internal void
+JitRunLockstep(chip8_jit *Jit, chip8 *Processor, chip8_jit_block *Block)
+{
+    chip8 Reference = *Processor;
+    unsigned short Start = Block->Start;
+    unsigned short Length = Block->Length;
+
+    long long Budget = Length;
+    Processor->Pc = Jit->Enter(Processor, &Budget, Block->Code);
+    JitFinishWrites(Jit);
+
+    for(int Cycle = 0; Cycle < Length; ++Cycle)
+        Chip8DoCycle(&Reference);
+
+    ++Jit->Stats.LockstepChecks;
+    const char *Field = JitCompare(Processor, &Reference);
+    if(Field)
+    {
+        fprintf(stderr, "jit: lockstep mismatch in %s after block 0x%03X (%d instructions)\n",
+                Field, Start, Length);
+        fprintf(stderr, "jit: pc 0x%03X vs 0x%03X, i 0x%03X vs 0x%03X\n",
+                Processor->Pc, Reference.Pc, Processor->I, Reference.I);
+        for(int Index = 0; Index < 16; ++Index)
+        {
+            if(Processor->V[Index] != Reference.V[Index])
+                fprintf(stderr, "jit: V%X 0x%02X vs 0x%02X\n", Index, Processor->V[Index], Reference.V[Index]);
+        }
+        abort();
+    }
+}
+
+chip8_jit *Chip8JitCreate(bool Lockstep)
+{
+    chip8_jit *Jit = (chip8_jit *) calloc(1, sizeof(chip8_jit));
+    if(!Jit)
+        return NULL;
+
+    int Flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_JIT
+    Flags |= MAP_JIT;
+#endif
+    void *Memory = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, Flags, -1, 0);
+    if(Memory == MAP_FAILED)
+    {
+        free(Jit);
+        return NULL;
+    }
+
+    Jit->Code = (unsigned char *) Memory;
+    Jit->Lockstep = Lockstep;
+
+    jit_emitter Emitter = {};
+    jit_emitter *E = &Emitter;
+    E->At = Jit->Code;
+
+    /* NOTE(koekeishiya): Enter(Processor, Budget, Code): save callee-saved registers and the
+     * budget pointer, load the budget into rbp and jump into the block. */
+    unsigned char *Enter = E->At;
+    Emit8(E, 0x53);
+    Emit8(E, 0x55);
+    Emit8(E, 0x41); Emit8(E, 0x54);
+    Emit8(E, 0x41); Emit8(E, 0x55);
+    Emit8(E, 0x41); Emit8(E, 0x56);
+    Emit8(E, 0x41); Emit8(E, 0x57);
+    Emit8(E, 0x56);
+    Emit8(E, 0x48); Emit8(E, 0x8B); Emit8(E, ModRM(0, RBP, RSI));
+    Emit8(E, 0xFF); Emit8(E, ModRM(3, 4, RDX));
+
+    /* NOTE(koekeishiya): Exit, with the next chip-8 pc in eax: store the remaining budget
+     * and restore the callee-saved registers. */
+    unsigned char *Exit = E->At;
+    Emit8(E, 0x5E);
+    Emit8(E, 0x48); Emit8(E, 0x89); Emit8(E, ModRM(0, RBP, RSI));
+    Emit8(E, 0x41); Emit8(E, 0x5F);
+    Emit8(E, 0x41); Emit8(E, 0x5E);
+    Emit8(E, 0x41); Emit8(E, 0x5D);
+    Emit8(E, 0x41); Emit8(E, 0x5C);
+    Emit8(E, 0x5D);
+    Emit8(E, 0x5B);
+    Emit8(E, 0xC3);
+
+    Jit->Enter = (chip8_jit_enter *) Enter;
+    Jit->Exit = Exit;
+    Jit->CodeStart = (unsigned int)(((E->At - Jit->Code) + 15) & ~15);
+
+    JitFlush(Jit);
+    Jit->Stats.Flushes = 0;
+    return Jit;
+}
+
+void Chip8JitDestroy(chip8_jit *Jit)
+{
+    if(Jit)
+    {
+        munmap(Jit->Code, JIT_CODE_SIZE);
+        free(Jit);
+    }
+}
+
+void Chip8JitReset(chip8_jit *Jit)
+{
+    JitFlush(Jit);
+}
+
+void Chip8JitRun(chip8_jit *Jit, chip8 *Processor, unsigned long long Cycles)
+{
+    if(Jit->Quirks != Processor->Quirks)
+    {
+        Jit->Quirks = Processor->Quirks;
+        JitFlush(Jit);
+    }
+
+    long long Budget = (long long) Cycles;
+    while(Budget > 0)
+    {
+        unsigned short Pc = Processor->Pc;
+        chip8_jit_block *Block = NULL;
+
+        if(!(Pc & 0xF001))
+        {
+            short Index = Jit->BlockAt[Pc >> 1];
+            if(Index == JIT_NO_BLOCK)
+                Block = JitCompile(Jit, Processor, Pc);
+            else if(Index >= 0)
+                Block = Jit->Blocks + Index;
+        }
+
+        if(!Block || Budget < Block->Length)
+        {
+            JitInterpret(Jit, Processor);
+            --Budget;
+        }
+        else if(Jit->Lockstep)
+        {
+            JitRunLockstep(Jit, Processor, Block);
+            Jit->Stats.NativeCycles += Block->Length;
+            Budget -= Block->Length;
+        }
+        else
+        {
+            long long Before = Budget;
+            Processor->Pc = (unsigned short) Jit->Enter(Processor, &Budget, Block->Code);
+            Jit->Stats.NativeCycles += Before - Budget;
+            JitFinishWrites(Jit);
+        }
+    }
+}
+
+chip8_jit_stats Chip8JitGetStats(chip8_jit *Jit)
+{
+    return Jit->Stats;
+}
+
+#else
+
+chip8_jit *Chip8JitCreate(bool Lockstep) { return NULL; }
+void Chip8JitDestroy(chip8_jit *Jit) {}
+void Chip8JitReset(chip8_jit *Jit) {}
+void Chip8JitRun(chip8_jit *Jit, chip8 *Processor, unsigned long long Cycles) {}
+chip8_jit_stats Chip8JitGetStats(chip8_jit *Jit) { chip8_jit_stats Stats = {}; return Stats; }
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef CHIP_8_JIT
+#define CHIP_8_JIT
+
+#include "chip8.h"
+
+struct chip8_jit;
+
+struct chip8_jit_stats
+{
+    unsigned long long BlocksCompiled;
+    unsigned long long BlocksInvalidated;
+    unsigned long long Flushes;
+    unsigned long long NativeCycles;
+    unsigned long long InterpretedCycles;
+    unsigned long long LockstepChecks;
+};
+
+/* NOTE(koekeishiya): Returns NULL when the host is not x86-64 or executable memory could
+ * not be allocated. In lockstep mode every block is checked against the interpreter
+ * right after it has run, and the first divergence is reported and aborts. */
+chip8_jit *Chip8JitCreate(bool Lockstep);
+void Chip8JitDestroy(chip8_jit *Jit);
+
+/* NOTE(koekeishiya): Throw away all translated code. Must be called whenever Memory is
+ * changed outside of Chip8JitRun; writes done by FX33 and FX55 are tracked automatically. */
+void Chip8JitReset(chip8_jit *Jit);
+
+/* NOTE(koekeishiya): Execute exactly the given number of cycles. */
+void Chip8JitRun(chip8_jit *Jit, chip8 *Processor, unsigned long long Cycles);
+
+chip8_jit_stats Chip8JitGetStats(chip8_jit *Jit);
+
+#endif
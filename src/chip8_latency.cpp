@@ -0,0 +1,203 @@
+#include "chip8_latency.h"
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+#define internal static
+
+static const char *Chip8LatencyStageNames[Chip8Latency_StageCount] =
+{
+    "observe",
+    "draw",
+    "present",
+    "total",
+};
+
+internal unsigned long long
+GetTimeNanos()
+{
+    using namespace std::chrono;
+    return (duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())).count();
+}
+
+internal unsigned long long
+Elapsed(unsigned long long From, unsigned long long To)
+{
+    return To > From ? To - From : 0;
+}
+
+internal unsigned short
+NextOpcode(chip8 *Processor)
+{
+    unsigned int Pc = Processor->Pc & 0xFFF;
+    return Processor->Memory[Pc] << 8 | Processor->Memory[(Pc + 1) & 0xFFF];
+}
+
+/* NOTE(koekeishiya): Whether the next instruction reads one of Keys. FX0A waits for any
+ * key, so it reads all of them. */
+internal bool
+ReadsKey(chip8 *Processor, unsigned int Keys)
+{
+    unsigned short Opcode = NextOpcode(Processor);
+    unsigned int Key = 1u << (Processor->V[(Opcode >> 8) & 0xF] & 0xF);
+
+    switch(Opcode & 0xF0FF)
+    {
+        case 0xE09E:
+        case 0xE0A1: return (Keys & Key) != 0;
+        case 0xF00A: return true;
+    }
+    return false;
+}
+
+internal bool
+Draws(chip8 *Processor)
+{
+    unsigned short Opcode = NextOpcode(Processor);
+    return (Opcode & 0xF000) == 0xD000 || Opcode == 0x00E0;
+}
+
+internal unsigned long long
+Stamp(chip8_latency *Latency, unsigned long long Start, unsigned long long Executed)
+{
+    return Latency->NanosPerCycle > 0 ? Start + (unsigned long long)(Executed * Latency->NanosPerCycle) : GetTimeNanos();
+}
+
+void Chip8LatencyInit(chip8_latency *Latency, double NanosPerCycle)
+{
+    memset(Latency, 0, sizeof(chip8_latency));
+    Latency->NanosPerCycle = NanosPerCycle;
+    Latency->State = Chip8Latency_Idle;
+}
+
+void Chip8LatencyKeys(chip8_latency *Latency, unsigned int Keys, unsigned long long Received)
+{
+    if(!Keys)
+        return;
+
+    if(Latency->State == Chip8Latency_Observing)
+    {
+        Latency->Keys |= Keys;
+        return;
+    }
+
+    if(Latency->State == Chip8Latency_Drawing)
+        ++Latency->Superseded;
+
+    memset(&Latency->Trace, 0, sizeof(Latency->Trace));
+    Latency->Trace.Id = ++Latency->NextId;
+    Latency->Trace.Received = Received;
+    Latency->State = Chip8Latency_Observing;
+    Latency->Keys = Keys;
+    Latency->Frames = 0;
+    ++Latency->Started;
+}
+
+void Chip8LatencyRun(chip8_latency *Latency, chip8_engine *Engine, chip8 *Processor,
+                     unsigned long long Cycles, unsigned long long Start)
+{
+    /* NOTE(koekeishiya): In emulated time the draw is stamped at the cycle of the first
+     * DXYN or 00E0 that changes the framebuffer, so stepping goes on until then. On the
+     * wall clock the frame end is as close as it gets. */
+    bool Emulated = Latency->NanosPerCycle > 0;
+    if(Latency->State == Chip8Latency_Idle || (Latency->State == Chip8Latency_Drawing && !Emulated))
+    {
+        Chip8EngineRun(Engine, Processor, Cycles);
+        return;
+    }
+
+    for(unsigned long long Executed = 0; Executed < Cycles; ++Executed)
+    {
+        if(Latency->State == Chip8Latency_Observing && ReadsKey(Processor, Latency->Keys))
+        {
+            Latency->Trace.Observed = Stamp(Latency, Start, Executed);
+            memcpy(Latency->Graphics, Processor->Graphics, sizeof(Latency->Graphics));
+            Latency->State = Chip8Latency_Drawing;
+            Latency->Frames = 0;
+
+            if(!Emulated)
+            {
+                Chip8EngineRun(Engine, Processor, Cycles - Executed);
+                return;
+            }
+        }
+
+        bool Draw = Latency->State == Chip8Latency_Drawing && Draws(Processor);
+        Chip8EngineRun(Engine, Processor, 1);
+
+        if(Draw && memcmp(Latency->Graphics, Processor->Graphics, sizeof(Latency->Graphics)) != 0)
+        {
+            Latency->Trace.Drawn = Stamp(Latency, Start, Executed);
+            Latency->Drawn = Latency->Trace;
+            Latency->State = Chip8Latency_Idle;
+
+            Chip8EngineRun(Engine, Processor, Cycles - Executed - 1);
+            return;
+        }
+    }
+}
+
+void Chip8LatencyFrame(chip8_latency *Latency, chip8 *Processor, unsigned long long Now)
+{
+    if(Latency->State == Chip8Latency_Observing)
+    {
+        if(++Latency->Frames >= CHIP8_LATENCY_TIMEOUT)
+        {
+            ++Latency->Unobserved;
+            Latency->State = Chip8Latency_Idle;
+        }
+    }
+    else if(Latency->State == Chip8Latency_Drawing)
+    {
+        if(memcmp(Latency->Graphics, Processor->Graphics, sizeof(Latency->Graphics)) != 0)
+        {
+            Latency->Trace.Drawn = Now;
+            Latency->Drawn = Latency->Trace;
+            Latency->State = Chip8Latency_Idle;
+        }
+        else if(++Latency->Frames >= CHIP8_LATENCY_TIMEOUT)
+        {
+            ++Latency->Undrawn;
+            Latency->State = Chip8Latency_Idle;
+        }
+    }
+}
+
+void Chip8LatencyRecord(chip8_latency_stats *Stats, chip8_latency_trace *Trace, unsigned long long Presented)
+{
+    if(!Trace->Id || Trace->Id <= Stats->LastId)
+        return;
+
+    unsigned int Slot = Stats->Count % CHIP8_LATENCY_SAMPLES;
+    Stats->Samples[Chip8Latency_Observe][Slot] = Elapsed(Trace->Received, Trace->Observed);
+    Stats->Samples[Chip8Latency_Draw][Slot] = Elapsed(Trace->Observed, Trace->Drawn);
+    Stats->Samples[Chip8Latency_Present][Slot] = Elapsed(Trace->Drawn, Presented);
+    Stats->Samples[Chip8Latency_Total][Slot] = Elapsed(Trace->Received, Presented);
+
+    Stats->LastId = Trace->Id;
+    ++Stats->Count;
+}
+
+unsigned long long Chip8LatencyPercentile(chip8_latency_stats *Stats, chip8_latency_stage Stage, double Percentile)
+{
+    unsigned int Count = Stats->Count < CHIP8_LATENCY_SAMPLES ? Stats->Count : CHIP8_LATENCY_SAMPLES;
+    if(Count == 0)
+        return 0;
+
+    unsigned long long Sorted[CHIP8_LATENCY_SAMPLES];
+    memcpy(Sorted, Stats->Samples[Stage], Count * sizeof(unsigned long long));
+
+    unsigned int Rank = (unsigned int)(Percentile / 100.0 * Count + 0.999999);
+    unsigned int Index = Rank > 0 ? Rank - 1 : 0;
+    if(Index >= Count)
+        Index = Count - 1;
+
+    std::nth_element(Sorted, Sorted + Index, Sorted + Count);
+    return Sorted[Index];
+}
+
+const char *Chip8LatencyStageName(chip8_latency_stage Stage)
+{
+    return Stage < Chip8Latency_StageCount ? Chip8LatencyStageNames[Stage] : "unknown";
+}
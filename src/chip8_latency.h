@@ -0,0 +1,109 @@
+#ifndef CHIP_8_LATENCY
+#define CHIP_8_LATENCY
+
+#include "chip8.h"
+#include "chip8_engine.h"
+
+/* NOTE(koekeishiya): Frames a trace waits for the rom to read the key, and then for it to
+ * draw, before it is given up. */
+#define CHIP8_LATENCY_TIMEOUT 60
+
+/* NOTE(koekeishiya): Traces the percentiles are taken over, the newest ones. */
+#define CHIP8_LATENCY_SAMPLES 1024
+
+/* NOTE(koekeishiya): The path of a key change to the screen: the host delivers the key
+ * event, the rom reads the key through EX9E, EXA1 or FX0A, the framebuffer changes, and the
+ * frame holding the change is presented. Each stage is measured from the previous one. */
+enum chip8_latency_stage
+{
+    Chip8Latency_Observe,
+    Chip8Latency_Draw,
+    Chip8Latency_Present,
+    Chip8Latency_Total,
+
+    Chip8Latency_StageCount
+};
+
+/* NOTE(koekeishiya): Id is 0 for no trace. Stamps are nanoseconds on whatever clock the
+ * tracker runs on. */
+struct chip8_latency_trace
+{
+    unsigned long long Id;
+    unsigned long long Received;
+    unsigned long long Observed;
+    unsigned long long Drawn;
+};
+
+enum chip8_latency_state
+{
+    Chip8Latency_Idle,
+    Chip8Latency_Observing,
+    Chip8Latency_Drawing,
+};
+
+/* NOTE(koekeishiya): Follows one trace at a time on the emulation thread. While a key
+ * change waits to be read, frames are run one instruction at a time so the read can be
+ * stamped exactly. In emulated time this goes on until the change is drawn. At any other
+ * time frames run as usual. NanosPerCycle is 0 to stamp
+ * with the wall clock, or the emulated length of an instruction to stamp in emulated
+ * time, as chip8-headless does. */
+struct chip8_latency
+{
+    double NanosPerCycle;
+    chip8_latency_state State;
+    chip8_latency_trace Trace;
+    unsigned long long NextId;
+
+    /* NOTE(koekeishiya): Keys that changed since the trace started, and the framebuffer
+     * when the rom read one of them. */
+    unsigned int Keys;
+    unsigned long long Graphics[DISPLAY_HEIGHT];
+    unsigned int Frames;
+
+    /* NOTE(koekeishiya): The newest trace that reached the framebuffer. Frames published
+     * from then on carry it, so that it is presented with whichever of them is shown. */
+    chip8_latency_trace Drawn;
+
+    /* NOTE(koekeishiya): Traces started, and those given up on because the rom did not
+     * read the key or did not draw in time, or because another key came first. */
+    unsigned long long Started;
+    unsigned long long Unobserved;
+    unsigned long long Undrawn;
+    unsigned long long Superseded;
+};
+
+/* NOTE(koekeishiya): Completed traces, owned by whoever presents frames. */
+struct chip8_latency_stats
+{
+    unsigned long long Samples[Chip8Latency_StageCount][CHIP8_LATENCY_SAMPLES];
+    unsigned long long Count;
+    unsigned long long LastId;
+};
+
+void Chip8LatencyInit(chip8_latency *Latency, double NanosPerCycle);
+
+/* NOTE(koekeishiya): The keys in Keys changed, delivered by the host at Received. A trace
+ * that is still waiting for the rom to read keys takes them in and keeps its older stamp. */
+void Chip8LatencyKeys(chip8_latency *Latency, unsigned int Keys, unsigned long long Received);
+
+/* NOTE(koekeishiya): Run Cycles instructions on Engine, starting at Start on the clock
+ * of the tracker. Stamps Observed before the first instruction that reads a changed key.
+ * In emulated time it also stamps Drawn at the first DXYN or 00E0 after that which changes
+ * the framebuffer. */
+void Chip8LatencyRun(chip8_latency *Latency, chip8_engine *Engine, chip8 *Processor,
+                     unsigned long long Cycles, unsigned long long Start);
+
+/* NOTE(koekeishiya): Call at the end of every frame, at Now on the clock of the tracker.
+ * On the wall clock, stamps Drawn once the framebuffer differs from when the key was read. */
+void Chip8LatencyFrame(chip8_latency *Latency, chip8 *Processor, unsigned long long Now);
+
+/* NOTE(koekeishiya): Record Trace as presented at Presented. Traces that were already
+ * recorded, i.e. frames that carried the same trace, are ignored. */
+void Chip8LatencyRecord(chip8_latency_stats *Stats, chip8_latency_trace *Trace, unsigned long long Presented);
+
+/* NOTE(koekeishiya): Percentile (0-100) of a stage over the newest samples, in nanoseconds. */
+unsigned long long Chip8LatencyPercentile(chip8_latency_stats *Stats, chip8_latency_stage Stage, double Percentile);
+
+const char *Chip8LatencyStageName(chip8_latency_stage Stage);
+
+#endif
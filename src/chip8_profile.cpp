@@ -0,0 +1,218 @@
+#include "chip8_profile.h"
+#include <string.h>
+
+#include <chrono>
+
+#define internal static
+
+static const char *Chip8OpcodeClassNames[Chip8Op_Count] =
+{
+    "00E0", "00EE", "0NNN",
+    "1NNN", "2NNN", "3XNN", "4XNN", "5XY0",
+    "6XNN", "7XNN",
+    "8XY0", "8XY1", "8XY2", "8XY3", "8XY4",
+    "8XY5", "8XY6", "8XY7", "8XYE",
+    "9XY0", "ANNN", "BNNN", "CXNN", "DXYN",
+    "EX9E", "EXA1",
+    "FX07", "FX0A", "FX15", "FX18", "FX1E",
+    "FX29", "FX33", "FX55", "FX65",
+    "unknown",
+};
+
+internal unsigned long long
+GetTimeNanos()
+{
+    using namespace std::chrono;
+    return (duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())).count();
+}
+
+chip8_opcode_class Chip8OpcodeClass(unsigned short Opcode)
+{
+    switch(Opcode & 0xF000)
+    {
+        case 0x0000:
+        {
+            if(Opcode == 0x00E0) return Chip8Op_00E0;
+            if(Opcode == 0x00EE) return Chip8Op_00EE;
+            return Chip8Op_0NNN;
+        }
+        case 0x1000: return Chip8Op_1NNN;
+        case 0x2000: return Chip8Op_2NNN;
+        case 0x3000: return Chip8Op_3XNN;
+        case 0x4000: return Chip8Op_4XNN;
+        case 0x5000: return Chip8Op_5XY0;
+        case 0x6000: return Chip8Op_6XNN;
+        case 0x7000: return Chip8Op_7XNN;
+        case 0x8000:
+        {
+            switch(Opcode & 0x000F)
+            {
+                case 0x0000: return Chip8Op_8XY0;
+                case 0x0001: return Chip8Op_8XY1;
+                case 0x0002: return Chip8Op_8XY2;
+                case 0x0003: return Chip8Op_8XY3;
+                case 0x0004: return Chip8Op_8XY4;
+                case 0x0005: return Chip8Op_8XY5;
+                case 0x0006: return Chip8Op_8XY6;
+                case 0x0007: return Chip8Op_8XY7;
+                case 0x000E: return Chip8Op_8XYE;
+            }
+        } break;
+        case 0x9000: return Chip8Op_9XY0;
+        case 0xA000: return Chip8Op_ANNN;
+        case 0xB000: return Chip8Op_BNNN;
+        case 0xC000: return Chip8Op_CXNN;
+        case 0xD000: return Chip8Op_DXYN;
+        case 0xE000:
+        {
+            if((Opcode & 0x00FF) == 0x009E) return Chip8Op_EX9E;
+            if((Opcode & 0x00FF) == 0x00A1) return Chip8Op_EXA1;
+        } break;
+        case 0xF000:
+        {
+            switch(Opcode & 0x00FF)
+            {
+                case 0x0007: return Chip8Op_FX07;
+                case 0x000A: return Chip8Op_FX0A;
+                case 0x0015: return Chip8Op_FX15;
+                case 0x0018: return Chip8Op_FX18;
+                case 0x001E: return Chip8Op_FX1E;
+                case 0x0029: return Chip8Op_FX29;
+                case 0x0033: return Chip8Op_FX33;
+                case 0x0055: return Chip8Op_FX55;
+                case 0x0065: return Chip8Op_FX65;
+            }
+        } break;
+    }
+
+    return Chip8Op_Unknown;
+}
+
+const char *Chip8OpcodeClassName(chip8_opcode_class Class)
+{
+    return Class < Chip8Op_Count ? Chip8OpcodeClassNames[Class] : "unknown";
+}
+
+void Chip8ProfileBegin(chip8_profile *Profile)
+{
+    memset(Profile, 0, sizeof(chip8_profile));
+    Profile->StartNanos = GetTimeNanos();
+}
+
+void Chip8ProfileEnd(chip8_profile *Profile)
+{
+    Profile->ElapsedNanos = GetTimeNanos() - Profile->StartNanos;
+}
+
+void Chip8ProfileMerge(chip8_profile *Into, chip8_profile *From)
+{
+    Into->Instructions += From->Instructions;
+    Into->DrawCalls += From->DrawCalls;
+    Into->PixelsTouched += From->PixelsTouched;
+    Into->PixelsErased += From->PixelsErased;
+
+    for(int Class = 0; Class < Chip8Op_Count; ++Class)
+        Into->Classes[Class] += From->Classes[Class];
+
+    for(int Address = 0; Address < 0x1000; ++Address)
+        Into->Addresses[Address] += From->Addresses[Address];
+
+    /* NOTE(koekeishiya): Instances that ran side by side overlap in time, so the merged
+     * profile covers the longest of them. */
+    if(From->ElapsedNanos > Into->ElapsedNanos)
+        Into->ElapsedNanos = From->ElapsedNanos;
+}
+
+double Chip8ProfileInstructionsPerSecond(chip8_profile *Profile)
+{
+    return Profile->ElapsedNanos ? Profile->Instructions * 1E9 / Profile->ElapsedNanos : 0.0;
+}
+
+int Chip8ProfileHotSpots(chip8_profile *Profile, chip8_hot_spot *Spots, int Count)
+{
+    /* NOTE(koekeishiya): Insertion into a small sorted array, Count is expected to be a
+     * handful and the address space is only 4 KB. */
+    int Found = 0;
+    for(int Address = 0; Address < 0x1000; ++Address)
+    {
+        unsigned long long Executed = Profile->Addresses[Address];
+        if(!Executed || (Found == Count && Executed <= Spots[Found - 1].Count))
+            continue;
+
+        int At = Found < Count ? Found++ : Count - 1;
+        while(At > 0 && Spots[At - 1].Count < Executed)
+        {
+            Spots[At] = Spots[At - 1];
+            --At;
+        }
+
+        Spots[At].Address = (unsigned short) Address;
+        Spots[At].Count = Executed;
+    }
+
+    return Found;
+}
+
+void Chip8ProfileWriteText(chip8_profile *Profile, FILE *File)
+{
+    double Total = Profile->Instructions ? (double) Profile->Instructions : 1.0;
+
+    fprintf(File, "profile: %llu instructions in %.3fs, %.0f instructions/sec\n",
+            Profile->Instructions, Profile->ElapsedNanos / 1E9, Chip8ProfileInstructionsPerSecond(Profile));
+    fprintf(File, "draw: %llu DXYN, %llu pixels touched, %llu erased\n",
+            Profile->DrawCalls, Profile->PixelsTouched, Profile->PixelsErased);
+
+    fprintf(File, "opcodes:\n");
+    for(int Class = 0; Class < Chip8Op_Count; ++Class)
+    {
+        if(Profile->Classes[Class])
+        {
+            fprintf(File, "  %-8s %14llu %6.2f%%\n", Chip8OpcodeClassName((chip8_opcode_class) Class),
+                    Profile->Classes[Class], 100.0 * Profile->Classes[Class] / Total);
+        }
+    }
+
+    chip8_hot_spot Spots[16];
+    int Count = Chip8ProfileHotSpots(Profile, Spots, 16);
+
+    fprintf(File, "hot spots:\n");
+    for(int Index = 0; Index < Count; ++Index)
+    {
+        fprintf(File, "  0x%03X    %14llu %6.2f%%\n", Spots[Index].Address,
+                Spots[Index].Count, 100.0 * Spots[Index].Count / Total);
+    }
+}
+
+void Chip8ProfileWriteJson(chip8_profile *Profile, FILE *File)
+{
+    fprintf(File, "{\n  \"instructions\": %llu,\n  \"elapsed_ns\": %llu,\n  \"instructions_per_second\": %.0f,\n",
+            Profile->Instructions, Profile->ElapsedNanos, Chip8ProfileInstructionsPerSecond(Profile));
+    fprintf(File, "  \"draw_calls\": %llu,\n  \"pixels_touched\": %llu,\n  \"pixels_erased\": %llu,\n",
+            Profile->DrawCalls, Profile->PixelsTouched, Profile->PixelsErased);
+
+    fprintf(File, "  \"opcodes\": {");
+    bool First = true;
+    for(int Class = 0; Class < Chip8Op_Count; ++Class)
+    {
+        if(Profile->Classes[Class])
+        {
+            fprintf(File, "%s\n    \"%s\": %llu", First ? "" : ",",
+                    Chip8OpcodeClassName((chip8_opcode_class) Class), Profile->Classes[Class]);
+            First = false;
+        }
+    }
+    fprintf(File, "\n  },\n");
+
+    /* NOTE(koekeishiya): Only addresses that were executed at least once. */
+    fprintf(File, "  \"addresses\": {");
+    First = true;
+    for(int Address = 0; Address < 0x1000; ++Address)
+    {
+        if(Profile->Addresses[Address])
+        {
+            fprintf(File, "%s\n    \"0x%03X\": %llu", First ? "" : ",", Address, Profile->Addresses[Address]);
+            First = false;
+        }
+    }
+    fprintf(File, "\n  }\n}\n");
+}
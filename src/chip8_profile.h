@@ -0,0 +1,79 @@
+#ifndef CHIP_8_PROFILE
+#define CHIP_8_PROFILE
+
+#include <stdio.h>
+
+/* NOTE(koekeishiya): Every distinct instruction of the chip-8, plus one for opcodes that
+ * do not decode to anything. */
+enum chip8_opcode_class
+{
+    Chip8Op_00E0, Chip8Op_00EE, Chip8Op_0NNN,
+    Chip8Op_1NNN, Chip8Op_2NNN, Chip8Op_3XNN, Chip8Op_4XNN, Chip8Op_5XY0,
+    Chip8Op_6XNN, Chip8Op_7XNN,
+    Chip8Op_8XY0, Chip8Op_8XY1, Chip8Op_8XY2, Chip8Op_8XY3, Chip8Op_8XY4,
+    Chip8Op_8XY5, Chip8Op_8XY6, Chip8Op_8XY7, Chip8Op_8XYE,
+    Chip8Op_9XY0, Chip8Op_ANNN, Chip8Op_BNNN, Chip8Op_CXNN, Chip8Op_DXYN,
+    Chip8Op_EX9E, Chip8Op_EXA1,
+    Chip8Op_FX07, Chip8Op_FX0A, Chip8Op_FX15, Chip8Op_FX18, Chip8Op_FX1E,
+    Chip8Op_FX29, Chip8Op_FX33, Chip8Op_FX55, Chip8Op_FX65,
+    Chip8Op_Unknown,
+
+    Chip8Op_Count
+};
+
+/* NOTE(koekeishiya): Counters filled in by Chip8DoCycle for a processor whose Profile
+ * points here. Only available when everything is built with -DCHIP8_PROFILE; without
+ * it the processor has no Profile field and Chip8DoCycle carries no instrumentation.
+ * Instructions executed by an engine without going through Chip8DoCycle, or skipped as
+ * part of an idle loop, are not counted. */
+struct chip8_profile
+{
+    unsigned long long Instructions;
+    unsigned long long Classes[Chip8Op_Count];
+
+    /* NOTE(koekeishiya): Instructions fetched from every address of the 4 KB space. */
+    unsigned long long Addresses[0x1000];
+
+    /* NOTE(koekeishiya): DXYN executions, sprite pixels drawn (set bits in the sprite rows
+     * that ended up on screen) and how many of them turned a lit pixel off. */
+    unsigned long long DrawCalls;
+    unsigned long long PixelsTouched;
+    unsigned long long PixelsErased;
+
+    unsigned long long StartNanos;
+    unsigned long long ElapsedNanos;
+};
+
+struct chip8_hot_spot
+{
+    unsigned short Address;
+    unsigned long long Count;
+};
+
+chip8_opcode_class Chip8OpcodeClass(unsigned short Opcode);
+const char *Chip8OpcodeClassName(chip8_opcode_class Class);
+
+/* NOTE(koekeishiya): Clear the counters and start the clock used for instructions/sec. */
+void Chip8ProfileBegin(chip8_profile *Profile);
+void Chip8ProfileEnd(chip8_profile *Profile);
+
+/* NOTE(koekeishiya): Add the counters of From to Into, e.g. to combine instances. */
+void Chip8ProfileMerge(chip8_profile *Into, chip8_profile *From);
+
+double Chip8ProfileInstructionsPerSecond(chip8_profile *Profile);
+
+/* NOTE(koekeishiya): Fill in at most Count of the most executed addresses, hottest first,
+ * and return how many were written. */
+int Chip8ProfileHotSpots(chip8_profile *Profile, chip8_hot_spot *Spots, int Count);
+
+void Chip8ProfileWriteText(chip8_profile *Profile, FILE *File);
+void Chip8ProfileWriteJson(chip8_profile *Profile, FILE *File);
+
+inline void Chip8ProfileInstruction(chip8_profile *Profile, unsigned short Pc, unsigned short Opcode)
+{
+    ++Profile->Instructions;
+    ++Profile->Classes[Chip8OpcodeClass(Opcode)];
+    ++Profile->Addresses[Pc & 0xFFF];
+}
+
+#endif
@@ -0,0 +1,162 @@
+#include "chip8_scheduler.h"
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+
+#define internal static
+
+#define MIN_SPIN_MARGIN 50000ULL
+#define MAX_SPIN_MARGIN 4000000ULL
+
+unsigned long long Chip8SchedulerNow()
+{
+    using namespace std::chrono;
+    return (duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())).count();
+}
+
+internal inline void
+SpinPause()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/* NOTE(koekeishiya): Sleep for roughly the given time and feed the oversleep back into
+ * SpinMargin: it jumps up to any larger oversleep and decays slowly towards smaller ones. */
+internal void
+SleepFor(chip8_scheduler *Scheduler, unsigned long long Nanos)
+{
+    struct timespec Request;
+    Request.tv_sec = Nanos / 1000000000ULL;
+    Request.tv_nsec = Nanos % 1000000000ULL;
+
+    unsigned long long Start = Chip8SchedulerNow();
+    nanosleep(&Request, NULL);
+    unsigned long long Slept = Chip8SchedulerNow() - Start;
+    Scheduler->Stats.SleepNanos += Slept;
+
+    unsigned long long Oversleep = Slept > Nanos ? Slept - Nanos : 0;
+    if(Oversleep > Scheduler->SpinMargin)
+        Scheduler->SpinMargin = Oversleep;
+    else
+        Scheduler->SpinMargin -= (Scheduler->SpinMargin - Oversleep) / 16;
+
+    if(Scheduler->SpinMargin < MIN_SPIN_MARGIN)
+        Scheduler->SpinMargin = MIN_SPIN_MARGIN;
+    else if(Scheduler->SpinMargin > MAX_SPIN_MARGIN)
+        Scheduler->SpinMargin = MAX_SPIN_MARGIN;
+}
+
+void Chip8SchedulerInit(chip8_scheduler *Scheduler, int InstructionsPerFrame)
+{
+    memset(Scheduler, 0, sizeof(chip8_scheduler));
+    Scheduler->InstructionsPerFrame = InstructionsPerFrame;
+    Scheduler->FrameNanos = 1000000000ULL / CHIP8_TIMER_HZ;
+    Scheduler->SpinMargin = 1000000ULL;
+    Scheduler->SkipIdle = true;
+    Chip8SchedulerResync(Scheduler);
+}
+
+void Chip8SchedulerResync(chip8_scheduler *Scheduler)
+{
+    unsigned long long Now = Chip8SchedulerNow();
+    Scheduler->NextFrame = Now;
+    Scheduler->NextPresent = Now;
+}
+
+void Chip8SchedulerRunFrame(chip8_scheduler *Scheduler, chip8_engine *Engine, chip8 *Processor)
+{
+    unsigned long long Cycles = Scheduler->InstructionsPerFrame;
+    Scheduler->Cycles += Cycles;
+    Scheduler->Idle.Type = Chip8Idle_None;
+
+    if(Scheduler->SkipIdle)
+    {
+        unsigned int MaxPeriod = Cycles / 2 < CHIP8_IDLE_MAX_PERIOD ? Cycles / 2 : CHIP8_IDLE_MAX_PERIOD;
+        Scheduler->Idle = Chip8DetectIdle(Processor, MaxPeriod);
+        if(Scheduler->Idle.Type != Chip8Idle_None)
+        {
+            unsigned long long Run = Chip8IdleCycles(&Scheduler->Idle, Cycles);
+            Scheduler->Stats.IdleCycles += Cycles - Run;
+            ++Scheduler->Stats.IdleFrames;
+            Cycles = Run;
+        }
+    }
+
+    if(Scheduler->Latency)
+        Chip8LatencyRun(Scheduler->Latency, Engine, Processor, Cycles, Chip8SchedulerNow());
+    else
+        Chip8EngineRun(Engine, Processor, Cycles);
+    Scheduler->Sounding = Processor->SoundTimer > 0;
+    Chip8TickTimers(Processor);
+    ++Scheduler->Stats.Frames;
+}
+
+int Chip8SchedulerFramesDue(chip8_scheduler *Scheduler)
+{
+    if(Scheduler->Turbo)
+        return 1;
+
+    unsigned long long Now = Chip8SchedulerNow();
+    if(Now < Scheduler->NextFrame)
+        return 0;
+
+    unsigned long long Due = (Now - Scheduler->NextFrame) / Scheduler->FrameNanos + 1;
+    if(Due > CHIP8_SCHEDULER_MAX_CATCH_UP)
+    {
+        Scheduler->Stats.Dropped += Due - CHIP8_SCHEDULER_MAX_CATCH_UP;
+        Scheduler->NextFrame = Now + Scheduler->FrameNanos;
+        return CHIP8_SCHEDULER_MAX_CATCH_UP;
+    }
+
+    Scheduler->NextFrame += Due * Scheduler->FrameNanos;
+    return (int) Due;
+}
+
+bool Chip8SchedulerShouldPresent(chip8_scheduler *Scheduler)
+{
+    if(Scheduler->Turbo)
+    {
+        unsigned long long Now = Chip8SchedulerNow();
+        if(Now < Scheduler->NextPresent)
+        {
+            ++Scheduler->Stats.Skipped;
+            return false;
+        }
+
+        Scheduler->NextPresent = Now + Scheduler->FrameNanos;
+    }
+
+    ++Scheduler->Stats.Presented;
+    return true;
+}
+
+void Chip8SchedulerWait(chip8_scheduler *Scheduler)
+{
+    if(Scheduler->Turbo)
+        return;
+
+    unsigned long long Deadline = Scheduler->NextFrame;
+    unsigned long long Now = Chip8SchedulerNow();
+
+    while(Now + Scheduler->SpinMargin < Deadline)
+    {
+        SleepFor(Scheduler, Deadline - Now - Scheduler->SpinMargin);
+        Now = Chip8SchedulerNow();
+    }
+
+    unsigned long long SpinStart = Now;
+    while(Now < Deadline)
+    {
+        SpinPause();
+        Now = Chip8SchedulerNow();
+    }
+
+    Scheduler->Stats.SpinNanos += Now - SpinStart;
+    Scheduler->Stats.LateNanos += Now - Deadline;
+    ++Scheduler->Stats.Waits;
+}
@@ -0,0 +1,96 @@
+#ifndef CHIP_8_SCHEDULER
+#define CHIP_8_SCHEDULER
+
+#include "chip8.h"
+#include "chip8_engine.h"
+#include "chip8_latency.h"
+
+#define CHIP8_TIMER_HZ 60
+
+/* NOTE(koekeishiya): Emulated frames that may be run back to back to catch up after the
+ * host stalled, e.g. while a window is being dragged. Anything beyond is dropped. */
+#define CHIP8_SCHEDULER_MAX_CATCH_UP 4
+
+struct chip8_scheduler_stats
+{
+    unsigned long long Frames;
+    unsigned long long Presented;
+
+    /* NOTE(koekeishiya): Frames that were emulated without being presented (turbo), and
+     * frames that were not emulated at all because the host fell too far behind. */
+    unsigned long long Skipped;
+    unsigned long long Dropped;
+
+    /* NOTE(koekeishiya): Time spent waiting for deadlines, split into sleeping and the
+     * final spin, and how late the wait returned on average. */
+    unsigned long long SleepNanos;
+    unsigned long long SpinNanos;
+    unsigned long long LateNanos;
+    unsigned long long Waits;
+
+    /* NOTE(koekeishiya): Frames that started in an idle loop, and the instructions that
+     * were skipped because of it. */
+    unsigned long long IdleFrames;
+    unsigned long long IdleCycles;
+};
+
+/* NOTE(koekeishiya): Runs the processor at InstructionsPerFrame instructions per 60 Hz
+ * frame, ticking the timers exactly once per frame. In normal mode frames are paced to
+ * wall-clock time; in turbo mode they run as fast as possible and only one frame per
+ * host refresh is presented. */
+struct chip8_scheduler
+{
+    int InstructionsPerFrame;
+    bool Turbo;
+
+    /* NOTE(koekeishiya): Instructions the processor has been asked to run so far, counting
+     * fast-forwarded ones. Input logs are stamped with this. */
+    unsigned long long Cycles;
+
+    /* NOTE(koekeishiya): Fast-forward through idle loops, on by default. Idle is what the
+     * last frame started in. */
+    bool SkipIdle;
+    chip8_idle Idle;
+
+    /* NOTE(koekeishiya): Whether the buzzer sounded during the last frame, i.e. the sound
+     * timer was still running when it was ticked. */
+    bool Sounding;
+
+    /* NOTE(koekeishiya): Traces key changes through the frames it runs, when set. */
+    chip8_latency *Latency;
+
+    unsigned long long FrameNanos;
+    unsigned long long NextFrame;
+    unsigned long long NextPresent;
+
+    /* NOTE(koekeishiya): How much earlier than a deadline sleeping stops and spinning
+     * starts. Adapted to the oversleep the host actually shows. */
+    unsigned long long SpinMargin;
+
+    chip8_scheduler_stats Stats;
+};
+
+unsigned long long Chip8SchedulerNow();
+
+void Chip8SchedulerInit(chip8_scheduler *Scheduler, int InstructionsPerFrame);
+
+/* NOTE(koekeishiya): Restart pacing from the current time, e.g. after a pause or when
+ * turbo is switched off, so that the frames that were not run are not caught up. */
+void Chip8SchedulerResync(chip8_scheduler *Scheduler);
+
+/* NOTE(koekeishiya): Execute one emulated frame: InstructionsPerFrame cycles followed by
+ * one timer tick. When the frame starts in an idle loop only the instructions needed to
+ * reach the same end state are executed. */
+void Chip8SchedulerRunFrame(chip8_scheduler *Scheduler, chip8_engine *Engine, chip8 *Processor);
+
+/* NOTE(koekeishiya): Number of frames to run now. In normal mode this is the number of
+ * deadlines that have passed, limited to CHIP8_SCHEDULER_MAX_CATCH_UP. In turbo mode it is
+ * always 1, and Chip8SchedulerShouldPresent decides when to show one. */
+int Chip8SchedulerFramesDue(chip8_scheduler *Scheduler);
+bool Chip8SchedulerShouldPresent(chip8_scheduler *Scheduler);
+
+/* NOTE(koekeishiya): Block until the next frame is due, sleeping for most of the wait and
+ * spinning only for the last SpinMargin nanoseconds. Returns immediately in turbo mode. */
+void Chip8SchedulerWait(chip8_scheduler *Scheduler);
+
+#endif
@@ -0,0 +1,390 @@
+#include "chip8_state.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+
+#define internal static
+
+#define BLOCK_SIZE 16
+#define STATE_BLOCKS ((sizeof(chip8) + BLOCK_SIZE - 1) / BLOCK_SIZE)
+#define BITMAP_SIZE ((STATE_BLOCKS + 7) / 8)
+
+internal unsigned char *
+Put(unsigned char *At, unsigned long long Value, int Bytes)
+{
+    for(int Index = 0; Index < Bytes; ++Index)
+        *At++ = (unsigned char)(Value >> (8 * Index));
+    return At;
+}
+
+internal unsigned char *
+Get(unsigned char *At, unsigned long long *Value, int Bytes)
+{
+    *Value = 0;
+    for(int Index = 0; Index < Bytes; ++Index)
+        *Value |= (unsigned long long)*At++ << (8 * Index);
+    return At;
+}
+
+unsigned int Chip8SerializeState(chip8 *Processor, unsigned char *Buffer)
+{
+    unsigned char *At = Buffer;
+    memcpy(At, CHIP8_STATE_MAGIC, 4);
+    At = Put(At + 4, CHIP8_STATE_VERSION, 2);
+    At = Put(At, 0, 2);
+
+    At = Put(At, Processor->Opcode, 2);
+    memcpy(At, Processor->Memory, sizeof(Processor->Memory));
+    At += sizeof(Processor->Memory);
+    At = Put(At, Processor->I, 2);
+    At = Put(At, Processor->Pc, 2);
+    memcpy(At, Processor->V, sizeof(Processor->V));
+    At += sizeof(Processor->V);
+
+    for(int Row = 0; Row < DISPLAY_HEIGHT; ++Row)
+        At = Put(At, Processor->Graphics[Row], 8);
+
+    for(int Index = 0; Index < 16; ++Index)
+        At = Put(At, Processor->Stack[Index], 2);
+
+    At = Put(At, Processor->Sp, 2);
+    At = Put(At, Processor->DelayTimer, 1);
+    At = Put(At, Processor->SoundTimer, 1);
+    At = Put(At, Processor->Draw, 1);
+    At = Put(At, Processor->RandomState, 8);
+
+    return (unsigned int)(At - Buffer);
+}
+
+bool Chip8DeserializeState(chip8 *Processor, unsigned char *Buffer, unsigned int Size)
+{
+    unsigned long long Value;
+    if(Size < CHIP8_STATE_SIZE || memcmp(Buffer, CHIP8_STATE_MAGIC, 4) != 0)
+        return false;
+
+    unsigned char *At = Get(Buffer + 4, &Value, 2);
+    if(Value != CHIP8_STATE_VERSION)
+        return false;
+
+    At = Get(At, &Value, 2);
+    if(Value != 0)
+        return false;
+
+    /* NOTE(koekeishiya): Pc and Sp are checked before anything is copied into Processor,
+     * so a state that fails to load leaves the running machine as it was. A full stack
+     * is the deepest a well-behaved rom gets, and Pc has to leave room for a whole
+     * opcode. */
+    unsigned char *Registers = At + 2 + sizeof(Processor->Memory);
+    Get(Registers + 2, &Value, 2);
+    if(Value > 0xFFE)
+        return false;
+
+    Get(Registers + 4 + sizeof(Processor->V) + 8 * DISPLAY_HEIGHT + 2 * 16, &Value, 2);
+    if(Value > 16)
+        return false;
+
+    At = Get(At, &Value, 2); Processor->Opcode = Value;
+    memcpy(Processor->Memory, At, sizeof(Processor->Memory));
+    At += sizeof(Processor->Memory);
+    At = Get(At, &Value, 2); Processor->I = Value;
+    At = Get(At, &Value, 2); Processor->Pc = Value;
+    memcpy(Processor->V, At, sizeof(Processor->V));
+    At += sizeof(Processor->V);
+
+    for(int Row = 0; Row < DISPLAY_HEIGHT; ++Row)
+    {
+        At = Get(At, &Value, 8);
+        Processor->Graphics[Row] = Value;
+    }
+
+    for(int Index = 0; Index < 16; ++Index)
+    {
+        At = Get(At, &Value, 2);
+        Processor->Stack[Index] = Value;
+    }
+
+    At = Get(At, &Value, 2); Processor->Sp = Value;
+    At = Get(At, &Value, 1); Processor->DelayTimer = Value;
+    At = Get(At, &Value, 1); Processor->SoundTimer = Value;
+    At = Get(At, &Value, 1); Processor->Draw = Value != 0;
+    At = Get(At, &Value, 8); Processor->RandomState = Value;
+
+    Processor->DirtyRows = 0xFFFFFFFF;
+    return true;
+}
+
+bool Chip8SaveState(chip8 *Processor, const char *Path)
+{
+    unsigned char Buffer[CHIP8_STATE_SIZE];
+    unsigned int Size = Chip8SerializeState(Processor, Buffer);
+
+    FILE *FileHandle = fopen(Path, "wb");
+    if(!FileHandle)
+        return false;
+
+    bool Result = fwrite(Buffer, 1, Size, FileHandle) == Size;
+    return fclose(FileHandle) == 0 && Result;
+}
+
+bool Chip8LoadState(chip8 *Processor, const char *Path)
+{
+    unsigned char Buffer[CHIP8_STATE_SIZE];
+
+    FILE *FileHandle = fopen(Path, "rb");
+    if(!FileHandle)
+        return false;
+
+    unsigned int Size = fread(Buffer, 1, sizeof(Buffer), FileHandle);
+    fclose(FileHandle);
+
+    /* NOTE(koekeishiya): Load into a copy first, so that a bad file leaves the running
+     * machine alone. */
+    chip8 Loaded = *Processor;
+    if(!Chip8DeserializeState(&Loaded, Buffer, Size))
+        return false;
+
+    *Processor = Loaded;
+    return true;
+}
+
+bool Chip8RewindCreate(chip8_rewind *Rewind, unsigned int PoolSize, unsigned int Capacity,
+                       unsigned int KeyframeInterval)
+{
+    memset(Rewind, 0, sizeof(chip8_rewind));
+    if(KeyframeInterval < 1 || Capacity < 2 * KeyframeInterval || PoolSize < 4 * sizeof(chip8))
+        return false;
+
+    Rewind->Pool = (unsigned char *) malloc(PoolSize);
+    Rewind->Entries = (chip8_rewind_entry *) malloc(Capacity * sizeof(chip8_rewind_entry));
+    Rewind->Scratch = (unsigned char *) malloc(BITMAP_SIZE + STATE_BLOCKS * BLOCK_SIZE);
+    if(!Rewind->Pool || !Rewind->Entries || !Rewind->Scratch)
+    {
+        Chip8RewindDestroy(Rewind);
+        return false;
+    }
+
+    Rewind->PoolSize = PoolSize;
+    Rewind->Capacity = Capacity;
+    Rewind->KeyframeInterval = KeyframeInterval;
+    return true;
+}
+
+void Chip8RewindDestroy(chip8_rewind *Rewind)
+{
+    free(Rewind->Pool);
+    free(Rewind->Entries);
+    free(Rewind->Scratch);
+    memset(Rewind, 0, sizeof(chip8_rewind));
+}
+
+void Chip8RewindClear(chip8_rewind *Rewind)
+{
+    Rewind->First = Rewind->Next;
+    Rewind->Head = 0;
+}
+
+unsigned int Chip8RewindCount(chip8_rewind *Rewind)
+{
+    return (unsigned int)(Rewind->Next - Rewind->First);
+}
+
+internal inline chip8_rewind_entry *
+EntryAt(chip8_rewind *Rewind, unsigned long long Sequence)
+{
+    return Rewind->Entries + (Sequence % Rewind->Capacity);
+}
+
+/* NOTE(koekeishiya): Drop the oldest keyframe and every delta based on it. Refuses to drop
+ * the group of Protect, which a delta that is about to be written depends on. */
+internal bool
+EvictOldest(chip8_rewind *Rewind, unsigned long long Protect)
+{
+    if(Rewind->First == Rewind->Next || Rewind->First == Protect)
+        return false;
+
+    do
+    {
+        ++Rewind->First;
+        ++Rewind->Stats.Evicted;
+    } while(Rewind->First != Rewind->Next && EntryAt(Rewind, Rewind->First)->Keyframe != Rewind->First);
+
+    return true;
+}
+
+/* NOTE(koekeishiya): Reserve Size contiguous bytes after Head, wrapping around to the
+ * start of the pool when the end is reached, and evicting old groups until they fit. */
+internal bool
+Allocate(chip8_rewind *Rewind, unsigned int Size, unsigned long long Protect, unsigned int *Offset)
+{
+    if(Size > Rewind->PoolSize)
+        return false;
+
+    if(Rewind->Next - Rewind->First == Rewind->Capacity && !EvictOldest(Rewind, Protect))
+        return false;
+
+    for(;;)
+    {
+        if(Rewind->First == Rewind->Next)
+        {
+            *Offset = 0;
+            Rewind->Head = Size;
+            return true;
+        }
+
+        unsigned int Head = Rewind->Head;
+        unsigned int Tail = EntryAt(Rewind, Rewind->First)->Offset;
+
+        if(Head > Tail)
+        {
+            if(Head + Size <= Rewind->PoolSize)
+            {
+                *Offset = Head;
+                Rewind->Head = Head + Size;
+                return true;
+            }
+
+            if(Size <= Tail)
+            {
+                *Offset = 0;
+                Rewind->Head = Size;
+                return true;
+            }
+        }
+        else if(Head + Size <= Tail)
+        {
+            *Offset = Head;
+            Rewind->Head = Head + Size;
+            return true;
+        }
+
+        if(!EvictOldest(Rewind, Protect))
+            return false;
+    }
+}
+
+void Chip8RewindPush(chip8_rewind *Rewind, chip8 *Processor)
+{
+    unsigned long long Start = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    unsigned char *State = (unsigned char *) Processor;
+    unsigned long long Sequence = Rewind->Next;
+    chip8_rewind_entry Entry;
+    bool Keyframe = true;
+
+    if(Rewind->First != Rewind->Next)
+    {
+        Entry.Keyframe = EntryAt(Rewind, Sequence - 1)->Keyframe;
+        Keyframe = Sequence - Entry.Keyframe >= Rewind->KeyframeInterval;
+    }
+
+    if(!Keyframe)
+    {
+        /* NOTE(koekeishiya): A bitmap of the blocks that differ from the keyframe, followed
+         * by the contents of those blocks. */
+        unsigned char *Base = Rewind->Pool + EntryAt(Rewind, Entry.Keyframe)->Offset;
+        unsigned char *Bitmap = Rewind->Scratch;
+        unsigned char *Data = Bitmap + BITMAP_SIZE;
+        memset(Bitmap, 0, BITMAP_SIZE);
+
+        for(unsigned int Block = 0; Block < STATE_BLOCKS; ++Block)
+        {
+            unsigned int Offset = Block * BLOCK_SIZE;
+            unsigned int Length = sizeof(chip8) - Offset < BLOCK_SIZE ? sizeof(chip8) - Offset : BLOCK_SIZE;
+            if(memcmp(State + Offset, Base + Offset, Length) != 0)
+            {
+                Bitmap[Block / 8] |= 1 << (Block % 8);
+                memcpy(Data, State + Offset, Length);
+                Data += Length;
+            }
+        }
+
+        Entry.Size = (unsigned int)(Data - Rewind->Scratch);
+        if(Allocate(Rewind, Entry.Size, Entry.Keyframe, &Entry.Offset))
+        {
+            memcpy(Rewind->Pool + Entry.Offset, Rewind->Scratch, Entry.Size);
+            Rewind->Stats.DeltaBytes += Entry.Size;
+        }
+        else
+        {
+            Keyframe = true;
+        }
+    }
+
+    if(Keyframe)
+    {
+        /* NOTE(koekeishiya): The pool is at least four states large, so after evicting
+         * everything a keyframe always fits. */
+        Entry.Keyframe = Sequence;
+        Entry.Size = sizeof(chip8);
+        Allocate(Rewind, Entry.Size, Sequence, &Entry.Offset);
+        memcpy(Rewind->Pool + Entry.Offset, State, Entry.Size);
+        Rewind->Stats.KeyframeBytes += Entry.Size;
+        ++Rewind->Stats.Keyframes;
+    }
+
+    *EntryAt(Rewind, Sequence) = Entry;
+    Rewind->Next = Sequence + 1;
+
+    unsigned long long Elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count() - Start;
+    Rewind->Stats.PushNanos += Elapsed;
+    if(Elapsed > Rewind->Stats.MaxPushNanos)
+        Rewind->Stats.MaxPushNanos = Elapsed;
+    ++Rewind->Stats.Pushes;
+}
+
+bool Chip8RewindRestore(chip8_rewind *Rewind, unsigned int Age, chip8 *Processor)
+{
+    if(Age >= Chip8RewindCount(Rewind))
+        return false;
+
+    unsigned long long Sequence = Rewind->Next - 1 - Age;
+    chip8_rewind_entry *Entry = EntryAt(Rewind, Sequence);
+    chip8_rewind_entry *Keyframe = EntryAt(Rewind, Entry->Keyframe);
+
+    unsigned char Key[16];
+    bool Paused = Processor->Paused;
+    memcpy(Key, Processor->Key, sizeof(Key));
+
+    unsigned char *State = (unsigned char *) Processor;
+    memcpy(State, Rewind->Pool + Keyframe->Offset, sizeof(chip8));
+
+    if(Entry->Keyframe != Sequence)
+    {
+        unsigned char *Bitmap = Rewind->Pool + Entry->Offset;
+        unsigned char *Data = Bitmap + BITMAP_SIZE;
+
+        for(unsigned int Block = 0; Block < STATE_BLOCKS; ++Block)
+        {
+            if(Bitmap[Block / 8] & (1 << (Block % 8)))
+            {
+                unsigned int Offset = Block * BLOCK_SIZE;
+                unsigned int Length = sizeof(chip8) - Offset < BLOCK_SIZE ? sizeof(chip8) - Offset : BLOCK_SIZE;
+                memcpy(State + Offset, Data, Length);
+                Data += Length;
+            }
+        }
+    }
+
+    memcpy(Processor->Key, Key, sizeof(Key));
+    Processor->Paused = Paused;
+    Processor->DirtyRows = 0xFFFFFFFF;
+    return true;
+}
+
+bool Chip8RewindPop(chip8_rewind *Rewind, chip8 *Processor)
+{
+    if(!Chip8RewindRestore(Rewind, 0, Processor))
+        return false;
+
+    --Rewind->Next;
+    if(Rewind->First == Rewind->Next)
+        Rewind->Head = 0;
+    else
+        Rewind->Head = EntryAt(Rewind, Rewind->Next)->Offset;
+
+    return true;
+}
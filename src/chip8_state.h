@@ -0,0 +1,83 @@
+#ifndef CHIP_8_STATE
+#define CHIP_8_STATE
+
+#include "chip8.h"
+
+#define CHIP8_STATE_MAGIC "CH8S"
+#define CHIP8_STATE_VERSION 1
+
+/* NOTE(koekeishiya): Size of a serialized version 1 state, including the 8 byte header. */
+#define CHIP8_STATE_SIZE (8 + 2 + 0x1000 + 2 + 2 + 16 + 8 * DISPLAY_HEIGHT + 2 * 16 + 2 + 1 + 1 + 1 + 8)
+
+/* NOTE(koekeishiya): Write the machine state as a fixed little-endian layout that does not
+ * depend on how struct chip8 is laid out by the compiler. Key, Paused, DirtyRows and the
+ * quirk profile belong to the host and are not saved; a restored state is marked as
+ * entirely dirty. */
+unsigned int Chip8SerializeState(chip8 *Processor, unsigned char *Buffer);
+bool Chip8DeserializeState(chip8 *Processor, unsigned char *Buffer, unsigned int Size);
+
+bool Chip8SaveState(chip8 *Processor, const char *Path);
+bool Chip8LoadState(chip8 *Processor, const char *Path);
+
+struct chip8_rewind_entry
+{
+    unsigned int Offset;
+    unsigned int Size;
+    unsigned long long Keyframe;
+};
+
+struct chip8_rewind_stats
+{
+    unsigned long long Pushes;
+    unsigned long long Keyframes;
+    unsigned long long Evicted;
+    unsigned long long KeyframeBytes;
+    unsigned long long DeltaBytes;
+
+    /* NOTE(koekeishiya): Time spent in Chip8RewindPush, the per-frame snapshot cost. */
+    unsigned long long PushNanos;
+    unsigned long long MaxPushNanos;
+};
+
+/* NOTE(koekeishiya): History of one state per frame in a fixed amount of memory. Every
+ * KeyframeInterval frames the full processor is stored, the frames in between are stored
+ * as the 16 byte blocks that differ from that keyframe. Restoring any frame is one copy
+ * plus one delta. When the pool is full the oldest keyframe is dropped together with the
+ * deltas that depend on it. */
+struct chip8_rewind
+{
+    unsigned char *Pool;
+    unsigned int PoolSize;
+    unsigned int Head;
+
+    chip8_rewind_entry *Entries;
+    unsigned int Capacity;
+    unsigned long long First;
+    unsigned long long Next;
+
+    unsigned int KeyframeInterval;
+    unsigned char *Scratch;
+
+    chip8_rewind_stats Stats;
+};
+
+bool Chip8RewindCreate(chip8_rewind *Rewind, unsigned int PoolSize, unsigned int Capacity,
+                       unsigned int KeyframeInterval);
+void Chip8RewindDestroy(chip8_rewind *Rewind);
+void Chip8RewindClear(chip8_rewind *Rewind);
+
+/* NOTE(koekeishiya): Record the state at the end of a frame. */
+void Chip8RewindPush(chip8_rewind *Rewind, chip8 *Processor);
+
+/* NOTE(koekeishiya): Number of frames that can currently be restored. */
+unsigned int Chip8RewindCount(chip8_rewind *Rewind);
+
+/* NOTE(koekeishiya): Restore the state recorded Age frames ago, 0 being the most recent.
+ * Key and Paused are left as they are. Returns false if that frame is not available. */
+bool Chip8RewindRestore(chip8_rewind *Rewind, unsigned int Age, chip8 *Processor);
+
+/* NOTE(koekeishiya): Restore the most recent frame and forget it, so that holding a rewind
+ * key steps back one frame at a time and recording resumes from there. */
+bool Chip8RewindPop(chip8_rewind *Rewind, chip8 *Processor);
+
+#endif
@@ -0,0 +1,469 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "chip8.h"
+#include "chip8_debug.h"
+#include "chip8_catalogue.h"
+
+#define internal static
+#define global_variable static
+
+/* NOTE(koekeishiya): continue runs at most this many instructions unless told otherwise,
+ * so that a rom that never reaches a breakpoint still answers. */
+#define DEFAULT_CONTINUE 100000000ULL
+
+struct debug_session
+{
+    chip8 Processor;
+    chip8_debugger Debugger;
+    int InstructionsPerFrame;
+    unsigned long long Cycles;
+    FILE *In;
+    FILE *Out;
+};
+
+global_variable const char *WatchNames[4] = { "-", "r", "w", "rw" };
+
+internal void
+PrintUsage()
+{
+    fprintf(stderr, "Usage: chip8-debug [-ipf N] [-seed S] [-quirks Q] [-listen unix:path] rom\n"
+                    "  runs the rom under a debugger driven by one command per line on stdin, or on\n"
+                    "  the first connection to the Unix domain socket with -listen; every reply ends\n"
+                    "  with a line that is either ok or starts with error. Addresses are hex.\n"
+                    "  -ipf N     instructions per 60 Hz timer tick (default: 10)\n"
+                    "  -seed S    random seed (default: 0)\n"
+                    "  -quirks Q  default, chip8, chip48, schip or xochip (default: the profile the\n"
+                    "             quirks.txt next to the rom records, otherwise default)\n");
+    exit(1);
+}
+
+internal void
+PrintHelp(FILE *Out)
+{
+    fprintf(Out, "break ADDR            stop before executing ADDR (b)\n"
+                 "delete ADDR           remove the breakpoint at ADDR\n"
+                 "watch r|w|rw A [B]    stop after an instruction reads or writes A..B (w)\n"
+                 "unwatch N             remove watchpoint N\n"
+                 "list                  breakpoints and watchpoints\n"
+                 "step [N]              execute N instructions (s)\n"
+                 "next                  execute one instruction, running calls to their return (n)\n"
+                 "continue [N]          run until a stop, at most N instructions (c)\n"
+                 "regs                  registers, timers and the stack (r)\n"
+                 "mem ADDR [LEN]        dump memory (x)\n"
+                 "dis [ADDR] [N]        disassemble, from pc by default (d)\n"
+                 "key K 0|1             release or press key K\n"
+                 "screen                the display, # for a lit pixel\n"
+                 "quit                  end the session (q)\n");
+}
+
+internal bool
+ParseHex(const char *Text, unsigned int *Value)
+{
+    if(!Text)
+        return false;
+
+    char *End;
+    unsigned long Parsed = strtoul(Text, &End, 16);
+    if(*End != 0 || Parsed > 0xFFFF)
+        return false;
+
+    *Value = Parsed;
+    return true;
+}
+
+internal unsigned short
+FetchOpcode(chip8 *Processor, unsigned int Address)
+{
+    return Processor->Memory[Address & 0xFFF] << 8 | Processor->Memory[(Address + 1) & 0xFFF];
+}
+
+internal void
+PrintLocation(debug_session *Session)
+{
+    chip8 *Processor = &Session->Processor;
+    unsigned short Opcode = FetchOpcode(Processor, Processor->Pc);
+
+    char Text[32];
+    Chip8Disassemble(Opcode, (chip8_quirks) Processor->Quirks, Text, sizeof(Text));
+    fprintf(Session->Out, "pc=0x%03X %04X %s cycle=%llu\n", Processor->Pc, Opcode, Text, Session->Cycles);
+}
+
+/* NOTE(koekeishiya): Run in pieces that end on timer ticks, so that timers count exactly
+ * as they do in chip8-headless. Only the first piece may resume from a breakpoint. */
+internal chip8_debug_stop
+Run(debug_session *Session, unsigned long long Cycles)
+{
+    chip8_debug_stop Stop = Chip8Stop_Cycles;
+    bool Resume = true;
+
+    while(Cycles > 0)
+    {
+        unsigned long long ToTick = Session->InstructionsPerFrame - Session->Cycles % Session->InstructionsPerFrame;
+        unsigned long long Piece = Cycles < ToTick ? Cycles : ToTick;
+
+        unsigned long long Executed;
+        Stop = Chip8DebugRun(&Session->Debugger, &Session->Processor, Piece, Resume, &Executed);
+        Session->Cycles += Executed;
+        Cycles -= Executed;
+        Resume = false;
+
+        if(Executed && Session->Cycles % Session->InstructionsPerFrame == 0)
+            Chip8TickTimers(&Session->Processor);
+
+        if(Stop != Chip8Stop_Cycles)
+            break;
+    }
+
+    return Stop;
+}
+
+internal void
+ReportStop(debug_session *Session, chip8_debug_stop Stop)
+{
+    chip8_debugger *Debugger = &Session->Debugger;
+    switch(Stop)
+    {
+        case Chip8Stop_Breakpoint: fprintf(Session->Out, "stop breakpoint\n"); break;
+        case Chip8Stop_Return: fprintf(Session->Out, "stop return\n"); break;
+        case Chip8Stop_Cycles: fprintf(Session->Out, "stop cycles\n"); break;
+        case Chip8Stop_Watchpoint:
+        {
+            fprintf(Session->Out, "stop watchpoint %d %s 0x%03X\n", Debugger->HitWatchpoint,
+                    Debugger->HitAccess == Chip8Watch_Read ? "read" : "write", Debugger->HitAddress);
+        } break;
+    }
+
+    PrintLocation(Session);
+}
+
+internal void
+PrintRegisters(debug_session *Session)
+{
+    chip8 *Processor = &Session->Processor;
+    FILE *Out = Session->Out;
+
+    fprintf(Out, "pc=0x%03X i=0x%03X sp=%d dt=%d st=%d\n", Processor->Pc, Processor->I, Processor->Sp,
+            Processor->DelayTimer, Processor->SoundTimer);
+
+    for(int Index = 0; Index < 16; ++Index)
+        fprintf(Out, "V%X=%02X%s", Index, Processor->V[Index], Index == 15 ? "\n" : " ");
+
+    fprintf(Out, "stack:");
+    for(int Index = 0; Index < Processor->Sp && Index < 16; ++Index)
+        fprintf(Out, " 0x%03X", Processor->Stack[Index]);
+    fprintf(Out, "\n");
+}
+
+internal void
+PrintList(debug_session *Session)
+{
+    chip8_debugger *Debugger = &Session->Debugger;
+    for(unsigned int Address = 0; Address < 0x1000; ++Address)
+    {
+        if(Chip8DebugTest(Debugger->Breakpoints, Address))
+            fprintf(Session->Out, "break 0x%03X\n", Address);
+    }
+
+    for(int Index = 0; Index < CHIP8_DEBUG_MAX_WATCHPOINTS; ++Index)
+    {
+        chip8_watchpoint *Watchpoint = Debugger->Watchpoints + Index;
+        if(Watchpoint->Used)
+        {
+            fprintf(Session->Out, "watch %d %s 0x%03X 0x%03X\n", Index, WatchNames[Watchpoint->Access],
+                    Watchpoint->First, Watchpoint->Last);
+        }
+    }
+}
+
+/* NOTE(koekeishiya): Execute one command line. Returns false once the session should end. */
+internal bool
+Execute(debug_session *Session, char *Line)
+{
+    char *Arguments[4] = {};
+    int Count = 0;
+    for(char *Token = strtok(Line, " \t\r\n"); Token && Count < 4; Token = strtok(NULL, " \t\r\n"))
+        Arguments[Count++] = Token;
+
+    if(Count == 0)
+        return true;
+
+    chip8 *Processor = &Session->Processor;
+    chip8_debugger *Debugger = &Session->Debugger;
+    FILE *Out = Session->Out;
+    const char *Command = Arguments[0];
+    const char *Error = NULL;
+    unsigned int A, B;
+
+    if(strcmp(Command, "break") == 0 || strcmp(Command, "b") == 0)
+    {
+        if(ParseHex(Arguments[1], &A) && A < 0x1000)
+            Chip8DebugSetBreakpoint(Debugger, A, true);
+        else
+            Error = "break needs an address below 0x1000";
+    }
+    else if(strcmp(Command, "delete") == 0)
+    {
+        if(ParseHex(Arguments[1], &A) && A < 0x1000 && Chip8DebugTest(Debugger->Breakpoints, A))
+            Chip8DebugSetBreakpoint(Debugger, A, false);
+        else
+            Error = "no breakpoint there";
+    }
+    else if(strcmp(Command, "watch") == 0 || strcmp(Command, "w") == 0)
+    {
+        unsigned char Access = 0;
+        for(int Index = 1; Index < 4; ++Index)
+        {
+            if(Arguments[1] && strcmp(Arguments[1], WatchNames[Index]) == 0)
+                Access = Index;
+        }
+
+        if(!Access || !ParseHex(Arguments[2], &A))
+            Error = "watch needs r, w or rw and an address";
+        else
+        {
+            if(!Arguments[3])
+                B = A;
+            else if(!ParseHex(Arguments[3], &B))
+                Error = "bad end address";
+
+            int Index = Error ? -1 : Chip8DebugAddWatchpoint(Debugger, A, B, Access);
+            if(Index >= 0)
+                fprintf(Out, "watch %d\n", Index);
+            else if(!Error)
+                Error = "bad range or too many watchpoints";
+        }
+    }
+    else if(strcmp(Command, "unwatch") == 0)
+    {
+        if(!Arguments[1] || !Chip8DebugRemoveWatchpoint(Debugger, atoi(Arguments[1])))
+            Error = "no such watchpoint";
+    }
+    else if(strcmp(Command, "list") == 0)
+    {
+        PrintList(Session);
+    }
+    else if(strcmp(Command, "step") == 0 || strcmp(Command, "s") == 0)
+    {
+        unsigned long long Cycles = Arguments[1] ? strtoull(Arguments[1], NULL, 10) : 1;
+        ReportStop(Session, Run(Session, Cycles));
+    }
+    else if(strcmp(Command, "next") == 0 || strcmp(Command, "n") == 0)
+    {
+        if(Chip8DebugStepOver(Debugger, Processor))
+        {
+            chip8_debug_stop Stop = Run(Session, DEFAULT_CONTINUE);
+            Debugger->ReturnPc = Debugger->ReturnSp = -1;
+            ReportStop(Session, Stop);
+        }
+        else
+        {
+            ReportStop(Session, Run(Session, 1));
+        }
+    }
+    else if(strcmp(Command, "continue") == 0 || strcmp(Command, "c") == 0)
+    {
+        unsigned long long Cycles = Arguments[1] ? strtoull(Arguments[1], NULL, 10) : DEFAULT_CONTINUE;
+        ReportStop(Session, Run(Session, Cycles));
+    }
+    else if(strcmp(Command, "regs") == 0 || strcmp(Command, "r") == 0)
+    {
+        PrintRegisters(Session);
+    }
+    else if(strcmp(Command, "mem") == 0 || strcmp(Command, "x") == 0)
+    {
+        unsigned int Length = Arguments[2] ? atoi(Arguments[2]) : 16;
+        if(!ParseHex(Arguments[1], &A) || A >= 0x1000)
+            Error = "mem needs an address below 0x1000";
+        else
+        {
+            for(unsigned int Offset = 0; Offset < Length && A + Offset < 0x1000; Offset += 16)
+            {
+                fprintf(Out, "0x%03X:", A + Offset);
+                for(unsigned int Index = Offset; Index < Offset + 16 && Index < Length && A + Index < 0x1000; ++Index)
+                    fprintf(Out, " %02X", Processor->Memory[A + Index]);
+                fprintf(Out, "\n");
+            }
+        }
+    }
+    else if(strcmp(Command, "dis") == 0 || strcmp(Command, "d") == 0)
+    {
+        A = Processor->Pc;
+        if(Arguments[1] && !ParseHex(Arguments[1], &A))
+            Error = "bad address";
+
+        int Lines = Arguments[2] ? atoi(Arguments[2]) : 10;
+        for(int Index = 0; !Error && Index < Lines; ++Index, A += 2)
+        {
+            unsigned short Opcode = FetchOpcode(Processor, A);
+            char Text[32];
+            Chip8Disassemble(Opcode, (chip8_quirks) Processor->Quirks, Text, sizeof(Text));
+            fprintf(Out, "%s0x%03X %04X %s\n", (A & 0xFFF) == Processor->Pc ? ">" : " ", A & 0xFFF, Opcode, Text);
+        }
+    }
+    else if(strcmp(Command, "key") == 0)
+    {
+        if(ParseHex(Arguments[1], &A) && A < 16 && Arguments[2])
+            Processor->Key[A] = atoi(Arguments[2]) != 0;
+        else
+            Error = "key needs a key 0-F and 0 or 1";
+    }
+    else if(strcmp(Command, "screen") == 0)
+    {
+        for(int Y = 0; Y < DISPLAY_HEIGHT; ++Y)
+        {
+            char Row[DISPLAY_WIDTH + 1];
+            for(int X = 0; X < DISPLAY_WIDTH; ++X)
+                Row[X] = Chip8GetPixel(Processor, X, Y) ? '#' : '.';
+            Row[DISPLAY_WIDTH] = 0;
+            fprintf(Out, "%s\n", Row);
+        }
+    }
+    else if(strcmp(Command, "help") == 0)
+    {
+        PrintHelp(Out);
+    }
+    else if(strcmp(Command, "quit") == 0 || strcmp(Command, "q") == 0)
+    {
+        fprintf(Out, "ok\n");
+        fflush(Out);
+        return false;
+    }
+    else
+    {
+        Error = "unknown command, see help";
+    }
+
+    if(Error)
+        fprintf(Out, "error: %s\n", Error);
+    else
+        fprintf(Out, "ok\n");
+
+    fflush(Out);
+    return true;
+}
+
+/* NOTE(koekeishiya): Accept one connection on a fresh socket at Path. */
+internal int
+ListenSocket(const char *Path)
+{
+    struct sockaddr_un Address;
+    memset(&Address, 0, sizeof(Address));
+    Address.sun_family = AF_UNIX;
+    if(strlen(Path) >= sizeof(Address.sun_path))
+        return -1;
+    strcpy(Address.sun_path, Path);
+
+    int Listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(Listener < 0)
+        return -1;
+
+    unlink(Path);
+    if(bind(Listener, (struct sockaddr *) &Address, sizeof(Address)) != 0 || listen(Listener, 1) != 0)
+    {
+        close(Listener);
+        return -1;
+    }
+
+    fprintf(stderr, "waiting for a debugger on %s\n", Path);
+    int Socket = accept(Listener, NULL, NULL);
+    close(Listener);
+    unlink(Path);
+    return Socket;
+}
+
+int main(int argc, char **argv)
+{
+    debug_session Session;
+    Session.InstructionsPerFrame = 10;
+    Session.Cycles = 0;
+    Session.In = stdin;
+    Session.Out = stdout;
+
+    unsigned long long Seed = 0;
+    chip8_quirks Quirks = Chip8Quirks_Default;
+    bool QuirksGiven = false;
+    const char *ListenPath = NULL;
+    const char *RomPath = NULL;
+
+    for(int Index = 1; Index < argc; ++Index)
+    {
+        const char *Arg = argv[Index];
+        bool HasValue = Index + 1 < argc;
+
+        if(strcmp(Arg, "-ipf") == 0 && HasValue)
+            Session.InstructionsPerFrame = atoi(argv[++Index]);
+        else if(strcmp(Arg, "-seed") == 0 && HasValue)
+            Seed = strtoull(argv[++Index], NULL, 10);
+        else if(strcmp(Arg, "-quirks") == 0 && HasValue)
+        {
+            if(!Chip8QuirksFromName(argv[++Index], &Quirks))
+                PrintUsage();
+            QuirksGiven = true;
+        }
+        else if(strcmp(Arg, "-listen") == 0 && HasValue && strncmp(argv[Index + 1], "unix:", 5) == 0)
+            ListenPath = argv[++Index] + 5;
+        else if(Arg[0] == '-' || RomPath)
+            PrintUsage();
+        else
+            RomPath = Arg;
+    }
+
+    if(!RomPath || Session.InstructionsPerFrame < 1)
+        PrintUsage();
+
+    chip8_catalogue Catalogue;
+    Chip8CatalogueCreate(&Catalogue);
+    if(!Chip8CatalogueAdd(&Catalogue, RomPath) || Catalogue.Count != 1)
+    {
+        fprintf(stderr, "Failed to load rom: %s\n", RomPath);
+        return 1;
+    }
+
+    chip8_rom *Rom = Catalogue.Roms;
+    if(!QuirksGiven)
+        Chip8CatalogueGetQuirks(&Catalogue, Rom, &Quirks);
+
+    chip8 *Processor = &Session.Processor;
+    Chip8Initialize(Processor);
+    Chip8SetQuirks(Processor, Quirks);
+    Chip8Seed(Processor, Seed);
+    if(!Chip8LoadRomImage(Processor, Rom->Data, Rom->Size))
+    {
+        fprintf(stderr, "%s is %u bytes, only %d fit in a chip8\n", RomPath, Rom->Size, CHIP8_ROM_CAPACITY);
+        return 1;
+    }
+
+    Chip8DebugInit(&Session.Debugger);
+
+    if(ListenPath)
+    {
+        int Socket = ListenSocket(ListenPath);
+        if(Socket < 0)
+        {
+            fprintf(stderr, "Failed to listen on %s\n", ListenPath);
+            return 1;
+        }
+
+        Session.In = fdopen(Socket, "r");
+        Session.Out = fdopen(dup(Socket), "w");
+    }
+
+    PrintLocation(&Session);
+    fprintf(Session.Out, "ok\n");
+    fflush(Session.Out);
+
+    char Line[256];
+    while(fgets(Line, sizeof(Line), Session.In))
+    {
+        if(!Execute(&Session, Line))
+            break;
+    }
+
+    Chip8CatalogueDestroy(&Catalogue);
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include <thread>
+#include <vector>
+#include "chip8.h"
+#include "chip8_explore.h"
+
+#define internal static
+
+internal void
+Fatal(const char *Format, ...)
+{
+    va_list Args;
+    va_start(Args, Format);
+    vfprintf(stderr, Format, Args);
+    va_end(Args);
+    exit(1);
+}
+
+internal void
+PrintUsage()
+{
+    Fatal("Usage: chip8-explore [-threads N] [-ipf N] [-depth N] [-states N] [-keys K] [-seed S] [-quirks Q] [-no-idle] [-verify] rom\n"
+          "  -threads N  worker threads (default: all cores)\n"
+          "  -ipf N      instructions per frame (default: 10)\n"
+          "  -depth N    frames to search (default: 30)\n"
+          "  -states N   most unique states to keep (default: 1000000)\n"
+          "  -keys K     keys to try, as hex digits, each alone and none (default: 0123456789ABCDEF)\n"
+          "  -seed S     random seed (default: 0)\n"
+          "  -quirks Q   default, chip8, chip48, schip or xochip (default: default)\n"
+          "  -no-idle    execute idle loops instead of fast-forwarding through them\n"
+          "  -verify     replay the path to the deepest state on a plain interpreter and\n"
+          "              check that it ends up in the same state\n");
+}
+
+internal bool
+SameState(chip8 *A, chip8 *B)
+{
+    return memcmp(A->Memory, B->Memory, sizeof(A->Memory)) == 0 &&
+           memcmp(A->V, B->V, sizeof(A->V)) == 0 &&
+           memcmp(A->Stack, B->Stack, sizeof(A->Stack)) == 0 &&
+           memcmp(A->Graphics, B->Graphics, sizeof(A->Graphics)) == 0 &&
+           A->I == B->I && A->Pc == B->Pc && A->Sp == B->Sp &&
+           A->DelayTimer == B->DelayTimer && A->SoundTimer == B->SoundTimer &&
+           A->RandomState == B->RandomState && A->Quirks == B->Quirks;
+}
+
+int main(int argc, char **argv)
+{
+    chip8_explore_config Config = {};
+    Config.Threads = std::thread::hardware_concurrency();
+    Config.InstructionsPerFrame = 10;
+    Config.SkipIdle = true;
+    Config.MaxDepth = 30;
+    Config.MaxStates = 1000000;
+
+    const char *Keys = "0123456789ABCDEF";
+    unsigned long long Seed = 0;
+    chip8_quirks Quirks = Chip8Quirks_Default;
+    bool Verify = false;
+    const char *Rom = NULL;
+
+    for(int Index = 1; Index < argc; ++Index)
+    {
+        const char *Arg = argv[Index];
+        bool HasValue = Index + 1 < argc;
+
+        if(strcmp(Arg, "-threads") == 0 && HasValue)
+            Config.Threads = atoi(argv[++Index]);
+        else if(strcmp(Arg, "-ipf") == 0 && HasValue)
+            Config.InstructionsPerFrame = atoi(argv[++Index]);
+        else if(strcmp(Arg, "-depth") == 0 && HasValue)
+            Config.MaxDepth = atoi(argv[++Index]);
+        else if(strcmp(Arg, "-states") == 0 && HasValue)
+            Config.MaxStates = strtoull(argv[++Index], NULL, 10);
+        else if(strcmp(Arg, "-keys") == 0 && HasValue)
+            Keys = argv[++Index];
+        else if(strcmp(Arg, "-seed") == 0 && HasValue)
+            Seed = strtoull(argv[++Index], NULL, 10);
+        else if(strcmp(Arg, "-quirks") == 0 && HasValue)
+        {
+            if(!Chip8QuirksFromName(argv[++Index], &Quirks))
+                PrintUsage();
+        }
+        else if(strcmp(Arg, "-no-idle") == 0)
+            Config.SkipIdle = false;
+        else if(strcmp(Arg, "-verify") == 0)
+            Verify = true;
+        else if(Arg[0] == '-' || Rom)
+            PrintUsage();
+        else
+            Rom = Arg;
+    }
+
+    if(!Rom || Config.InstructionsPerFrame < 1 || Config.MaxStates < 1)
+        PrintUsage();
+
+    if(Config.Threads < 1)
+        Config.Threads = 1;
+
+    std::vector<unsigned short> Inputs(1, 0);
+    for(const char *Key = Keys; *Key; ++Key)
+    {
+        char Digit[2] = { *Key, 0 };
+        char *End;
+        unsigned long Value = strtoul(Digit, &End, 16);
+        if(*End)
+            PrintUsage();
+        Inputs.push_back((unsigned short)(1 << Value));
+    }
+
+    Config.Inputs = Inputs.data();
+    Config.InputCount = (int) Inputs.size();
+
+    chip8 *Start = (chip8 *) malloc(sizeof(chip8));
+    Chip8Initialize(Start);
+    Chip8SetQuirks(Start, Quirks);
+    Chip8Seed(Start, Seed);
+    if(!Chip8LoadRom(Start, Rom))
+        Fatal("Failed to load rom: %s\n", Rom);
+
+    chip8_explore *Explore = Chip8ExploreCreate(&Config);
+    chip8_explore_result Result = Chip8ExploreRun(Explore, Start);
+    if(Result.OutOfMemory)
+        Fatal("Out of memory after %llu states\n", Result.States);
+
+    double Seconds = Result.Nanos / 1E9;
+    printf("%s: %u frames deep, %llu unique states, %llu duplicates pruned%s\n",
+           Rom, Result.Depth, Result.States, Result.Duplicates,
+           Result.Truncated ? " (stopped at -states)" : "");
+    printf("expansions: %llu in %.3f s, %.2f M/s on %d threads, %llu steals\n",
+           Result.Expansions, Seconds, Seconds > 0 ? Result.Expansions / Seconds / 1E6 : 0.0,
+           Config.Threads, Result.Steals);
+    printf("memory: %llu chunks copied on write, %.1f MB in arenas, %.0f bytes per state (a chip8 is %zu)\n",
+           Result.Chunks, Result.ArenaBytes / (1024.0 * 1024.0),
+           (double) Result.ArenaBytes / Result.States, sizeof(chip8));
+
+    if(Verify)
+    {
+        chip8_explore_node *Deepest = Result.Found ? Result.Found : Result.Deepest;
+        std::vector<unsigned short> Path(Deepest->Depth + 1);
+        unsigned int Length = Chip8ExplorePath(Deepest, Path.data(), Deepest->Depth);
+
+        chip8 *Expected = (chip8 *) malloc(sizeof(chip8));
+        chip8 *Replayed = (chip8 *) malloc(sizeof(chip8));
+        Chip8ExploreMaterialize(Deepest, Expected);
+
+        Chip8Initialize(Replayed);
+        Chip8SetQuirks(Replayed, Quirks);
+        Chip8Seed(Replayed, Seed);
+        Chip8LoadRom(Replayed, Rom);
+        for(unsigned int Frame = 0; Frame < Length; ++Frame)
+        {
+            for(int Key = 0; Key < 16; ++Key)
+                Replayed->Key[Key] = (Path[Frame] >> Key) & 1;
+
+            for(int Cycle = 0; Cycle < Config.InstructionsPerFrame; ++Cycle)
+                Chip8DoCycle(Replayed);
+            Chip8TickTimers(Replayed);
+        }
+
+        bool Same = SameState(Expected, Replayed);
+        printf("verify: replayed %u frames, %s\n", Length, Same ? "same state" : "MISMATCH");
+        free(Expected);
+        free(Replayed);
+        if(!Same)
+            return 1;
+    }
+
+    Chip8ExploreDestroy(Explore);
+    free(Start);
+    return 0;
+}
@@ -0,0 +1,353 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "chip8_export.h"
+
+#define internal static
+
+internal void
+PrintUsage()
+{
+    fprintf(stderr, "Usage: chip8-frames [-png] [-scale N] stream [directory]\n"
+                    "  decodes a frame stream written by -export into one image per frame, named by\n"
+                    "  its cycle number, or only prints its size without a directory. A stream of\n"
+                    "  unix:/path listens on that Unix domain socket and decodes the first emulator\n"
+                    "  that connects, - reads stdin\n"
+                    "  -png      write png instead of pgm images\n"
+                    "  -scale N  draw every pixel as N x N pixels (default: 1)\n");
+    exit(1);
+}
+
+internal unsigned int
+Crc32(unsigned int Crc, const unsigned char *Data, size_t Size)
+{
+    static unsigned int Table[256];
+    if(!Table[1])
+    {
+        for(unsigned int Index = 0; Index < 256; ++Index)
+        {
+            unsigned int Value = Index;
+            for(int Bit = 0; Bit < 8; ++Bit)
+                Value = (Value & 1) ? 0xEDB88320 ^ (Value >> 1) : Value >> 1;
+            Table[Index] = Value;
+        }
+    }
+
+    Crc = ~Crc;
+    for(size_t Index = 0; Index < Size; ++Index)
+        Crc = Table[(Crc ^ Data[Index]) & 0xFF] ^ (Crc >> 8);
+    return ~Crc;
+}
+
+internal unsigned char *
+PutBig32(unsigned char *At, unsigned int Value)
+{
+    At[0] = (unsigned char)(Value >> 24);
+    At[1] = (unsigned char)(Value >> 16);
+    At[2] = (unsigned char)(Value >> 8);
+    At[3] = (unsigned char) Value;
+    return At + 4;
+}
+
+internal void
+WriteChunk(FILE *File, const char *Type, const unsigned char *Data, unsigned int Size)
+{
+    unsigned char Header[8];
+    PutBig32(Header, Size);
+    memcpy(Header + 4, Type, 4);
+
+    unsigned int Crc = Crc32(0, Header + 4, 4);
+    Crc = Crc32(Crc, Data, Size);
+
+    unsigned char Trailer[4];
+    PutBig32(Trailer, Crc);
+
+    fwrite(Header, 1, 8, File);
+    fwrite(Data, 1, Size, File);
+    fwrite(Trailer, 1, 4, File);
+}
+
+/* NOTE(koekeishiya): An 8-bit greyscale png whose zlib stream only holds stored blocks.
+ * The images are small enough that compressing them is not worth a dependency. */
+internal bool
+WritePng(const char *Path, const unsigned char *Pixels, int Width, int Height)
+{
+    FILE *File = fopen(Path, "wb");
+    if(!File)
+        return false;
+
+    static const unsigned char Signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    fwrite(Signature, 1, sizeof(Signature), File);
+
+    unsigned char Header[13];
+    PutBig32(Header, Width);
+    PutBig32(Header + 4, Height);
+    Header[8] = 8;
+    Header[9] = 0;
+    Header[10] = Header[11] = Header[12] = 0;
+    WriteChunk(File, "IHDR", Header, sizeof(Header));
+
+    size_t Raw = (size_t)(Width + 1) * Height;
+    size_t Blocks = (Raw + 0xFFFE) / 0xFFFF;
+    unsigned char *Data = (unsigned char *) malloc(2 + Raw + Blocks * 5 + 4);
+    unsigned char *At = Data;
+    *At++ = 0x78;
+    *At++ = 0x01;
+
+    unsigned int A = 1, B = 0;
+    size_t Done = 0;
+    int X = 0, Y = 0;
+    while(Done < Raw)
+    {
+        unsigned int Size = Raw - Done < 0xFFFF ? Raw - Done : 0xFFFF;
+        *At++ = Done + Size == Raw;
+        *At++ = (unsigned char) Size;
+        *At++ = (unsigned char)(Size >> 8);
+        *At++ = (unsigned char) ~Size;
+        *At++ = (unsigned char)(~Size >> 8);
+
+        for(unsigned int Index = 0; Index < Size; ++Index)
+        {
+            unsigned char Byte = X == 0 ? 0 : Pixels[Y * Width + X - 1];
+            if(++X > Width)
+            {
+                X = 0;
+                ++Y;
+            }
+
+            *At++ = Byte;
+            A = (A + Byte) % 65521;
+            B = (B + A) % 65521;
+        }
+
+        Done += Size;
+    }
+
+    At = PutBig32(At, (B << 16) | A);
+    WriteChunk(File, "IDAT", Data, At - Data);
+    WriteChunk(File, "IEND", NULL, 0);
+    free(Data);
+
+    return fclose(File) == 0;
+}
+
+internal bool
+WritePgm(const char *Path, const unsigned char *Pixels, int Width, int Height)
+{
+    FILE *File = fopen(Path, "wb");
+    if(!File)
+        return false;
+
+    fprintf(File, "P5\n%d %d\n255\n", Width, Height);
+    fwrite(Pixels, 1, (size_t) Width * Height, File);
+    return fclose(File) == 0;
+}
+
+/* NOTE(koekeishiya): Accept one connection on a fresh socket at Path. */
+internal FILE *
+ListenSocket(const char *Path)
+{
+    struct sockaddr_un Address;
+    memset(&Address, 0, sizeof(Address));
+    Address.sun_family = AF_UNIX;
+    if(strlen(Path) >= sizeof(Address.sun_path))
+        return NULL;
+    strcpy(Address.sun_path, Path);
+
+    int Listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(Listener < 0)
+        return NULL;
+
+    unlink(Path);
+    if(bind(Listener, (struct sockaddr *) &Address, sizeof(Address)) != 0 || listen(Listener, 1) != 0)
+    {
+        close(Listener);
+        return NULL;
+    }
+
+    fprintf(stderr, "waiting for an emulator on %s\n", Path);
+    int Socket = accept(Listener, NULL, NULL);
+    close(Listener);
+    unlink(Path);
+
+    return Socket < 0 ? NULL : fdopen(Socket, "rb");
+}
+
+/* NOTE(koekeishiya): mkdir -p. Succeeds when Path ends up being a directory. */
+internal bool
+CreateDirectory(const char *Path)
+{
+    char Partial[4096];
+    size_t Length = strlen(Path);
+    if(Length == 0 || Length >= sizeof(Partial))
+        return false;
+
+    memcpy(Partial, Path, Length + 1);
+    for(size_t Index = 1; Index <= Length; ++Index)
+    {
+        if(Partial[Index] != '/' && Partial[Index] != 0)
+            continue;
+
+        char Separator = Partial[Index];
+        Partial[Index] = 0;
+        if(mkdir(Partial, 0755) != 0 && errno != EEXIST)
+            return false;
+        Partial[Index] = Separator;
+    }
+
+    struct stat Info;
+    return stat(Path, &Info) == 0 && S_ISDIR(Info.st_mode);
+}
+
+internal bool
+ReadVarint(FILE *File, unsigned long long *Value)
+{
+    *Value = 0;
+    for(int Shift = 0; Shift < 64; Shift += 7)
+    {
+        int Byte = fgetc(File);
+        if(Byte == EOF)
+            return false;
+
+        *Value |= (unsigned long long)(Byte & 0x7F) << Shift;
+        if(!(Byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    bool Png = false;
+    int Scale = 1;
+    const char *StreamPath = NULL;
+    const char *Directory = NULL;
+
+    for(int Index = 1; Index < argc; ++Index)
+    {
+        const char *Arg = argv[Index];
+        if(strcmp(Arg, "-png") == 0)
+            Png = true;
+        else if(strcmp(Arg, "-scale") == 0 && Index + 1 < argc)
+            Scale = atoi(argv[++Index]);
+        else if(Arg[0] == '-' && Arg[1] != 0)
+            PrintUsage();
+        else if(!StreamPath)
+            StreamPath = Arg;
+        else if(!Directory)
+            Directory = Arg;
+        else
+            PrintUsage();
+    }
+
+    if(!StreamPath || Scale < 1)
+        PrintUsage();
+
+    /* NOTE(koekeishiya): Before the stream is opened, so that a listening socket does not
+     * accept an emulator only to fail on the first frame. */
+    if(Directory && !CreateDirectory(Directory))
+    {
+        fprintf(stderr, "Failed to create directory %s\n", Directory);
+        return 1;
+    }
+
+    FILE *File;
+    if(strcmp(StreamPath, "-") == 0)
+        File = stdin;
+    else if(strncmp(StreamPath, "unix:", 5) == 0)
+        File = ListenSocket(StreamPath + 5);
+    else
+        File = fopen(StreamPath, "rb");
+
+    if(!File)
+    {
+        fprintf(stderr, "Failed to open %s\n", StreamPath);
+        return 1;
+    }
+
+    unsigned char Header[CHIP8_EXPORT_HEADER_SIZE];
+    if(fread(Header, 1, sizeof(Header), File) != sizeof(Header) ||
+       memcmp(Header, CHIP8_EXPORT_MAGIC, 4) != 0 || Header[4] != CHIP8_EXPORT_VERSION)
+    {
+        fprintf(stderr, "%s is not a frame stream\n", StreamPath);
+        return 1;
+    }
+
+    int Planes = Header[5];
+    int Width = Header[6] | (Header[7] << 8);
+    int Height = Header[8] | (Header[9] << 8);
+    unsigned int Bytes = Planes * Height * (Width / 8);
+    if(Planes < 1 || Planes > 2 || Width % 64 != 0 || Bytes == 0 || Bytes > CHIP8_EXPORT_MAX_BYTES)
+    {
+        fprintf(stderr, "%s has an unsupported layout: %d planes of %dx%d\n", StreamPath, Planes, Width, Height);
+        return 1;
+    }
+
+    /* NOTE(koekeishiya): The same greys as the window uses for extended roms. */
+    static const unsigned char Palette[4] = { 0x00, 0xFF, 0xAA, 0x55 };
+
+    unsigned char Frame[CHIP8_EXPORT_MAX_BYTES] = {};
+    unsigned char Runs[CHIP8_EXPORT_MAX_BYTES * 2 + 16];
+    unsigned char *Pixels = (unsigned char *) malloc((size_t) Width * Height * Scale * Scale);
+
+    unsigned long long Frames = 0, Total = CHIP8_EXPORT_HEADER_SIZE;
+    unsigned long long Cycle, Length;
+    while(ReadVarint(File, &Cycle))
+    {
+        if(!ReadVarint(File, &Length) || Length > sizeof(Runs) ||
+           fread(Runs, 1, Length, File) != Length || !Chip8ExportApply(Frame, Bytes, Runs, Length))
+        {
+            fprintf(stderr, "%s: record %llu is truncated or malformed\n", StreamPath, Frames);
+            return 1;
+        }
+
+        ++Frames;
+        unsigned char Scratch[20];
+        Total += (Chip8ExportPutVarint(Chip8ExportPutVarint(Scratch, Cycle), Length) - Scratch) + Length;
+
+        if(!Directory)
+            continue;
+
+        int PlaneBytes = Height * Width / 8;
+        for(int Y = 0; Y < Height * Scale; ++Y)
+        {
+            for(int X = 0; X < Width * Scale; ++X)
+            {
+                int Bit = (Y / Scale) * Width + X / Scale;
+                int Colour = 0;
+                for(int Plane = 0; Plane < Planes; ++Plane)
+                {
+                    if(Frame[Plane * PlaneBytes + Bit / 8] & (0x80 >> (Bit % 8)))
+                        Colour |= 1 << Plane;
+                }
+                Pixels[(size_t) Y * Width * Scale + X] = Palette[Colour];
+            }
+        }
+
+        char Path[4096];
+        snprintf(Path, sizeof(Path), "%s/%012llu.%s", Directory, Cycle, Png ? "png" : "pgm");
+
+        bool Written = Png ? WritePng(Path, Pixels, Width * Scale, Height * Scale)
+                           : WritePgm(Path, Pixels, Width * Scale, Height * Scale);
+        if(!Written)
+        {
+            fprintf(stderr, "Failed to write %s\n", Path);
+            return 1;
+        }
+    }
+
+    printf("%s: %llu frames of %dx%d, %d plane%s, %llu bytes, %.1f bytes/frame\n",
+           StreamPath, Frames, Width, Height, Planes, Planes == 1 ? "" : "s", Total,
+           Frames ? (double)(Total - CHIP8_EXPORT_HEADER_SIZE) / Frames : 0.0);
+
+    free(Pixels);
+    if(File != stdin)
+        fclose(File);
+    return 0;
+}
@@ -6,9 +6,21 @@
 #include <time.h>
 #include <unistd.h>
 #include <stdarg.h>
+#include <string.h>
 
-#include <chrono>
+#include <atomic>
+#include <thread>
 #include "chip8.h"
+#include "chip8_engine.h"
+#include "chip8_scheduler.h"
+#include "chip8_state.h"
+#include "chip8_input.h"
+#include "chip8_frame.h"
+#include "chip8_extended.h"
+#include "chip8_catalogue.h"
+#include "chip8_audio.h"
+#include "chip8_export.h"
+#include "chip8_latency.h"
 
 #define internal static
 #define global_variable static
@@ -21,22 +33,59 @@ struct glfw_window_dimension
 };
 
 internal void ResetRom();
-internal unsigned long long GetTimeNanos();
-global_variable long DeltaTime = 1E9 / 400;
-global_variable long CurrentTime = GetTimeNanos();
-global_variable long NewTime = 0;
-global_variable double FrameTime = 0;
 
 global_variable int DISPLAY_MODIFIER = 10;
+global_variable GLuint DisplayTexture;
 global_variable chip8 Processor;
+global_variable chip8_engine Engine;
+global_variable chip8_scheduler Scheduler;
+global_variable chip8_rewind Rewind;
+global_variable chip8_input_recorder Recorder;
 global_variable const char *LoadedRom;
-
-internal unsigned long long
-GetTimeNanos()
-{
-    using namespace std::chrono;
-    return (duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())).count();
-}
+global_variable chip8_catalogue Catalogue;
+global_variable chip8_rom *Image;
+global_variable unsigned long long Seed;
+global_variable chip8_quirks Quirks;
+
+/* NOTE(koekeishiya): Set with -extended, in which case it runs the rom instead of Processor,
+ * always on the interpreter and without rewind, states or recording. */
+global_variable chip8_extended *Extended;
+
+/* NOTE(koekeishiya): The emulation thread is the producer of Audio, Buzzer is what it last
+ * told it. */
+global_variable chip8_audio Audio;
+global_variable bool Buzzer;
+
+/* NOTE(koekeishiya): Set with -export, fed by the emulation thread after every frame. */
+global_variable chip8_export *Export;
+
+/* NOTE(koekeishiya): Key changes are traced from the key callback to the buffer swap. The
+ * emulation thread follows them until they are drawn, the GLFW thread records them once
+ * presented. Not used with -extended. */
+global_variable chip8_latency Latency;
+global_variable chip8_latency_stats LatencyStats;
+
+/* NOTE(koekeishiya): Everything above belongs to the emulation thread once it runs. The
+ * GLFW thread only talks to it through the atomics below and the frame exchange. */
+global_variable std::atomic<unsigned int> KeyState;
+global_variable std::atomic<unsigned long long> KeyNanos;
+global_variable std::atomic<bool> Running;
+global_variable std::atomic<bool> Paused;
+global_variable std::atomic<bool> TurboMode;
+global_variable std::atomic<bool> Rewinding;
+global_variable std::atomic<bool> SaveRequested;
+global_variable std::atomic<bool> LoadRequested;
+global_variable std::atomic<bool> ResetRequested;
+global_variable chip8_frame_exchange FrameExchange;
+
+/* NOTE(koekeishiya): What the display texture currently holds, owned by the GLFW thread. */
+global_variable unsigned long long Uploaded[DISPLAY_HEIGHT];
+global_variable unsigned long long UploadedPlanes[EXTENDED_PLANES][EXTENDED_HEIGHT][EXTENDED_WORDS];
+global_variable bool UploadedValid;
+
+#ifdef CHIP8_PROFILE
+global_variable chip8_profile Profile;
+#endif
 
 internal glfw_window_dimension
 GLFWGetWindowDimension(GLFWwindow *Window)
@@ -59,38 +108,85 @@ GLFWUpdateWindow(GLFWwindow *Window)
     if(error != GL_NO_ERROR)
         printf("OpenGL Error: %d\n", error);
 
-    glfwPollEvents();
     glfwSwapBuffers(Window);
 }
 
+/* NOTE(koekeishiya): KeyNanos holds when the first key change since the last frame
+ * arrived. It is stamped before the change is published so the emulation thread never
+ * sees a change without it. */
 internal void
-GLFWKeyCallback(GLFWwindow *Window, int key, int scancode, int action, int mods)
+SetKey(int Key, int Action)
 {
-    switch(key)
-    {
-        case GLFW_KEY_1: { Processor.Key[0x1] = (action == GLFW_PRESS || action == GLFW_REPEAT); break; }
-        case GLFW_KEY_2: { Processor.Key[0x2] = (action == GLFW_PRESS || action == GLFW_REPEAT); break; }
-        case GLFW_KEY_3: { Processor.Key[0x3] = (action == GLFW_PRESS || action == GLFW_REPEAT); break; }
-        case GLFW_KEY_4: { Processor.Key[0xC] = (action == GLFW_PRESS || action == GLFW_REPEAT); break; }
-
-        case GLFW_KEY_Q: { Processor.Key[0x4] = (action == GLFW_PRESS || action == GLFW_REPEAT); break; }
-        case GLFW_KEY_W: { Processor.Key[0x5] = (action == GLFW_PRESS || action == GLFW_REPEAT); break; }
-        case GLFW_KEY_E: { Processor.Key[0x6] = (action == GLFW_PRESS || action == GLFW_REPEAT); break; }
-        case GLFW_KEY_R: { Processor.Key[0xD] = (action == GLFW_PRESS || action == GLFW_REPEAT); break; }
+    unsigned int Bit = 1u << Key;
+    bool Pressed = Action == GLFW_PRESS || Action == GLFW_REPEAT;
+    if(((KeyState.load(std::memory_order_relaxed) & Bit) != 0) == Pressed)
+        return;
+
+    unsigned long long Expected = 0;
+    KeyNanos.compare_exchange_strong(Expected, Chip8SchedulerNow(), std::memory_order_relaxed);
+
+    if(Pressed)
+        KeyState.fetch_or(Bit, std::memory_order_release);
+    else
+        KeyState.fetch_and(~Bit, std::memory_order_release);
+}
 
-        case GLFW_KEY_A: { Processor.Key[0x7] = (action == GLFW_PRESS || action == GLFW_REPEAT); break; }
-        case GLFW_KEY_S: { Processor.Key[0x8] = (action == GLFW_PRESS || action == GLFW_REPEAT); break; }
-        case GLFW_KEY_D: { Processor.Key[0x9] = (action == GLFW_PRESS || action == GLFW_REPEAT); break; }
-        case GLFW_KEY_F: { Processor.Key[0xE] = (action == GLFW_PRESS || action == GLFW_REPEAT); break; }
+/* NOTE(koekeishiya): Runs on the emulation thread before every frame, so keys change
+ * between frames and the cycle count of the scheduler is an exact timestamp for them. */
+internal void
+ApplyKeys()
+{
+    unsigned char *Current = Extended ? Extended->Key : Processor.Key;
+    unsigned int Keys = KeyState.load(std::memory_order_acquire);
+    unsigned long long Received = KeyNanos.exchange(0, std::memory_order_relaxed);
+    unsigned int Changed = 0;
+    for(int Key = 0; Key < 16; ++Key)
+    {
+        unsigned char Pressed = (Keys >> Key) & 1;
+        if(Current[Key] != Pressed)
+        {
+            Current[Key] = Pressed;
+            Changed |= 1u << Key;
+            Chip8RecordKey(&Recorder, Scheduler.Cycles, Key, Pressed);
+        }
+    }
 
-        case GLFW_KEY_Z: { Processor.Key[0xA] = (action == GLFW_PRESS || action == GLFW_REPEAT); break; }
-        case GLFW_KEY_X: { Processor.Key[0x0] = (action == GLFW_PRESS || action == GLFW_REPEAT); break; }
-        case GLFW_KEY_C: { Processor.Key[0xB] = (action == GLFW_PRESS || action == GLFW_REPEAT); break; }
-        case GLFW_KEY_V: { Processor.Key[0xF] = (action == GLFW_PRESS || action == GLFW_REPEAT); break; }
+    if(Changed && !Extended)
+        Chip8LatencyKeys(&Latency, Changed, Received ? Received : Chip8SchedulerNow());
+}
 
-        case GLFW_KEY_P: { if(action == GLFW_PRESS) Processor.Paused = !Processor.Paused; break; }
-        case GLFW_KEY_ENTER: { ResetRom(); break; }
-        case GLFW_KEY_ESCAPE: { exit(0); break; }
+internal void
+GLFWKeyCallback(GLFWwindow *Window, int key, int scancode, int action, int mods)
+{
+    switch(key)
+    {
+        case GLFW_KEY_1: { SetKey(0x1, action); break; }
+        case GLFW_KEY_2: { SetKey(0x2, action); break; }
+        case GLFW_KEY_3: { SetKey(0x3, action); break; }
+        case GLFW_KEY_4: { SetKey(0xC, action); break; }
+
+        case GLFW_KEY_Q: { SetKey(0x4, action); break; }
+        case GLFW_KEY_W: { SetKey(0x5, action); break; }
+        case GLFW_KEY_E: { SetKey(0x6, action); break; }
+        case GLFW_KEY_R: { SetKey(0xD, action); break; }
+
+        case GLFW_KEY_A: { SetKey(0x7, action); break; }
+        case GLFW_KEY_S: { SetKey(0x8, action); break; }
+        case GLFW_KEY_D: { SetKey(0x9, action); break; }
+        case GLFW_KEY_F: { SetKey(0xE, action); break; }
+
+        case GLFW_KEY_Z: { SetKey(0xA, action); break; }
+        case GLFW_KEY_X: { SetKey(0x0, action); break; }
+        case GLFW_KEY_C: { SetKey(0xB, action); break; }
+        case GLFW_KEY_V: { SetKey(0xF, action); break; }
+
+        case GLFW_KEY_P: { if(action == GLFW_PRESS) Paused = !Paused; break; }
+        case GLFW_KEY_T: { if(action == GLFW_PRESS) TurboMode = !TurboMode; break; }
+        case GLFW_KEY_BACKSPACE: { Rewinding = (action == GLFW_PRESS || action == GLFW_REPEAT); break; }
+        case GLFW_KEY_F5: { if(action == GLFW_PRESS) SaveRequested = true; break; }
+        case GLFW_KEY_F9: { if(action == GLFW_PRESS) LoadRequested = true; break; }
+        case GLFW_KEY_ENTER: { if(action == GLFW_PRESS) ResetRequested = true; break; }
+        case GLFW_KEY_ESCAPE: { glfwSetWindowShouldClose(Window, 1); break; }
     }
 }
 
@@ -124,8 +220,10 @@ GLFWCreateWindow(int Width, int Height, const char *Title)
     glfwSetFramebufferSizeCallback(Window, GLFWWindowSizeCallback);
     glfwSetKeyCallback(Window, GLFWKeyCallback);
 
+    /* NOTE(koekeishiya): Emulation is paced by the scheduler on its own thread, so waiting
+     * for vsync here only delays presenting and never the emulation. */
     glfwMakeContextCurrent(Window);
-    glfwSwapInterval(0);
+    glfwSwapInterval(1);
 
     printf("OpenGL %s\n", glGetString(GL_VERSION));
     glewExperimental = GL_TRUE;
@@ -135,46 +233,495 @@ GLFWCreateWindow(int Width, int Height, const char *Title)
     return Window;
 }
 
-internal inline void
-DrawGraphics()
+/* NOTE(koekeishiya): An extended display is uploaded at its high resolution, with the four
+ * colours of the two planes as shades of grey. */
+internal void
+CreateDisplayTexture()
+{
+    int Width = Extended ? EXTENDED_WIDTH : DISPLAY_WIDTH;
+    int Height = Extended ? EXTENDED_HEIGHT : DISPLAY_HEIGHT;
+
+    glGenTextures(1, &DisplayTexture);
+    glBindTexture(GL_TEXTURE_2D, DisplayTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, Width, Height, 0,
+                 GL_LUMINANCE, GL_UNSIGNED_BYTE, NULL);
+}
+
+/* NOTE(koekeishiya): Upload only the rows that differ from what the texture holds, one
+ * glTexSubImage2D call per run of consecutive changed rows. Frames can be replaced before
+ * they are shown, so the rows are compared instead of trusting DirtyRows of one frame. */
+internal void
+UpdateDisplayTexture(chip8_frame *Frame)
 {
+    unsigned int DirtyRows = 0;
     for(int Y = 0; Y < DISPLAY_HEIGHT; ++Y)
     {
-        for(int X = 0; X < DISPLAY_WIDTH; ++X)
+        if(!UploadedValid || Frame->Graphics[Y] != Uploaded[Y])
+            DirtyRows |= 1u << Y;
+    }
+
+    if(!DirtyRows)
+        return;
+
+    unsigned char Pixels[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+    glBindTexture(GL_TEXTURE_2D, DisplayTexture);
+
+    int Y = 0;
+    while(Y < DISPLAY_HEIGHT)
+    {
+        if(!(DirtyRows & (1u << Y)))
         {
-            if(Processor.Graphics[(Y * DISPLAY_WIDTH) + X] == 0)
-                glColor3f(0.0f ,0.0f ,0.0f);
-            else
-                glColor3f(1.0f, 1.0f, 1.0f);
+            ++Y;
+            continue;
+        }
+
+        int First = Y;
+        while(Y < DISPLAY_HEIGHT && (DirtyRows & (1u << Y)))
+        {
+            unsigned char *Row = Pixels + Y * DISPLAY_WIDTH;
+            unsigned long long Line = Frame->Graphics[Y];
+            for(int X = 0; X < DISPLAY_WIDTH; ++X)
+                Row[X] = ((Line >> (DISPLAY_WIDTH - 1 - X)) & 1) ? 0xFF : 0x00;
+
+            Uploaded[Y] = Line;
+            ++Y;
+        }
+
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, First, DISPLAY_WIDTH, Y - First,
+                        GL_LUMINANCE, GL_UNSIGNED_BYTE, Pixels + First * DISPLAY_WIDTH);
+    }
+
+    UploadedValid = true;
+}
+
+internal void
+UpdateExtendedTexture(chip8_frame *Frame)
+{
+    local_persist const unsigned char Palette[4] = { 0x00, 0xFF, 0xAA, 0x55 };
+
+    unsigned long long DirtyRows = 0;
+    for(int Y = 0; Y < EXTENDED_HEIGHT; ++Y)
+    {
+        for(int Plane = 0; Plane < EXTENDED_PLANES; ++Plane)
+        {
+            if(!UploadedValid || memcmp(Frame->Planes[Plane][Y], UploadedPlanes[Plane][Y], sizeof(UploadedPlanes[Plane][Y])) != 0)
+                DirtyRows |= 1ULL << Y;
+        }
+    }
+
+    if(!DirtyRows)
+        return;
+
+    unsigned char Pixels[EXTENDED_WIDTH * EXTENDED_HEIGHT];
+    glBindTexture(GL_TEXTURE_2D, DisplayTexture);
+
+    int Y = 0;
+    while(Y < EXTENDED_HEIGHT)
+    {
+        if(!(DirtyRows & (1ULL << Y)))
+        {
+            ++Y;
+            continue;
+        }
+
+        int First = Y;
+        while(Y < EXTENDED_HEIGHT && (DirtyRows & (1ULL << Y)))
+        {
+            unsigned char *Row = Pixels + Y * EXTENDED_WIDTH;
+            for(int X = 0; X < EXTENDED_WIDTH; ++X)
+            {
+                int Word = X / 64;
+                int Shift = 63 - (X % 64);
+                int Colour = ((Frame->Planes[0][Y][Word] >> Shift) & 1) |
+                             (((Frame->Planes[1][Y][Word] >> Shift) & 1) << 1);
+                Row[X] = Palette[Colour];
+            }
 
-            glBegin(GL_QUADS);
-            glVertex3f((X * DISPLAY_MODIFIER), (Y * DISPLAY_MODIFIER), 0.0f);
-            glVertex3f((X * DISPLAY_MODIFIER), (Y * DISPLAY_MODIFIER) + DISPLAY_MODIFIER, 0.0f);
-            glVertex3f((X * DISPLAY_MODIFIER) + DISPLAY_MODIFIER, (Y * DISPLAY_MODIFIER) + DISPLAY_MODIFIER, 0.0f);
-            glVertex3f((X * DISPLAY_MODIFIER) + DISPLAY_MODIFIER, (Y * DISPLAY_MODIFIER) + 0.0f, 0.0f);
-            glEnd();
+            for(int Plane = 0; Plane < EXTENDED_PLANES; ++Plane)
+                memcpy(UploadedPlanes[Plane][Y], Frame->Planes[Plane][Y], sizeof(UploadedPlanes[Plane][Y]));
+            ++Y;
         }
+
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, First, EXTENDED_WIDTH, Y - First,
+                        GL_LUMINANCE, GL_UNSIGNED_BYTE, Pixels + First * EXTENDED_WIDTH);
+    }
+
+    UploadedValid = true;
+}
+
+internal void
+DrawDisplay()
+{
+    float Width = DISPLAY_WIDTH * DISPLAY_MODIFIER;
+    float Height = DISPLAY_HEIGHT * DISPLAY_MODIFIER;
+
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, DisplayTexture);
+    glColor3f(1.0f, 1.0f, 1.0f);
+
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.0f, 0.0f); glVertex3f(0.0f, 0.0f, 0.0f);
+    glTexCoord2f(0.0f, 1.0f); glVertex3f(0.0f, Height, 0.0f);
+    glTexCoord2f(1.0f, 1.0f); glVertex3f(Width, Height, 0.0f);
+    glTexCoord2f(1.0f, 0.0f); glVertex3f(Width, 0.0f, 0.0f);
+    glEnd();
+
+    glDisable(GL_TEXTURE_2D);
+}
+
+/* NOTE(koekeishiya): A log only describes one uninterrupted run from the start of the rom,
+ * so resetting, rewinding or loading a state ends it. */
+internal void
+StopRecording()
+{
+    if(Recorder.File)
+    {
+        if(Chip8RecorderClose(&Recorder, Scheduler.Cycles, Chip8GraphicsHash(&Processor)))
+            printf("Recording stopped after %llu cycles\n", Scheduler.Cycles);
+        else
+            printf("Recording stopped after %llu cycles, but writing the log failed\n", Scheduler.Cycles);
     }
 }
 
 internal void
 ResetRom()
 {
+    StopRecording();
+    Seed = time(NULL);
+
+    if(Extended)
+    {
+        Chip8ExtendedInitialize(Extended);
+        Chip8ExtendedSetQuirks(Extended, Quirks);
+        Chip8ExtendedSeed(Extended, Seed);
+        if(!Chip8ExtendedLoadRomImage(Extended, Image->Data, Image->Size))
+            Fatal("%s is %u bytes, only %d fit in the extended machine\n", LoadedRom, Image->Size, EXTENDED_ROM_CAPACITY);
+
+        Scheduler.Cycles = 0;
+        return;
+    }
+
     Chip8Initialize(&Processor);
-    if(!Chip8LoadRom(&Processor, LoadedRom))
-        Fatal("Failed to load rom: %s\n", LoadedRom);
+    Chip8SetQuirks(&Processor, Quirks);
+    Chip8Seed(&Processor, Seed);
+
+#ifdef CHIP8_PROFILE
+    Processor.Profile = &Profile;
+#endif
+    if(!Chip8LoadRomImage(&Processor, Image->Data, Image->Size))
+        Fatal("%s is %u bytes, only %d fit in a chip8, see -extended\n", LoadedRom, Image->Size, CHIP8_ROM_CAPACITY);
+
+    Chip8EngineReset(&Engine);
+    Chip8RewindClear(&Rewind);
+    Scheduler.Cycles = 0;
+}
+
+/* NOTE(koekeishiya): The state file lives next to the rom, as rom.state. */
+internal void
+SaveOrLoadState()
+{
+    if(Extended)
+    {
+        SaveRequested = LoadRequested = false;
+        return;
+    }
+
+    char Path[4096];
+    snprintf(Path, sizeof(Path), "%s.state", LoadedRom);
+
+    if(SaveRequested.exchange(false))
+    {
+        if(!Chip8SaveState(&Processor, Path))
+            printf("Failed to save state: %s\n", Path);
+    }
+
+    if(LoadRequested.exchange(false))
+    {
+        if(Chip8LoadState(&Processor, Path))
+        {
+            StopRecording();
+            Chip8EngineReset(&Engine);
+            Chip8RewindClear(&Rewind);
+        }
+        else
+        {
+            printf("Failed to load state: %s\n", Path);
+        }
+    }
+}
+
+/* NOTE(koekeishiya): Hand the framebuffer to the GLFW thread and wake it up. */
+internal void
+PublishFrame()
+{
+    chip8_frame *Frame = Chip8FrameBack(&FrameExchange);
+    Frame->Extended = Extended != NULL;
+    if(Extended)
+    {
+        memcpy(Frame->Planes, Extended->Planes, sizeof(Frame->Planes));
+        Extended->DirtyRows = 0;
+    }
+    else
+    {
+        memcpy(Frame->Graphics, Processor.Graphics, sizeof(Frame->Graphics));
+        Processor.DirtyRows = 0;
+    }
+
+    Frame->Sequence = Scheduler.Stats.Frames;
+    Frame->Trace = Latency.Drawn;
+    Chip8FramePublish(&FrameExchange);
+    glfwPostEmptyEvent();
+}
+
+/* NOTE(koekeishiya): The extended counterpart of Chip8SchedulerRunFrame, without idle
+ * detection since that only understands a chip8. */
+internal void
+RunExtendedFrame()
+{
+    Scheduler.Cycles += Scheduler.InstructionsPerFrame;
+    Chip8ExtendedRunCycles(Extended, Scheduler.InstructionsPerFrame);
+    Scheduler.Sounding = Extended->SoundTimer > 0;
+    Chip8ExtendedTickTimers(Extended);
+    ++Scheduler.Stats.Frames;
+}
+
+/* NOTE(koekeishiya): Only changes go to the audio thread, stamped with the start of the
+ * frame that caused them. */
+internal void
+UpdateBuzzer(bool Sounding, unsigned long long FrameStart)
+{
+    if(Sounding != Buzzer)
+    {
+        Chip8AudioPush(&Audio, Sounding, FrameStart);
+        Buzzer = Sounding;
+    }
+}
+
+internal void
+ExportFrame()
+{
+    if(!Export)
+        return;
+
+    if(Extended)
+        Chip8ExportFrame(Export, &Extended->Planes[0][0][0], Scheduler.Cycles);
+    else
+        Chip8ExportFrame(Export, Processor.Graphics, Scheduler.Cycles);
+}
+
+/* NOTE(koekeishiya): One iteration per emulated frame: take the requests of the GLFW
+ * thread, run the frames that are due, publish the result, then sleep until the next
+ * frame. A paused machine keeps the normal pace so that it does not spin. */
+internal void
+EmulationThread()
+{
+    while(Running.load(std::memory_order_relaxed))
+    {
+        if(ResetRequested.exchange(false))
+            ResetRom();
+
+        Processor.Paused = Paused;
+        bool Turbo = TurboMode && !Processor.Paused;
+        if(Turbo != Scheduler.Turbo)
+        {
+            Scheduler.Turbo = Turbo;
+            Chip8SchedulerResync(&Scheduler);
+        }
+
+        if(SaveRequested || LoadRequested)
+            SaveOrLoadState();
+
+        /* NOTE(koekeishiya): While rewinding, every due frame steps one recorded frame back
+         * instead of running forwards. */
+        int Frames = Chip8SchedulerFramesDue(&Scheduler);
+        if(Processor.Paused)
+            UpdateBuzzer(false, Chip8SchedulerNow());
+
+        while(!Processor.Paused && Frames-- > 0)
+        {
+            unsigned long long FrameStart = Chip8SchedulerNow();
+            if(Extended)
+            {
+                ApplyKeys();
+                RunExtendedFrame();
+                UpdateBuzzer(Scheduler.Sounding, FrameStart);
+                ExportFrame();
+                continue;
+            }
+
+            if(Rewinding)
+            {
+                UpdateBuzzer(false, FrameStart);
+                StopRecording();
+                if(Chip8RewindPop(&Rewind, &Processor))
+                    Chip8EngineReset(&Engine);
+                ExportFrame();
+                continue;
+            }
+
+            ApplyKeys();
+
+            Chip8SchedulerRunFrame(&Scheduler, &Engine, &Processor);
+            Chip8LatencyFrame(&Latency, &Processor, Chip8SchedulerNow());
+            UpdateBuzzer(Scheduler.Sounding, FrameStart);
+            ExportFrame();
+            Chip8RewindPush(&Rewind, &Processor);
+
+            if(Recorder.File && Scheduler.Stats.Frames % CHIP8_TIMER_HZ == 0)
+                Chip8RecordCheckpoint(&Recorder, Scheduler.Cycles, Chip8GraphicsHash(&Processor));
+        }
+
+        bool Dirty = Extended ? Extended->DirtyRows != 0 : Processor.DirtyRows != 0;
+        if(Dirty && Chip8SchedulerShouldPresent(&Scheduler))
+            PublishFrame();
+
+        Chip8SchedulerWait(&Scheduler);
+    }
+
+    UpdateBuzzer(false, Chip8SchedulerNow());
+    StopRecording();
+}
+
+internal void
+PrintUsage()
+{
+    Fatal("Usage: chip8 [-ipf N] [-engine E] [-quirks Q] [-extended] [-turbo] [-record log]\n"
+          "             [-audio A] [-export F] /path/to/rom\n"
+          "  Backspace rewinds while held, F5 saves to rom.state and F9 loads it.\n"
+          "  -ipf N     instructions per 60 Hz frame (default: 10)\n"
+          "  -engine E  interpreter, cached, fused, jit or jit-lockstep (default: interpreter)\n"
+          "  -quirks Q  default, chip8, chip48, schip or xochip (default: the profile in the\n"
+          "             quirks.txt next to the rom or in its archive, otherwise default)\n"
+          "  -extended  run SUPER-CHIP and XO-CHIP roms, on the interpreter without rewind,\n"
+          "             states or recording\n"
+          "  -turbo     start in turbo mode, toggled with T\n"
+          "  -record L  record keys with cycle stamps to L, for chip8-headless -replay\n"
+          "  -audio A   device, null, or a .wav file to write the buzzer to (default: device,\n"
+          "             or null if there is no audio device)\n"
+          "  -export F  stream every changed frame to the file F, or to the Unix domain\n"
+          "             socket P with unix:P, for chip8-frames\n");
 }
 
 int main(int argc, char **argv)
 {
-    if(argc != 2)
-        Fatal("Usage: chip8 /path/to/rom\n");
+    int InstructionsPerFrame = 10;
+    const char *RecordPath = NULL;
+    chip8_engine_type EngineType = Chip8Engine_Interpreter;
+    bool UseExtended = false;
+    bool QuirksGiven = false;
+    chip8_audio_backend AudioBackend = Chip8Audio_Device;
+    const char *AudioPath = NULL;
+    const char *ExportPath = NULL;
+
+    for(int Index = 1; Index < argc; ++Index)
+    {
+        const char *Arg = argv[Index];
+        bool HasValue = Index + 1 < argc;
 
-    LoadedRom = argv[1];
-    Chip8Initialize(&Processor);
-    if(!Chip8LoadRom(&Processor, LoadedRom))
+        if(strcmp(Arg, "-ipf") == 0 && HasValue)
+            InstructionsPerFrame = atoi(argv[++Index]);
+        else if(strcmp(Arg, "-engine") == 0 && HasValue)
+        {
+            if(!Chip8EngineFromName(argv[++Index], &EngineType))
+                PrintUsage();
+        }
+        else if(strcmp(Arg, "-quirks") == 0 && HasValue)
+        {
+            if(!Chip8QuirksFromName(argv[++Index], &Quirks))
+                PrintUsage();
+            QuirksGiven = true;
+        }
+        else if(strcmp(Arg, "-extended") == 0)
+            UseExtended = true;
+        else if(strcmp(Arg, "-turbo") == 0)
+            TurboMode = true;
+        else if(strcmp(Arg, "-record") == 0 && HasValue)
+            RecordPath = argv[++Index];
+        else if(strcmp(Arg, "-audio") == 0 && HasValue)
+        {
+            const char *Value = argv[++Index];
+            size_t Length = strlen(Value);
+            if(Length > 4 && strcmp(Value + Length - 4, ".wav") == 0)
+            {
+                AudioBackend = Chip8Audio_Wav;
+                AudioPath = Value;
+            }
+            else if(!Chip8AudioFromName(Value, &AudioBackend) || AudioBackend == Chip8Audio_Wav)
+                PrintUsage();
+        }
+        else if(strcmp(Arg, "-export") == 0 && HasValue)
+            ExportPath = argv[++Index];
+        else if(Arg[0] == '-' || LoadedRom)
+            PrintUsage();
+        else
+            LoadedRom = Arg;
+    }
+
+    if(!LoadedRom || InstructionsPerFrame < 1)
+        PrintUsage();
+
+    if(RecordPath && InstructionsPerFrame > 0xFFFF)
+        Fatal("-record stores -ipf in 16 bits, %d is too large\n", InstructionsPerFrame);
+
+    /* NOTE(koekeishiya): The rom stays mapped, so resetting never touches the disk. */
+    Chip8CatalogueCreate(&Catalogue);
+    if(!Chip8CatalogueAdd(&Catalogue, LoadedRom))
         Fatal("Failed to load rom: %s\n", LoadedRom);
 
+    for(unsigned int Index = 0; Index < Catalogue.SkippedCount; ++Index)
+        fprintf(stderr, "Skipped %s: it %s\n", Catalogue.Skipped[Index].Path, Catalogue.Skipped[Index].Reason);
+
+    if(Catalogue.Count != 1)
+        Fatal("%s holds %u roms, the emulator runs one\n", LoadedRom, Catalogue.Count);
+
+    Image = Catalogue.Roms;
+    if(!QuirksGiven)
+        Chip8CatalogueGetQuirks(&Catalogue, Image, &Quirks);
+
+    if(UseExtended)
+    {
+        if(EngineType != Chip8Engine_Interpreter || RecordPath)
+            Fatal("-extended only runs on the interpreter and cannot be recorded\n");
+
+        Extended = (chip8_extended *) malloc(sizeof(chip8_extended));
+        if(!Extended)
+            Fatal("Failed to allocate extended machine\n");
+    }
+
+    if(!Chip8EngineCreate(&Engine, EngineType))
+        Fatal("Failed to create %s engine\n", Chip8EngineName(EngineType));
+
+    /* NOTE(koekeishiya): 16 MB holds well over ten minutes of typical play, the entry
+     * table caps history at ten minutes. */
+    if(!Chip8RewindCreate(&Rewind, 16 << 20, 10 * 60 * CHIP8_TIMER_HZ, CHIP8_TIMER_HZ))
+        Fatal("Failed to create rewind buffer\n");
+
+#ifdef CHIP8_PROFILE
+    Chip8ProfileBegin(&Profile);
+#endif
+
+    ResetRom();
+    Chip8SchedulerInit(&Scheduler, InstructionsPerFrame);
+    Chip8LatencyInit(&Latency, 0);
+    if(!Extended)
+        Scheduler.Latency = &Latency;
+
+    if(RecordPath)
+    {
+        chip8_input_header Header;
+        Header.InstructionsPerFrame = InstructionsPerFrame;
+        Header.Seed = Seed;
+        Header.RomHash = Chip8RomHash(&Processor);
+        Header.Quirks = Quirks;
+        if(!Chip8RecorderOpen(&Recorder, RecordPath, &Header))
+            Fatal("Failed to open %s for recording\n", RecordPath);
+    }
+
     glfw_window_dimension Dimension = { DISPLAY_WIDTH * DISPLAY_MODIFIER,
                                         DISPLAY_HEIGHT * DISPLAY_MODIFIER };
     GLFWwindow *Window = GLFWCreateWindow(Dimension.Width, Dimension.Height, "Chip-8 Emulator");
@@ -186,43 +733,151 @@ int main(int argc, char **argv)
     glMatrixMode(GL_MODELVIEW);
     glViewport(0, 0, Dimension.Width, Dimension.Height);
 
-    while(!glfwWindowShouldClose(Window))
+    CreateDisplayTexture();
+    Chip8FrameExchangeInit(&FrameExchange);
+
+    if(!Chip8AudioOpen(&Audio, AudioBackend, AudioPath))
     {
-        NewTime = GetTimeNanos();
-        FrameTime += NewTime - CurrentTime;
-        CurrentTime = NewTime;
+        if(AudioBackend != Chip8Audio_Device)
+            Fatal("Failed to open %s audio output %s\n", Chip8AudioName(AudioBackend), AudioPath ? AudioPath : "");
 
-        while(FrameTime >= DeltaTime)
-        {
-            if(!Processor.Paused)
-            {
-                if(Processor.DelayTimer == 0)
-                    Chip8DoCycle(&Processor);
+        printf("No audio device, the buzzer is silent\n");
+        Chip8AudioOpen(&Audio, Chip8Audio_Null, NULL);
+    }
 
-                if(Processor.DelayTimer > 0)
-                    --Processor.DelayTimer;
+    if(!Chip8AudioStart(&Audio))
+        Fatal("Failed to start %s audio output\n", Chip8AudioName(Audio.Backend));
 
-                if(Processor.SoundTimer > 0)
-                {
-                    if(Processor.SoundTimer == 1)
-                        printf("Make buzzer sound!\n");
+    if(ExportPath)
+    {
+        Export = Extended ? Chip8ExportOpen(ExportPath, EXTENDED_PLANES, EXTENDED_WIDTH, EXTENDED_HEIGHT)
+                          : Chip8ExportOpen(ExportPath, 1, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+        if(!Export)
+            Fatal("Failed to open %s for exporting frames\n", ExportPath);
 
-                    --Processor.SoundTimer;
-                }
+        Chip8ExportStart(Export);
+    }
+
+    Running = true;
+    std::thread Emulation(EmulationThread);
+
+    /* NOTE(koekeishiya): The GLFW thread only handles input and presents frames. It sleeps
+     * in glfwWaitEvents until there is input or the emulation thread published a frame. */
+    unsigned long long NextTitle = Chip8SchedulerNow() + 1000000000ULL;
+    chip8_frame_stats Last = {};
+    while(!glfwWindowShouldClose(Window))
+    {
+        glfwWaitEvents();
+
+        chip8_frame *Frame = Chip8FrameAcquire(&FrameExchange);
+        if(Frame)
+        {
+            if(Frame->Extended)
+                UpdateExtendedTexture(Frame);
+            else
+                UpdateDisplayTexture(Frame);
+            GLFWClearWindow();
+            DrawDisplay();
+            GLFWUpdateWindow(Window);
+            Chip8FramePresented(&FrameExchange, Frame);
+            Chip8LatencyRecord(&LatencyStats, &Frame->Trace, Chip8SchedulerNow());
+        }
 
-                if(Processor.Draw)
+        /* NOTE(koekeishiya): Show the average handoff of the last second in the title, and
+         * the input latency over the newest key changes. */
+        unsigned long long Now = Chip8SchedulerNow();
+        if(Now >= NextTitle)
+        {
+            chip8_frame_stats *Stats = &FrameExchange.Stats;
+            unsigned long long Frames = Stats->Acquired - Last.Acquired;
+            if(Frames)
+            {
+                char Title[192];
+                int Length = snprintf(Title, sizeof(Title), "Chip-8 Emulator - handoff %.2f ms, present %.2f ms",
+                                      (Stats->HandoffNanos - Last.HandoffNanos) / 1E6 / Frames,
+                                      (Stats->PresentNanos - Last.PresentNanos) / 1E6 / Frames);
+                if(LatencyStats.Count)
                 {
-                    GLFWClearWindow();
-                    DrawGraphics();
-                    Processor.Draw = false;
+                    snprintf(Title + Length, sizeof(Title) - Length, ", input p50 %.1f ms, p99 %.1f ms",
+                             Chip8LatencyPercentile(&LatencyStats, Chip8Latency_Total, 50) / 1E6,
+                             Chip8LatencyPercentile(&LatencyStats, Chip8Latency_Total, 99) / 1E6);
                 }
+                glfwSetWindowTitle(Window, Title);
             }
 
-            GLFWUpdateWindow(Window);
-            FrameTime -= DeltaTime;
+            Last = *Stats;
+            NextTitle = Now + 1000000000ULL;
         }
     }
 
+    Running = false;
+    Emulation.join();
+    Chip8AudioClose(&Audio);
+
+    if(Export)
+    {
+        chip8_export_stats ExportStats = Chip8ExportClose(Export);
+        printf("export: %llu frames, %llu dropped, %.1f bytes/frame%s\n",
+               ExportStats.Pushed, ExportStats.Dropped,
+               ExportStats.Written ? (double) ExportStats.Bytes / ExportStats.Written : 0.0,
+               ExportStats.Failed ? ", writing failed" : "");
+    }
+
+    chip8_audio_stats AudioStats = Chip8AudioGetStats(&Audio);
+    if(AudioStats.Events)
+    {
+        printf("audio: %s, %llu buzzer changes, %llu dropped, latency %.2f ms avg, %.2f ms max\n",
+               Chip8AudioName(Audio.Backend), AudioStats.Events, AudioStats.Dropped,
+               AudioStats.LatencyNanos / 1E6 / AudioStats.Events, AudioStats.MaxLatencyNanos / 1E6);
+    }
+
+    chip8_frame_stats FrameStats = Chip8FrameGetStats(&FrameExchange);
+    if(FrameStats.Acquired)
+    {
+        printf("frames: %llu published, %llu shown, %llu replaced before shown, handoff %.2f ms avg, %.2f ms max, "
+               "present %.2f ms avg, %.2f ms max\n",
+               FrameStats.Published, FrameStats.Acquired, FrameStats.Replaced,
+               FrameStats.HandoffNanos / 1E6 / FrameStats.Acquired, FrameStats.MaxHandoffNanos / 1E6,
+               FrameStats.PresentNanos / 1E6 / FrameStats.Acquired, FrameStats.MaxPresentNanos / 1E6);
+    }
+
+    if(Latency.Started)
+    {
+        printf("latency: %llu key changes, %llu presented, %llu not read, %llu not drawn, %llu superseded\n",
+               Latency.Started, LatencyStats.Count, Latency.Unobserved, Latency.Undrawn, Latency.Superseded);
+        for(int Stage = 0; Stage < Chip8Latency_StageCount && LatencyStats.Count; ++Stage)
+        {
+            printf("  %-8s p50 %.2f ms, p99 %.2f ms\n", Chip8LatencyStageName((chip8_latency_stage) Stage),
+                   Chip8LatencyPercentile(&LatencyStats, (chip8_latency_stage) Stage, 50) / 1E6,
+                   Chip8LatencyPercentile(&LatencyStats, (chip8_latency_stage) Stage, 99) / 1E6);
+        }
+    }
+
+    chip8_rewind_stats *Stats = &Rewind.Stats;
+    if(Stats->Pushes)
+    {
+        printf("rewind: %llu frames, %.0f bytes/frame, snapshot %.2f us avg, %.2f us max\n",
+               Stats->Pushes, (double)(Stats->KeyframeBytes + Stats->DeltaBytes) / Stats->Pushes,
+               Stats->PushNanos / 1E3 / Stats->Pushes, Stats->MaxPushNanos / 1E3);
+    }
+
+#ifdef CHIP8_PROFILE
+    /* NOTE(koekeishiya): The profile covers the whole session, across resets. */
+    Chip8ProfileEnd(&Profile);
+    Chip8ProfileWriteText(&Profile, stdout);
+
+    FILE *ProfileFile = fopen("chip8-profile.json", "w");
+    if(ProfileFile)
+    {
+        Chip8ProfileWriteJson(&Profile, ProfileFile);
+        fclose(ProfileFile);
+    }
+#endif
+
+    Chip8RewindDestroy(&Rewind);
+    Chip8EngineDestroy(&Engine);
+    free(Extended);
+    Chip8CatalogueDestroy(&Catalogue);
     glfwTerminate();
     return 0;
 }
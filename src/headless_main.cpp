@@ -0,0 +1,929 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "chip8.h"
+#include "chip8_engine.h"
+#include "chip8_batch.h"
+#include "chip8_state.h"
+#include "chip8_input.h"
+#include "chip8_aot.h"
+#include "chip8_cache.h"
+#include "chip8_extended.h"
+#include "chip8_catalogue.h"
+#include "chip8_audio.h"
+#include "chip8_export.h"
+#include "chip8_latency.h"
+
+#define internal static
+#define global_variable static
+
+#define NANOS_PER_FRAME (1000000000ULL / 60)
+
+/* NOTE(koekeishiya): How long -latency holds every key down, and then up. */
+#define LATENCY_HOLD_FRAMES 20
+
+struct headless_instance
+{
+    const char *Rom;
+    int Copy;
+    chip8 Processor;
+    chip8_engine Engine;
+
+    /* NOTE(koekeishiya): Set with -extended, in which case it runs instead of Processor. */
+    chip8_extended *Extended;
+
+    unsigned long long Cycles;
+    unsigned long long IdleCycles;
+    chip8_rewind_stats RewindStats;
+    unsigned long long RestoreNanos;
+    unsigned long long Restores;
+    chip8_replay_result Replay;
+
+#ifdef CHIP8_PROFILE
+    chip8_profile *Profile;
+#endif
+};
+
+/* NOTE(koekeishiya): A unit of work for one thread, either a single instance or, with the
+ * batch engine, up to CHIP8_BATCH_LANES instances of the same rom. */
+struct headless_job
+{
+    int First;
+    int Count;
+    chip8_batch_stats BatchStats;
+};
+
+struct headless_options
+{
+    int Threads;
+    int Copies;
+    int InstructionsPerFrame;
+    unsigned long long Cycles;
+    unsigned long long Seed;
+    chip8_engine_type Engine;
+    chip8_quirks Quirks;
+    bool QuirksForced;
+    bool Batch;
+    bool Extended;
+    bool SkipIdle;
+    bool Rewind;
+    chip8_input_log *Replay;
+    const char *ProfilePath;
+    const char *ModulePath;
+
+    /* NOTE(koekeishiya): Set with -audio, for a single instance only. */
+    chip8_audio *Audio;
+
+    /* NOTE(koekeishiya): Set with -export, for a single instance only. */
+    chip8_export *Export;
+
+    /* NOTE(koekeishiya): Set with -latency, for a single instance only. LatencyKeys are
+     * the keys to press, as hex digits. */
+    const char *LatencyKeys;
+    chip8_latency *Latency;
+    chip8_latency_stats *LatencyStats;
+};
+
+global_variable std::atomic<int> NextJob;
+
+internal unsigned long long
+GetTimeNanos()
+{
+    using namespace std::chrono;
+    return (duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())).count();
+}
+
+internal void
+Fatal(const char *Format, ...)
+{
+    va_list Args;
+    va_start(Args, Format);
+    vfprintf(stderr, Format, Args);
+    va_end(Args);
+    exit(1);
+}
+
+/* NOTE(koekeishiya): Render the buzzer for one emulated frame into the wav file. Nothing
+ * runs in real time here, so events are stamped with emulated time and the samples of
+ * every frame are pulled right after it ran. */
+internal void
+RenderAudioFrame(chip8_audio *Audio, bool Sounding, bool *Buzzer, unsigned long long Frame)
+{
+    if(Sounding != *Buzzer)
+    {
+        Chip8AudioPush(Audio, Sounding, Frame * NANOS_PER_FRAME);
+        *Buzzer = Sounding;
+    }
+
+    Chip8AudioPull(Audio, CHIP8_AUDIO_RATE / 60);
+}
+
+/* NOTE(koekeishiya): Press each key of -latency in turn and release it again, changing
+ * keys between frames like the frontend does. Changes are stamped with emulated time. */
+internal void
+PressSyntheticKeys(headless_options *Options, chip8 *Processor, unsigned long long Frame)
+{
+    if(Frame % LATENCY_HOLD_FRAMES != 0)
+        return;
+
+    unsigned long long Step = Frame / LATENCY_HOLD_FRAMES;
+    char Digit = Options->LatencyKeys[(Step / 2) % strlen(Options->LatencyKeys)];
+    int Key = Digit <= '9' ? Digit - '0' : (Digit | 0x20) - 'a' + 10;
+    unsigned char Pressed = (Step & 1) == 0;
+
+    if(Processor->Key[Key] != Pressed)
+    {
+        Processor->Key[Key] = Pressed;
+        Chip8LatencyKeys(Options->Latency, 1u << Key, Frame * NANOS_PER_FRAME);
+    }
+}
+
+internal void
+RunInstance(headless_instance *Instance, headless_options *Options)
+{
+    chip8 *Processor = &Instance->Processor;
+    unsigned long long Remaining = Options->Cycles;
+
+    chip8_rewind Rewind = {};
+    if(Options->Rewind && !Chip8RewindCreate(&Rewind, 4 << 20, 60 * 60 * 10, 60))
+        Fatal("Failed to create rewind buffer\n");
+
+    bool Buzzer = false;
+    unsigned long long Frames = 0;
+
+    /* NOTE(koekeishiya): Timers count at 60 Hz, so they are ticked once every
+     * InstructionsPerFrame cycles rather than being tied to wall-clock time. */
+    while(Remaining > 0)
+    {
+        unsigned long long Frame = Options->InstructionsPerFrame;
+        if(Frame > Remaining)
+            Frame = Remaining;
+
+        if(Options->Latency)
+            PressSyntheticKeys(Options, Processor, Frames);
+
+        chip8_idle Idle = {};
+        if(Options->SkipIdle)
+        {
+            unsigned int MaxPeriod = Frame / 2 < CHIP8_IDLE_MAX_PERIOD ? Frame / 2 : CHIP8_IDLE_MAX_PERIOD;
+            Idle = Chip8DetectIdle(Processor, MaxPeriod);
+        }
+
+        if((Idle.Type == Chip8Idle_Halt || Idle.Type == Chip8Idle_Key) && !Options->Rewind)
+        {
+            /* NOTE(koekeishiya): Keys never change here and the loop does not read the delay
+             * timer, so it keeps going until the end of the run. Execute what is needed to
+             * land in the right place in the loop, then apply all remaining timer ticks. */
+            unsigned long long Ticks = (Remaining + Options->InstructionsPerFrame - 1) / Options->InstructionsPerFrame;
+            unsigned long long Run = Chip8IdleCycles(&Idle, Remaining);
+            Chip8EngineRun(&Instance->Engine, Processor, Run);
+            Instance->IdleCycles += Remaining - Run;
+
+            Processor->DelayTimer = Ticks < Processor->DelayTimer ? Processor->DelayTimer - Ticks : 0;
+            Processor->SoundTimer = Ticks < Processor->SoundTimer ? Processor->SoundTimer - Ticks : 0;
+            break;
+        }
+
+        unsigned long long Run = Idle.Type == Chip8Idle_Timer ? Chip8IdleCycles(&Idle, Frame) : Frame;
+        if(Options->Latency)
+            Chip8LatencyRun(Options->Latency, &Instance->Engine, Processor, Run, Frames * NANOS_PER_FRAME);
+        else
+            Chip8EngineRun(&Instance->Engine, Processor, Run);
+
+        if(Options->Audio)
+            RenderAudioFrame(Options->Audio, Processor->SoundTimer > 0, &Buzzer, Frames);
+
+        Chip8TickTimers(Processor);
+        Instance->IdleCycles += Frame - Run;
+        Remaining -= Frame;
+        ++Frames;
+
+        /* NOTE(koekeishiya): There is no display, so a trace ends where it is drawn and the
+         * total covers observe and draw only. */
+        if(Options->Latency)
+        {
+            Chip8LatencyFrame(Options->Latency, Processor, Frames * NANOS_PER_FRAME);
+            Chip8LatencyRecord(Options->LatencyStats, &Options->Latency->Drawn, Options->Latency->Drawn.Drawn);
+        }
+
+        if(Options->Export)
+            Chip8ExportFrame(Options->Export, Processor->Graphics, Options->Cycles - Remaining);
+
+        if(Options->Rewind)
+            Chip8RewindPush(&Rewind, Processor);
+    }
+
+    if(Options->Rewind)
+    {
+        /* NOTE(koekeishiya): Scrub through the whole history into a scratch processor to
+         * measure the cost of restoring, then check that the newest frame matches. */
+        chip8 *Scratch = (chip8 *) malloc(sizeof(chip8));
+        *Scratch = *Processor;
+
+        unsigned int Count = Chip8RewindCount(&Rewind);
+        unsigned long long Start = GetTimeNanos();
+        for(unsigned int Age = 0; Age < Count; ++Age)
+            Chip8RewindRestore(&Rewind, Age, Scratch);
+
+        Instance->RestoreNanos = GetTimeNanos() - Start;
+        Instance->Restores = Count;
+
+        if(Count && Chip8RewindRestore(&Rewind, 0, Scratch))
+        {
+            Scratch->DirtyRows = Processor->DirtyRows;
+            if(memcmp(Scratch, Processor, sizeof(chip8)) != 0)
+                Fatal("%s #%d: rewind restored a different state\n", Instance->Rom, Instance->Copy);
+        }
+
+        Instance->RewindStats = Rewind.Stats;
+        Chip8RewindDestroy(&Rewind);
+        free(Scratch);
+    }
+
+    Instance->Cycles = Options->Cycles;
+}
+
+internal void
+RunExtended(headless_instance *Instance, headless_options *Options)
+{
+    chip8_extended *Processor = Instance->Extended;
+    unsigned long long Remaining = Options->Cycles;
+    bool Buzzer = false;
+    unsigned long long Frames = 0;
+    while(Remaining > 0)
+    {
+        unsigned long long Frame = Options->InstructionsPerFrame;
+        if(Frame > Remaining)
+            Frame = Remaining;
+
+        Chip8ExtendedRunCycles(Processor, Frame);
+        if(Options->Audio)
+            RenderAudioFrame(Options->Audio, Processor->SoundTimer > 0, &Buzzer, Frames++);
+
+        Chip8ExtendedTickTimers(Processor);
+        Remaining -= Frame;
+
+        if(Options->Export)
+            Chip8ExportFrame(Options->Export, &Processor->Planes[0][0][0], Options->Cycles - Remaining);
+    }
+
+    Instance->Cycles = Options->Cycles;
+}
+
+internal void
+RunReplay(headless_instance *Instance, headless_options *Options)
+{
+    Instance->Replay = Chip8InputReplay(Options->Replay, &Instance->Engine, &Instance->Processor, Options->SkipIdle);
+    Instance->Cycles = Instance->Replay.Cycles;
+    Instance->IdleCycles = Instance->Replay.IdleCycles;
+}
+
+internal void
+RunBatch(headless_instance *Instances, headless_job *Job, headless_options *Options)
+{
+    chip8_batch *Batch = Chip8BatchCreate();
+    if(!Batch)
+        Fatal("Failed to create batch\n");
+
+    Chip8BatchSetSkipIdle(Batch, Options->SkipIdle);
+
+    /* NOTE(koekeishiya): A job only holds copies of one rom, which all share its quirks. */
+    for(int Lane = 0; Lane < Job->Count; ++Lane)
+    {
+        if(!Chip8BatchSetLane(Batch, Lane, &Instances[Lane].Processor))
+            Fatal("%s: every lane of a batch needs the same quirks\n", Instances[Lane].Rom);
+    }
+
+    unsigned long long Remaining = Options->Cycles;
+    while(Remaining > 0)
+    {
+        unsigned long long Frame = Options->InstructionsPerFrame;
+        if(Frame > Remaining)
+            Frame = Remaining;
+
+        Chip8BatchRun(Batch, Frame);
+        Chip8BatchTickTimers(Batch);
+        Remaining -= Frame;
+    }
+
+    for(int Lane = 0; Lane < Job->Count; ++Lane)
+    {
+        Chip8BatchGetLane(Batch, Lane, &Instances[Lane].Processor);
+        Instances[Lane].Cycles = Options->Cycles;
+    }
+
+    Job->BatchStats = Chip8BatchGetStats(Batch);
+    Chip8BatchDestroy(Batch);
+}
+
+internal void
+WorkerThread(std::vector<headless_instance> *Instances, std::vector<headless_job> *Jobs,
+             headless_options *Options)
+{
+    for(;;)
+    {
+        int Index = NextJob.fetch_add(1, std::memory_order_relaxed);
+        if(Index >= (int)Jobs->size())
+            break;
+
+        headless_job *Job = &(*Jobs)[Index];
+        if(Options->Batch)
+            RunBatch(&(*Instances)[Job->First], Job, Options);
+        else if(Options->Extended)
+            RunExtended(&(*Instances)[Job->First], Options);
+        else if(Options->Replay)
+            RunReplay(&(*Instances)[Job->First], Options);
+        else
+            RunInstance(&(*Instances)[Job->First], Options);
+
+#ifdef CHIP8_PROFILE
+        if(Options->ProfilePath)
+            Chip8ProfileEnd((*Instances)[Job->First].Profile);
+#endif
+    }
+}
+
+internal void
+PrintExtendedInstance(headless_instance *Instance)
+{
+    chip8_extended *Processor = Instance->Extended;
+    printf("%s #%d: pc=0x%04X i=0x%04X sp=%d dt=%d st=%d %s planes=%X v=",
+           Instance->Rom, Instance->Copy, Processor->Pc, Processor->I, Processor->Sp,
+           Processor->DelayTimer, Processor->SoundTimer, Processor->HighRes ? "hires" : "lores",
+           Processor->PlaneMask);
+
+    for(int Index = 0; Index < 16; ++Index)
+        printf("%02X", Processor->V[Index]);
+
+    printf(" hash=%016llx\n", Chip8ExtendedGraphicsHash(Processor));
+}
+
+internal void
+PrintInstance(headless_instance *Instance)
+{
+    if(Instance->Extended)
+    {
+        PrintExtendedInstance(Instance);
+        return;
+    }
+
+    chip8 *Processor = &Instance->Processor;
+    printf("%s #%d: pc=0x%03X i=0x%03X sp=%d dt=%d st=%d v=",
+           Instance->Rom, Instance->Copy, Processor->Pc, Processor->I,
+           Processor->Sp, Processor->DelayTimer, Processor->SoundTimer);
+
+    for(int Index = 0; Index < 16; ++Index)
+        printf("%02X", Processor->V[Index]);
+
+    printf(" hash=%016llx\n", Chip8GraphicsHash(Processor));
+}
+
+internal void
+PrintUsage()
+{
+    Fatal("Usage: chip8-headless [-threads N] [-copies N] [-cycles N] [-ipf N] [-seed S] [-engine E] [-quirks Q] [-extended] [-no-idle] [-rewind] [-replay log] [-profile json] [-aot module] [-audio wav] [-export file] [-latency keys] rom [rom ...]\n"
+          "  every rom can also be a directory of roms or an archive made by chip8-pack\n"
+          "  -threads N  worker threads (default: all cores)\n"
+          "  -copies N   instances per rom (default: 1)\n"
+          "  -cycles N   cycles to run per instance (default: 1000000)\n"
+          "  -ipf N      instructions per 60 Hz timer tick (default: 10)\n"
+          "  -seed S     random seed, instance k is seeded with S + k (default: 0)\n"
+          "  -engine E   interpreter, cached, fused, jit, jit-lockstep, aot or batch\n"
+          "              (default: interpreter)\n"
+          "  -quirks Q   default, chip8, chip48, schip or xochip for every rom (default: the\n"
+          "              profile the catalogue records for the rom, otherwise default)\n"
+          "  -extended   run on the SUPER-CHIP/XO-CHIP machine with 64 KB and a 128x64\n"
+          "              display; interpreter only\n"
+          "  -no-idle    execute idle loops instead of fast-forwarding through them\n"
+          "  -rewind     record every frame into a rewind buffer and report its cost\n"
+          "  -replay L   replay an input log recorded by chip8 -record, checking its hashes;\n"
+          "              the seed, -ipf and -quirks come from the log, -cycles is ignored\n"
+          "  -profile J  print an opcode and hot spot profile, and write it to J as JSON;\n"
+          "              needs a build with -DCHIP8_PROFILE (make headless-profile)\n"
+          "  -aot M      run with the aot engine, using the module M built by make aot\n"
+          "  -audio W    write the buzzer of a single instance to the wav file W, at 60\n"
+          "              emulated frames per second of audio; disables idle fast-forward\n"
+          "  -export F   write every changed frame of a single instance to F (or the Unix\n"
+          "              domain socket P with unix:P), for chip8-frames\n"
+          "  -latency K  press and release the keys K (hex digits, e.g. 46) in turn on a single\n"
+          "              instance and report how long the rom takes to read and draw them,\n"
+          "              in emulated time; disables idle fast-forward\n");
+}
+
+int main(int argc, char **argv)
+{
+    headless_options Options;
+    Options.Threads = std::thread::hardware_concurrency();
+    Options.Copies = 1;
+    Options.InstructionsPerFrame = 10;
+    Options.Cycles = 1000000;
+    Options.Seed = 0;
+    Options.Engine = Chip8Engine_Interpreter;
+    Options.Quirks = Chip8Quirks_Default;
+    Options.QuirksForced = false;
+    Options.Batch = false;
+    Options.Extended = false;
+    Options.SkipIdle = true;
+    Options.Rewind = false;
+    Options.Replay = NULL;
+    Options.ProfilePath = NULL;
+    Options.ModulePath = NULL;
+    Options.Audio = NULL;
+    Options.Export = NULL;
+    Options.LatencyKeys = NULL;
+    Options.Latency = NULL;
+    Options.LatencyStats = NULL;
+
+    chip8_input_log Log;
+    const char *ReplayPath = NULL;
+    const char *EngineName = NULL;
+    const char *AudioPath = NULL;
+    const char *ExportPath = NULL;
+
+    std::vector<const char *> Roms;
+    for(int Index = 1; Index < argc; ++Index)
+    {
+        const char *Arg = argv[Index];
+        bool HasValue = Index + 1 < argc;
+
+        if(strcmp(Arg, "-threads") == 0 && HasValue)
+            Options.Threads = atoi(argv[++Index]);
+        else if(strcmp(Arg, "-copies") == 0 && HasValue)
+            Options.Copies = atoi(argv[++Index]);
+        else if(strcmp(Arg, "-cycles") == 0 && HasValue)
+            Options.Cycles = strtoull(argv[++Index], NULL, 10);
+        else if(strcmp(Arg, "-ipf") == 0 && HasValue)
+            Options.InstructionsPerFrame = atoi(argv[++Index]);
+        else if(strcmp(Arg, "-seed") == 0 && HasValue)
+            Options.Seed = strtoull(argv[++Index], NULL, 10);
+        else if(strcmp(Arg, "-engine") == 0 && HasValue)
+        {
+            EngineName = argv[++Index];
+            Options.Batch = strcmp(EngineName, "batch") == 0;
+            if(!Options.Batch && !Chip8EngineFromName(EngineName, &Options.Engine))
+                PrintUsage();
+        }
+        else if(strcmp(Arg, "-quirks") == 0 && HasValue)
+        {
+            if(!Chip8QuirksFromName(argv[++Index], &Options.Quirks))
+                PrintUsage();
+            Options.QuirksForced = true;
+        }
+        else if(strcmp(Arg, "-extended") == 0)
+            Options.Extended = true;
+        else if(strcmp(Arg, "-no-idle") == 0)
+            Options.SkipIdle = false;
+        else if(strcmp(Arg, "-rewind") == 0)
+            Options.Rewind = true;
+        else if(strcmp(Arg, "-replay") == 0 && HasValue)
+            ReplayPath = argv[++Index];
+        else if(strcmp(Arg, "-profile") == 0 && HasValue)
+            Options.ProfilePath = argv[++Index];
+        else if(strcmp(Arg, "-aot") == 0 && HasValue)
+            Options.ModulePath = argv[++Index];
+        else if(strcmp(Arg, "-audio") == 0 && HasValue)
+            AudioPath = argv[++Index];
+        else if(strcmp(Arg, "-export") == 0 && HasValue)
+            ExportPath = argv[++Index];
+        else if(strcmp(Arg, "-latency") == 0 && HasValue)
+        {
+            Options.LatencyKeys = argv[++Index];
+            if(!*Options.LatencyKeys || strspn(Options.LatencyKeys, "0123456789abcdefABCDEF") != strlen(Options.LatencyKeys))
+                PrintUsage();
+        }
+        else if(Arg[0] == '-')
+            PrintUsage();
+        else
+            Roms.push_back(Arg);
+    }
+
+    if(Roms.empty() || Options.Copies < 1 || Options.InstructionsPerFrame < 1)
+        PrintUsage();
+
+    /* NOTE(koekeishiya): -aot picks the engine, so it only goes together with -engine aot
+     * and never silently overrides, or is overridden by, another choice. */
+    if(Options.ModulePath)
+    {
+        if(Options.Batch || (EngineName && Options.Engine != Chip8Engine_Aot))
+            Fatal("-aot runs the aot engine and can not be combined with -engine %s\n", EngineName);
+
+        Options.Engine = Chip8Engine_Aot;
+    }
+
+    if(Options.Engine == Chip8Engine_Aot && !Options.ModulePath)
+        Fatal("the aot engine needs a module, see -aot\n");
+
+    if(Options.Rewind && Options.Batch)
+        Fatal("-rewind is not supported with the batch engine\n");
+
+    if(Options.Extended && (Options.Batch || Options.Engine != Chip8Engine_Interpreter || Options.Rewind ||
+                            ReplayPath || Options.ProfilePath))
+        Fatal("-extended only runs on the interpreter, without -rewind, -replay or -profile\n");
+
+    /* NOTE(koekeishiya): The extended machine never fast-forwards, and -audio and -latency
+     * observe every frame, timer idle loops included. */
+    if(Options.Extended || AudioPath || Options.LatencyKeys)
+        Options.SkipIdle = false;
+
+#ifdef CHIP8_PROFILE
+    if(Options.ProfilePath && Options.Batch)
+        Fatal("-profile is not supported with the batch engine\n");
+
+    if(Options.ProfilePath && Options.Engine != Chip8Engine_Interpreter)
+        fprintf(stderr, "warning: the %s engine bypasses Chip8DoCycle for most instructions, which are not profiled\n",
+                Chip8EngineName(Options.Engine));
+#else
+    if(Options.ProfilePath)
+        Fatal("-profile needs a build with -DCHIP8_PROFILE, see make headless-profile\n");
+#endif
+
+    if(ReplayPath)
+    {
+        if(Options.Batch || Options.Rewind)
+            Fatal("-replay can not be combined with -rewind or the batch engine\n");
+
+        if(!Chip8InputLoad(&Log, ReplayPath))
+            Fatal("Failed to load input log: %s\n", ReplayPath);
+
+        Options.Replay = &Log;
+        Options.InstructionsPerFrame = Log.Header.InstructionsPerFrame;
+        Options.Quirks = Log.Header.Quirks;
+        Options.QuirksForced = true;
+    }
+
+    if((AudioPath || ExportPath) && (Options.Batch || Options.Replay))
+        Fatal("-audio and -export can not be combined with -replay or the batch engine\n");
+
+    if(Options.LatencyKeys && (Options.Batch || Options.Replay || Options.Extended))
+        Fatal("-latency can not be combined with -replay, -extended or the batch engine\n");
+
+    if(Options.Threads < 1)
+        Options.Threads = 1;
+
+    /* NOTE(koekeishiya): Every rom is mapped once and each instance copies from the image,
+     * so thousands of roms or copies do not mean thousands of reads. */
+    unsigned long long StartupTime = GetTimeNanos();
+
+    chip8_catalogue Catalogue;
+    Chip8CatalogueCreate(&Catalogue);
+    for(size_t Index = 0; Index < Roms.size(); ++Index)
+    {
+        if(!Chip8CatalogueAdd(&Catalogue, Roms[Index]))
+            Fatal("Failed to load rom: %s\n", Roms[Index]);
+    }
+
+    for(unsigned int Index = 0; Index < Catalogue.SkippedCount; ++Index)
+        fprintf(stderr, "Skipped %s: it %s\n", Catalogue.Skipped[Index].Path, Catalogue.Skipped[Index].Reason);
+
+    if(Catalogue.Count == 0)
+        Fatal("No roms found\n");
+
+    std::vector<headless_instance> Instances((size_t) Catalogue.Count * Options.Copies);
+    for(size_t RomIndex = 0; RomIndex < Catalogue.Count; ++RomIndex)
+    {
+        chip8_rom *Rom = Catalogue.Roms + RomIndex;
+        chip8_quirks Quirks = Options.Quirks;
+        if(!Options.QuirksForced)
+            Chip8CatalogueGetQuirks(&Catalogue, Rom, &Quirks);
+
+        for(int Copy = 0; Copy < Options.Copies; ++Copy)
+        {
+            size_t InstanceIndex = RomIndex * Options.Copies + Copy;
+            headless_instance *Instance = &Instances[InstanceIndex];
+            Instance->Rom = Rom->Name;
+            Instance->Copy = Copy;
+            Instance->Cycles = 0;
+            Instance->IdleCycles = 0;
+            Instance->RewindStats = chip8_rewind_stats();
+            Instance->RestoreNanos = 0;
+            Instance->Restores = 0;
+            Instance->Extended = NULL;
+
+            if(Options.Extended)
+            {
+                Instance->Extended = (chip8_extended *) malloc(sizeof(chip8_extended));
+                if(!Instance->Extended)
+                    Fatal("Failed to allocate extended machine\n");
+
+                Chip8ExtendedInitialize(Instance->Extended);
+                Chip8ExtendedSetQuirks(Instance->Extended, Quirks);
+                Chip8ExtendedSeed(Instance->Extended, Options.Seed + InstanceIndex);
+                if(!Chip8ExtendedLoadRomImage(Instance->Extended, Rom->Data, Rom->Size))
+                    Fatal("%s is %u bytes, only %d fit in the extended machine\n", Instance->Rom, Rom->Size, EXTENDED_ROM_CAPACITY);
+            }
+
+            Chip8Initialize(&Instance->Processor);
+            Chip8SetQuirks(&Instance->Processor, Quirks);
+            Chip8Seed(&Instance->Processor, Options.Replay ? Options.Replay->Header.Seed : Options.Seed + InstanceIndex);
+            if(!Options.Extended && !Chip8LoadRomImage(&Instance->Processor, Rom->Data, Rom->Size))
+                Fatal("%s is %u bytes, only %d fit in a chip8, see -extended\n", Instance->Rom, Rom->Size, CHIP8_ROM_CAPACITY);
+
+            if(Options.Replay && Rom->Hash != Options.Replay->Header.RomHash)
+                Fatal("%s is not the rom the input log was recorded with\n", Instance->Rom);
+
+            if(!Options.Batch && !Chip8EngineCreate(&Instance->Engine, Options.Engine))
+                Fatal("Failed to create %s engine\n", Chip8EngineName(Options.Engine));
+
+            if(Options.ModulePath && !Chip8EngineLoadModule(&Instance->Engine, Options.ModulePath))
+                Fatal("Failed to load module: %s\n", Options.ModulePath);
+
+#ifdef CHIP8_PROFILE
+            Instance->Profile = NULL;
+            if(Options.ProfilePath)
+            {
+                Instance->Profile = (chip8_profile *) malloc(sizeof(chip8_profile));
+                if(!Instance->Profile)
+                    Fatal("Failed to allocate profile\n");
+
+                Chip8ProfileBegin(Instance->Profile);
+                Instance->Processor.Profile = Instance->Profile;
+            }
+#endif
+        }
+    }
+
+    StartupTime = GetTimeNanos() - StartupTime;
+
+    chip8_audio Audio;
+    if(AudioPath)
+    {
+        if(Instances.size() != 1)
+            Fatal("-audio writes the buzzer of a single instance, not %zu\n", Instances.size());
+
+        if(!Chip8AudioOpen(&Audio, Chip8Audio_Wav, AudioPath))
+            Fatal("Failed to open %s\n", AudioPath);
+
+        Options.Audio = &Audio;
+    }
+
+    /* NOTE(koekeishiya): Not started, so every frame is written and none dropped. */
+    if(ExportPath)
+    {
+        if(Instances.size() != 1)
+            Fatal("-export writes the frames of a single instance, not %zu\n", Instances.size());
+
+        Options.Export = Options.Extended ? Chip8ExportOpen(ExportPath, EXTENDED_PLANES, EXTENDED_WIDTH, EXTENDED_HEIGHT)
+                                          : Chip8ExportOpen(ExportPath, 1, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+        if(!Options.Export)
+            Fatal("Failed to open %s for exporting frames\n", ExportPath);
+    }
+
+    chip8_latency Latency;
+    chip8_latency_stats LatencyStats = {};
+    if(Options.LatencyKeys)
+    {
+        if(Instances.size() != 1)
+            Fatal("-latency measures a single instance, not %zu\n", Instances.size());
+
+        Chip8LatencyInit(&Latency, (double) NANOS_PER_FRAME / Options.InstructionsPerFrame);
+        Options.Latency = &Latency;
+        Options.LatencyStats = &LatencyStats;
+    }
+
+    std::vector<headless_job> Jobs;
+    for(size_t RomIndex = 0; RomIndex < Catalogue.Count; ++RomIndex)
+    {
+        int Step = Options.Batch ? CHIP8_BATCH_LANES : 1;
+        for(int Copy = 0; Copy < Options.Copies; Copy += Step)
+        {
+            headless_job Job = {};
+            Job.First = RomIndex * Options.Copies + Copy;
+            Job.Count = Options.Copies - Copy < Step ? Options.Copies - Copy : Step;
+            Jobs.push_back(Job);
+        }
+    }
+
+    if(Options.Threads > (int)Jobs.size())
+        Options.Threads = Jobs.size();
+
+    unsigned long long StartTime = GetTimeNanos();
+
+    std::vector<std::thread> Workers;
+    for(int Index = 0; Index < Options.Threads; ++Index)
+        Workers.push_back(std::thread(WorkerThread, &Instances, &Jobs, &Options));
+
+    for(size_t Index = 0; Index < Workers.size(); ++Index)
+        Workers[Index].join();
+
+    unsigned long long ElapsedTime = GetTimeNanos() - StartTime;
+
+    if(Options.Audio)
+        Chip8AudioClose(Options.Audio);
+
+    chip8_export_stats ExportStats = {};
+    if(Options.Export)
+        ExportStats = Chip8ExportClose(Options.Export);
+
+    unsigned long long TotalCycles = 0;
+    unsigned long long IdleCycles = 0;
+    for(size_t Index = 0; Index < Instances.size(); ++Index)
+    {
+        PrintInstance(&Instances[Index]);
+        TotalCycles += Instances[Index].Cycles;
+        IdleCycles += Instances[Index].IdleCycles;
+    }
+
+    for(size_t Index = 0; Index < Jobs.size(); ++Index)
+        IdleCycles += Jobs[Index].BatchStats.IdleLaneSteps;
+
+    if(Options.Engine == Chip8Engine_Fused && !Options.Batch)
+    {
+        chip8_cache_stats Total = {};
+        unsigned long long Executed = 0;
+        for(size_t Index = 0; Index < Instances.size(); ++Index)
+        {
+            chip8_cache_stats Stats = Chip8CacheGetStats(Instances[Index].Engine.Cache);
+            Total.FusedDispatches += Stats.FusedDispatches;
+            Total.FusedCycles += Stats.FusedCycles;
+            for(int Sequence = 0; Sequence < Chip8Fused_Count; ++Sequence)
+                Total.Sequences[Sequence] += Stats.Sequences[Sequence];
+            Executed += Instances[Index].Cycles - Instances[Index].IdleCycles;
+        }
+
+        printf("fused: %llu fused dispatches covering %llu cycles, %.1f%% of executed cycles\n",
+               Total.FusedDispatches, Total.FusedCycles, Executed ? 100.0 * Total.FusedCycles / Executed : 0.0);
+        for(int Sequence = 0; Sequence < Chip8Fused_Count; ++Sequence)
+        {
+            printf("fused: %-20s %llu dispatches\n", Chip8CacheSequenceName((chip8_fused_sequence) Sequence),
+                   Total.Sequences[Sequence]);
+        }
+    }
+
+    if(Options.ModulePath)
+    {
+        chip8_aot_stats Total = {};
+        for(size_t Index = 0; Index < Instances.size(); ++Index)
+        {
+            chip8_aot_stats Stats = Chip8AotGetStats(Instances[Index].Engine.Aot);
+            Total.NativeCycles += Stats.NativeCycles;
+            Total.InterpretedCycles += Stats.InterpretedCycles;
+            Total.BlocksInvalidated += Stats.BlocksInvalidated;
+        }
+
+        unsigned long long Executed = Total.NativeCycles + Total.InterpretedCycles;
+        printf("aot: %s, %.1f%% of executed cycles recompiled, %llu blocks invalidated\n",
+               Chip8AotName(Instances[0].Engine.Aot), Executed ? 100.0 * Total.NativeCycles / Executed : 0.0,
+               Total.BlocksInvalidated);
+    }
+
+    for(size_t Index = 0; Index < Instances.size(); ++Index)
+    {
+        Chip8EngineDestroy(&Instances[Index].Engine);
+        free(Instances[Index].Extended);
+    }
+
+    /* NOTE(koekeishiya): Fast-forwarded cycles are never executed, so they only count
+     * towards the effective rate, which says how fast emulated time passes. */
+    double Seconds = ElapsedTime / 1E9;
+    unsigned long long ExecutedCycles = TotalCycles - IdleCycles;
+    printf("%zu instances, %d threads, %s engine, %llu cycles executed in %.3fs: %.0f instructions/sec\n",
+           Instances.size(), Options.Threads, Options.Batch ? "batch" : Chip8EngineName(Options.Engine),
+           ExecutedCycles, Seconds, Seconds > 0 ? ExecutedCycles / Seconds : 0.0);
+
+    if(Options.SkipIdle)
+    {
+        printf("idle: %.1f%% of %llu cycles fast-forwarded, effective emulated rate %.0f cycles/sec\n",
+               TotalCycles ? 100.0 * IdleCycles / TotalCycles : 0.0, TotalCycles,
+               Seconds > 0 ? TotalCycles / Seconds : 0.0);
+    }
+
+    printf("startup: %u roms, %.1f KB read or mapped, %u quirk profiles, %zu instances ready in %.3fs\n",
+           Catalogue.Count, Catalogue.Bytes / 1024.0, Catalogue.ProfileCount, Instances.size(),
+           StartupTime / 1E9);
+
+    if(Options.Audio)
+    {
+        chip8_audio_stats Stats = Chip8AudioGetStats(Options.Audio);
+        printf("audio: %s, %.1fs, %llu buzzer changes\n", AudioPath, (double) Stats.Frames / CHIP8_AUDIO_RATE, Stats.Events);
+    }
+
+    if(ExportPath)
+    {
+        printf("export: %s, %llu frames, %.1f bytes/frame\n", ExportPath, ExportStats.Written,
+               ExportStats.Written ? (double) ExportStats.Bytes / ExportStats.Written : 0.0);
+        if(ExportStats.Failed)
+            Fatal("Failed to write %s\n", ExportPath);
+    }
+
+    if(Options.Latency)
+    {
+        printf("latency: keys %s, %llu key changes, %llu drawn, %llu not read, %llu not drawn, %llu superseded\n",
+               Options.LatencyKeys, Latency.Started, LatencyStats.Count, Latency.Unobserved, Latency.Undrawn,
+               Latency.Superseded);
+        for(int Stage = 0; Stage < Chip8Latency_StageCount && LatencyStats.Count; ++Stage)
+        {
+            if(Stage == Chip8Latency_Present)
+            {
+                printf("  %-8s n/a, no display\n", Chip8LatencyStageName((chip8_latency_stage) Stage));
+                continue;
+            }
+
+            printf("  %-8s p50 %.2f ms, p99 %.2f ms\n", Chip8LatencyStageName((chip8_latency_stage) Stage),
+                   Chip8LatencyPercentile(&LatencyStats, (chip8_latency_stage) Stage, 50) / 1E6,
+                   Chip8LatencyPercentile(&LatencyStats, (chip8_latency_stage) Stage, 99) / 1E6);
+        }
+    }
+
+#ifdef CHIP8_PROFILE
+    if(Options.ProfilePath)
+    {
+        chip8_profile *Total = (chip8_profile *) malloc(sizeof(chip8_profile));
+        Chip8ProfileBegin(Total);
+        for(size_t Index = 0; Index < Instances.size(); ++Index)
+        {
+            Chip8ProfileMerge(Total, Instances[Index].Profile);
+            free(Instances[Index].Profile);
+        }
+
+        Chip8ProfileWriteText(Total, stdout);
+
+        FILE *File = fopen(Options.ProfilePath, "w");
+        if(!File)
+            Fatal("Failed to write profile: %s\n", Options.ProfilePath);
+
+        Chip8ProfileWriteJson(Total, File);
+        fclose(File);
+        free(Total);
+    }
+#endif
+
+    if(Options.Replay)
+    {
+        int Failed = 0;
+        for(size_t Index = 0; Index < Instances.size(); ++Index)
+        {
+            chip8_replay_result *Replay = &Instances[Index].Replay;
+            if(Replay->Mismatches)
+            {
+                printf("%s #%d: %llu of %llu checkpoints differ, first at cycle %llu\n",
+                       Instances[Index].Rom, Instances[Index].Copy, Replay->Mismatches,
+                       Replay->Checkpoints, Replay->FirstMismatch);
+                ++Failed;
+            }
+        }
+
+        chip8_replay_result *First = &Instances[0].Replay;
+        double Realtime = (double)First->Cycles / Options.InstructionsPerFrame / 60.0;
+        printf("replay: %llu keys, %llu checkpoints, %.1fs of play per instance, %.0fx realtime, %d of %zu instances diverged\n",
+               First->Keys, First->Checkpoints, Realtime,
+               Seconds > 0 ? Realtime * Instances.size() / Seconds : 0.0, Failed, Instances.size());
+
+        Chip8InputFree(&Log);
+        if(Failed)
+            return 1;
+    }
+
+    if(Options.Rewind)
+    {
+        chip8_rewind_stats Total = {};
+        unsigned long long RestoreNanos = 0, Restores = 0;
+        for(size_t Index = 0; Index < Instances.size(); ++Index)
+        {
+            chip8_rewind_stats *Stats = &Instances[Index].RewindStats;
+            Total.Pushes += Stats->Pushes;
+            Total.Keyframes += Stats->Keyframes;
+            Total.KeyframeBytes += Stats->KeyframeBytes;
+            Total.DeltaBytes += Stats->DeltaBytes;
+            Total.PushNanos += Stats->PushNanos;
+            if(Stats->MaxPushNanos > Total.MaxPushNanos)
+                Total.MaxPushNanos = Stats->MaxPushNanos;
+            RestoreNanos += Instances[Index].RestoreNanos;
+            Restores += Instances[Index].Restores;
+        }
+
+        printf("rewind: %llu frames, %llu keyframes, %.0f bytes/frame, snapshot %.0f ns avg, %llu ns max, restore %.0f ns avg\n",
+               Total.Pushes, Total.Keyframes,
+               Total.Pushes ? (double)(Total.KeyframeBytes + Total.DeltaBytes) / Total.Pushes : 0.0,
+               Total.Pushes ? (double)Total.PushNanos / Total.Pushes : 0.0, Total.MaxPushNanos,
+               Restores ? (double)RestoreNanos / Restores : 0.0);
+    }
+
+    if(Options.Batch)
+    {
+        /* NOTE(koekeishiya): Occupancy is the average fraction of the lanes of a batch that
+         * took part in a vector step, scalar is the share of lane-steps run one at a time. */
+        double VectorSteps = 0, VectorLaneSteps = 0, ScalarLaneSteps = 0, Capacity = 0;
+        for(size_t Index = 0; Index < Jobs.size(); ++Index)
+        {
+            chip8_batch_stats *Stats = &Jobs[Index].BatchStats;
+            VectorSteps += Stats->VectorSteps;
+            VectorLaneSteps += Stats->VectorLaneSteps;
+            ScalarLaneSteps += Stats->ScalarLaneSteps;
+            Capacity += (double)Stats->VectorSteps * Jobs[Index].Count;
+        }
+
+        double LaneSteps = VectorLaneSteps + ScalarLaneSteps;
+        printf("batch: %.0f vector steps, occupancy %.1f%%, scalar lane-steps %.1f%%\n",
+               VectorSteps, Capacity > 0 ? 100.0 * VectorLaneSteps / Capacity : 0.0,
+               LaneSteps > 0 ? 100.0 * ScalarLaneSteps / LaneSteps : 0.0);
+    }
+
+    Chip8CatalogueDestroy(&Catalogue);
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "chip8_catalogue.h"
+
+int main(int argc, char **argv)
+{
+    if(argc < 3)
+    {
+        fprintf(stderr, "Usage: chip8-pack output.ch8p path [path ...]\n"
+                        "       chip8-pack -list path [path ...]\n"
+                        "  packs rom files, directories of roms and other archives into one archive that\n"
+                        "  chip8-headless and chip8 map in one go, together with the quirk profiles from\n"
+                        "  any quirks.txt; -list prints the hash, profile, size and name of every rom\n");
+        return 1;
+    }
+
+    bool List = strcmp(argv[1], "-list") == 0;
+
+    chip8_catalogue Catalogue;
+    Chip8CatalogueCreate(&Catalogue);
+
+    for(int Index = 2; Index < argc; ++Index)
+    {
+        if(!Chip8CatalogueAdd(&Catalogue, argv[Index]))
+        {
+            fprintf(stderr, "Failed to read %s, or it is an empty rom, one larger than %d bytes or holds a bad quirks.txt\n",
+                    argv[Index], CHIP8_CATALOGUE_MAX_ROM);
+            return 1;
+        }
+    }
+
+    for(unsigned int Index = 0; Index < Catalogue.SkippedCount; ++Index)
+        fprintf(stderr, "Skipped %s: it %s\n", Catalogue.Skipped[Index].Path, Catalogue.Skipped[Index].Reason);
+
+    if(List)
+    {
+        for(unsigned int Index = 0; Index < Catalogue.Count; ++Index)
+        {
+            chip8_rom *Rom = Catalogue.Roms + Index;
+            chip8_quirks Quirks;
+            bool Known = Chip8CatalogueGetQuirks(&Catalogue, Rom, &Quirks);
+            printf("%016llx %-8s %6u %s\n", Rom->Hash, Known ? Chip8QuirksName(Quirks) : "-", Rom->Size, Rom->Name);
+        }
+    }
+    else if(!Chip8CatalogueWrite(&Catalogue, argv[1]))
+    {
+        fprintf(stderr, "Failed to write %s\n", argv[1]);
+        return 1;
+    }
+    else
+    {
+        printf("%s: %u roms, %u quirk profiles\n", argv[1], Catalogue.Count, Catalogue.ProfileCount);
+    }
+
+    Chip8CatalogueDestroy(&Catalogue);
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "chip8_aot.h"
+
+int main(int argc, char **argv)
+{
+    chip8_quirks Quirks = Chip8Quirks_Default;
+    int First = 1;
+    if(argc == 5 && strcmp(argv[1], "-quirks") == 0)
+    {
+        if(!Chip8QuirksFromName(argv[2], &Quirks))
+            argc = 0;
+        First = 3;
+    }
+
+    if(argc != First + 2)
+    {
+        fprintf(stderr, "Usage: chip8-recompile [-quirks default|chip8|chip48|schip|xochip] rom output.cpp\n"
+                        "  translates rom into C++ for the aot engine; build the output with\n"
+                        "  g++ -O2 -shared -fPIC -Isrc output.cpp -o module.so, or use make aot ROM=rom\n"
+                        "  the module only runs natively with the quirk profile it was built for\n");
+        return 1;
+    }
+
+    const char *RomPath = argv[First];
+    const char *OutputPath = argv[First + 1];
+
+    FILE *RomFile = fopen(RomPath, "rb");
+    if(!RomFile)
+    {
+        fprintf(stderr, "Failed to open rom: %s\n", RomPath);
+        return 1;
+    }
+
+    unsigned char Rom[0x1000];
+    unsigned int Length = (unsigned int) fread(Rom, 1, sizeof(Rom), RomFile);
+    fclose(RomFile);
+
+    if(Length == 0 || Length > 0x1000 - 0x200)
+    {
+        fprintf(stderr, "%s is not a chip-8 rom, it must be between 1 and %d bytes\n", RomPath, 0x1000 - 0x200);
+        return 1;
+    }
+
+    FILE *Output = fopen(OutputPath, "w");
+    if(!Output)
+    {
+        fprintf(stderr, "Failed to open output: %s\n", OutputPath);
+        return 1;
+    }
+
+    const char *Name = strrchr(RomPath, '/');
+    Name = Name ? Name + 1 : RomPath;
+
+    chip8_aot_translate_stats Stats;
+    bool Written = Chip8AotTranslate(Rom, Length, Name, Quirks, Output, &Stats);
+    Written = (fclose(Output) == 0) && Written;
+
+    if(!Written)
+    {
+        fprintf(stderr, "Failed to write %s\n", OutputPath);
+        return 1;
+    }
+
+    printf("%s: %u of %u instructions reachable in %u blocks, %u of %u indirect jumps resolved\n",
+           Name, Stats.Instructions, Length / 2, Stats.Blocks, Stats.ResolvedIndirect,
+           Stats.ResolvedIndirect + Stats.UnresolvedIndirect);
+    return 0;
+}